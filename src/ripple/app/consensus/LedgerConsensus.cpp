@@ -26,6 +26,7 @@
 #include <ripple/app/ledger/LedgerTiming.h>
 #include <ripple/app/ledger/LedgerToJson.h>
 #include <ripple/app/main/Application.h>
+#include <ripple/app/main/CollectorManager.h>
 #include <ripple/app/misc/AmendmentTable.h>
 #include <ripple/app/misc/CanonicalTXSet.h>
 #include <ripple/app/misc/IHashRouter.h>
@@ -37,12 +38,16 @@
 #include <ripple/core/Config.h>
 #include <ripple/core/JobQueue.h>
 #include <ripple/core/LoadFeeTrack.h>
+#include <ripple/core/ParallelFor.h>
 #include <ripple/json/to_string.h>
 #include <ripple/overlay/Overlay.h>
 #include <ripple/overlay/predicates.h>
+#include <ripple/protocol/Indexes.h>
 #include <ripple/protocol/STValidation.h>
 #include <ripple/protocol/UintTypes.h>
+#include <ripple/app/misc/DividendMaster.h>
 #include <ripple/app/misc/DividendVote.h>
+#include <algorithm>
 
 namespace ripple {
 
@@ -105,6 +110,10 @@ public:
         , mHaveCloseTimeConsensus (false)
         , mConsensusStartTime
             (boost::posix_time::microsec_clock::universal_time ())
+        , mApplyTime (getApp().getCollectorManager ().collector ()->make_event (
+            "ledger_apply"))
+        , mFlushTime (getApp().getCollectorManager ().collector ()->make_event (
+            "ledger_flush"))
     {
         WriteLog (lsDEBUG, LedgerConsensus) << "Creating consensus object";
         WriteLog (lsTRACE, LedgerConsensus)
@@ -1054,16 +1063,23 @@ private:
             WriteLog (lsDEBUG, LedgerConsensus)
                 << "Applying consensus set transactions to the"
                 << " last closed ledger";
+            auto applyStart = std::chrono::steady_clock::now ();
             applyTransactions (set, newLCL, newLCL, retriableTransactions, false);
             newLCL->updateSkipList ();
             newLCL->setClosed ();
 
+            auto flushStart = std::chrono::steady_clock::now ();
             int asf = newLCL->peekAccountStateMap ()->flushDirty (
                 hotACCOUNT_NODE, newLCL->getLedgerSeq());
             int tmf = newLCL->peekTransactionMap ()->flushDirty (
                 hotTRANSACTION_NODE, newLCL->getLedgerSeq());
+            auto flushEnd = std::chrono::steady_clock::now ();
+            mApplyTime.notify (flushStart - applyStart);
+            mFlushTime.notify (flushEnd - flushStart);
             WriteLog (lsDEBUG, LedgerConsensus) << "Flushed " << asf << " account and " <<
-                tmf << "transaction nodes";
+                tmf << "transaction nodes in " <<
+                std::chrono::duration_cast<std::chrono::milliseconds> (
+                    flushEnd - flushStart).count () << "ms";
 
             // Accept ledger
             newLCL->setAccepted (closeTime, mCloseResolution, closeTimeCorrect);
@@ -2027,6 +2043,11 @@ private:
     int                             mPreviousProposers;
     int                             mPreviousMSeconds;
 
+    // Time to apply the consensus set, which also rehashes the changed
+    // nodes, and to write the new ledger's nodes to the node store
+    beast::insight::Event           mApplyTime;
+    beast::insight::Event           mFlushTime;
+
     // Convergence tracking, trusted peers indexed by hash of public key
     hash_map<NodeID, LedgerProposal::pointer>  mPeerPositions;
 
@@ -2063,19 +2084,10 @@ make_LedgerConsensus (LedgerConsensus::clock_type& clock, LocalTxs& localtx,
         prevLCLHash, previousLedger, closeTime, feeVote, dividendVote);
 }
 
-/** Apply a transaction to a ledger
-
-  @param engine       The transaction engine containing the ledger.
-  @param txn          The transaction to be applied to ledger.
-  @param openLedger   true if ledger is open
-  @param retryAssured true if the transaction should be retried on failure.
-  @return             One of resultSuccess, resultFail or resultRetry.
-*/
 static
-int applyTransaction (TransactionEngine& engine
-    , STTx::ref txn, bool openLedger, bool retryAssured)
+TransactionEngineParams applyParams (STTx::ref txn
+    , bool openLedger, bool retryAssured)
 {
-    // Returns false if the transaction has need not be retried.
     TransactionEngineParams parms = openLedger ? tapOPEN_LEDGER : tapNONE;
 
     if (retryAssured)
@@ -2089,39 +2101,250 @@ int applyTransaction (TransactionEngine& engine
         parms = static_cast<TransactionEngineParams>
             (parms | tapNO_CHECK_SIGN);
     }
+
+    return parms;
+}
+
+/** Classify the outcome of applying a transaction
+
+  @return             One of resultSuccess, resultFail or resultRetry.
+*/
+static
+int applyResult (TER result, bool didApply)
+{
+    if (didApply)
+    {
+        WriteLog (lsDEBUG, LedgerConsensus)
+        << "Transaction success: " << transHuman (result);
+        return LedgerConsensusImp::resultSuccess;
+    }
+
+    if (isTefFailure (result) || isTemMalformed (result) ||
+        isTelLocal (result))
+    {
+        // failure
+        WriteLog (lsDEBUG, LedgerConsensus)
+            << "Transaction failure: " << transHuman (result);
+        return LedgerConsensusImp::resultFail;
+    }
+
+    WriteLog (lsDEBUG, LedgerConsensus)
+        << "Transaction retry: " << transHuman (result);
+    return LedgerConsensusImp::resultRetry;
+}
+
+// Adds the entries the engine's view wrote to the ledger to written,
+// then empties the view for the next transaction
+static
+void clearView (TransactionEngine& engine, hash_set<uint256>* written)
+{
+    if (written)
+    {
+        for (auto const& entry : engine.view ())
+        {
+            if (entry.second.mAction != taaCACHED)
+                written->insert (entry.first);
+        }
+    }
+    engine.view ().clear ();
+}
+
+/** Apply a transaction to a ledger
+
+  @param engine       The transaction engine containing the ledger.
+  @param txn          The transaction to be applied to ledger.
+  @param parms        How to apply it, from applyParams.
+  @param written      If not null, collects the ledger entries written.
+  @return             One of resultSuccess, resultFail or resultRetry.
+*/
+static
+int applyTransaction (TransactionEngine& engine
+    , STTx::ref txn, TransactionEngineParams parms
+    , hash_set<uint256>* written = nullptr)
+{
+    // Returns false if the transaction has need not be retried.
     WriteLog (lsDEBUG, LedgerConsensus) << "TXN "
         << txn->getTransactionID ()
-        << (openLedger ? " open" : " closed")
-        << (retryAssured ? "/retry" : "/final");
+        << ((parms & tapOPEN_LEDGER) ? " open" : " closed")
+        << ((parms & tapRETRY) ? "/retry" : "/final");
     WriteLog (lsTRACE, LedgerConsensus) << txn->getJson (0);
 
     try
     {
         bool didApply;
-        TER result = engine.applyTransaction (*txn, parms, didApply);
+        TER result = engine.applyToView (*txn, parms, didApply);
 
         if (didApply)
+            engine.commitView (*txn, result, parms);
+
+        clearView (engine, written);
+        return applyResult (result, didApply);
+    }
+    catch (...)
+    {
+        clearView (engine, written);
+        WriteLog (lsWARNING, LedgerConsensus) << "Throws";
+        return LedgerConsensusImp::resultFail;
+    }
+}
+
+static
+int applyTransaction (TransactionEngine& engine
+    , STTx::ref txn, bool openLedger, bool retryAssured
+    , hash_set<uint256>* written = nullptr)
+{
+    return applyTransaction (engine, txn,
+        applyParams (txn, openLedger, retryAssured), written);
+}
+
+//------------------------------------------------------------------------------
+
+// A transaction applied ahead of its turn to the ledger as it was before
+// the pass. It is committed in its turn if no transaction committed before
+// it wrote any of its entries, else it is applied again.
+struct Speculation
+{
+    bool valid = false;
+    TransactionEngineParams parms = tapNONE;
+    TER result = tesSUCCESS;
+    bool didApply = false;
+    LedgerEntrySet view;
+
+    // Every entry the transaction read or wrote
+    std::vector<uint256> entries;
+};
+
+// Transactions with fewer candidates are not worth the threads
+static std::size_t const minSpeculations = 64;
+
+/** The ledger entries a transaction can touch, if the transaction alone
+    tells them. Entries that were read and found missing leave no trace in
+    the view, so they must be in this list.
+
+    Transactions that walk order books or directories, or change the
+    ledger header, return false and are always applied in order.
+*/
+static
+bool declaredEntries (STTx const& txn, std::vector<uint256>& entries)
+{
+    switch (txn.getTxnType ())
+    {
+    case ttPAYMENT:
+        // Only direct native payments, which never ripple
+        if (txn.isFieldPresent (sfPaths) || txn.isFieldPresent (sfSendMax) ||
+            !txn.getFieldAmount (sfAmount).isNative ())
+            return false;
+
+        entries.push_back (getAccountRootIndex (
+            txn.getSourceAccount ().getAccountID ()));
+        entries.push_back (getAccountRootIndex (
+            txn.getFieldAccount160 (sfDestination)));
+        return true;
+
+    case ttACCOUNT_SET:
+        // Setting RequireAuth reads the root page of the owner directory,
+        // which a trust line created earlier in the pass may add
+        entries.push_back (getAccountRootIndex (
+            txn.getSourceAccount ().getAccountID ()));
+        entries.push_back (getOwnerDirIndex (
+            txn.getSourceAccount ().getAccountID ()));
+        return true;
+
+    case ttREGULAR_KEY_SET:
+        entries.push_back (getAccountRootIndex (
+            txn.getSourceAccount ().getAccountID ()));
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+/** Apply the transactions that declare their entries to views of the
+    ledger on several threads. The ledger is not changed.
+
+    @return One speculation per transaction, or none if there are too few
+            candidates.
+*/
+static
+std::vector<Speculation> speculate (Ledger::ref ledger
+    , std::vector<STTx::pointer> const& txns
+    , bool openLedger, unsigned int threads)
+{
+    std::vector<Speculation> speculations (txns.size ());
+    std::vector<std::size_t> work;
+
+    for (std::size_t i = 0; i < txns.size (); ++i)
+    {
+        if (declaredEntries (*txns[i], speculations[i].entries))
+            work.push_back (i);
+    }
+
+    if ((threads < 2) || (work.size () < minSpeculations))
+        return {};
+
+    // The fee settings are loaded on first use, load them before the
+    // workers would race to
+    ledger->getReserve (0);
+
+    // Threads take minSpeculations of them at a time
+    parallelFor (work.size (), [&](std::size_t w)
+    {
+        auto const& txn = txns[work[w]];
+        auto& spec = speculations[work[w]];
+        spec.parms = applyParams (txn, openLedger, true);
+
+        TransactionEngine engine (ledger);
+
+        try
         {
-            WriteLog (lsDEBUG, LedgerConsensus)
-            << "Transaction success: " << transHuman (result);
-            return LedgerConsensusImp::resultSuccess;
-        }
+            spec.result = engine.applyToView (*txn, spec.parms,
+                spec.didApply);
 
-        if (isTefFailure (result) || isTemMalformed (result) ||
-            isTelLocal (result))
+            for (auto const& entry : engine.view ())
+                spec.entries.push_back (entry.first);
+
+            spec.view.swapWith (engine.view ());
+            spec.valid = true;
+        }
+        catch (...)
         {
-            // failure
-            WriteLog (lsDEBUG, LedgerConsensus)
-                << "Transaction failure: " << transHuman (result);
-            return LedgerConsensusImp::resultFail;
+            // Applied again in its turn, which reports the failure
         }
+    }, threads, minSpeculations);
 
-        WriteLog (lsDEBUG, LedgerConsensus)
-            << "Transaction retry: " << transHuman (result);
-        return LedgerConsensusImp::resultRetry;
+    return speculations;
+}
+
+// Applies a transaction in its turn, from its speculation when that is
+// still good
+static
+int applySpeculation (TransactionEngine& engine
+    , STTx::ref txn, Speculation& spec, hash_set<uint256>& written)
+{
+    // Speculated transactions always got their parms
+    if (!spec.valid || std::any_of (spec.entries.begin (), spec.entries.end (),
+        [&written](uint256 const& entry)
+        {
+            return written.count (entry) != 0;
+        }))
+    {
+        return applyTransaction (engine, txn, spec.parms, &written);
+    }
+
+    try
+    {
+        engine.view ().swapWith (spec.view);
+
+        if (spec.didApply)
+            engine.commitView (*txn, spec.result, spec.parms);
+
+        clearView (engine, &written);
+        return applyResult (spec.result, spec.didApply);
     }
     catch (...)
     {
+        clearView (engine, &written);
         WriteLog (lsWARNING, LedgerConsensus) << "Throws";
         return LedgerConsensusImp::resultFail;
     }
@@ -2140,11 +2363,23 @@ int applyTransaction (TransactionEngine& engine
 void applyTransactions (SHAMap::ref set, Ledger::ref applyLedger,
     Ledger::ref checkLedger, CanonicalTXSet& retriableTransactions,
     bool openLgr)
+{
+    applyTransactions (set, applyLedger, checkLedger, retriableTransactions,
+        openLgr, parallelForThreads ());
+}
+
+void applyTransactions (SHAMap::ref set, Ledger::ref applyLedger,
+    Ledger::ref checkLedger, CanonicalTXSet& retriableTransactions,
+    bool openLgr, unsigned int threads)
 {
     TransactionEngine engine (applyLedger);
 
     if (set)
     {
+        // Parse the candidates first, so the accounts a dividend ledger
+        // pays can be loaded as one batch before anything is applied
+        std::vector<STTx::pointer> txns;
+
         for (SHAMapItem::pointer item = set->peekFirstItem (); !!item;
             item = set->peekNextItem (item->getTag ()))
         {
@@ -2157,15 +2392,7 @@ void applyTransactions (SHAMap::ref set, Ledger::ref applyLedger,
                 try
                 {
                     SerializerIterator sit (item->peekSerializer ());
-                    STTx::pointer txn
-                        = std::make_shared<STTx>(sit);
-                    if (applyTransaction (engine, txn,
-                              openLgr, true) == LedgerConsensusImp::resultRetry)
-                    {
-                        // On failure, stash the failed transaction for
-                        // later retry.
-                        retriableTransactions.push_back (txn);
-                    }
+                    txns.push_back (std::make_shared<STTx>(sit));
                 }
                 catch (...)
                 {
@@ -2173,6 +2400,41 @@ void applyTransactions (SHAMap::ref set, Ledger::ref applyLedger,
                 }
             }
         }
+
+        if (!openLgr)
+            DividendMaster::prefetchApply (applyLedger, txns);
+
+        // Payments and account settings run ahead on other threads, and
+        // are committed here in the same order as without them
+        std::vector<Speculation> speculations = speculate (applyLedger,
+            txns, openLgr, threads);
+        hash_set<uint256> written;
+
+        for (std::size_t i = 0; i < txns.size (); ++i)
+        {
+            auto const& txn = txns[i];
+            try
+            {
+                int result;
+                if (!speculations.empty () && !speculations[i].entries.empty ())
+                    result = applySpeculation (engine, txn, speculations[i],
+                        written);
+                else
+                    result = applyTransaction (engine, txn, openLgr, true,
+                        speculations.empty () ? nullptr : &written);
+
+                if (result == LedgerConsensusImp::resultRetry)
+                {
+                    // On failure, stash the failed transaction for
+                    // later retry.
+                    retriableTransactions.push_back (txn);
+                }
+            }
+            catch (...)
+            {
+                WriteLog (lsWARNING, LedgerConsensus) << "  Throws";
+            }
+        }
     }
 
     int changes;
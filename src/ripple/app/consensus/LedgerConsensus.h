@@ -102,6 +102,14 @@ applyTransactions(SHAMap::ref set, Ledger::ref applyLedger,
                   Ledger::ref checkLedger,
                   CanonicalTXSet& retriableTransactions, bool openLgr);
 
+// Same as above, with payments and account settings speculated on up to
+// threads threads. The ledger is the same for any number of threads.
+void
+applyTransactions(SHAMap::ref set, Ledger::ref applyLedger,
+                  Ledger::ref checkLedger,
+                  CanonicalTXSet& retriableTransactions, bool openLgr,
+                  unsigned int threads);
+
 } // ripple
 
 #endif
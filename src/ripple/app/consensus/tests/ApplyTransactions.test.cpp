@@ -0,0 +1,271 @@
+#include <BeastConfig.h>
+#include <ripple/app/consensus/LedgerConsensus.h>
+#include <ripple/app/main/Application.h>
+#include <ripple/app/misc/CanonicalTXSet.h>
+#include <ripple/app/misc/DefaultMissingNodeHandler.h>
+#include <ripple/app/tx/TransactionEngine.h>
+#include <ripple/basics/Log.h>
+#include <ripple/core/ParallelFor.h>
+#include <ripple/protocol/Indexes.h>
+#include <ripple/protocol/TxFlags.h>
+#include <beast/module/core/text/LexicalCast.h>
+#include <beast/unit_test/suite.h>
+#include <chrono>
+#include <random>
+
+namespace ripple {
+
+// Builds a ledger of funded accounts and a payment flood between them, with
+// chains of payments from one account, payments that create accounts, and
+// transactions that must be retried or applied in order.
+class ApplyTransactionsFixture
+{
+public:
+    explicit ApplyTransactionsFixture(std::size_t accounts)
+    {
+        RippleAddress const seed = RippleAddress::createSeedGeneric("masterpassphrase");
+        RippleAddress const generator = RippleAddress::createGeneratorPublic(seed);
+        for (std::size_t i = 0; i < accounts; ++i)
+        {
+            m_public.push_back(RippleAddress::createAccountPublic(generator, i + 1));
+            m_private.push_back(RippleAddress::createAccountPrivate(generator, seed, i + 1));
+        }
+    }
+
+    Ledger::pointer
+    makeBaseLedger()
+    {
+        std::uint64_t const vrp = SYSTEM_CURRENCY_PARTS;
+        std::uint64_t const vbc = SYSTEM_CURRENCY_PARTS_VBC;
+
+        RippleAddress const master = RippleAddress::createAccountPublic(
+            RippleAddress::createGeneratorPublic(
+                RippleAddress::createSeedGeneric("masterpassphrase")), 0);
+        Ledger::pointer ledger = std::make_shared<Ledger>(master,
+            100000000 * vrp, 100000000 * vbc);
+
+        for (auto const& account : m_public)
+        {
+            auto sle = std::make_shared<SLE>(ltACCOUNT_ROOT,
+                getAccountRootIndex(account.getAccountID()));
+            sle->setFieldAccount(sfAccount, account.getAccountID());
+            sle->setFieldAmount(sfBalance, STAmount(10000 * vrp));
+            sle->setFieldAmount(sfBalanceVBC, STAmount(10000 * vbc));
+            sle->setFieldU32(sfSequence, 1);
+            ledger->writeBack(lepCREATE, sle);
+        }
+
+        ledger->peekAccountStateMap()->flushDirty(hotACCOUNT_NODE, ledger->getLedgerSeq());
+        ledger->updateHash();
+        ledger->setClosed();
+        return ledger;
+    }
+
+    // With trustPairs, that many accounts also get a trust line from
+    // another account and try to set RequireAuth, which fails once the
+    // line is in their owner directory
+    SHAMap::pointer
+    makeFlood(std::size_t payments, std::uint32_t seed,
+        std::size_t trustPairs = 0)
+    {
+        std::uint64_t const vrp = SYSTEM_CURRENCY_PARTS;
+        std::mt19937 gen(seed);
+        std::uniform_int_distribution<std::size_t> pick(0, m_public.size() - 1);
+        std::vector<std::uint32_t> sequence(m_public.size(), 1);
+
+        std::vector<SHAMapItem::pointer> items;
+        for (std::size_t i = 0; i < payments; ++i)
+        {
+            std::size_t const from = pick(gen);
+            std::uint32_t seq = sequence[from]++;
+            int const kind = gen() % 100;
+
+            STTx trans(kind < 4 ? ttACCOUNT_SET : ttPAYMENT);
+            trans.setSourceAccount(m_public[from]);
+            trans.setSigningPubKey(m_public[from]);
+            trans.setFieldAmount(sfFee, STAmount(10));
+
+            if (kind < 4)
+            {
+                trans.setFieldU32(sfTransferRate, 1000000000 + kind);
+            }
+            else if (kind < 8)
+            {
+                // Creates an account, or pays the one another payment made
+                trans.setFieldAccount(sfDestination, Account(0x100000 + gen() % 16));
+                trans.setFieldAmount(sfAmount, STAmount(1000 * vrp));
+            }
+            else if (kind < 10)
+            {
+                // Not funded, retried and then claims only the fee
+                trans.setFieldAccount(sfDestination,
+                    m_public[pick(gen)].getAccountID());
+                trans.setFieldAmount(sfAmount, STAmount(1000000 * vrp));
+            }
+            else if (kind < 12)
+            {
+                // Applied in order, not speculated
+                trans.setFieldAccount(sfDestination,
+                    m_public[pick(gen)].getAccountID());
+                trans.setFieldAmount(sfAmount, STAmount(vrp));
+                trans.setFieldAmount(sfSendMax, STAmount(vrp));
+            }
+            else
+            {
+                trans.setFieldAccount(sfDestination,
+                    m_public[pick(gen)].getAccountID());
+                trans.setFieldAmount(sfAmount, STAmount((1 + gen() % 100) * vrp));
+            }
+
+            // Skips a sequence, so the account's later transactions are
+            // retried and left over
+            if (kind == 99)
+                seq = ++sequence[from];
+            trans.setSequence(seq);
+            trans.sign(m_private[from]);
+            add(items, trans);
+        }
+
+        for (std::size_t i = 0; i < trustPairs; ++i)
+        {
+            std::size_t const holder = pick(gen);
+            std::size_t issuer = pick(gen);
+            if (issuer == holder)
+                issuer = (issuer + 1) % m_public.size();
+
+            STTx trust(ttTRUST_SET);
+            trust.setSourceAccount(m_public[holder]);
+            trust.setSigningPubKey(m_public[holder]);
+            trust.setFieldAmount(sfFee, STAmount(10));
+            trust.setFieldAmount(sfLimitAmount, STAmount(sfLimitAmount,
+                Issue(to_currency("USD"), m_public[issuer].getAccountID()), 100));
+            trust.setSequence(sequence[holder]++);
+            trust.sign(m_private[holder]);
+            add(items, trust);
+
+            STTx auth(ttACCOUNT_SET);
+            auth.setSourceAccount(m_public[issuer]);
+            auth.setSigningPubKey(m_public[issuer]);
+            auth.setFieldAmount(sfFee, STAmount(10));
+            auth.setFieldU32(sfSetFlag, asfRequireAuth);
+            auth.setSequence(sequence[issuer]++);
+            auth.sign(m_private[issuer]);
+            add(items, auth);
+        }
+
+        Application& app = getApp();
+        SHAMap::pointer set = std::make_shared<SHAMap>(smtTRANSACTION,
+            app.getFullBelowCache(), app.getTreeNodeCache(), app.getNodeStore(),
+            DefaultMissingNodeHandler(), deprecatedLogs().journal("SHAMap"));
+        set->addGiveItems(items, true, false);
+        return set;
+    }
+
+    // Applies the set as the consensus close does and returns the new ledger
+    static Ledger::pointer
+    close(Ledger::pointer const& base, SHAMap::ref set, unsigned int threads,
+        std::size_t& retried)
+    {
+        Ledger::pointer ledger = std::make_shared<Ledger>(false, *base);
+        CanonicalTXSet retriable(set->getHash());
+        applyTransactions(set, ledger, ledger, retriable, false, threads);
+        retried = retriable.size();
+        ledger->setClosed();
+        ledger->updateHash();
+        return ledger;
+    }
+
+private:
+    static void
+    add(std::vector<SHAMapItem::pointer>& items, STTx const& trans)
+    {
+        Serializer s;
+        trans.add(s, true);
+        items.push_back(std::make_shared<SHAMapItem>(trans.getTransactionID(), s.peekData()));
+    }
+
+    std::vector<RippleAddress> m_public;
+    std::vector<RippleAddress> m_private;
+};
+
+class ApplyTransactions_test : public beast::unit_test::suite
+{
+public:
+    void testSameAsSerial(std::uint32_t seed, std::size_t trustPairs = 0)
+    {
+        testcase("same ledger as one thread, seed " + std::to_string(seed) +
+            (trustPairs ? ", require auth" : ""));
+
+        ApplyTransactionsFixture fixture(200);
+        Ledger::pointer base = fixture.makeBaseLedger();
+        SHAMap::pointer set = fixture.makeFlood(2000, seed, trustPairs);
+
+        std::size_t serialRetried, parallelRetried;
+        Ledger::pointer serial = ApplyTransactionsFixture::close(base, set, 1, serialRetried);
+        Ledger::pointer parallel = ApplyTransactionsFixture::close(base, set, 8, parallelRetried);
+
+        expect(serial->peekTransactionMap()->getHash() !=
+            base->peekTransactionMap()->getHash(), "nothing applied");
+        expect(parallel->peekAccountStateMap()->getHash() ==
+            serial->peekAccountStateMap()->getHash(), "state differs");
+        expect(parallel->peekTransactionMap()->getHash() ==
+            serial->peekTransactionMap()->getHash(), "metadata differs");
+        expect(parallel->getTotalCoins() == serial->getTotalCoins(), "fees differ");
+        expect(parallel->getHash() == serial->getHash(), "ledger hash differs");
+        expect(parallelRetried == serialRetried, "retries differ");
+    }
+
+    void run()
+    {
+        testSameAsSerial(1);
+        testSameAsSerial(2);
+        testSameAsSerial(3);
+
+        // A trust line to an account is created before the account's
+        // AccountSet reads its owner directory, in about half the pairs
+        testSameAsSerial(4, 40);
+    }
+};
+
+// Measures applying a payment flood on one thread and on all of them.
+// Pass the number of payments as the argument, the default is 20000.
+class ApplyTransactionsTiming_test : public beast::unit_test::suite
+{
+public:
+    void run()
+    {
+        std::size_t payments = 20000;
+        if (!arg().empty())
+            payments = beast::lexicalCastThrow<std::size_t>(arg());
+
+        testcase("apply " + std::to_string(payments) + " payments");
+
+        using clock = std::chrono::steady_clock;
+        auto ms = [](clock::time_point start)
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                clock::now() - start).count();
+        };
+
+        ApplyTransactionsFixture fixture(payments / 4);
+        Ledger::pointer base = fixture.makeBaseLedger();
+        SHAMap::pointer set = fixture.makeFlood(payments, 1);
+
+        std::size_t retried;
+        auto start = clock::now();
+        Ledger::pointer serial = ApplyTransactionsFixture::close(base, set, 1, retried);
+        log << "one thread: " << ms(start) << "ms";
+
+        unsigned int const threads = parallelForThreads();
+        start = clock::now();
+        Ledger::pointer parallel = ApplyTransactionsFixture::close(base, set, threads, retried);
+        log << threads << " threads: " << ms(start) << "ms";
+
+        expect(parallel->getHash() == serial->getHash());
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ApplyTransactions,ripple_app,ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(ApplyTransactionsTiming,ripple_app,ripple);
+
+}
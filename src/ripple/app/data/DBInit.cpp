@@ -63,6 +63,26 @@ const char* TxnDBInit[] =
     "CREATE INDEX AcctLgrIndex ON               \
         AccountTransactions(LedgerSeq, Account, TransID);",
 
+    // Each account's share of a dividend, keyed by the dividend's base
+    // ledger. Filled in as the ledger applying the dividend is saved.
+    "CREATE TABLE AccountDividends (            \
+        Account                 CHARACTER(64),  \
+        DividendLedger          BIGINT UNSIGNED,\
+        LedgerSeq               BIGINT UNSIGNED,\
+        TransID                 CHARACTER(64),  \
+        DividendCoins           BIGINT UNSIGNED,\
+        DividendCoinsVBC        BIGINT UNSIGNED,\
+        DividendCoinsVBCRank    BIGINT UNSIGNED,\
+        DividendCoinsVBCSprd    BIGINT UNSIGNED,\
+        DividendTSprd           BIGINT UNSIGNED,\
+        DividendVRank           BIGINT UNSIGNED,\
+        DividendVSprd           BIGINT UNSIGNED \
+    );",
+    "CREATE UNIQUE INDEX AcctDivIndex ON        \
+        AccountDividends(Account, DividendLedger);",
+    "CREATE INDEX AcctDivLgrIndex ON            \
+        AccountDividends(LedgerSeq);",
+
     "END TRANSACTION;"
     
 };
@@ -100,6 +120,24 @@ const char* TxnDBInitMySQL[] =
         AccountTransactions(Account, LedgerSeq, TxnSeq, TransID);",
     "CREATE INDEX AcctLgrIndex ON               \
         AccountTransactions(LedgerSeq, Account, TransID);",
+
+    "CREATE TABLE IF NOT EXISTS AccountDividends (   \
+        Account                 CHARACTER(64),      \
+        DividendLedger          BIGINT UNSIGNED,    \
+        LedgerSeq               BIGINT UNSIGNED,    \
+        TransID                 CHARACTER(64),      \
+        DividendCoins           BIGINT UNSIGNED,    \
+        DividendCoinsVBC        BIGINT UNSIGNED,    \
+        DividendCoinsVBCRank    BIGINT UNSIGNED,    \
+        DividendCoinsVBCSprd    BIGINT UNSIGNED,    \
+        DividendTSprd           BIGINT UNSIGNED,    \
+        DividendVRank           BIGINT UNSIGNED,    \
+        DividendVSprd           BIGINT UNSIGNED     \
+    );",
+    "CREATE UNIQUE INDEX AcctDivIndex ON            \
+        AccountDividends(Account, DividendLedger);",
+    "CREATE INDEX AcctDivLgrIndex ON                \
+        AccountDividends(LedgerSeq);",
     
     "COMMIT;"
 };
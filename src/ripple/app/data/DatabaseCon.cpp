@@ -47,6 +47,12 @@ DatabaseCon::~DatabaseCon ()
 {
     mDatabase->disconnect ();
     delete mDatabase;
+
+    if (mReadDatabase)
+    {
+        mReadDatabase->disconnect ();
+        delete mReadDatabase;
+    }
 }
 
 DatabaseCon::Setup
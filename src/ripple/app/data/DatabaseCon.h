@@ -54,6 +54,14 @@ public:
         return mDatabase;
     }
 
+    /** The database for queries that may read slightly stale data.
+        This is a read replica when one is configured, else getDB ().
+    */
+    Database* getReadDB ()
+    {
+        return mReadDatabase ? mReadDatabase : mDatabase;
+    }
+
     typedef std::recursive_mutex mutex;
 
     std::unique_lock<mutex> lock ()
@@ -61,6 +69,14 @@ public:
         return std::unique_lock<mutex>(mLock);
     }
 
+    // A replica serves reads from any thread, only getDB () needs the lock
+    std::unique_lock<mutex> lockRead ()
+    {
+        if (mReadDatabase)
+            return std::unique_lock<mutex>(mLock, std::defer_lock);
+        return lock ();
+    }
+
     mutex& peekMutex()
     {
         return mLock;
@@ -69,6 +85,7 @@ public:
 protected:
     DatabaseCon () {}
     Database* mDatabase;
+    Database* mReadDatabase = nullptr;
 
 private:
     mutex  mLock;
@@ -3,25 +3,130 @@
 #include <ripple/app/main/Application.h>
 #include <ripple/core/JobQueue.h>
 #include <ripple/basics/Log.h>
+#include <algorithm>
+#include <cstring>
 
 namespace ripple {
+
+MySQLParams::Value& MySQLParams::at (int position)
+{
+    assert (position > 0);
+    if (mValues.size () < static_cast<std::size_t> (position))
+        mValues.resize (position);
+    return mValues[position - 1];
+}
+
+void MySQLParams::bind (int position, std::string const& value)
+{
+    auto& v = at (position);
+    v.type = MYSQL_TYPE_STRING;
+    v.data = value;
+}
+
+void MySQLParams::bind (int position, void const* data, std::size_t length)
+{
+    auto& v = at (position);
+    v.type = MYSQL_TYPE_BLOB;
+    v.data.assign (static_cast<char const*> (data), length);
+}
+
+void MySQLParams::bind (int position, std::uint32_t value)
+{
+    auto& v = at (position);
+    v.type = MYSQL_TYPE_LONGLONG;
+    v.number = value;
+}
+
+void MySQLParams::bind (int position, std::uint64_t value)
+{
+    auto& v = at (position);
+    v.type = MYSQL_TYPE_LONGLONG;
+    v.number = value;
+}
+
+//---------------------------------------------------
 MySQLDatabase::MySQLDatabase(char const* host, std::uint32_t port,
                              char const* username, char const* password,
-                             char const* database, bool asyncBatch)
+                             char const* database, bool asyncBatch,
+                             int poolSize)
     : Database (host),
       mPort(port),
       mUsername(username),
       mPassword(password),
       mDatabase(database)
     , mAsyncBatch(asyncBatch)
+    , mPoolSize(std::max (poolSize, 1))
 {
     mDBType = Type::MySQL;
 }
-    
+
 MySQLDatabase::~MySQLDatabase()
 {
+    // The statement of this thread may give a connection back to the pool
+    mStmt.reset ();
 }
-    
+
+std::unique_ptr <MySQLConnection> MySQLDatabase::acquire ()
+{
+    {
+        std::unique_lock <std::mutex> lock (mPoolLock);
+        mPoolCond.wait (lock, [this]
+        {
+            return !mIdle.empty () || mConnections < mPoolSize;
+        });
+        if (!mIdle.empty ())
+        {
+            auto connection = std::move (mIdle.back ());
+            mIdle.pop_back ();
+            return connection;
+        }
+        ++mConnections;
+    }
+
+    // Connect without holding the pool lock
+    auto connection = std::make_unique <MySQLConnection> (mHost.c_str(),
+        mPort, mUsername.c_str(), mPassword.c_str(), mDatabase.c_str());
+    if (!connection->mConnection)
+    {
+        std::lock_guard <std::mutex> lock (mPoolLock);
+        --mConnections;
+        mPoolCond.notify_one ();
+        return nullptr;
+    }
+    return connection;
+}
+
+void MySQLDatabase::release (std::unique_ptr <MySQLConnection> connection)
+{
+    if (!connection)
+        return;
+    std::lock_guard <std::mutex> lock (mPoolLock);
+    mIdle.push_back (std::move (connection));
+    mPoolCond.notify_one ();
+}
+
+int MySQLDatabase::getConnectionCount ()
+{
+    std::lock_guard <std::mutex> lock (mPoolLock);
+    return mConnections;
+}
+
+MySQLDatabase::Lease::Lease (MySQLDatabase& db)
+    : mDatabase (db)
+    , mConnection (db.getStatement ()->mConnection.get ())
+{
+    if (!mConnection)
+    {
+        mOwned = db.acquire ();
+        mConnection = mOwned.get ();
+    }
+}
+
+MySQLDatabase::Lease::~Lease ()
+{
+    mDatabase.release (std::move (mOwned));
+}
+
 // returns true if the query went ok
 bool MySQLDatabase::executeSQL(const char* sql, bool fail_ok)
 {
@@ -31,25 +136,30 @@ bool MySQLDatabase::executeSQL(const char* sql, bool fail_ok)
         stmt->mSqlQueue.push_back(sql);
         return true;
     }
-    
-    assert(stmt->mConnection);
+
     endIterRows();
-    int rc = mysql_query(stmt->mConnection, sql);
+    Lease connection (*this);
+    if (!connection)
+        return false;
+
+    int rc = mysql_query(connection->mConnection, sql);
     if (rc != 0)
     {
         WriteLog (lsWARNING, MySQLDatabase)
             << "executeSQL-" << sql
-            << " error_info:" << mysql_error(stmt->mConnection);
+            << " error_info:" << mysql_error(connection->mConnection);
         return false;
     }
     //SQL has result(like `select`)
-    if (mysql_field_count(stmt->mConnection) > 0)
+    if (mysql_field_count(connection->mConnection) > 0)
     {
-        stmt->mResult = mysql_store_result(stmt->mConnection);
+        // The whole result is read here, so the rows stay valid after the
+        // connection goes back to the pool
+        stmt->mResult = mysql_store_result(connection->mConnection);
         if (stmt->mResult == nullptr)
         {
             WriteLog (lsWARNING, MySQLDatabase)
-                << "startIterRows: " << mysql_error(stmt->mConnection);
+                << "startIterRows: " << mysql_error(connection->mConnection);
             return false;
         }
         if (mysql_num_rows(stmt->mResult) > 0)
@@ -60,10 +170,100 @@ bool MySQLDatabase::executeSQL(const char* sql, bool fail_ok)
         {
             stmt->mMoreRows = false;
         }
+        stmt->mRowsAffected = 0;
+    }
+    else
+    {
+        stmt->mRowsAffected = mysql_affected_rows(connection->mConnection);
     }
     return true;
 }
-    
+
+// Runs a multi-statement query and reads every result so the connection
+// can take the next one
+bool MySQLDatabase::executeMulti (MySQLConnection& connection, std::string const& sql)
+{
+    if (mysql_real_query(connection.mConnection, sql.data (), sql.size ()) != 0)
+    {
+        WriteLog (lsWARNING, MySQLDatabase)
+            << "executeMulti error_info:" << mysql_error(connection.mConnection);
+        return false;
+    }
+
+    int status;
+    do
+    {
+        if (auto result = mysql_store_result(connection.mConnection))
+            mysql_free_result(result);
+        status = mysql_next_result(connection.mConnection);
+    }
+    while (status == 0);
+
+    if (status > 0)
+    {
+        // The statements after the failed one were not run
+        WriteLog (lsWARNING, MySQLDatabase)
+            << "executeMulti error_info:" << mysql_error(connection.mConnection);
+        return false;
+    }
+    return true;
+}
+
+bool MySQLDatabase::executePrepared (std::string const& sql, MySQLParams const& params)
+{
+    auto stmt = getStatement();
+    if (stmt->mInBatch)
+    {
+        assert (false);
+        return false;
+    }
+
+    endIterRows();
+    Lease connection (*this);
+    if (!connection)
+        return false;
+
+    MYSQL_STMT* prepared = connection->prepare (sql);
+    if (!prepared)
+        return false;
+
+    auto const& values = params.mValues;
+    std::vector <MYSQL_BIND> binds (values.size ());
+    std::vector <unsigned long> lengths (values.size ());
+    for (std::size_t i = 0; i < values.size (); ++i)
+    {
+        auto& bind = binds[i];
+        std::memset (&bind, 0, sizeof (bind));
+        bind.buffer_type = values[i].type;
+        if (values[i].type == MYSQL_TYPE_LONGLONG)
+        {
+            bind.buffer = const_cast<unsigned long long*> (&values[i].number);
+            bind.is_unsigned = true;
+        }
+        else if (values[i].type != MYSQL_TYPE_NULL)
+        {
+            lengths[i] = values[i].data.size ();
+            bind.buffer = const_cast<char*> (values[i].data.data ());
+            bind.buffer_length = lengths[i];
+            bind.length = &lengths[i];
+        }
+    }
+
+    if ((!binds.empty () && mysql_stmt_bind_param(prepared, binds.data ()) != 0) ||
+        mysql_stmt_execute(prepared) != 0)
+    {
+        WriteLog (lsWARNING, MySQLDatabase)
+            << "executePrepared-" << sql
+            << " error_info:" << mysql_stmt_error(prepared);
+        // A reconnect loses the statements prepared on the connection
+        connection->discard (sql);
+        return false;
+    }
+
+    stmt->mRowsAffected = mysql_stmt_affected_rows(prepared);
+    return true;
+}
+
 bool MySQLDatabase::batchStart()
 {
     auto stmt = getStatement();
@@ -80,10 +280,30 @@ bool MySQLDatabase::batchCommit()
         return false;
     }
     stmt->mInBatch = false;
+
+    // Join the batch into queries of up to maxBatchQuery bytes
+    std::list<std::string> queries;
+    std::string query;
+    for (auto& sql : stmt->mSqlQueue)
+    {
+        if (!query.empty () && query.size () + sql.size () > maxBatchQuery)
+        {
+            queries.push_back (std::move (query));
+            query.clear ();
+        }
+        query += sql;
+        if (sql.empty () || sql.back () != ';')
+            query += ';';
+    }
+    if (!query.empty ())
+        queries.push_back (std::move (query));
+    stmt->mSqlQueue.clear();
+
+    std::unique_lock <std::mutex> lock (mThreadBatchLock);
+    if (!queries.empty ())
+        mSqlQueue.push_back (std::move (queries));
     if (mAsyncBatch)
     {
-        std::unique_lock <std::mutex> lock (mThreadBatchLock);
-        std::move(stmt->mSqlQueue.begin(), stmt->mSqlQueue.end(), std::back_inserter(mSqlQueue));
         if (!mThreadBatch && !mSqlQueue.empty ())
         {
             mThreadBatch = true;
@@ -94,31 +314,50 @@ bool MySQLDatabase::batchCommit()
     }
     else
     {
-        std::move(stmt->mSqlQueue.begin(), stmt->mSqlQueue.end(), std::back_inserter(mSqlQueue));
-        executeSQLBatch();
+        lock.unlock();
+        return executeSQLBatch();
     }
     return true;
 }
 
 bool MySQLDatabase::executeSQLBatch()
 {
+    // One connection for the whole queue: a batch may hold a transaction
+    // that spans several queries
+    Lease connection (*this);
+    bool result = true;
+
     std::unique_lock <std::mutex> lock (mThreadBatchLock);
     while (!mSqlQueue.empty())
     {
-        std::string sql = mSqlQueue.front();
+        std::list<std::string> batch = std::move (mSqlQueue.front());
         mSqlQueue.pop_front();
         lock.unlock();
-        executeSQL(sql.c_str(), true);
+
+        // The rest of a batch, its COMMIT included, must not run after a
+        // query failed. Don't leave the failed transaction open on a pooled
+        // connection.
+        for (auto const& sql : batch)
+        {
+            if (!connection || !executeMulti(*connection, sql))
+            {
+                if (connection)
+                    mysql_query(connection->mConnection, "ROLLBACK;");
+                result = false;
+                break;
+            }
+        }
+
         lock.lock();
     }
     mThreadBatch = false;
-    return true;
+    return result;
 }
 
 // tells you how many rows were changed by an update or insert
 std::uint64_t MySQLDatabase::getNumRowsAffected ()
 {
-    return mysql_affected_rows(getStatement()->mConnection);
+    return getStatement()->mRowsAffected;
 }
 
 // returns false if there are no results
@@ -194,16 +433,28 @@ bool MySQLDatabase::getNextRow(bool finalize)
     return false;
 }
 
+
 bool MySQLDatabase::beginTransaction()
 {
+    auto stmt = getStatement();
+    // In a batch the transaction is sent with the rest of the batch
+    if (!stmt->mInBatch && !stmt->mConnection)
+    {
+        stmt->mConnection = acquire();
+        if (!stmt->mConnection)
+            return false;
+    }
     return executeSQL("START TRANSACTION;", false);
 }
 
 bool MySQLDatabase::endTransaction()
 {
-    return executeSQL("COMMIT;", false);
+    auto stmt = getStatement();
+    bool result = executeSQL("COMMIT;", false);
+    release(std::move(stmt->mConnection));
+    return result;
 }
-    
+
 bool MySQLDatabase::getNull (int colIndex)
 {
     auto stmt = getStatement();
@@ -265,7 +516,7 @@ Blob MySQLDatabase::getBinary (int colIndex)
 std::uint64_t MySQLDatabase::getBigInt (int colIndex)
 {
     auto stmt = getStatement();
-    return boost::lexical_cast<std::int32_t>(stmt->mCurRow[colIndex]);
+    return boost::lexical_cast<std::uint64_t>(stmt->mCurRow[colIndex]);
 }
 
 MySQLStatement* MySQLDatabase::getStatement()
@@ -273,12 +524,12 @@ MySQLStatement* MySQLDatabase::getStatement()
     auto stmt = mStmt.get();
     if (!stmt)
     {
-        stmt = new MySQLStatement(mHost.c_str(), mPort, mUsername.c_str(), mPassword.c_str(), mDatabase.c_str());
+        stmt = new MySQLStatement(*this);
         mStmt.reset(stmt);
     }
     return stmt;
 }
-    
+
 bool MySQLDatabase::hasField(const std::string &table, const std::string &field)
 {
     std::string sql = "SHOW COLUMNS FROM `" + table + "`;";
@@ -298,7 +549,7 @@ bool MySQLDatabase::hasField(const std::string &table, const std::string &field)
 }
     
 //---------------------------------------------------
-MySQLStatement::MySQLStatement(char const* host, std::uint32_t port, char const* username, char const* password, char const* database)
+MySQLConnection::MySQLConnection(char const* host, std::uint32_t port, char const* username, char const* password, char const* database)
 {
     mConnection = mysql_init(nullptr);
     if (!mConnection || mysql_real_connect(mConnection, host,
@@ -315,15 +566,65 @@ MySQLStatement::MySQLStatement(char const* host, std::uint32_t port, char const*
             mysql_close(mConnection);
             mConnection = nullptr;
         }
-        assert(false);
+        return;
     }
     // set auto connect
     my_bool reconnect = 1;
     mysql_options(mConnection, MYSQL_OPT_RECONNECT, &reconnect);
-    
+}
+
+MySQLConnection::~MySQLConnection()
+{
+    for (auto& prepared : mPrepared)
+    {
+        mysql_stmt_close(prepared.second);
+    }
+
+    if (mConnection)
+    {
+        mysql_close(mConnection);
+    }
+}
+
+MYSQL_STMT* MySQLConnection::prepare (std::string const& sql)
+{
+    auto iter = mPrepared.find (sql);
+    if (iter != mPrepared.end ())
+        return iter->second;
+
+    MYSQL_STMT* prepared = mysql_stmt_init(mConnection);
+    if (!prepared)
+        return nullptr;
+    if (mysql_stmt_prepare(prepared, sql.data (), sql.size ()) != 0)
+    {
+        WriteLog (lsWARNING, MySQLDatabase)
+            << "prepare-" << sql
+            << " error_info:" << mysql_stmt_error(prepared);
+        mysql_stmt_close(prepared);
+        return nullptr;
+    }
+    mPrepared.emplace (sql, prepared);
+    return prepared;
+}
+
+void MySQLConnection::discard (std::string const& sql)
+{
+    auto iter = mPrepared.find (sql);
+    if (iter != mPrepared.end ())
+    {
+        mysql_stmt_close(iter->second);
+        mPrepared.erase (iter);
+    }
+}
+
+//---------------------------------------------------
+MySQLStatement::MySQLStatement(MySQLDatabase& db)
+    : mDatabase (db)
+{
     mInBatch = false;
 
     mMoreRows = false;
+    mRowsAffected = 0;
     mResult = nullptr;
     mCurRow = nullptr;
 }
@@ -335,12 +636,10 @@ MySQLStatement::~MySQLStatement()
         mysql_free_result(mResult);
     }
 
-    if (mConnection)
-    {
-        mysql_close(mConnection);
-    }
+    // A transaction that was never ended
+    mDatabase.release(std::move(mConnection));
 }
-    
+
 MySQLDatabaseCon::MySQLDatabaseCon(beast::StringPairArray& params, const char* initStrings[], int initCount)
 {
     assert(params[beast::String("type")] == "mysql"
@@ -349,19 +648,42 @@ MySQLDatabaseCon::MySQLDatabaseCon(beast::StringPairArray& params, const char* i
            && params[beast::String("username")] != beast::String::empty
            && params[beast::String("password")] != beast::String::empty
            && params[beast::String("database")] != beast::String::empty);
-    
+
     std::string host = params[beast::String("host")].toStdString();
     int port = boost::lexical_cast<int>(params[beast::String("port")].toStdString());
     std::string username = params[beast::String("username")].toStdString();
     std::string password = params[beast::String("password")].toStdString();
     std::string database = params[beast::String("database")].toStdString();
-    bool asyncBatch = getConfig().transactionDatabase[beast::String("async_batch")] == beast::String("true");
-    
-    mDatabase = new MySQLDatabase(host.c_str(), port, username.c_str(), password.c_str(), database.c_str(), asyncBatch);
+    bool asyncBatch = params[beast::String("async_batch")] == beast::String("true");
+    int poolSize = defaultPoolSize;
+    if (params[beast::String("pool_size")].isNotEmpty())
+        poolSize = params[beast::String("pool_size")].getIntValue();
+
+    mDatabase = new MySQLDatabase(host.c_str(), port, username.c_str(), password.c_str(), database.c_str(), asyncBatch, poolSize);
     mDatabase->connect ();
-    
+
     for (int i = 0; i < initCount; ++i)
         mDatabase->executeSQL (initStrings[i], true);
+
+    if (params[beast::String("replica_host")].isNotEmpty())
+    {
+        auto param = [&params](char const* name, std::string const& fallback)
+        {
+            auto const value = params[beast::String(name)];
+            return value.isEmpty() ? fallback : value.toStdString();
+        };
+
+        std::string replicaHost = param("replica_host", host);
+        int replicaPort = boost::lexical_cast<int>(
+            param("replica_port", std::to_string(port)));
+
+        // The replica is only read, it needs no schema and no batches
+        mReadDatabase = new MySQLDatabase(replicaHost.c_str(), replicaPort,
+            param("replica_username", username).c_str(),
+            param("replica_password", password).c_str(),
+            param("replica_database", database).c_str(), false, poolSize);
+        mReadDatabase->connect ();
+    }
 }
 
 } // ripple
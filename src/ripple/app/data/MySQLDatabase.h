@@ -6,17 +6,67 @@
 #include <beast/module/core/text/StringPairArray.h>
 #include <beast/utility/LeakChecked.h>
 #include <ripple/app/data/DatabaseCon.h>
+#include <condition_variable>
+#include <map>
+#include <memory>
 
 namespace ripple {
 
+/** Parameters of a statement prepared on the server.
+    Positions start at 1, as for SqliteStatement.
+*/
+class MySQLParams
+{
+public:
+    void bind (int position, std::string const& value);
+    void bind (int position, void const* data, std::size_t length);
+    void bind (int position, std::uint32_t value);
+    void bind (int position, std::uint64_t value);
+
+    void clear ()
+    {
+        mValues.clear ();
+    }
+
+private:
+    friend class MySQLDatabase;
+
+    struct Value
+    {
+        enum_field_types type = MYSQL_TYPE_NULL;
+        std::string data;
+        unsigned long long number = 0;
+    };
+
+    Value& at (int position);
+
+    std::vector <Value> mValues;
+};
+
+class MySQLConnection;
 class MySQLStatement;
-class MySQLThreadSpecificData;
+
+/** A MySQL database shared by all threads.
+
+    Statements run on connections taken from a bounded pool. A connection
+    is held only while a statement runs, or from beginTransaction to
+    endTransaction; results are read into memory, so a thread can step
+    through its rows after the connection went back to the pool. The rows
+    and batch of each thread are kept apart, so the database can be used
+    from several threads without an outside lock.
+
+    The statements of a batch are sent to the server a few at a time as
+    multi-statement queries instead of one round trip per statement.
+*/
 class MySQLDatabase
     : public Database
     , private beast::LeakChecked <MySQLDatabase>
 {
 public:
-    explicit MySQLDatabase (char const* host, std::uint32_t port, char const* username, char const* password, char const* database, bool asyncBatch);
+    // Largest multi-statement query a batch is split into
+    static std::size_t const maxBatchQuery = 1024 * 1024;
+
+    explicit MySQLDatabase (char const* host, std::uint32_t port, char const* username, char const* password, char const* database, bool asyncBatch, int poolSize);
     ~MySQLDatabase ();
 
     void connect (){};
@@ -25,7 +75,13 @@ public:
     // returns true if the query went ok
     bool executeSQL (const char* sql, bool fail_okay);
     bool executeSQLBatch();
-    
+
+    /** Run a statement that returns no rows, preparing it on the server
+        the first time each pooled connection sees it.
+        Not allowed in a batch.
+    */
+    bool executePrepared (std::string const& sql, MySQLParams const& params);
+
     bool batchStart() override;
     bool batchCommit() override;
 
@@ -39,11 +95,12 @@ public:
     // call this after you executeSQL
     // will return false if there are no more rows
     bool getNextRow (bool finalize);
-    
+
     bool beginTransaction() override;
     bool endTransaction() override;
 
     bool hasField(const std::string &table, const std::string &field) override;
+
     bool getNull (int colIndex);
     char* getStr (int colIndex, std::string& retStr);
     std::int32_t getInt (int colIndex);
@@ -53,42 +110,137 @@ public:
     int getBinary (int colIndex, unsigned char* buf, int maxSize);
     Blob getBinary (int colIndex);
     std::uint64_t getBigInt (int colIndex);
+
+    // Connections open now, and the most the pool opens
+    int getConnectionCount ();
+    int getPoolSize () const
+    {
+        return mPoolSize;
+    }
+
 private:
+    friend class MySQLStatement;
+
+    // Holds a connection while a statement runs. Uses the connection of
+    // the thread's transaction if there is one, else one from the pool.
+    class Lease
+    {
+    public:
+        explicit Lease (MySQLDatabase& db);
+        ~Lease ();
+
+        explicit operator bool () const
+        {
+            return mConnection != nullptr;
+        }
+
+        MySQLConnection* operator-> () const
+        {
+            return mConnection;
+        }
+
+        MySQLConnection& operator* () const
+        {
+            return *mConnection;
+        }
+
+    private:
+        MySQLDatabase& mDatabase;
+        std::unique_ptr <MySQLConnection> mOwned;
+        MySQLConnection* mConnection;
+    };
+
+    // Returns nullptr if a new connection could not be opened
+    std::unique_ptr <MySQLConnection> acquire ();
+    void release (std::unique_ptr <MySQLConnection> connection);
+
+    bool executeMulti (MySQLConnection& connection, std::string const& sql);
+
     bool getColNumber (const char* colName, int* retIndex);
     MySQLStatement *getStatement();
-    
+
     std::uint32_t mPort;
     std::string mUsername;
     std::string mPassword;
     std::string mDatabase;
     bool mAsyncBatch;
+    int const mPoolSize;
 
     boost::thread_specific_ptr<MySQLStatement> mStmt;
-    
-    std::list<std::string> mSqlQueue;
+
+    std::mutex mPoolLock;
+    std::condition_variable mPoolCond;
+    std::vector <std::unique_ptr <MySQLConnection>> mIdle;
+    int mConnections = 0;
+
+    // Batches waiting to be sent, each already joined into multi-statement
+    // queries. A batch stops at its first failed query.
+    std::list<std::list<std::string>> mSqlQueue;
     bool mThreadBatch = false;
     std::mutex mThreadBatchLock;
 };
-    
+
+// A connection in the pool, with the statements prepared on it
+class MySQLConnection
+{
+public:
+    MySQLConnection(char const* host, std::uint32_t port, char const* username, char const* password, char const* database);
+    ~MySQLConnection();
+
+    // Returns the statement prepared from sql, preparing it if needed
+    MYSQL_STMT* prepare (std::string const& sql);
+
+    // Forget a statement that failed, it is prepared again on next use
+    void discard (std::string const& sql);
+
+    MYSQL *mConnection;
+
+private:
+    std::map <std::string, MYSQL_STMT*> mPrepared;
+};
+
+// The rows and batch of one thread
 class MySQLStatement
 {
 public:
-    MySQLStatement(char const* host, std::uint32_t port, char const* username, char const* password, char const* database);
+    explicit MySQLStatement (MySQLDatabase& db);
     ~MySQLStatement();
 
-    MYSQL *mConnection;
+    MySQLDatabase& mDatabase;
+
+    // Held from beginTransaction to endTransaction
+    std::unique_ptr <MySQLConnection> mConnection;
+
     std::list<std::string> mSqlQueue;
     bool mInBatch;
     bool mMoreRows;
+    std::uint64_t mRowsAffected;
     std::vector <std::string> mColNameTable;
     MYSQL_RES *mResult;
     MYSQL_ROW mCurRow;
 };
-    
+
+/** The transaction database on MySQL.
+
+    Configured by the [transaction_db] section:
+
+    @code
+    type=mysql
+    host, port, username, password, database
+    async_batch=true      send batches from a job instead of the caller
+    pool_size=8           connections the pool opens at most
+    replica_host=...      a read replica for account_tx queries, which
+    replica_port=...      may lag the primary. The replica's username,
+                          password and database default to the primary's.
+    @endcode
+*/
 class MySQLDatabaseCon
     : public DatabaseCon
 {
 public:
+    // Used when pool_size is not set
+    static int const defaultPoolSize = 8;
+
     MySQLDatabaseCon (beast::StringPairArray& mysqlParams, const char* initString[], int countInit);
 };
 
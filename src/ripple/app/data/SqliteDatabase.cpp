@@ -422,6 +422,11 @@ int SqliteStatement::bind (int position, std::uint32_t value)
     return sqlite3_bind_int64 (statement, position, static_cast<sqlite3_int64> (value));
 }
 
+int SqliteStatement::bind (int position, std::uint64_t value)
+{
+    return sqlite3_bind_int64 (statement, position, static_cast<sqlite3_int64> (value));
+}
+
 int SqliteStatement::bind (int position, std::string const& value)
 {
     return sqlite3_bind_text (statement, position, value.data (), value.size (), SQLITE_TRANSIENT);
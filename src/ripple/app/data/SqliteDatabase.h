@@ -133,6 +133,7 @@ public:
     int bindStatic (int position, std::string const& value);
 
     int bind (int position, std::uint32_t value);
+    int bind (int position, std::uint64_t value);
     int bind (int position);
 
     // columns start at 0
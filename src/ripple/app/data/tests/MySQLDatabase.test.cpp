@@ -0,0 +1,235 @@
+#include <BeastConfig.h>
+#include <ripple/app/data/MySQLDatabase.h>
+#include <ripple/app/data/SqliteDatabase.h>
+#include <ripple/basics/StringUtilities.h>
+#include <beast/unit_test/suite.h>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+namespace ripple {
+
+// Compares the MySQL transaction database with SQLite. Needs a running
+// MySQL or MariaDB server and a database the user may create tables in,
+// given as the argument, for example:
+//
+//   host=127.0.0.1|port=3306|username=radard|password=radard|database=radard_test
+//
+// rows, pool_size and threads may also be set.
+class MySQLDatabaseTiming_test : public beast::unit_test::suite
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    static double
+    seconds(clock::time_point start)
+    {
+        return std::chrono::duration<double>(clock::now() - start).count();
+    }
+
+    static std::string
+    insertSQL(int id)
+    {
+        std::string const data(std::to_string(id) + "-payload-of-a-transaction");
+        return "INSERT INTO TimingTest (Id, Data) VALUES (" +
+            std::to_string(id) + ",X'" + strHex(data) + "');";
+    }
+
+    void
+    report(std::string const& name, int rows, double elapsed)
+    {
+        log << name << ": " << static_cast<std::uint64_t>(rows / elapsed) <<
+            " inserts/sec";
+    }
+
+    // Average microseconds to read one row by key
+    double
+    queryLatency(Database& db, int rows, int queries)
+    {
+        std::mt19937 gen(rows);
+        std::uniform_int_distribution<int> id(0, rows - 1);
+        int found = 0;
+        auto const start = clock::now();
+        for (int i = 0; i < queries; ++i)
+        {
+            if (SQL_EXISTS(&db, "SELECT Data FROM TimingTest WHERE Id = " +
+                    std::to_string(id(gen)) + ";"))
+            {
+                ++found;
+                db.endIterRows();
+            }
+        }
+        expect(found == queries, "missing rows");
+        return seconds(start) * 1000000 / queries;
+    }
+
+    void
+    testSqlite(int rows, int queries)
+    {
+        testcase("sqlite");
+
+        SqliteDatabase sqlite("");
+        Database& db = sqlite;
+        db.connect();
+        db.executeSQL("CREATE TABLE TimingTest (Id BIGINT PRIMARY KEY, Data BLOB);");
+
+        auto const start = clock::now();
+        db.beginTransaction();
+        for (int i = 0; i < rows; ++i)
+            db.executeSQL(insertSQL(i));
+        db.endTransaction();
+        report("sqlite, transaction", rows, seconds(start));
+
+        log << "sqlite query: " << queryLatency(db, rows, queries) << "us";
+        db.disconnect();
+    }
+
+    void
+    testMySQL(beast::StringPairArray& params, int rows, int queries,
+        int poolSize, int threads)
+    {
+        testcase("mysql");
+
+        MySQLDatabase mysql(params["host"].toStdString().c_str(),
+            params["port"].getIntValue(),
+            params["username"].toStdString().c_str(),
+            params["password"].toStdString().c_str(),
+            params["database"].toStdString().c_str(), false, poolSize);
+        Database& db = mysql;
+        db.connect();
+
+        if (!db.executeSQL("DROP TABLE IF EXISTS TimingTest;", false) ||
+            !db.executeSQL("CREATE TABLE TimingTest (Id BIGINT PRIMARY KEY, "
+                "Data BLOB) ENGINE=InnoDB;", false))
+        {
+            fail("cannot create TimingTest, is the server running?");
+            return;
+        }
+
+        {
+            // Pipelined: the batch goes to the server as a few queries
+            auto const start = clock::now();
+            db.batchStart();
+            db.beginTransaction();
+            for (int i = 0; i < rows; ++i)
+                db.executeSQL(insertSQL(i), false);
+            db.endTransaction();
+            expect(db.batchCommit());
+            report("mysql, pipelined batch", rows, seconds(start));
+        }
+
+        expect(db.executeSQL("SELECT COUNT(*) AS Count FROM TimingTest;", false) &&
+            db.startIterRows(false) && db.getBigInt(0) == rows, "batch rows");
+        db.endIterRows();
+
+        {
+            // A failed batch stops and rolls back, the rows before the
+            // failure are not committed
+            db.batchStart();
+            db.beginTransaction();
+            db.executeSQL(insertSQL(2 * rows), false);
+            db.executeSQL(insertSQL(0), false);
+            db.executeSQL(insertSQL(2 * rows + 1), false);
+            db.endTransaction();
+            expect(!db.batchCommit(), "duplicate key");
+        }
+
+        expect(db.executeSQL("SELECT COUNT(*) AS Count FROM TimingTest;", false) &&
+            db.startIterRows(false) && db.getBigInt(0) == rows, "rolled back");
+        db.endIterRows();
+
+        {
+            // BIGINT columns, like the dividend amounts, pass 32 bits
+            std::uint64_t const big = 5000000000;
+            expect(db.executeSQL("INSERT INTO TimingTest (Id, Data) VALUES (" +
+                std::to_string(big) + ",X'00');", false));
+            expect(db.executeSQL("SELECT Id FROM TimingTest WHERE Id > " +
+                std::to_string(2 * rows) + ";", false) &&
+                db.startIterRows(false) && db.getBigInt(0) == big, "bigint");
+            db.endIterRows();
+            db.executeSQL("DELETE FROM TimingTest WHERE Id = " +
+                std::to_string(big) + ";", false);
+        }
+
+        {
+            // Prepared: one round trip per row, but no parsing
+            std::string const sql("INSERT INTO TimingTest (Id, Data) VALUES (?, ?);");
+            MySQLParams params;
+            auto const start = clock::now();
+            db.beginTransaction();
+            for (int i = rows; i < 2 * rows; ++i)
+            {
+                std::string const data(std::to_string(i) + "-payload-of-a-transaction");
+                params.bind(1, static_cast<std::uint32_t>(i));
+                params.bind(2, data.data(), data.size());
+                expect(mysql.executePrepared(sql, params));
+                expect(mysql.getNumRowsAffected() == 1);
+            }
+            db.endTransaction();
+            report("mysql, prepared", rows, seconds(start));
+        }
+
+        log << "mysql query: " << queryLatency(db, 2 * rows, queries) << "us";
+
+        {
+            // More threads than connections share the pool
+            std::atomic<int> done(0);
+            std::vector<std::thread> workers;
+            auto const start = clock::now();
+            for (int t = 0; t < threads; ++t)
+            {
+                workers.emplace_back([&, t]
+                {
+                    std::string const sql("SELECT Data FROM TimingTest WHERE Id = " +
+                        std::to_string(t) + ";");
+                    for (int i = 0; i < queries; ++i)
+                    {
+                        if (SQL_EXISTS(&db, sql))
+                            ++done;
+                        db.endIterRows();
+                    }
+                });
+            }
+            for (auto& worker : workers)
+                worker.join();
+            auto const elapsed = seconds(start);
+            expect(done == threads * queries, "pooled queries");
+            expect(mysql.getConnectionCount() <= mysql.getPoolSize(), "pool bound");
+            log << "mysql " << threads << " threads, " << poolSize <<
+                " connections: " << static_cast<std::uint64_t>(
+                    done / elapsed) << " queries/sec";
+        }
+
+        db.executeSQL("DROP TABLE TimingTest;", false);
+    }
+
+    void
+    run()
+    {
+        auto params = parseDelimitedKeyValueString(arg());
+        if (params["host"].isEmpty() || params["database"].isEmpty())
+        {
+            log << "usage: host=...|port=...|username=...|password=...|database=...";
+            pass();
+            return;
+        }
+        if (params["port"].isEmpty())
+            params.set("port", "3306");
+
+        auto value = [&params](char const* name, int fallback)
+        {
+            return params[name].isEmpty() ? fallback : params[name].getIntValue();
+        };
+        int const rows = value("rows", 100000);
+        int const queries = 10000;
+
+        testSqlite(rows, queries);
+        testMySQL(params, rows, queries, value("pool_size",
+            MySQLDatabaseCon::defaultPoolSize), value("threads", 32));
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(MySQLDatabaseTiming,ripple_app,ripple);
+
+}
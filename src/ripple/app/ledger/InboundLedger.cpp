@@ -27,12 +27,14 @@
 #include <ripple/app/main/Application.h>
 #include <ripple/app/misc/NetworkOPs.h>
 #include <ripple/basics/Log.h>
+#include <ripple/core/Config.h>
 #include <ripple/core/JobQueue.h>
 #include <ripple/overlay/Overlay.h>
 #include <ripple/resource/Fees.h>
 #include <ripple/protocol/HashPrefix.h>
 #include <ripple/nodestore/Database.h>
 #include <boost/foreach.hpp>
+#include <algorithm>
 
 namespace ripple {
 
@@ -46,8 +48,28 @@ enum
 
     // how many timeouts before we get aggressive
     ,ledgerBecomeAggressiveThreshold = 6
+
+    // how many nodes to ask one peer for in one request
+    ,ledgerNodesPerRequest = 128
+
+    // how many missing nodes to look for at least
+    ,ledgerMissingNodes = 256
+
+    // how many jobs may process received data for one ledger at once
+    ,ledgerDataJobs = 4
 };
 
+static std::vector<Peer::id_t> getIds (std::vector<Peer::ptr> const& peers)
+{
+    std::vector<Peer::id_t> ids;
+    ids.reserve (peers.size ());
+
+    for (auto const& peer : peers)
+        ids.push_back (peer->id ());
+
+    return ids;
+}
+
 InboundLedger::InboundLedger (uint256 const& hash, std::uint32_t seq, fcReason reason,
     clock_type& clock)
     : PeerSet (hash, ledgerAcquireTimeoutMillis, false, clock,
@@ -60,7 +82,10 @@ InboundLedger::InboundLedger (uint256 const& hash, std::uint32_t seq, fcReason r
     , mByHash (true)
     , mSeq (seq)
     , mReason (reason)
-    , mReceiveDispatched (false)
+    , mScheduler (clock, getConfig ().LEDGER_FETCH_REQUESTS,
+        ledgerNodesPerRequest,
+            std::chrono::milliseconds (ledgerAcquireTimeoutMillis))
+    , mDataJobs (0)
 {
 
     if (m_journal.trace) m_journal.trace <<
@@ -236,6 +261,7 @@ void InboundLedger::onTimer (bool wasProgress, ScopedLockType&)
 {
     mRecentTXNodes.clear ();
     mRecentASNodes.clear ();
+    mScheduler.expire ();
 
     if (isDone())
     {
@@ -355,6 +381,68 @@ std::weak_ptr<PeerSet> InboundLedger::pmDowncast ()
     return std::dynamic_pointer_cast<PeerSet> (shared_from_this ());
 }
 
+/** The peers to ask for nodes: the given one, or else all of the set
+    Call with a lock
+*/
+std::vector<Peer::ptr> InboundLedger::getRequestPeers (Peer::ptr const& peer)
+{
+    std::vector<Peer::ptr> peers;
+
+    if (peer)
+    {
+        peers.push_back (peer);
+        return peers;
+    }
+
+    peers.reserve (mPeers.size ());
+    for (auto const& p : mPeers)
+    {
+        Peer::ptr iPeer (getApp().overlay ().findPeerByShortID (p.first));
+
+        if (iPeer)
+            peers.push_back (iPeer);
+        else
+            mScheduler.removePeer (p.first);
+    }
+
+    return peers;
+}
+
+/** Split the nodes between the peers and send the requests
+    Call with a lock
+*/
+void InboundLedger::sendNodeRequests (protocol::TMGetLedger& tmGL,
+    std::vector<SHAMapNodeID> const& nodeIDs,
+    std::set<SHAMapNodeID>& recentNodes, std::vector<Peer::ptr> const& peers)
+{
+    auto const requests = mScheduler.assign (nodeIDs, getIds (peers));
+
+    for (auto const& request : requests)
+    {
+        tmGL.clear_nodeids ();
+
+        for (auto const& nodeID : request.nodes)
+        {
+            * (tmGL.add_nodeids ()) = nodeID.getRawString ();
+            recentNodes.insert (nodeID);
+        }
+
+        auto const iPeer = std::find_if (peers.begin (), peers.end (),
+            [&request] (Peer::ptr const& p)
+            {
+                return p->id () == request.peer;
+            });
+        assert (iPeer != peers.end ());
+
+        (*iPeer)->send (std::make_shared<Message> (
+            tmGL, protocol::mtGET_LEDGER));
+    }
+
+    if (m_journal.trace) m_journal.trace <<
+        "Sent " << requests.size () << " requests for " << nodeIDs.size () <<
+            " nodes to " << peers.size () << " peers";
+}
+
 /** Dispatch acquire completion
 */
 static void LADispatch (
@@ -566,17 +654,23 @@ void InboundLedger::trigger (Peer::ptr const& peer)
         }
         else
         {
+            // Look past the nodes already in flight for enough new
+            // ones to fill every free request slot
+            std::vector<Peer::ptr> peers (getRequestPeers (peer));
+            int const capacity = mScheduler.getCapacity (getIds (peers));
+            int const max = std::max<int> (ledgerMissingNodes,
+                capacity + mRecentASNodes.size ());
+
             std::vector<SHAMapNodeID> nodeIDs;
             std::vector<uint256> nodeHashes;
-            // VFALCO Why 256? Make this a constant
-            nodeIDs.reserve (256);
-            nodeHashes.reserve (256);
+            nodeIDs.reserve (max);
+            nodeHashes.reserve (max);
             AccountStateSF filter;
 
             // Release the lock while we process the large state map
             sl.unlock();
             mLedger->peekAccountStateMap ()->getMissingNodes (
-                nodeIDs, nodeHashes, 256, &filter);
+                nodeIDs, nodeHashes, max, &filter);
             sl.lock();
 
             // Make sure nothing happened while we released the lock
@@ -596,25 +690,20 @@ void InboundLedger::trigger (Peer::ptr const& peer)
                 }
                 else
                 {
-                    // VFALCO Why 128? Make this a constant
                     if (!mAggressive)
                         filterNodes (nodeIDs, nodeHashes, mRecentASNodes,
-                            128, !isProgress ());
+                            std::max (capacity, 1), !isProgress ());
 
                     if (!nodeIDs.empty ())
                     {
                         tmGL.set_itype (protocol::liAS_NODE);
-                        BOOST_FOREACH (SHAMapNodeID const& it, nodeIDs)
-                        {
-                            * (tmGL.add_nodeids ()) = it.getRawString ();
-                        }
                         if (m_journal.trace) m_journal.trace <<
                             "Sending AS node " << nodeIDs.size () <<
                                 " request to " << (
                                     peer ? "selected peer" : "all peers");
                         if (nodeIDs.size () == 1 && m_journal.trace) m_journal.trace <<
                             "AS node: " << nodeIDs[0];
-                        sendRequest (tmGL, peer);
+                        sendNodeRequests (tmGL, nodeIDs, mRecentASNodes, peers);
                         return;
                     }
                     else
@@ -646,13 +735,18 @@ void InboundLedger::trigger (Peer::ptr const& peer)
         }
         else
         {
+            std::vector<Peer::ptr> peers (getRequestPeers (peer));
+            int const capacity = mScheduler.getCapacity (getIds (peers));
+            int const max = std::max<int> (ledgerMissingNodes,
+                capacity + mRecentTXNodes.size ());
+
             std::vector<SHAMapNodeID> nodeIDs;
             std::vector<uint256> nodeHashes;
-            nodeIDs.reserve (256);
-            nodeHashes.reserve (256);
+            nodeIDs.reserve (max);
+            nodeHashes.reserve (max);
             TransactionStateSF filter;
             mLedger->peekTransactionMap ()->getMissingNodes (
-                nodeIDs, nodeHashes, 256, &filter);
+                nodeIDs, nodeHashes, max, &filter);
 
             if (nodeIDs.empty ())
             {
@@ -670,20 +764,16 @@ void InboundLedger::trigger (Peer::ptr const& peer)
             {
                 if (!mAggressive)
                     filterNodes (nodeIDs, nodeHashes, mRecentTXNodes,
-                        128, !isProgress ());
+                        std::max (capacity, 1), !isProgress ());
 
                 if (!nodeIDs.empty ())
                 {
                     tmGL.set_itype (protocol::liTX_NODE);
-                    BOOST_FOREACH (SHAMapNodeID const& it, nodeIDs)
-                    {
-                        * (tmGL.add_nodeids ()) = it.getRawString ();
-                    }
                     if (m_journal.trace) m_journal.trace <<
                         "Sending TX node " << nodeIDs.size () <<
                         " request to " << (
                             peer ? "selected peer" : "all peers");
-                    sendRequest (tmGL, peer);
+                    sendNodeRequests (tmGL, nodeIDs, mRecentTXNodes, peers);
                     return;
                 }
                 else
@@ -769,10 +859,7 @@ void InboundLedger::filterNodes (std::vector<SHAMapNodeID>& nodeIDs,
         nodeHashes.resize (max);
     }
 
-    BOOST_FOREACH (const SHAMapNodeID & n, nodeIDs)
-    {
-        recentNodes.insert (n);
-    }
+    // The nodes are marked as recent when a request for them is sent
 }
 
 /** Take ledger header data
@@ -823,8 +910,8 @@ bool InboundLedger::takeHeader (std::string const& data)
 /** Process TX data received from a peer
     Call with a lock
 */
-bool InboundLedger::takeTxNode (const std::list<SHAMapNodeID>& nodeIDs,
-    const std::list< Blob >& data, SHAMapAddNode& san)
+bool InboundLedger::takeTxNode (std::vector<ReceivedNode> const& nodes,
+    SHAMapAddNode& san)
 {
     if (!mHaveHeader)
     {
@@ -840,29 +927,24 @@ bool InboundLedger::takeTxNode (const std::list<SHAMapNodeID>& nodeIDs,
         return true;
     }
 
-    std::list<SHAMapNodeID>::const_iterator nodeIDit = nodeIDs.begin ();
-    std::list< Blob >::const_iterator nodeDatait = data.begin ();
     TransactionStateSF tFilter;
 
-    while (nodeIDit != nodeIDs.end ())
+    for (auto const& node : nodes)
     {
-        if (nodeIDit->isRoot ())
+        if (node.id.isRoot ())
         {
             san += mLedger->peekTransactionMap ()->addRootNode (
-                mLedger->getTransHash (), *nodeDatait, snfWIRE, &tFilter);
+                mLedger->getTransHash (), node.data, snfWIRE, &tFilter);
             if (!san.isGood())
                 return false;
         }
         else
         {
             san +=  mLedger->peekTransactionMap ()->addKnownNode (
-                *nodeIDit, *nodeDatait, &tFilter);
+                node.id, node.node, &tFilter);
             if (!san.isGood())
                 return false;
         }
-
-        ++nodeIDit;
-        ++nodeDatait;
     }
 
     if (!mLedger->peekTransactionMap ()->isSynching ())
@@ -883,13 +965,13 @@ bool InboundLedger::takeTxNode (const std::list<SHAMapNodeID>& nodeIDs,
 /** Process AS data received from a peer
     Call with a lock
 */
-bool InboundLedger::takeAsNode (const std::list<SHAMapNodeID>& nodeIDs,
-    const std::list< Blob >& data, SHAMapAddNode& san)
+bool InboundLedger::takeAsNode (std::vector<ReceivedNode> const& nodes,
+    SHAMapAddNode& san)
 {
     if (m_journal.trace) m_journal.trace <<
-        "got ASdata (" << nodeIDs.size () << ") acquiring ledger " << mHash;
-    if (nodeIDs.size () == 1 && m_journal.trace) m_journal.trace <<
-        "got AS node: " << nodeIDs.front ();
+        "got ASdata (" << nodes.size () << ") acquiring ledger " << mHash;
+    if (nodes.size () == 1 && m_journal.trace) m_journal.trace <<
+        "got AS node: " << nodes.front ().id;
 
     ScopedLockType sl (mLock);
 
@@ -907,16 +989,14 @@ bool InboundLedger::takeAsNode (const std::list<SHAMapNodeID>& nodeIDs,
         return true;
     }
 
-    std::list<SHAMapNodeID>::const_iterator nodeIDit = nodeIDs.begin ();
-    std::list< Blob >::const_iterator nodeDatait = data.begin ();
     AccountStateSF tFilter;
 
-    while (nodeIDit != nodeIDs.end ())
+    for (auto const& node : nodes)
     {
-        if (nodeIDit->isRoot ())
+        if (node.id.isRoot ())
         {
             san += mLedger->peekAccountStateMap ()->addRootNode (
-                mLedger->getAccountHash (), *nodeDatait, snfWIRE, &tFilter);
+                mLedger->getAccountHash (), node.data, snfWIRE, &tFilter);
             if (!san.isGood ())
             {
                 if (m_journal.warning) m_journal.warning <<
@@ -927,7 +1007,7 @@ bool InboundLedger::takeAsNode (const std::list<SHAMapNodeID>& nodeIDs,
         else
         {
             san += mLedger->peekAccountStateMap ()->addKnownNode (
-                *nodeIDit, *nodeDatait, &tFilter);
+                node.id, node.node, &tFilter);
             if (!san.isGood ())
             {
                 if (m_journal.warning) m_journal.warning <<
@@ -935,9 +1015,6 @@ bool InboundLedger::takeAsNode (const std::list<SHAMapNodeID>& nodeIDs,
                 return false;
             }
         }
-
-        ++nodeIDit;
-        ++nodeDatait;
     }
 
     if (!mLedger->peekAccountStateMap ()->isSynching ())
@@ -1050,10 +1127,10 @@ bool InboundLedger::gotData (std::weak_ptr<Peer> peer,
 
     mReceivedData.push_back (PeerDataPairType (peer, data));
 
-    if (mReceiveDispatched)
+    if (mDataJobs >= ledgerDataJobs)
         return false;
 
-    mReceiveDispatched = true;
+    ++mDataJobs;
     return true;
 }
 
@@ -1068,10 +1145,10 @@ bool InboundLedger::gotData (std::weak_ptr<Peer> peer,
 int InboundLedger::processData (std::shared_ptr<Peer> peer,
     protocol::TMLedgerData& packet)
 {
-    ScopedLockType sl (mLock);
-
     if (packet.type () == protocol::liBASE)
     {
+        ScopedLockType sl (mLock);
+
         if (packet.nodes_size () < 1)
         {
             if (m_journal.warning) m_journal.warning <<
@@ -1122,9 +1199,6 @@ int InboundLedger::processData (std::shared_ptr<Peer> peer,
     if ((packet.type () == protocol::liTX_NODE) || (
         packet.type () == protocol::liAS_NODE))
     {
-        std::list<SHAMapNodeID> nodeIDs;
-        std::list< Blob > nodeData;
-
         if (packet.nodes ().size () == 0)
         {
             if (m_journal.info) m_journal.info <<
@@ -1133,44 +1207,79 @@ int InboundLedger::processData (std::shared_ptr<Peer> peer,
             return -1;
         }
 
-        for (int i = 0; i < packet.nodes ().size (); ++i)
-        {
-            const protocol::TMLedgerNode& node = packet.nodes (i);
+        // Decode and hash the nodes before taking the lock, so that
+        // replies from several peers are worked on at once
+        std::vector<ReceivedNode> nodes;
+        nodes.reserve (packet.nodes ().size ());
+        std::size_t bytes = 0;
+        uint256 const uZero;
 
-            if (!node.has_nodeid () || !node.has_nodedata ())
+        try
+        {
+            for (int i = 0; i < packet.nodes ().size (); ++i)
             {
-                if (m_journal.warning) m_journal.warning <<
-                    "Got bad node";
-                peer->charge (Resource::feeInvalidRequest);
-                return -1;
-            }
+                const protocol::TMLedgerNode& node = packet.nodes (i);
 
-            nodeIDs.push_back (SHAMapNodeID (node.nodeid ().data (),
-                node.nodeid ().size ()));
-            nodeData.push_back (Blob (node.nodedata ().begin (),
-                node.nodedata ().end ()));
-        }
+                if (!node.has_nodeid () || !node.has_nodedata ())
+                {
+                    if (m_journal.warning) m_journal.warning <<
+                        "Got bad node";
+                    peer->charge (Resource::feeInvalidRequest);
+                    return -1;
+                }
 
-        SHAMapAddNode ret;
+                ReceivedNode received;
+                received.id = SHAMapNodeID (node.nodeid ().data (),
+                    node.nodeid ().size ());
+                Blob data (node.nodedata ().begin (), node.nodedata ().end ());
+                bytes += data.size ();
+
+                if (received.id.isRoot ())
+                    received.data = std::move (data);
+                else
+                    received.node = std::make_shared<SHAMapTreeNode> (
+                        data, 0, snfWIRE, uZero, false);
 
-        if (packet.type () == protocol::liTX_NODE)
+                nodes.push_back (std::move (received));
+            }
+        }
+        catch (std::exception const&)
         {
-            takeTxNode (nodeIDs, nodeData, ret);
-            if (m_journal.debug) m_journal.debug <<
-                "Ledger TX node stats: " << ret.get();
+            if (m_journal.warning) m_journal.warning <<
+                "Got malformed node";
+            peer->charge (Resource::feeInvalidRequest);
+            return -1;
         }
-        else
+
+        SHAMapAddNode ret;
         {
-            takeAsNode (nodeIDs, nodeData, ret);
-            if (m_journal.debug) m_journal.debug <<
-                "Ledger AS node stats: " << ret.get();
+            ScopedLockType sl (mLock);
+
+            if (packet.type () == protocol::liTX_NODE)
+            {
+                takeTxNode (nodes, ret);
+                if (m_journal.debug) m_journal.debug <<
+                    "Ledger TX node stats: " << ret.get();
+            }
+            else
+            {
+                takeAsNode (nodes, ret);
+                if (m_journal.debug) m_journal.debug <<
+                    "Ledger AS node stats: " << ret.get();
+            }
+
+            // Root requests go to every peer outside the scheduler
+            if (!nodes.front ().id.isRoot ())
+                mScheduler.onReply (peer->id (), nodes.size (), bytes);
+
+            if (!ret.isInvalid ())
+                progress ();
+            else
+                if (m_journal.debug) m_journal.debug <<
+                    "Peer sends invalid node data";
         }
 
-        if (!ret.isInvalid ())
-            progress ();
-        else
-            if (m_journal.debug) m_journal.debug <<
-                "Peer sends invalid node data";
+        getApp().getInboundLedgers ().gotNodes (nodes.size (), bytes);
 
         return ret.getGood ();
     }
@@ -1179,48 +1288,38 @@ int InboundLedger::processData (std::shared_ptr<Peer> peer,
 }
 
 /** Process pending TMLedgerData
-    Query the 'best' peer
+    Then refill the request slots the replies freed
 */
 void InboundLedger::runData ()
 {
-    std::shared_ptr<Peer> chosenPeer;
-    int chosenPeerCount = -1;
+    bool processed = false;
 
-    std::vector <PeerDataPairType> data;
-    do
+    for (;;)
     {
-        data.clear();
+        PeerDataPairType entry;
         {
             ScopedLockType sl (mReceivedDataLock);
 
             if (mReceivedData.empty ())
             {
-                mReceiveDispatched = false;
+                --mDataJobs;
                 break;
             }
-            data.swap(mReceivedData);
+
+            entry = std::move (mReceivedData.front ());
+            mReceivedData.pop_front ();
         }
 
-        // Select the peer that gives us the most nodes that are useful,
-        // breaking ties in favor of the peer that responded first.
-        for (auto& entry : data)
+        Peer::ptr peer = entry.first.lock();
+        if (peer)
         {
-            Peer::ptr peer = entry.first.lock();
-            if (peer)
-            {
-                int count = processData (peer, *(entry.second));
-                if (count > chosenPeerCount)
-                {
-                    chosenPeer = peer;
-                    chosenPeerCount = count;
-                }
-            }
+            processData (peer, *(entry.second));
+            processed = true;
         }
+    }
 
-    } while (1);
-
-    if (chosenPeer)
-        trigger (chosenPeer);
+    if (processed)
+        trigger (Peer::ptr ());
 }
 
 Json::Value InboundLedger::getJson (int)
@@ -1253,6 +1352,9 @@ Json::Value InboundLedger::getJson (int)
 
     ret["timeouts"] = getTimeouts ();
 
+    if (!mComplete && !mFailed)
+        ret["requests"] = mScheduler.getJson ();
+
     if (mHaveHeader && !mHaveState)
     {
         Json::Value hv (Json::arrayValue);
@@ -21,8 +21,10 @@
 #define RIPPLE_INBOUNDLEDGER_H
 
 #include <ripple/app/ledger/Ledger.h>
+#include <ripple/app/peers/AcquireScheduler.h>
 #include <ripple/app/peers/PeerSet.h>
 #include <ripple/basics/CountedObject.h>
+#include <deque>
 #include <set>
 
 namespace ripple {
@@ -93,6 +95,9 @@ public:
     bool checkLocal ();
     void init (ScopedLockType& collectionLock);
 
+    /** Queue data received from a peer.
+        @return `true` if another job should be added to process it.
+    */
     bool gotData (std::weak_ptr<Peer>, std::shared_ptr<protocol::TMLedgerData>);
 
     typedef std::pair <protocol::TMGetObjectByHash::ObjectType, uint256> neededHash_t;
@@ -105,9 +110,19 @@ public:
 
     /** Return a Json::objectValue. */
     Json::Value getJson (int);
+
+    /** Process queued data. Several jobs may run this at once. */
     void runData ();
 
 private:
+    /** A tree node received from a peer. */
+    struct ReceivedNode
+    {
+        SHAMapNodeID id;
+        Blob data;                      // Only kept for the root
+        SHAMapTreeNode::pointer node;   // Decoded before taking the lock
+    };
+
     void done ();
 
     void onTimer (bool progress, ScopedLockType& peerSetLock);
@@ -119,19 +134,24 @@ private:
 
     std::weak_ptr <PeerSet> pmDowncast ();
 
+    std::vector <Peer::ptr> getRequestPeers (Peer::ptr const& peer);
+
+    void sendNodeRequests (protocol::TMGetLedger& tmGL,
+        std::vector <SHAMapNodeID> const& nodeIDs,
+        std::set <SHAMapNodeID>& recentNodes,
+        std::vector <Peer::ptr> const& peers);
+
     int processData (std::shared_ptr<Peer> peer, protocol::TMLedgerData& data);
 
     bool takeHeader (std::string const& data);
-    bool takeTxNode (const std::list<SHAMapNodeID>& IDs, const std::list<Blob >& data,
-                     SHAMapAddNode&);
+    bool takeTxNode (std::vector <ReceivedNode> const& nodes, SHAMapAddNode&);
     bool takeTxRootNode (Blob const& data, SHAMapAddNode&);
 
     // VFALCO TODO Rename to receiveAccountStateNode
     //             Don't use acronyms, but if we are going to use them at least
     //             capitalize them correctly.
     //
-    bool takeAsNode (const std::list<SHAMapNodeID>& IDs, const std::list<Blob >& data,
-                     SHAMapAddNode&);
+    bool takeAsNode (std::vector <ReceivedNode> const& nodes, SHAMapAddNode&);
     bool takeAsRootNode (Blob const& data, SHAMapAddNode&);
 
 private:
@@ -148,11 +168,13 @@ private:
     std::set <SHAMapNodeID> mRecentTXNodes;
     std::set <SHAMapNodeID> mRecentASNodes;
 
+    // Which peers to ask for which nodes. Protected by mLock.
+    AcquireScheduler mScheduler;
 
     // Data we have received from peers
     PeerSet::LockType mReceivedDataLock;
-    std::vector <PeerDataPairType> mReceivedData;
-    bool mReceiveDispatched;
+    std::deque <PeerDataPairType> mReceivedData;
+    int mDataJobs;      // Jobs running runData
 
     std::vector <std::function <void (InboundLedger::pointer)> > mOnComplete;
 };
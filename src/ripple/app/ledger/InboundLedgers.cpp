@@ -21,9 +21,11 @@
 #include <ripple/app/ledger/InboundLedgers.h>
 #include <ripple/app/main/Application.h>
 #include <ripple/app/misc/NetworkOPs.h>
+#include <ripple/basics/DecayingSample.h>
 #include <ripple/basics/Log.h>
 #include <ripple/core/JobQueue.h>
 #include <beast/cxx14/memory.h> // <memory>
+#include <mutex>
 
 namespace ripple {
 
@@ -44,6 +46,10 @@ public:
         , mRecentFailures ("LedgerAcquireRecentFailures",
             clock, 0, kReacquireIntervalSeconds)
         , mCounter(collector->make_counter("ledger_fetches"))
+        , mNodeRate (clock.now ())
+        , mByteRate (clock.now ())
+        , mTotalNodes (0)
+        , mTotalBytes (0)
     {
     }
 
@@ -310,6 +316,33 @@ public:
     return ret;
     }
 
+    void gotNodes (std::size_t nodes, std::size_t bytes)
+    {
+        auto const now = m_clock.now ();
+        std::lock_guard <std::mutex> lock (mThroughputLock);
+
+        mNodeRate.add (nodes, now);
+        mByteRate.add (bytes, now);
+        mTotalNodes += nodes;
+        mTotalBytes += bytes;
+    }
+
+    Json::Value getThroughput ()
+    {
+        auto const now = m_clock.now ();
+        Json::Value ret (Json::objectValue);
+        std::lock_guard <std::mutex> lock (mThroughputLock);
+
+        ret["nodes_per_second"] = static_cast <Json::UInt> (
+            mNodeRate.value (now));
+        ret["bytes_per_second"] = static_cast <Json::UInt> (
+            mByteRate.value (now));
+        ret["nodes"] = static_cast <Json::UInt> (mTotalNodes);
+        ret["bytes"] = static_cast <Json::UInt> (mTotalBytes);
+
+        return ret;
+    }
+
     void gotFetchPack (Job&)
     {
         std::vector<InboundLedger::pointer> acquires;
@@ -397,6 +430,13 @@ private:
     uint256 mValidationLedger;
 
     beast::insight::Counter mCounter;
+
+    // Received tree nodes, over all inbound ledgers
+    std::mutex mThroughputLock;
+    DecayWindow <10, clock_type> mNodeRate;
+    DecayWindow <10, clock_type> mByteRate;
+    std::uint64_t mTotalNodes;
+    std::uint64_t mTotalBytes;
 };
 
 //------------------------------------------------------------------------------
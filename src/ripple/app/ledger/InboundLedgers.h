@@ -71,6 +71,12 @@ public:
 
     virtual Json::Value getInfo() = 0;
 
+    /** Count tree nodes received for any inbound ledger. */
+    virtual void gotNodes (std::size_t nodes, std::size_t bytes) = 0;
+
+    /** Nodes and bytes received per second over all inbound ledgers. */
+    virtual Json::Value getThroughput() = 0;
+
     virtual void gotFetchPack (Job&) = 0;
     virtual void sweep () = 0;
 
@@ -24,7 +24,7 @@
 #include <ripple/app/ledger/LedgerMaster.h>
 #include <ripple/app/ledger/LedgerTiming.h>
 #include <ripple/app/ledger/LedgerToJson.h>
-#include <ripple/app/ledger/OrderBookDB.h>
+#include <ripple/app/ledger/TransactionIndexer.h>
 #include <ripple/app/data/DatabaseCon.h>
 #include <ripple/app/data/SqliteDatabase.h>
 #include <ripple/app/main/Application.h>
@@ -656,7 +656,7 @@ uint256 Ledger::getHash ()
     return mHash;
 }
 
-bool Ledger::saveValidatedLedger (bool current)
+bool Ledger::saveValidatedLedger (bool current, bool isSynchronous)
 {
     // TODO(tom): Fix this hard-coded SQL!
     WriteLog (lsTRACE, Ledger)
@@ -664,22 +664,6 @@ bool Ledger::saveValidatedLedger (bool current)
         << (current ? "" : "fromAcquire ") << getLedgerSeq ();
     static boost::format deleteLedger (
         "DELETE FROM Ledgers WHERE LedgerSeq = %u;");
-    static boost::format deleteTrans1 (
-        "DELETE FROM Transactions WHERE LedgerSeq = %u;");
-    static boost::format deleteTrans2 (
-        "DELETE FROM AccountTransactions WHERE LedgerSeq = %u;");
-    static boost::format deleteAcctTrans (
-        "DELETE FROM AccountTransactions WHERE TransID = '%s';");
-    static boost::format transExists (
-        "SELECT Status FROM Transactions WHERE TransID = '%s';");
-    static boost::format updateTx (
-        "UPDATE Transactions SET LedgerSeq = %u, Status = '%c', TxnMeta = %s "
-        "WHERE TransID = '%s';");
-    static boost::format addLedger (
-        "INSERT OR REPLACE INTO Ledgers "
-        "(LedgerHash,LedgerSeq,PrevHash,TotalCoins,TotalCoinsVBC,ClosingTime,PrevClosingTime,"
-        "CloseTimeRes,CloseFlags,DividendLedger,AccountSetHash,TransSetHash) VALUES "
-        "('%s','%u','%s','%s','%s','%u','%u','%d','%u','%u','%s','%s');");
 
     if (!getAccountHash ().isNonZero ())
     {
@@ -733,82 +717,37 @@ bool Ledger::saveValidatedLedger (bool current)
             boost::str (deleteLedger % mLedgerSeq));
     }
     
-    if (getApp().getTxnDB().getDB()->getDBType()!=Database::Type::Null)
+    if (aLedger)
     {
-        auto db = getApp().getTxnDB ().getDB ();
-        auto dbLock (getApp().getTxnDB ().lock ());
-        db->batchStart();
-        db->beginTransaction();
-
-        db->executeSQL (boost::str (deleteTrans1 % getLedgerSeq ()));
-        db->executeSQL (boost::str (deleteTrans2 % getLedgerSeq ()));
-
-        std::string const ledgerSeq (std::to_string (getLedgerSeq ()));
-
         for (auto const& vt : aLedger->getMap ())
-        {
-            uint256 transactionID = vt.second->getTransactionID ();
-
             getApp().getMasterTransaction ().inLedger (
-                transactionID, getLedgerSeq ());
-
-            std::string const txnId (to_string (transactionID));
-            std::string const txnSeq (std::to_string (vt.second->getTxnSeq ()));
+                vt.second->getTransactionID (), getLedgerSeq ());
 
-            db->executeSQL (boost::str (deleteAcctTrans % transactionID));
+        // The Ledgers row is written once the transactions are, so that
+        // a ledger in the Ledgers table always has its transactions.
+        auto& indexer = getApp().getLedgerMaster ().getTransactionIndexer ();
 
-            auto const& accts = vt.second->getAffected ();
+        if (!isSynchronous)
+        {
+            indexer.addLedger (aLedger,
+                std::bind (&Ledger::saveLedgerRow, shared_from_this ()));
+            return true;
+        }
 
-            if (!accts.empty ())
-            {
-                std::string sql ("INSERT INTO AccountTransactions "
-                                 "(TransID, Account, LedgerSeq, TxnSeq) VALUES ");
+        indexer.writeLedger (*aLedger);
+    }
 
-                // Try to make an educated guess on how much space we'll need
-                // for our arguments. In argument order we have:
-                // 64 + 34 + 10 + 10 = 118 + 10 extra = 128 bytes
-                sql.reserve (sql.length () + (accts.size () * 128));
+    saveLedgerRow ();
+    return true;
+}
 
-                bool first = true;
-                for (auto const& it : accts)
-                {
-                    if (!first)
-                        sql += ", ('";
-                    else
-                    {
-                        sql += "('";
-                        first = false;
-                    }
-
-                    sql += txnId;
-                    sql += "','";
-                    sql += it.humanAccountID ();
-                    sql += "',";
-                    sql += ledgerSeq;
-                    sql += ",";
-                    sql += txnSeq;
-                    sql += ")";
-                }
-                sql += ";";
-                if (ShouldLog (lsTRACE, Ledger))
-                {
-                    WriteLog (lsTRACE, Ledger) << "ActTx: " << sql;
-                }
-                db->executeSQL (sql);
-            }
-            else
-                WriteLog (lsWARNING, Ledger)
-                    << "Transaction in ledger " << mLedgerSeq
-                    << " affects no accounts";
-
-            db->executeSQL (
-                STTx::getMetaSQLInsertReplaceHeader (db->getDBType()) +
-                vt.second->getTxn ()->getMetaSQL (
-                    getLedgerSeq (), vt.second->getEscMeta (), mCloseTime) + ";");
-        }
-        db->endTransaction();
-        db->batchCommit();
-    }
+void Ledger::saveLedgerRow ()
+{
+    static boost::format addLedger (
+        "INSERT OR REPLACE INTO Ledgers "
+        "(LedgerHash,LedgerSeq,PrevHash,TotalCoins,TotalCoinsVBC,ClosingTime,PrevClosingTime,"
+        "CloseTimeRes,CloseFlags,DividendLedger,AccountSetHash,TransSetHash) VALUES "
+        "('%s','%u','%s','%s','%s','%u','%u','%d','%u','%u','%s','%s');");
 
     {
         auto sl (getApp().getLedgerDB ().lock ());
@@ -828,7 +767,6 @@ bool Ledger::saveValidatedLedger (bool current)
         StaticScopedLockType sl (sPendingSaveLock);
         sPendingSaves.erase(getLedgerSeq());
     }
-    return true;
 }
 
 #ifndef NO_SQLITE3_PREPARE
@@ -1418,6 +1356,29 @@ void Ledger::visitStateItems (std::function<void (SLE::ref)> function) const
     }
 }
 
+void Ledger::visitStateItems (
+    int branch, std::function<void (SLE::ref)> function) const
+{
+    try
+    {
+        if (mAccountStateMap)
+        {
+            mAccountStateMap->visitLeaves(branch,
+                std::bind(&visitHelper, std::ref(function),
+                          std::placeholders::_1));
+        }
+    }
+    catch (SHAMapMissingNode&)
+    {
+        if (mHash.isNonZero ())
+        {
+            getApp().getInboundLedgers().findCreate(
+                mHash, mLedgerSeq, InboundLedger::fcGENERIC);
+        }
+        throw;
+    }
+}
+
 uint256 Ledger::getFirstLedgerIndex () const
 {
     SHAMapItem::pointer node = mAccountStateMap->peekFirstItem ();
@@ -1880,7 +1841,7 @@ bool Ledger::pendSaveValidated (bool isSynchronous, bool isCurrent)
 
     if (isSynchronous)
     {
-        return saveValidatedLedger(isCurrent);
+        return saveValidatedLedger(isCurrent, true);
     }
     else if (isCurrent)
     {
@@ -1920,12 +1881,6 @@ void Ledger::qualityDirDescriber (
     sle->setFieldH160 (sfTakerGetsCurrency, uTakerGetsCurrency);
     sle->setFieldH160 (sfTakerGetsIssuer, uTakerGetsIssuer);
     sle->setFieldU64 (sfExchangeRate, uRate);
-    if (isNew)
-    {
-        getApp().getOrderBookDB().addOrderBook(
-            {{uTakerPaysCurrency, uTakerPaysIssuer},
-                {uTakerGetsCurrency, uTakerGetsIssuer}});
-    }
 }
 
 void Ledger::initializeFees ()
@@ -338,6 +338,10 @@ public:
         std::function <bool (SLE::ref)>) const;
     void visitStateItems (std::function<void (SLE::ref)>) const;
 
+    // Visit the state entries below one branch of the state map's root.
+    // Different branches may be visited concurrently.
+    void visitStateItems (int branch, std::function<void (SLE::ref)>) const;
+
     // database functions (low-level)
     static Ledger::pointer loadByIndex (std::uint32_t ledgerIndex);
     static Ledger::pointer loadByHash (uint256 const& ledgerHash);
@@ -493,9 +497,12 @@ protected:
 
     void saveValidatedLedgerAsync(Job&, bool current)
     {
-        saveValidatedLedger(current);
+        saveValidatedLedger(current, false);
     }
-    bool saveValidatedLedger (bool current);
+    bool saveValidatedLedger (bool current, bool isSynchronous);
+
+    // Record the ledger in the Ledgers table once its transactions are saved
+    void saveLedgerRow ();
 
 private:
     void initializeFees ();
@@ -21,6 +21,7 @@
 #include <ripple/app/ledger/LedgerMaster.h>
 #include <ripple/app/ledger/InboundLedgers.h>
 #include <ripple/app/ledger/LedgerCleaner.h>
+#include <ripple/app/ledger/TransactionIndexer.h>
 #include <ripple/app/ledger/LedgerHistory.h>
 #include <ripple/app/ledger/LedgerHolder.h>
 #include <ripple/app/ledger/OrderBookDB.h>
@@ -76,6 +77,7 @@ public:
     RangeSet mCompleteLedgers;
 
     std::unique_ptr <LedgerCleaner> mLedgerCleaner;
+    std::unique_ptr <TransactionIndexer> mTransactionIndexer;
 
     int                         mMinValidations;    // The minimum validations to publish a ledger
     uint256                     mLastValidateHash;
@@ -118,6 +120,8 @@ public:
         , mHeldTransactions (uint256 ())
         , mLedgerCleaner (make_LedgerCleaner (
             *this, deprecatedLogs().journal("LedgerCleaner")))
+        , mTransactionIndexer (make_TransactionIndexer (
+            *this, collector, deprecatedLogs().journal("TransactionIndexer")))
         , mMinValidations (0)
         , mLastValidateSeq (0)
         , mAdvanceThread (false)
@@ -603,6 +607,7 @@ public:
             tmBH.set_ledgerhash (nextLedger->getHash().begin (), 32);
             Message::pointer packet = std::make_shared<Message> (tmBH, protocol::mtGET_OBJECTS);
 
+            getApp().getOPs ().expectFetchPack (target);
             target->send (packet);
             WriteLog (lsTRACE, LedgerMaster) << "Requested fetch pack for " << nextLedger->getLedgerSeq() - 1;
         }
@@ -1501,6 +1506,11 @@ public:
         mLedgerCleaner->doClean (parameters);
     }
 
+    TransactionIndexer& getTransactionIndexer ()
+    {
+        return *mTransactionIndexer;
+    }
+
     void setLedgerRangePresent (std::uint32_t minV, std::uint32_t maxV)
     {
         ScopedLockType sl (mCompleteLock);
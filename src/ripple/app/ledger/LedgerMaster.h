@@ -31,6 +31,8 @@
 
 namespace ripple {
 
+class TransactionIndexer;
+
 // Tracks the current ledger and any ledgers in the process of closing
 // Tracks ledger history
 // Tracks held transactions
@@ -148,6 +150,8 @@ public:
     virtual bool fixIndex (LedgerIndex ledgerIndex, LedgerHash const& ledgerHash) = 0;
     virtual void doLedgerCleaner(Json::Value const& parameters) = 0;
 
+    virtual TransactionIndexer& getTransactionIndexer () = 0;
+
     virtual beast::PropertyStream::Source& getPropertySource () = 0;
 
     static bool shouldAcquire (std::uint32_t currentLedgerID, 
@@ -136,7 +136,8 @@ void fillJson (Object& json, LedgerFill const& fill)
                     STTx txn (sit);
                     if (!bFillDividend && txn.getTxnType()==ttDIVIDEND)
                         continue;
-                    txns.append (txn.getJson (0));
+                    auto&& txJson = RPC::appendObject (txns);
+                    RPC::copyFrom (txJson, txn);
                 }
                 else if (type == SHAMapTreeNode::tnTRANSACTION_MD)
                 {
@@ -150,9 +151,10 @@ void fillJson (Object& json, LedgerFill const& fill)
 
                     TransactionMetaSet meta (
                         item->getTag (), ledger.getLedgerSeq(), sit.getVL ());
-                    Json::Value txJson = txn.getJson (0);
-                    txJson[jss::metaData] = meta.getJson (0);
-                    txns.append (txJson);
+                    auto&& txJson = RPC::appendObject (txns);
+                    RPC::copyFrom (txJson, txn);
+                    auto&& metaJson = RPC::addObject (txJson, jss::metaData);
+                    RPC::copyFrom (metaJson, meta.getAsObject ());
                 }
                 else
                 {
@@ -177,7 +179,8 @@ void fillJson (Object& json, LedgerFill const& fill)
                 [&array, &count] (SLE::ref sle)
                 {
                     count.yield();
-                    array.append (sle->getJson(0));
+                    auto&& entry = RPC::appendObject (array);
+                    RPC::copyFrom (entry, *sle);
                 });
         }
         else
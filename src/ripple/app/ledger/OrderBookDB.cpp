@@ -25,46 +25,145 @@
 #include <ripple/basics/Log.h>
 #include <ripple/core/Config.h>
 #include <ripple/core/JobQueue.h>
+#include <ripple/core/ParallelFor.h>
 #include <ripple/protocol/Indexes.h>
 #include <ripple/protocol/JsonFields.h>
+#include <algorithm>
+#include <array>
 
 namespace ripple {
 
+void OrderBookDB::Books::add (OrderBook::ref book)
+{
+    sourceMap[book->book ().in].push_back (book);
+    destMap[book->book ().out].push_back (book);
+    if (isXRP (book->getCurrencyOut ()))
+        xrpBooks.insert (book->book ().in);
+    if (isVBC (book->getCurrencyOut ()))
+        vbcBooks.insert (book->book ().in);
+}
+
+void OrderBookDB::Books::remove (uint256 const& bookBase, Book const& book)
+{
+    auto erase = [&bookBase] (IssueToOrderBook& map, Issue const& issue)
+    {
+        auto it = map.find (issue);
+        if (it == map.end ())
+            return;
+
+        auto& list = it->second;
+        list.erase (std::remove_if (list.begin (), list.end (),
+            [&bookBase] (OrderBook::ref ob)
+            {
+                return ob->getBookBase () == bookBase;
+            }), list.end ());
+
+        if (list.empty ())
+            map.erase (it);
+    };
+
+    erase (sourceMap, book.in);
+    erase (destMap, book.out);
+
+    // Another book from the same issue may still go to XRP or VBC
+    bool toXRP = false;
+    bool toVBC = false;
+    auto it = sourceMap.find (book.in);
+    if (it != sourceMap.end ())
+    {
+        for (auto const& ob : it->second)
+        {
+            toXRP = toXRP || isXRP (ob->getCurrencyOut ());
+            toVBC = toVBC || isVBC (ob->getCurrencyOut ());
+        }
+    }
+    if (!toXRP)
+        xrpBooks.erase (book.in);
+    if (!toVBC)
+        vbcBooks.erase (book.in);
+}
+
+//------------------------------------------------------------------------------
+
+// A quality directory is a book root if it is the first page of its
+// directory. Books are keyed by their book base.
+static bool isBookRoot (SLE const& entry)
+{
+    return entry.getType () == ltDIR_NODE &&
+        entry.isFieldPresent (sfExchangeRate) &&
+        entry.getFieldH256 (sfRootIndex) == entry.getIndex ();
+}
+
+static Book getBook (STObject const& entry)
+{
+    // Zero fields are left out of the metadata of a created entry, and
+    // the currency and issuer of XRP are zero.
+    auto field = [&entry] (SField const& name)
+    {
+        return entry.isFieldPresent (name) ?
+            entry.getFieldH160 (name) : uint160 ();
+    };
+
+    Book book;
+    book.in.currency.copyFrom (field (sfTakerPaysCurrency));
+    book.in.account.copyFrom (field (sfTakerPaysIssuer));
+    book.out.account.copyFrom (field (sfTakerGetsIssuer));
+    book.out.currency.copyFrom (field (sfTakerGetsCurrency));
+    return book;
+}
+
+// Visit the state entries of a ledger, the SHAMap branches in parallel
+static void visitBranches (Ledger::ref ledger,
+    std::function <void (int branch, SLE::ref sle)> const& visit)
+{
+    parallelFor (16, [&](std::size_t branch)
+    {
+        ledger->visitStateItems (branch, [&visit, branch](SLE::ref sle)
+        {
+            visit (branch, sle);
+        });
+    });
+}
+
+//------------------------------------------------------------------------------
+
 OrderBookDB::OrderBookDB (Stoppable& parent)
     : Stoppable ("OrderBookDB", parent)
+    , mBooks (std::make_shared <Books> ())
     , mSeq (0)
+    , mWalkSeq (0)
 {
 }
 
 void OrderBookDB::invalidate ()
 {
-    ScopedLockType sl (mLock);
+    std::lock_guard <std::mutex> sl (mUpdateLock);
     mSeq = 0;
+    mWalkSeq = 0;
+    mPending.clear ();
 }
 
 void OrderBookDB::setup (Ledger::ref ledger)
 {
     {
-        ScopedLockType sl (mLock);
-        auto seq = ledger->getLedgerSeq ();
+        std::lock_guard <std::mutex> sl (mUpdateLock);
 
-        // Do a full update every 256 ledgers
-        if (mSeq != 0)
-        {
-            if (seq == mSeq)
-                return;
-            if ((seq > mSeq) && ((seq - mSeq) < 256))
-                return;
-            if ((seq < mSeq) && ((mSeq - seq) < 16))
-                return;
-        }
+        // Once found, the books are kept up to date by applyLedger
+        if (mSeq != 0 || mWalkSeq != 0)
+            return;
 
         WriteLog (lsDEBUG, OrderBookDB)
-            << "Advancing from " << mSeq << " to " << seq;
+            << "Finding books in " << ledger->getLedgerSeq ();
 
-        mSeq = seq;
+        mWalkSeq = ledger->getLedgerSeq ();
+        mPending.clear ();
     }
 
+    startWalk (ledger);
+}
+
+void OrderBookDB::startWalk (Ledger::ref ledger)
+{
     if (getConfig().RUN_STANDALONE)
         update(ledger);
     else
@@ -72,148 +171,273 @@ void OrderBookDB::setup (Ledger::ref ledger)
             std::bind(&OrderBookDB::update, this, ledger));
 }
 
-static void updateHelper (SLE::ref entry,
-    hash_set< uint256 >& seen,
-    OrderBookDB::IssueToOrderBook& destMap,
-    OrderBookDB::IssueToOrderBook& sourceMap,
-    hash_set< Issue >& XRPBooks,
-    int& books)
-{
-    if (entry->getType () == ltDIR_NODE &&
-        entry->isFieldPresent (sfExchangeRate) &&
-        entry->getFieldH256 (sfRootIndex) == entry->getIndex())
-    {
-        Book book;
-        book.in.currency.copyFrom (entry->getFieldH160 (sfTakerPaysCurrency));
-        book.in.account.copyFrom (entry->getFieldH160 (sfTakerPaysIssuer));
-        book.out.account.copyFrom (entry->getFieldH160 (sfTakerGetsIssuer));
-        book.out.currency.copyFrom (entry->getFieldH160 (sfTakerGetsCurrency));
-
-        uint256 index = getBookBase (book);
-        if (seen.insert (index).second)
-        {
-            auto orderBook = std::make_shared<OrderBook> (index, book);
-            sourceMap[book.in].push_back (orderBook);
-            destMap[book.out].push_back (orderBook);
-            if (isXRP(book.out))
-                XRPBooks.insert(book.in);
-			//if (isVBC(book.out))
-			//	VBCBooks.insert(book.in);
-            ++books;
-        }
-    }
-}
-
 void OrderBookDB::update (Ledger::pointer ledger)
 {
-    hash_set< uint256 > seen;
-    OrderBookDB::IssueToOrderBook destMap;
-    OrderBookDB::IssueToOrderBook sourceMap;
-    hash_set< Issue > XRPBooks;
-	hash_set< Issue > VBCBooks;
+    std::uint32_t const seq = ledger->getLedgerSeq ();
+    std::array<BookDirectories, 16> branchDirectories;
 
     WriteLog (lsDEBUG, OrderBookDB) << "OrderBookDB::update>";
 
     // walk through the entire ledger looking for orderbook entries
-    int books = 0;
-
     try
     {
-        ledger->visitStateItems(std::bind(&updateHelper, std::placeholders::_1,
-                                          std::ref(seen), std::ref(destMap),
-            std::ref(sourceMap), std::ref(XRPBooks), std::ref(books)));
+        visitBranches (ledger, [&branchDirectories](int branch, SLE::ref sle)
+        {
+            if (isBookRoot (*sle))
+            {
+                Book const book = getBook (*sle);
+                auto& entry = branchDirectories[branch][getBookBase (book)];
+                entry.first = book;
+                ++entry.second;
+            }
+        });
     }
     catch (const SHAMapMissingNode&)
     {
         WriteLog (lsINFO, OrderBookDB)
             << "OrderBookDB::update encountered a missing node";
-        ScopedLockType sl (mLock);
-        mSeq = 0;
+        std::lock_guard <std::mutex> sl (mUpdateLock);
+        if (mWalkSeq == seq)
+        {
+            mSeq = 0;
+            mWalkSeq = 0;
+            mPending.clear ();
+        }
         return;
     }
 
+    // A book's quality directories can be spread over several branches
+    BookDirectories directories;
+    for (auto& branch : branchDirectories)
+    {
+        for (auto const& entry : branch)
+        {
+            auto& merged = directories[entry.first];
+            merged.first = entry.second.first;
+            merged.second += entry.second.second;
+        }
+        branch.clear ();
+    }
+
+    auto books = std::make_shared <Books> ();
+    books->seq = seq;
+    for (auto const& entry : directories)
+        books->add (std::make_shared<OrderBook> (entry.first, entry.second.first));
+
     WriteLog (lsDEBUG, OrderBookDB)
-        << "OrderBookDB::update< " << books << " books found";
+        << "OrderBookDB::update< " << directories.size () << " books found";
+
+    Ledger::pointer rewalk;
     {
-        ScopedLockType sl (mLock);
+        std::lock_guard <std::mutex> sl (mUpdateLock);
+
+        // Invalidated while we walked
+        if (mWalkSeq != seq)
+            return;
+
+        mDirectories.swap (directories);
+        mSeq = seq;
+        mWalkSeq = 0;
+        {
+            ScopedLockType sl2 (mLock);
+            mBooks = books;
+        }
 
-        mXRPBooks.swap(XRPBooks);
-        mSourceMap.swap(sourceMap);
-        mDestMap.swap(destMap);
+        // Catch up with the ledgers published during the walk
+        for (auto const& pending : mPending)
+        {
+            std::uint32_t const pendingSeq = pending->getLedgerSeq ();
+            if (pendingSeq <= mSeq)
+                continue;
+
+            if (pendingSeq != mSeq + 1)
+            {
+                rewalk = mPending.back ()->getLedger ();
+                mWalkSeq = rewalk->getLedgerSeq ();
+                break;
+            }
+
+            applyLocked (*pending);
+        }
+        mPending.clear ();
     }
+
     getApp().getLedgerMaster().newOrderBookDB();
+
+    if (rewalk)
+        startWalk (rewalk);
 }
 
-void OrderBookDB::addOrderBook(Book const& book)
+void OrderBookDB::applyLedger (AcceptedLedger::pointer const& ledger)
 {
-    bool toXRP = isXRP (book.out);
-	bool toVBC = isVBC (book.out);
-    ScopedLockType sl (mLock);
-
-    if (toXRP)
+    std::uint32_t const seq = ledger->getLedgerSeq ();
     {
-        // We don't want to search through all the to-XRP or from-XRP order
-        // books!
-        for (auto ob: mSourceMap[book.in])
+        std::lock_guard <std::mutex> sl (mUpdateLock);
+
+        if (mWalkSeq != 0)
+        {
+            if (seq > mWalkSeq)
+                mPending.push_back (ledger);
+            return;
+        }
+
+        if (mSeq != 0)
         {
-            if (isXRP (ob->getCurrencyOut ())) // also to XRP
+            if (seq <= mSeq)
+                return;
+
+            if (seq == mSeq + 1)
+            {
+                applyLocked (*ledger);
                 return;
+            }
+
+            WriteLog (lsINFO, OrderBookDB)
+                << "Gap from " << mSeq << " to " << seq << ", finding books";
         }
+
+        mWalkSeq = seq;
+        mPending.clear ();
     }
-	else if (toVBC)
-	{
-		for (auto ob : mSourceMap[book.in])
-		{
-			if (isVBC (ob->getCurrencyOut())) // also to VBC
-				return;
-		}
-	}
-    else
+
+    startWalk (ledger->getLedger ());
+}
+
+void OrderBookDB::applyLocked (AcceptedLedger const& ledger)
+{
+    std::uint32_t const seq = ledger.getLedgerSeq ();
+
+    // The net number of book roots each transaction created
+    BookDirectories changes;
+
+    for (auto const& item : ledger.getMap ())
     {
-        for (auto ob: mDestMap[book.out])
+        auto const& meta = item.second->getMeta ();
+        if (!meta)
+            continue;
+
+        for (auto& node : meta->getNodes ())
         {
-            if (ob->getCurrencyIn() == book.in.currency &&
-                ob->getIssuerIn() == book.in.account)
+            try
             {
-                return;
+                if (node.getFieldU16 (sfLedgerEntryType) != ltDIR_NODE)
+                    continue;
+
+                SField const* field = nullptr;
+                int delta = 0;
+
+                if (node.getFName () == sfCreatedNode)
+                {
+                    field = &sfNewFields;
+                    delta = 1;
+                }
+                else if (node.getFName () == sfDeletedNode)
+                {
+                    field = &sfFinalFields;
+                    delta = -1;
+                }
+                else
+                    continue;
+
+                auto data = dynamic_cast<const STObject*> (
+                    node.peekAtPField (*field));
+
+                if (!data || !data->isFieldPresent (sfExchangeRate) ||
+                    !data->isFieldPresent (sfRootIndex) ||
+                    data->getFieldH256 (sfRootIndex) !=
+                        node.getFieldH256 (sfLedgerIndex))
+                    continue;
+
+                Book const book = getBook (*data);
+                auto& change = changes[getBookBase (book)];
+                change.first = book;
+                change.second += delta;
+            }
+            catch (...)
+            {
+                WriteLog (lsINFO, OrderBookDB)
+                    << "Fields not found in OrderBookDB::applyLocked";
             }
         }
     }
-    uint256 index = getBookBase(book);
-    auto orderBook = std::make_shared<OrderBook> (index, book);
-
-    mSourceMap[book.in].push_back (orderBook);
-    mDestMap[book.out].push_back (orderBook);
-    if (toXRP)
-        mXRPBooks.insert(book.in);
-	if (toVBC)
-		mVBCBooks.insert(book.in);
+
+    mSeq = seq;
+
+    // Copied the first time a book is added or removed
+    std::shared_ptr <Books> books;
+
+    for (auto const& change : changes)
+    {
+        if (change.second.second == 0)
+            continue;
+
+        auto& entry = mDirectories[change.first];
+        bool const existed = entry.second > 0;
+        entry.first = change.second.first;
+        entry.second += change.second.second;
+        bool const exists = entry.second > 0;
+
+        if (entry.second < 0)
+        {
+            WriteLog (lsWARNING, OrderBookDB)
+                << "Ledger " << seq << " deleted an unknown book directory";
+        }
+
+        if (exists != existed)
+        {
+            if (!books)
+                books = std::make_shared <Books> (*getBooks ());
+
+            if (exists)
+                books->add (std::make_shared<OrderBook> (
+                    change.first, change.second.first));
+            else
+                books->remove (change.first, change.second.first);
+        }
+
+        if (!exists)
+            mDirectories.erase (change.first);
+    }
+
+    if (!books)
+        return;
+
+    WriteLog (lsDEBUG, OrderBookDB)
+        << "Books changed in ledger " << seq;
+
+    books->seq = seq;
+    ScopedLockType sl (mLock);
+    mBooks = books;
+}
+
+std::shared_ptr <OrderBookDB::Books const> OrderBookDB::getBooks ()
+{
+    ScopedLockType sl (mLock);
+    return mBooks;
 }
 
 // return list of all orderbooks that want this issuerID and currencyID
 OrderBook::List OrderBookDB::getBooksByTakerPays (Issue const& issue)
 {
-    ScopedLockType sl (mLock);
-    auto it = mSourceMap.find (issue);
-    return it == mSourceMap.end () ? OrderBook::List() : it->second;
+    auto const books = getBooks ();
+    auto it = books->sourceMap.find (issue);
+    return it == books->sourceMap.end () ? OrderBook::List() : it->second;
 }
 
 int OrderBookDB::getBookSize(Issue const& issue) {
-    ScopedLockType sl (mLock);
-    auto it = mSourceMap.find (issue);
-    return it == mSourceMap.end () ? 0 : it->second.size();
+    auto const books = getBooks ();
+    auto it = books->sourceMap.find (issue);
+    return it == books->sourceMap.end () ? 0 : it->second.size();
 }
 
 bool OrderBookDB::isBookToXRP(Issue const& issue)
 {
-    ScopedLockType sl (mLock);
-    return mXRPBooks.count(issue) > 0;
+    return getBooks ()->xrpBooks.count(issue) > 0;
 }
 
 bool OrderBookDB::isBookToVBC(Issue const& issue)
 {
-	ScopedLockType sl(mLock);
-	return mVBCBooks.count(issue) > 0;
+    return getBooks ()->vbcBooks.count(issue) > 0;
 }
 
 BookListeners::pointer OrderBookDB::makeBookListeners (Book const& book)
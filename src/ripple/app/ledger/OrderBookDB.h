@@ -20,12 +20,22 @@
 #ifndef RIPPLE_ORDERBOOKDB_H_INCLUDED
 #define RIPPLE_ORDERBOOKDB_H_INCLUDED
 
+#include <ripple/app/ledger/AcceptedLedger.h>
 #include <ripple/app/ledger/AcceptedLedgerTx.h>
 #include <ripple/app/ledger/BookListeners.h>
 #include <ripple/app/misc/OrderBook.h>
+#include <deque>
+#include <mutex>
 
 namespace ripple {
 
+/** The order books in the last validated ledger.
+
+    The books are found by walking the whole ledger once, at startup or
+    after a gap in the published ledgers. After that they are kept up to
+    date from the book directories that each validated ledger's metadata
+    shows being created or deleted.
+*/
 class OrderBookDB
     : public beast::Stoppable
     , public beast::LeakChecked <OrderBookDB>
@@ -33,11 +43,20 @@ class OrderBookDB
 public:
     explicit OrderBookDB (Stoppable& parent);
 
+    /** Find the books in a ledger if they have not been found yet. */
     void setup (Ledger::ref ledger);
+
+    /** Find the books by walking the whole ledger. */
     void update (Ledger::pointer ledger);
+
+    /** Forget the books. They are found again from the next ledger. */
     void invalidate ();
 
-    void addOrderBook(Book const&);
+    /** Bring the books up to date with a validated ledger.
+        Ledgers must be applied in order. A ledger that does not follow
+        the last one applied starts a new walk.
+    */
+    void applyLedger (AcceptedLedger::pointer const& ledger);
 
     /** @return a list of all orderbooks that want this issuerID and currencyID.
      */
@@ -59,31 +78,68 @@ public:
 
     typedef hash_map <Issue, OrderBook::List> IssueToOrderBook;
 
-private:
-    void rawAddBook(Book const&);
+    /** The books as of one ledger. Never changed once published. */
+    struct Books
+    {
+        // the ledger in which the books last changed
+        std::uint32_t seq;
 
-    // by ci/ii
-    IssueToOrderBook mSourceMap;
+        // by ci/ii
+        IssueToOrderBook sourceMap;
 
-    // by co/io
-    IssueToOrderBook mDestMap;
+        // by co/io
+        IssueToOrderBook destMap;
 
-    // does an order book to XRP exist
-    hash_set <Issue> mXRPBooks;
+        // does an order book to XRP exist
+        hash_set <Issue> xrpBooks;
 
-	// does an order book to VBC exist
-	hash_set <Issue> mVBCBooks;
+        // does an order book to VBC exist
+        hash_set <Issue> vbcBooks;
+
+        Books ()
+            : seq (0)
+        {
+        }
+
+        void add (OrderBook::ref book);
+        void remove (uint256 const& bookBase, Book const& book);
+    };
+
+    /** The number of quality directories in each book, by book base. */
+    typedef hash_map <uint256, std::pair <Book, int>> BookDirectories;
+
+private:
+    std::shared_ptr <Books const> getBooks ();
+
+    void applyLocked (AcceptedLedger const& ledger);
+    void startWalk (Ledger::ref ledger);
 
     typedef RippleRecursiveMutex LockType;
     typedef std::lock_guard <LockType> ScopedLockType;
+
+    // Protects mBooks and mListeners
     LockType mLock;
 
+    std::shared_ptr <Books const> mBooks;
+
     typedef hash_map <Book, BookListeners::pointer>
     BookToListenersMap;
 
     BookToListenersMap mListeners;
 
+    // Serializes updates, and protects the members below
+    std::mutex mUpdateLock;
+
+    BookDirectories mDirectories;
+
+    // the last ledger applied, or zero if the books are not known
     std::uint32_t mSeq;
+
+    // the ledger being walked, or zero
+    std::uint32_t mWalkSeq;
+
+    // ledgers published while the walk runs
+    std::deque <AcceptedLedger::pointer> mPending;
 };
 
 } // ripple
@@ -0,0 +1,850 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/app/ledger/TransactionIndexer.h>
+#include <ripple/app/data/DatabaseCon.h>
+#include <ripple/app/data/SqliteDatabase.h>
+#ifdef USE_MYSQL
+#include <ripple/app/data/MySQLDatabase.h>
+#endif
+#include <ripple/app/main/Application.h>
+#include <ripple/app/misc/DividendMaster.h>
+#include <ripple/basics/StringUtilities.h>
+#include <ripple/basics/UnorderedContainers.h>
+#include <ripple/protocol/TxFormats.h>
+#include <beast/threads/Thread.h>
+#include <beast/cxx14/memory.h> // <memory>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace ripple {
+
+/*
+
+TransactionIndexer
+
+Fills the Transactions and AccountTransactions tables for validated ledgers.
+A dividend ledger can have hundreds of thousands of transactions, so rows
+are written with multi-row statements instead of one statement per row. On
+SQLite and MySQL the statements are prepared once and reused for every
+ledger, with the raw transaction and metadata bound as blobs instead of
+escaped as text. MySQL keeps the prepared statements on each connection of
+its pool, so they run in a transaction rather than as a batch.
+
+Accounts are still stored as their human readable IDs, since that is what
+the account_tx queries look them up by, but each account is converted once
+per ledger rather than once per row.
+
+Each account's share of a dividend is also written to the AccountDividends
+table, keyed by account and dividend ledger, so account_dividend can look it
+up without joining the transaction tables or parsing the transaction.
+
+*/
+
+class TransactionIndexerImp
+    : public TransactionIndexer
+    , public beast::LeakChecked <TransactionIndexerImp>
+{
+public:
+    // While this many transactions are waiting, adding a ledger blocks. A
+    // ledger is always accepted when the queue is empty, however large.
+    static std::size_t const maxQueuedTxns = 250000;
+    static std::size_t const maxQueuedLedgers = 256;
+
+    // Rows per multi-row statement. SQLite allows at most 999 parameters
+    // in a statement, MySQL 65535.
+    static int const accountRows = 200;     // 4 parameters each
+    static int const transactionRows = 100; // 9 parameters each
+    static int const deleteIds = 500;       // 1 parameter each
+    static int const dividendRows = 80;     // 11 parameters each
+
+    typedef std::chrono::steady_clock clock_type;
+
+    struct Item
+    {
+        AcceptedLedger::pointer ledger;
+        Callback onWritten;
+    };
+
+    // Human readable IDs of the accounts in one ledger
+    class AccountNames
+    {
+    public:
+        std::string const& get (RippleAddress const& address)
+        {
+            auto result = m_names.emplace (address.getAccountID (), std::string ());
+            if (result.second)
+                result.first->second = address.humanAccountID ();
+            return result.first->second;
+        }
+
+        std::string const& get (Account const& account)
+        {
+            auto result = m_names.emplace (account, std::string ());
+            if (result.second)
+                result.first->second =
+                    RippleAddress::createAccountID (account).humanAccountID ();
+            return result.first->second;
+        }
+
+    private:
+        hash_map <Account, std::string> m_names;
+    };
+
+    // One account's share of a dividend, from a dividend apply transaction
+    struct DividendRow
+    {
+        std::string const* id;
+        std::string const* account;
+        std::uint32_t dividendLedger;
+        std::uint64_t values[7];    // in the order of dividendFields
+    };
+
+    static SField const* const dividendFields[7];
+
+    static void getDividendRows (AcceptedLedger const& ledger,
+        std::vector <std::string> const& ids, AccountNames& names,
+            std::vector <DividendRow>& rows)
+    {
+        std::size_t n = 0;
+        for (auto const& vt : ledger.getMap ())
+        {
+            STTx const& txn = *vt.second->getTxn ();
+
+            if (txn.getTxnType () == ttDIVIDEND &&
+                vt.second->getResult () == tesSUCCESS &&
+                txn.getFieldU8 (sfDividendType) == DividendMaster::DivType_Apply &&
+                txn.isFieldPresent (sfDestination))
+            {
+                DividendRow row;
+                row.id = &ids[n];
+                row.account = &names.get (txn.getFieldAccount160 (sfDestination));
+                row.dividendLedger = txn.getFieldU32 (sfDividendLedger);
+                for (int i = 0; i < 7; ++i)
+                    row.values[i] = txn.getFieldU64 (*dividendFields[i]);
+                rows.push_back (row);
+            }
+            ++n;
+        }
+    }
+
+    static std::string dividendHeader (Database::Type type)
+    {
+        return std::string (type == Database::Type::MySQL ?
+            "REPLACE INTO " : "INSERT OR REPLACE INTO ") +
+            "AccountDividends (Account, DividendLedger, LedgerSeq, TransID, "
+            "DividendCoins, DividendCoinsVBC, DividendCoinsVBCRank, "
+            "DividendCoinsVBCSprd, DividendTSprd, DividendVRank, DividendVSprd) "
+            "VALUES ";
+    }
+
+#ifdef USE_MYSQL
+    // A statement prepared on the MySQL server, bound like a SqliteStatement
+    class MySQLPrepared
+    {
+    public:
+        MySQLPrepared (MySQLDatabase* db, std::string const& sql)
+            : m_db (*db)
+            , m_sql (sql)
+        {
+        }
+
+        template <class... Args>
+        void bind (int position, Args const&... args)
+        {
+            m_params.bind (position, args...);
+        }
+
+        bool execute ()
+        {
+            bool const result = m_db.executePrepared (m_sql, m_params);
+            m_params.clear ();
+            return result;
+        }
+
+    private:
+        MySQLDatabase& m_db;
+        std::string const m_sql;
+        MySQLParams m_params;
+    };
+#endif
+
+    template <class Statement>
+    struct Statements
+    {
+        template <class DB>
+        Statements (DB* db, Database::Type type)
+            : deleteTransactions (db,
+                "DELETE FROM Transactions WHERE LedgerSeq = ?;")
+            , deleteAccountTxs (db,
+                "DELETE FROM AccountTransactions WHERE LedgerSeq = ?;")
+            , deleteAccountTxIds (db,
+                "DELETE FROM AccountTransactions WHERE TransID IN " +
+                    parameters (deleteIds, 1) + ";")
+            , insertAccountTxs (db, accountTxHeader + parameters (4, accountRows))
+            , insertAccountTx (db, accountTxHeader + parameters (4, 1))
+            , insertTransactions (db, STTx::getMetaSQLInsertReplaceHeader (
+                type) + parameters (9, transactionRows))
+            , deleteDividends (db,
+                "DELETE FROM AccountDividends WHERE LedgerSeq = ?;")
+            , insertDividends (db, dividendHeader (type) +
+                parameters (11, dividendRows))
+            , insertDividend (db, dividendHeader (type) +
+                parameters (11, 1))
+        {
+        }
+
+        // Returns "(?,...),(?,...),..." with the given number of rows
+        static std::string parameters (int columns, int rows)
+        {
+            std::string row ("(?");
+            for (int i = 1; i < columns; ++i)
+                row += ",?";
+            row += ")";
+
+            std::string s;
+            s.reserve (rows * (row.size () + 1));
+            for (int i = 0; i < rows; ++i)
+            {
+                if (i != 0)
+                    s += ",";
+                s += row;
+            }
+            return s;
+        }
+
+        Statement deleteTransactions;
+        Statement deleteAccountTxs;
+        Statement deleteAccountTxIds;
+        Statement insertAccountTxs;
+        Statement insertAccountTx;
+        Statement insertTransactions;
+        Statement deleteDividends;
+        Statement insertDividends;
+        Statement insertDividend;
+    };
+
+#ifndef NO_SQLITE3_PREPARE
+    typedef Statements <SqliteStatement> SqliteStatements;
+#endif
+#ifdef USE_MYSQL
+    typedef Statements <MySQLPrepared> MySQLStatements;
+#endif
+
+    static std::string const accountTxHeader;
+
+    beast::Journal m_journal;
+    beast::insight::Gauge m_queuedLedgers;
+    beast::insight::Gauge m_queuedTxns;
+    beast::insight::Event m_writeTime;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;   // a ledger was added, or stopping
+    std::condition_variable m_space;    // a ledger was written, or stopping
+    std::deque <Item> m_queue;          // the front is being written
+    std::size_t m_txnCount;             // transactions in m_queue
+    bool m_stopping;
+    std::thread m_thread;
+
+    // Held while writing. Protects m_statements.
+    std::mutex m_writeMutex;
+#ifndef NO_SQLITE3_PREPARE
+    std::unique_ptr <SqliteStatements> m_statements;
+#endif
+    // The cached statements were released and must not be prepared again
+    bool m_released;
+
+    //--------------------------------------------------------------------------
+
+    TransactionIndexerImp (Stoppable& parent,
+        beast::insight::Collector::ptr const& collector,
+            beast::Journal journal)
+        : TransactionIndexer (parent)
+        , m_journal (journal)
+        , m_queuedLedgers (collector->make_gauge ("txindexer", "lag_ledgers"))
+        , m_queuedTxns (collector->make_gauge ("txindexer", "lag_transactions"))
+        , m_writeTime (collector->make_event ("txindexer", "write"))
+        , m_txnCount (0)
+        , m_stopping (false)
+        , m_released (false)
+    {
+    }
+
+    ~TransactionIndexerImp ()
+    {
+        if (m_thread.joinable ())
+            m_thread.join ();
+    }
+
+    //--------------------------------------------------------------------------
+    //
+    // Stoppable
+    //
+    //--------------------------------------------------------------------------
+
+    void onStart ()
+    {
+        std::lock_guard <std::mutex> lock (m_mutex);
+        m_thread = std::thread (&TransactionIndexerImp::run, this);
+    }
+
+    void onStop ()
+    {
+        bool running;
+        {
+            std::lock_guard <std::mutex> lock (m_mutex);
+            m_stopping = true;
+            running = m_thread.joinable ();
+            m_wakeup.notify_all ();
+            m_space.notify_all ();
+        }
+
+        // The thread writes the ledgers still queued before it stops
+        if (! running)
+        {
+            releaseStatements ();
+            stopped ();
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //
+    // TransactionIndexer
+    //
+    //--------------------------------------------------------------------------
+
+    void addLedger (AcceptedLedger::pointer const& ledger,
+        Callback onWritten) override
+    {
+        std::size_t const txns = ledger->getTxnCount ();
+        {
+            std::unique_lock <std::mutex> lock (m_mutex);
+
+            if (m_thread.joinable ())
+            {
+                m_space.wait (lock, [this, txns]
+                {
+                    return m_stopping || m_queue.empty () ||
+                        ((m_txnCount + txns <= maxQueuedTxns) &&
+                            (m_queue.size () < maxQueuedLedgers));
+                });
+
+                if (! m_stopping)
+                {
+                    m_queue.push_back ({ledger, std::move (onWritten)});
+                    m_txnCount += txns;
+                    updateGauges ();
+                    m_wakeup.notify_one ();
+                    return;
+                }
+            }
+        }
+
+        writeLedger (*ledger);
+        onWritten ();
+    }
+
+    bool writeLedger (AcceptedLedger const& ledger) override
+    {
+        Database* db = getApp().getTxnDB ().getDB ();
+
+        if (db->getDBType () == Database::Type::Null)
+            return true;
+
+        std::lock_guard <std::mutex> writeLock (m_writeMutex);
+        auto dbLock (getApp().getTxnDB ().lock ());
+
+        // Prepared MySQL statements run on the connection the transaction
+        // holds, they can not be sent with a batch
+        bool const batch = db->getDBType () != Database::Type::MySQL;
+
+        if (batch)
+            db->batchStart ();
+        db->beginTransaction ();
+
+        bool result;
+#ifdef USE_MYSQL
+        if (db->getDBType () == Database::Type::MySQL)
+        {
+            MySQLStatements statements (static_cast <MySQLDatabase*> (db),
+                Database::Type::MySQL);
+            result = writePrepared (statements, ledger);
+        }
+        else
+#endif
+#ifndef NO_SQLITE3_PREPARE
+        if (db->getDBType () == Database::Type::Sqlite)
+        {
+            if (m_released)
+            {
+                SqliteStatements statements (db->getSqliteDB (),
+                    Database::Type::Sqlite);
+                result = writePrepared (statements, ledger);
+            }
+            else
+            {
+                if (! m_statements)
+                    m_statements = std::make_unique <SqliteStatements> (
+                        db->getSqliteDB (), Database::Type::Sqlite);
+                result = writePrepared (*m_statements, ledger);
+            }
+        }
+        else
+#endif
+        {
+            result = writeText (db, ledger);
+        }
+
+        db->endTransaction ();
+        if (batch)
+            db->batchCommit ();
+
+        if (! result && m_journal.warning) m_journal.warning <<
+            "Ledger " << ledger.getLedgerSeq () <<
+                " transactions were not all indexed";
+
+        return result;
+    }
+
+    std::size_t getQueueSize () override
+    {
+        std::lock_guard <std::mutex> lock (m_mutex);
+        return m_queue.size ();
+    }
+
+    //--------------------------------------------------------------------------
+
+    void updateGauges ()
+    {
+        m_queuedLedgers.set (m_queue.size ());
+        m_queuedTxns.set (m_txnCount);
+    }
+
+    void releaseStatements ()
+    {
+        std::lock_guard <std::mutex> writeLock (m_writeMutex);
+#ifndef NO_SQLITE3_PREPARE
+        m_statements.reset ();
+#endif
+        m_released = true;
+    }
+
+    void run ()
+    {
+        beast::Thread::setCurrentThreadName ("TxIndexer");
+
+        std::unique_lock <std::mutex> lock (m_mutex);
+
+        for (;;)
+        {
+            m_wakeup.wait (lock, [this]
+            {
+                return m_stopping || ! m_queue.empty ();
+            });
+
+            if (m_queue.empty ())
+                break;
+
+            Item item = m_queue.front ();
+            lock.unlock ();
+
+            auto const start = clock_type::now ();
+            writeLedger (*item.ledger);
+            m_writeTime.notify (std::chrono::duration_cast <
+                std::chrono::milliseconds> (clock_type::now () - start));
+
+            item.onWritten ();
+
+            lock.lock ();
+            m_txnCount -= item.ledger->getTxnCount ();
+            m_queue.pop_front ();
+            updateGauges ();
+            m_space.notify_all ();
+        }
+
+        lock.unlock ();
+
+        // The statements belong to the database connection, which may be
+        // closed once we have stopped.
+        releaseStatements ();
+        stopped ();
+    }
+
+    //--------------------------------------------------------------------------
+
+#ifndef NO_SQLITE3_PREPARE
+    bool step (SqliteStatement& statement)
+    {
+        int const ret = statement.step ();
+        statement.reset ();
+
+        if (statement.isDone (ret))
+            return true;
+
+        if (m_journal.warning) m_journal.warning <<
+            "Indexing transactions: " << statement.getError (ret);
+        return false;
+    }
+#endif
+
+#ifdef USE_MYSQL
+    // executePrepared logs the error
+    bool step (MySQLPrepared& statement)
+    {
+        return statement.execute ();
+    }
+#endif
+
+    template <class Statement>
+    static void bindDividend (Statement& statement, int p,
+        std::uint32_t ledgerSeq, DividendRow const& row)
+    {
+        statement.bind (p + 1, *row.account);
+        statement.bind (p + 2, row.dividendLedger);
+        statement.bind (p + 3, ledgerSeq);
+        statement.bind (p + 4, *row.id);
+        for (int i = 0; i < 7; ++i)
+            statement.bind (p + 5 + i, row.values[i]);
+    }
+
+    template <class Statement>
+    bool writePrepared (Statements <Statement>& st, AcceptedLedger const& ledger)
+    {
+        std::uint32_t const ledgerSeq = ledger.getLedgerSeq ();
+        std::uint32_t const closeTime = ledger.getLedger ()->getCloseTimeNC ();
+        auto const& txns = ledger.getMap ();
+        bool result = true;
+
+        st.deleteTransactions.bind (1, ledgerSeq);
+        result = step (st.deleteTransactions) && result;
+        st.deleteAccountTxs.bind (1, ledgerSeq);
+        result = step (st.deleteAccountTxs) && result;
+
+        std::vector <std::string> ids;
+        ids.reserve (txns.size ());
+        for (auto const& vt : txns)
+            ids.push_back (to_string (vt.second->getTransactionID ()));
+
+        // A transaction may have been recorded in another ledger. The last
+        // statement is padded by repeating an ID.
+        for (std::size_t i = 0; i < ids.size (); i += deleteIds)
+        {
+            for (int j = 0; j < deleteIds; ++j)
+                st.deleteAccountTxIds.bind (j + 1,
+                    ids[std::min (i + j, ids.size () - 1)]);
+            result = step (st.deleteAccountTxIds) && result;
+        }
+
+        AccountNames names;
+
+        // Account rows, in statements of accountRows rows and single rows
+        // for the remainder
+        {
+            struct Row
+            {
+                std::string const* id;
+                std::string const* account;
+                std::uint32_t txnSeq;
+            };
+
+            std::vector <Row> rows;
+            rows.reserve (txns.size () * 2);
+
+            std::size_t n = 0;
+            for (auto const& vt : txns)
+            {
+                auto const& accounts = vt.second->getAffected ();
+
+                if (accounts.empty () && m_journal.warning) m_journal.warning <<
+                    "Transaction in ledger " << ledgerSeq <<
+                        " affects no accounts";
+
+                for (auto const& account : accounts)
+                    rows.push_back ({&ids[n], &names.get (account),
+                        vt.second->getTxnSeq ()});
+                ++n;
+            }
+
+            std::size_t i = 0;
+            for (; i + accountRows <= rows.size (); i += accountRows)
+            {
+                for (int j = 0; j < accountRows; ++j)
+                {
+                    Row const& row = rows[i + j];
+                    st.insertAccountTxs.bind (j * 4 + 1, *row.id);
+                    st.insertAccountTxs.bind (j * 4 + 2, *row.account);
+                    st.insertAccountTxs.bind (j * 4 + 3, ledgerSeq);
+                    st.insertAccountTxs.bind (j * 4 + 4, row.txnSeq);
+                }
+                result = step (st.insertAccountTxs) && result;
+            }
+
+            for (; i < rows.size (); ++i)
+            {
+                st.insertAccountTx.bind (1, *rows[i].id);
+                st.insertAccountTx.bind (2, *rows[i].account);
+                st.insertAccountTx.bind (3, ledgerSeq);
+                st.insertAccountTx.bind (4, rows[i].txnSeq);
+                result = step (st.insertAccountTx) && result;
+            }
+        }
+
+        // Transaction rows. Replacing a row is idempotent, so the last
+        // statement is padded by repeating a row.
+        {
+            std::vector <AcceptedLedgerTx const*> batch;
+            std::vector <Blob> raw;
+            batch.reserve (transactionRows);
+            raw.reserve (transactionRows);
+
+            std::string const status (1, TXN_SQL_VALIDATED);
+            std::size_t n = 0;
+
+            auto flush = [&]
+            {
+                for (int row = 0; row < transactionRows; ++row)
+                {
+                    int const i = std::min <int> (row, batch.size () - 1);
+                    AcceptedLedgerTx const& tx = *batch[i];
+                    STTx const& txn = *tx.getTxn ();
+                    auto format = TxFormats::getInstance ().findByType (
+                        txn.getTxnType ());
+                    assert (format != nullptr);
+
+                    int const p = row * 9;
+                    st.insertTransactions.bind (p + 1, ids[n + i]);
+                    st.insertTransactions.bind (p + 2, format->getName ());
+                    st.insertTransactions.bind (p + 3, names.get (txn.getSourceAccount ()));
+                    st.insertTransactions.bind (p + 4, txn.getSequence ());
+                    st.insertTransactions.bind (p + 5, ledgerSeq);
+                    st.insertTransactions.bind (p + 6, status);
+                    st.insertTransactions.bind (p + 7, closeTime);
+                    st.insertTransactions.bind (p + 8, raw[i].data (), raw[i].size ());
+                    st.insertTransactions.bind (p + 9, tx.getRawMeta ().data (),
+                        tx.getRawMeta ().size ());
+                }
+                result = step (st.insertTransactions) && result;
+
+                n += batch.size ();
+                batch.clear ();
+                raw.clear ();
+            };
+
+            for (auto const& vt : txns)
+            {
+                Serializer s;
+                vt.second->getTxn ()->add (s);
+                raw.push_back (std::move (s.modData ()));
+                batch.push_back (vt.second.get ());
+
+                if (batch.size () == transactionRows)
+                    flush ();
+            }
+
+            if (! batch.empty ())
+                flush ();
+        }
+
+        // Dividend rows, in statements of dividendRows rows and single rows
+        // for the remainder
+        {
+            st.deleteDividends.bind (1, ledgerSeq);
+            result = step (st.deleteDividends) && result;
+
+            std::vector <DividendRow> rows;
+            getDividendRows (ledger, ids, names, rows);
+
+            std::size_t i = 0;
+            for (; i + dividendRows <= rows.size (); i += dividendRows)
+            {
+                for (int j = 0; j < dividendRows; ++j)
+                    bindDividend (st.insertDividends, j * 11, ledgerSeq,
+                        rows[i + j]);
+                result = step (st.insertDividends) && result;
+            }
+
+            for (; i < rows.size (); ++i)
+            {
+                bindDividend (st.insertDividend, 0, ledgerSeq, rows[i]);
+                result = step (st.insertDividend) && result;
+            }
+        }
+
+        return result;
+    }
+
+    // Used when statements can not be prepared. Builds multi-row
+    // statements as text.
+    bool writeText (Database* db, AcceptedLedger const& ledger)
+    {
+        std::string const ledgerSeq (std::to_string (ledger.getLedgerSeq ()));
+        std::uint32_t const closeTime = ledger.getLedger ()->getCloseTimeNC ();
+        auto const& txns = ledger.getMap ();
+        bool result = true;
+
+        result = db->executeSQL ("DELETE FROM Transactions WHERE LedgerSeq = " +
+            ledgerSeq + ";") && result;
+        result = db->executeSQL ("DELETE FROM AccountTransactions WHERE LedgerSeq = " +
+            ledgerSeq + ";") && result;
+
+        std::vector <std::string> ids;
+        ids.reserve (txns.size ());
+        for (auto const& vt : txns)
+            ids.push_back (to_string (vt.second->getTransactionID ()));
+
+        for (std::size_t i = 0; i < ids.size (); i += deleteIds)
+        {
+            std::string sql ("DELETE FROM AccountTransactions WHERE TransID IN (");
+            for (std::size_t j = i; j < std::min (i + deleteIds, ids.size ()); ++j)
+            {
+                if (j != i)
+                    sql += ",";
+                sql += "'" + ids[j] + "'";
+            }
+            sql += ");";
+            result = db->executeSQL (sql) && result;
+        }
+
+        AccountNames names;
+
+        {
+            std::string sql;
+            int rows = 0;
+            std::size_t n = 0;
+            for (auto const& vt : txns)
+            {
+                auto const& accounts = vt.second->getAffected ();
+
+                if (accounts.empty () && m_journal.warning) m_journal.warning <<
+                    "Transaction in ledger " << ledgerSeq <<
+                        " affects no accounts";
+
+                std::string const txnSeq (std::to_string (vt.second->getTxnSeq ()));
+                for (auto const& account : accounts)
+                {
+                    sql += rows == 0 ? accountTxHeader : std::string (",");
+                    sql += "('" + ids[n] + "','" + names.get (account) + "'," +
+                        ledgerSeq + "," + txnSeq + ")";
+
+                    if (++rows == accountRows)
+                    {
+                        result = db->executeSQL (sql + ";") && result;
+                        sql.clear ();
+                        rows = 0;
+                    }
+                }
+                ++n;
+            }
+
+            if (rows != 0)
+                result = db->executeSQL (sql + ";") && result;
+        }
+
+        {
+            std::string const header (
+                STTx::getMetaSQLInsertReplaceHeader (db->getDBType ()));
+            std::string sql;
+            int rows = 0;
+            for (auto const& vt : txns)
+            {
+                sql += rows == 0 ? header : std::string (",");
+                sql += vt.second->getTxn ()->getMetaSQL (
+                    ledger.getLedgerSeq (), vt.second->getEscMeta (), closeTime);
+
+                if (++rows == transactionRows)
+                {
+                    result = db->executeSQL (sql + ";") && result;
+                    sql.clear ();
+                    rows = 0;
+                }
+            }
+
+            if (rows != 0)
+                result = db->executeSQL (sql + ";") && result;
+        }
+
+        {
+            result = db->executeSQL ("DELETE FROM AccountDividends WHERE LedgerSeq = " +
+                ledgerSeq + ";") && result;
+
+            std::vector <DividendRow> dividends;
+            getDividendRows (ledger, ids, names, dividends);
+
+            std::string const header (dividendHeader (db->getDBType ()));
+            std::string sql;
+            int rows = 0;
+            for (auto const& row : dividends)
+            {
+                sql += rows == 0 ? header : std::string (",");
+                sql += "('" + *row.account + "'," +
+                    std::to_string (row.dividendLedger) + "," + ledgerSeq +
+                    ",'" + *row.id + "'";
+                for (auto value : row.values)
+                    sql += "," + std::to_string (value);
+                sql += ")";
+
+                if (++rows == dividendRows)
+                {
+                    result = db->executeSQL (sql + ";") && result;
+                    sql.clear ();
+                    rows = 0;
+                }
+            }
+
+            if (rows != 0)
+                result = db->executeSQL (sql + ";") && result;
+        }
+
+        return result;
+    }
+};
+
+std::string const TransactionIndexerImp::accountTxHeader (
+    "INSERT INTO AccountTransactions (TransID, Account, LedgerSeq, TxnSeq) VALUES ");
+
+SField const* const TransactionIndexerImp::dividendFields[7] =
+{
+    &sfDividendCoins, &sfDividendCoinsVBC, &sfDividendCoinsVBCRank,
+    &sfDividendCoinsVBCSprd, &sfDividendTSprd, &sfDividendVRank,
+    &sfDividendVSprd
+};
+
+//------------------------------------------------------------------------------
+
+TransactionIndexer::TransactionIndexer (Stoppable& parent)
+    : Stoppable ("TransactionIndexer", parent)
+{
+}
+
+TransactionIndexer::~TransactionIndexer ()
+{
+}
+
+std::unique_ptr <TransactionIndexer>
+make_TransactionIndexer (beast::Stoppable& parent,
+    beast::insight::Collector::ptr const& collector, beast::Journal journal)
+{
+    return std::make_unique <TransactionIndexerImp> (parent, collector, journal);
+}
+
+} // ripple
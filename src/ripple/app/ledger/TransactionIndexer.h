@@ -0,0 +1,80 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_TRANSACTIONINDEXER_H_INCLUDED
+#define RIPPLE_TRANSACTIONINDEXER_H_INCLUDED
+
+#include <ripple/app/ledger/AcceptedLedger.h>
+#include <beast/insight/Collector.h>
+#include <beast/threads/Stoppable.h>
+#include <beast/utility/Journal.h>
+#include <functional>
+#include <memory>
+
+namespace ripple {
+
+/** Writes the transactions of validated ledgers to the transaction database.
+
+    Ledgers are written on the indexer's own thread in the order they are
+    added, so saving a validated ledger does not wait for its transactions
+    and account rows to reach the database. Adding a ledger blocks while
+    too many transactions are waiting to be written.
+*/
+class TransactionIndexer
+    : public beast::Stoppable
+{
+protected:
+    explicit TransactionIndexer (Stoppable& parent);
+
+public:
+    typedef std::function <void ()> Callback;
+
+    /** Destroy the object. */
+    virtual ~TransactionIndexer () = 0;
+
+    /** Queue a ledger's transactions to be written.
+        Blocks while the queue is full. If the indexer is not running the
+        ledger is written before returning.
+
+        Thread safety:
+            Safe to call from any thread at any time.
+
+        @param onWritten Called once the ledger's transactions are written,
+                         whether or not writing them succeeded.
+    */
+    virtual void addLedger (AcceptedLedger::pointer const& ledger,
+        Callback onWritten) = 0;
+
+    /** Write a ledger's transactions before returning.
+        Ledgers that are already queued may be written after this one.
+        @return false if the database reported an error.
+    */
+    virtual bool writeLedger (AcceptedLedger const& ledger) = 0;
+
+    /** The number of ledgers queued or being written. */
+    virtual std::size_t getQueueSize () = 0;
+};
+
+std::unique_ptr <TransactionIndexer> make_TransactionIndexer (
+    beast::Stoppable& parent, beast::insight::Collector::ptr const& collector,
+        beast::Journal journal);
+
+} // ripple
+
+#endif
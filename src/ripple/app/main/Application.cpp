@@ -39,9 +39,11 @@
 #include <ripple/app/misc/IHashRouter.h>
 #include <ripple/app/misc/NetworkOPs.h>
 #include <ripple/app/misc/SHAMapStore.h>
+#include <ripple/app/misc/SignatureVerifier.h>
 #include <ripple/app/misc/Validations.h>
 #include <ripple/app/paths/FindPaths.h>
 #include <ripple/app/paths/PathRequests.h>
+#include <ripple/app/paths/Pathfinder.h>
 #include <ripple/app/peers/UniqueNodeList.h>
 #include <ripple/app/tx/TransactionMaster.h>
 #include <ripple/app/websocket/WSDoor.h>
@@ -211,6 +213,7 @@ public:
     std::unique_ptr <AmendmentTable> m_amendmentTable;
     std::unique_ptr <LoadFeeTrack> mFeeTrack;
     std::unique_ptr <IHashRouter> mHashRouter;
+    std::unique_ptr <SignatureVerifier> m_signatureVerifier;
     std::unique_ptr <Validations> mValidations;
     std::unique_ptr <LoadManager> m_loadManager;
     beast::DeadlineTimer m_sweepTimer;
@@ -328,6 +331,10 @@ public:
 
         , mHashRouter (IHashRouter::New (IHashRouter::getDefaultHoldTime ()))
 
+        , m_signatureVerifier (make_SignatureVerifier (*m_jobQueue,
+            *mHashRouter, 0, m_collectorManager->collector (),
+                m_logs.journal("SignatureVerifier")))
+
         , mValidations (make_Validations ())
 
         , m_loadManager (make_LoadManager (*this, m_logs.journal("LoadManager")))
@@ -490,6 +497,11 @@ public:
         return *mHashRouter;
     }
 
+    SignatureVerifier& getSignatureVerifier ()
+    {
+        return *m_signatureVerifier;
+    }
+
     Validations& getValidations ()
     {
         return *mValidations;
@@ -953,6 +965,9 @@ public:
         logTimedCall (m_journal.warning, "AcceptedLedger::sweep", __FILE__, __LINE__,
             &AcceptedLedger::sweep);
 
+        logTimedCall (m_journal.warning, "Pathfinder::sweepCache", __FILE__, __LINE__,
+            &Pathfinder::sweepCache);
+
         logTimedCall (m_journal.warning, "SHAMap::sweep", __FILE__, __LINE__,std::bind (
             &TreeNodeCache::sweep, &m_treeNodeCache));
 
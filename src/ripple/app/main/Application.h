@@ -58,6 +58,7 @@ class Validations;
 
 class DatabaseCon;
 class SHAMapStore;
+class SignatureVerifier;
 
 using NodeCache     = TaggedCache <uint256, Blob>;
 using SLECache      = TaggedCache <uint256, STLedgerEntry>;
@@ -103,6 +104,7 @@ public:
     virtual Validators::Manager&    getValidators () = 0;
     virtual AmendmentTable&         getAmendmentTable() = 0;
     virtual IHashRouter&            getHashRouter () = 0;
+    virtual SignatureVerifier&      getSignatureVerifier () = 0;
     virtual LoadFeeTrack&           getFeeTrack () = 0;
     virtual LoadManager&            getLoadManager () = 0;
     virtual Overlay&                overlay () = 0;
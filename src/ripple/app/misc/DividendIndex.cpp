@@ -0,0 +1,399 @@
+#include <BeastConfig.h>
+#include <ripple/app/misc/DividendIndex.h>
+#include <ripple/core/ParallelFor.h>
+#include <ripple/protocol/Indexes.h>
+#include <ripple/protocol/SystemParameters.h>
+#include <array>
+#include <fstream>
+
+namespace ripple {
+
+// "DIVX" followed by a format version
+static std::uint32_t const checkpointMagic = 0x44495658;
+static std::uint32_t const checkpointVersion = 1;
+
+DividendIndex::DividendIndex (beast::Journal journal, std::size_t historyDepth)
+    : m_journal (journal)
+    , m_historyDepth (historyDepth)
+    , m_seq (0)
+{
+}
+
+void DividendIndex::visitLedger (Ledger::ref ledger,
+    std::function <void (int branch, SLE::ref sle)> const& visit)
+{
+    parallelFor (16, [&](std::size_t branch)
+    {
+        ledger->visitStateItems (branch, [&visit, branch](SLE::ref sle)
+        {
+            if (sle->getType () == ltACCOUNT_ROOT || sle->getType () == ltREFER)
+                visit (branch, sle);
+        });
+    });
+}
+
+DividendIndex::DividendAccount DividendIndex::makeAccount (SLE const& sle)
+{
+    DividendAccount account;
+    account.account = sle.getFieldAccount (sfAccount).getAccountID ();
+    account.balanceVBC = sle.getFieldAmount (sfBalanceVBC).getNValue ();
+    account.height = 0;
+    if (sle.isFieldPresent (sfReferee) && sle.isFieldPresent (sfReferenceHeight))
+    {
+        account.height = sle.getFieldU32 (sfReferenceHeight);
+        account.referee = sle.getFieldAccount (sfReferee).getAccountID ();
+    }
+    return account;
+}
+
+void DividendIndex::readAccounts (Ledger::ref ledger, DividendAccounts& accounts)
+{
+    std::array<DividendAccounts, 16> branchAccounts;
+    std::array<std::vector<uint256>, 16> branchRefers;
+    visitLedger (ledger, [&](int branch, SLE::ref sle)
+    {
+        if (sle->getType () == ltREFER)
+            branchRefers[branch].push_back (sle->getIndex ());
+        else
+            branchAccounts[branch].push_back (makeAccount (*sle));
+    });
+
+    std::vector<uint256> refers;
+    std::size_t total = 0;
+    for (int branch = 0; branch < 16; ++branch)
+    {
+        refers.insert (refers.end (), branchRefers[branch].begin (), branchRefers[branch].end ());
+        total += branchAccounts[branch].size ();
+    }
+    // keys within and across branches are visited in ascending order
+    assert (std::is_sorted (refers.begin (), refers.end ()));
+
+    // accounts below one VBC only take part when they referred someone
+    accounts.clear ();
+    accounts.reserve (total);
+    for (auto& branch : branchAccounts)
+    {
+        for (auto const& account : branch)
+        {
+            if (account.balanceVBC < SYSTEM_CURRENCY_PARTS_VBC
+                && !std::binary_search (refers.begin (), refers.end (), getAccountReferIndex (account.account)))
+            {
+                continue;
+            }
+            accounts.push_back (account);
+        }
+        DividendAccounts ().swap (branch);
+    }
+}
+
+void DividendIndex::reset (Ledger::ref ledger)
+{
+    std::array<std::vector<std::pair<uint256, DividendAccount>>, 16> branchAccounts;
+    std::array<std::vector<uint256>, 16> branchRefers;
+    visitLedger (ledger, [&](int branch, SLE::ref sle)
+    {
+        if (sle->getType () == ltREFER)
+            branchRefers[branch].push_back (sle->getIndex ());
+        else
+            branchAccounts[branch].emplace_back (sle->getIndex (), makeAccount (*sle));
+    });
+
+    // entries arrive in key order, so every insert lands at the end
+    std::map <uint256, DividendAccount> accounts;
+    std::set <uint256> refers;
+    for (int branch = 0; branch < 16; ++branch)
+    {
+        for (auto const& entry : branchAccounts[branch])
+            accounts.emplace_hint (accounts.end (), entry);
+        refers.insert (branchRefers[branch].begin (), branchRefers[branch].end ());
+    }
+
+    std::lock_guard <std::mutex> lock (m_mutex);
+    m_seq = ledger->getLedgerSeq ();
+    m_hash = ledger->getHash ();
+    m_accounts.swap (accounts);
+    m_refers.swap (refers);
+    m_history.clear ();
+
+    if (m_journal.info) m_journal.info <<
+        "index reset to ledger " << m_seq << " with " << m_accounts.size () <<
+        " accounts " << m_refers.size () << " refers";
+}
+
+bool DividendIndex::applyLedger (AcceptedLedger const& accepted)
+{
+    Ledger::ref ledger = accepted.getLedger ();
+
+    {
+        std::lock_guard <std::mutex> lock (m_mutex);
+        if (m_seq == 0 || ledger->getLedgerSeq () != m_seq + 1 ||
+            ledger->getParentHash () != m_hash)
+            return false;
+    }
+
+    std::vector<uint256> changed;
+    for (auto const& it : accepted.getMap ())
+    {
+        auto const& meta = it.second->getMeta ();
+        if (!meta)
+            continue;
+        for (auto const& node : meta->getNodes ())
+        {
+            auto const type = node.getFieldU16 (sfLedgerEntryType);
+            if (type == ltACCOUNT_ROOT || type == ltREFER)
+                changed.push_back (node.getFieldH256 (sfLedgerIndex));
+        }
+    }
+    std::sort (changed.begin (), changed.end ());
+    changed.erase (std::unique (changed.begin (), changed.end ()), changed.end ());
+
+    // read the new entries before touching the index, a missing node
+    // leaves it unchanged
+    std::vector<SLE::pointer> entries;
+    entries.reserve (changed.size ());
+    for (auto const& index : changed)
+        entries.push_back (ledger->getSLEi (index));
+
+    std::lock_guard <std::mutex> lock (m_mutex);
+    if (m_seq == 0 || ledger->getLedgerSeq () != m_seq + 1 ||
+        ledger->getParentHash () != m_hash)
+        return false;
+
+    Delta delta;
+    delta.seq = ledger->getLedgerSeq ();
+    delta.parentHash = m_hash;
+    for (std::size_t i = 0; i < changed.size (); ++i)
+        setEntry (changed[i], entries[i], delta);
+
+    m_seq = ledger->getLedgerSeq ();
+    m_hash = ledger->getHash ();
+    m_history.push_back (std::move (delta));
+    while (m_history.size () > m_historyDepth)
+        m_history.pop_front ();
+
+    if (m_journal.trace) m_journal.trace <<
+        "index applied ledger " << m_seq << " with " << changed.size () << " changes";
+    return true;
+}
+
+void DividendIndex::setEntry (uint256 const& index, SLE::pointer const& sle, Delta& delta)
+{
+    if (!sle)
+    {
+        if (m_refers.erase (index))
+        {
+            delta.refers.emplace_back (index, true);
+            return;
+        }
+        auto it = m_accounts.find (index);
+        if (it != m_accounts.end ())
+        {
+            delta.accounts.emplace_back (index, it->second);
+            m_accounts.erase (it);
+        }
+        return;
+    }
+
+    if (sle->getType () == ltREFER)
+    {
+        if (m_refers.insert (index).second)
+            delta.refers.emplace_back (index, false);
+        return;
+    }
+
+    if (sle->getType () != ltACCOUNT_ROOT)
+        return;
+
+    auto it = m_accounts.find (index);
+    if (it == m_accounts.end ())
+    {
+        delta.accounts.emplace_back (index, boost::none);
+        m_accounts.emplace (index, makeAccount (*sle));
+    }
+    else
+    {
+        delta.accounts.emplace_back (index, it->second);
+        it->second = makeAccount (*sle);
+    }
+}
+
+bool DividendIndex::getAccounts (Ledger::ref ledger, DividendAccounts& accounts) const
+{
+    std::lock_guard <std::mutex> lock (m_mutex);
+
+    std::uint32_t const seq = ledger->getLedgerSeq ();
+    if (m_seq == 0 || seq > m_seq || seq + m_history.size () < m_seq)
+        return false;
+
+    // Undo the ledgers after seq, newest first, so the value an entry had
+    // before the oldest of them wins.
+    std::map <uint256, boost::optional <DividendAccount>> accountOverrides;
+    std::map <uint256, bool> referOverrides;
+    uint256 hash = m_hash;
+    for (auto it = m_history.rbegin (); it != m_history.rend () && it->seq > seq; ++it)
+    {
+        for (auto const& entry : it->accounts)
+            accountOverrides[entry.first] = entry.second;
+        for (auto const& entry : it->refers)
+            referOverrides[entry.first] = entry.second;
+        hash = it->parentHash;
+    }
+
+    if (hash != ledger->getHash ())
+        return false;
+
+    auto hasRefer = [&](Account const& account)
+    {
+        auto const index = getAccountReferIndex (account);
+        auto const it = referOverrides.find (index);
+        if (it != referOverrides.end ())
+            return it->second;
+        return m_refers.count (index) != 0;
+    };
+    auto add = [&](DividendAccount const& account)
+    {
+        // accounts below one VBC only take part when they referred someone
+        if (account.balanceVBC < SYSTEM_CURRENCY_PARTS_VBC && !hasRefer (account.account))
+            return;
+        accounts.push_back (account);
+    };
+
+    // merge the current entries with the overrides, in key order
+    accounts.clear ();
+    accounts.reserve (m_accounts.size ());
+    auto over = accountOverrides.begin ();
+    for (auto const& entry : m_accounts)
+    {
+        for (; over != accountOverrides.end () && over->first < entry.first; ++over)
+        {
+            if (over->second)
+                add (*over->second);
+        }
+        if (over != accountOverrides.end () && over->first == entry.first)
+        {
+            if (over->second)
+                add (*over->second);
+            ++over;
+            continue;
+        }
+        add (entry.second);
+    }
+    for (; over != accountOverrides.end (); ++over)
+    {
+        if (over->second)
+            add (*over->second);
+    }
+    return true;
+}
+
+bool DividendIndex::isValid () const
+{
+    std::lock_guard <std::mutex> lock (m_mutex);
+    return m_seq != 0;
+}
+
+std::uint32_t DividendIndex::getLedgerSeq () const
+{
+    std::lock_guard <std::mutex> lock (m_mutex);
+    return m_seq;
+}
+
+bool DividendIndex::save (std::string const& path) const
+{
+    std::string const temp = path + ".tmp";
+    {
+        std::ofstream out (temp, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+
+        std::lock_guard <std::mutex> lock (m_mutex);
+        if (m_seq == 0)
+            return false;
+
+        Serializer s;
+        s.add32 (checkpointMagic);
+        s.add32 (checkpointVersion);
+        s.add32 (m_seq);
+        s.add256 (m_hash);
+        s.add64 (m_accounts.size ());
+        s.add64 (m_refers.size ());
+        for (auto const& entry : m_accounts)
+        {
+            s.add256 (entry.first);
+            s.add160 (entry.second.account);
+            s.add160 (entry.second.referee);
+            s.add64 (entry.second.balanceVBC);
+            s.add32 (entry.second.height);
+            if (s.getLength () >= 1024 * 1024)
+            {
+                out.write (static_cast<char const*> (s.getDataPtr ()), s.getLength ());
+                s.erase ();
+            }
+        }
+        for (auto const& index : m_refers)
+            s.add256 (index);
+        out.write (static_cast<char const*> (s.getDataPtr ()), s.getLength ());
+        if (!out)
+            return false;
+    }
+
+    if (std::rename (temp.c_str (), path.c_str ()) != 0)
+        return false;
+
+    if (m_journal.info) m_journal.info <<
+        "index checkpointed at ledger " << getLedgerSeq ();
+    return true;
+}
+
+bool DividendIndex::load (std::string const& path)
+{
+    std::ifstream in (path, std::ios::binary);
+    if (!in)
+        return false;
+
+    Blob data ((std::istreambuf_iterator<char> (in)), std::istreambuf_iterator<char> ());
+    Serializer s (data);
+    SerializerIterator sit (s);
+
+    std::uint32_t seq;
+    uint256 hash;
+    std::map <uint256, DividendAccount> accounts;
+    std::set <uint256> refers;
+    try
+    {
+        if (sit.get32 () != checkpointMagic || sit.get32 () != checkpointVersion)
+            return false;
+        seq = sit.get32 ();
+        hash = sit.get256 ();
+        std::uint64_t const accountCount = sit.get64 ();
+        std::uint64_t const referCount = sit.get64 ();
+        for (std::uint64_t i = 0; i < accountCount; ++i)
+        {
+            uint256 const index = sit.get256 ();
+            DividendAccount account;
+            sit.getBitString (account.account);
+            sit.getBitString (account.referee);
+            account.balanceVBC = sit.get64 ();
+            account.height = sit.get32 ();
+            accounts.emplace_hint (accounts.end (), index, account);
+        }
+        for (std::uint64_t i = 0; i < referCount; ++i)
+            refers.insert (refers.end (), sit.get256 ());
+    }
+    catch (std::exception const& e)
+    {
+        if (m_journal.warning) m_journal.warning <<
+            "bad index checkpoint " << path << ": " << e.what ();
+        return false;
+    }
+
+    std::lock_guard <std::mutex> lock (m_mutex);
+    m_seq = seq;
+    m_hash = hash;
+    m_accounts.swap (accounts);
+    m_refers.swap (refers);
+    m_history.clear ();
+    return true;
+}
+
+}
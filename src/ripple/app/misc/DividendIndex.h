@@ -0,0 +1,96 @@
+#ifndef RIPPLE_APP_DIVIDEND_INDEX_H_INCLUDED
+#define RIPPLE_APP_DIVIDEND_INDEX_H_INCLUDED
+
+#include <ripple/app/ledger/AcceptedLedger.h>
+#include <ripple/app/misc/DividendMaster.h>
+#include <boost/optional.hpp>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+
+namespace ripple {
+
+/** The AccountRoot and Refer entries the dividend is calculated from.
+
+    The index is built once from a full walk of a ledger's state and then
+    kept current from the metadata of each following ledger, so a dividend
+    run does not need to walk the whole base ledger. The changes of the
+    last few ledgers are kept so the state of a recent base ledger can be
+    reproduced. The current state can be checkpointed to disk.
+*/
+class DividendIndex
+{
+public:
+    typedef DividendMaster::DividendAccount DividendAccount;
+    typedef DividendMaster::DividendAccounts DividendAccounts;
+
+    explicit DividendIndex (beast::Journal journal, std::size_t historyDepth = 256);
+
+    /** Visit the AccountRoot and Refer entries of a ledger.
+        The 16 branches of the state map root are walked concurrently;
+        visit(branch, sle) is called from one thread per branch and sees
+        each branch's entries in state map order.
+    */
+    static void visitLedger (Ledger::ref ledger,
+        std::function <void (int branch, SLE::ref sle)> const& visit);
+
+    /** Read the accounts taking part in a dividend with a full walk of
+        the ledger's state, without keeping an index.
+    */
+    static void readAccounts (Ledger::ref ledger, DividendAccounts& accounts);
+
+    /** Rebuild the index from a full walk of the ledger's state. */
+    void reset (Ledger::ref ledger);
+
+    /** Apply the state changes of the ledger following the current one.
+        @return false if the ledger does not follow the indexed ledger, in
+                which case the index is left unchanged.
+    */
+    bool applyLedger (AcceptedLedger const& ledger);
+
+    /** Fetch the accounts taking part in a dividend based on a ledger.
+        Accounts are in state map order, as calcDividendFunc expects.
+        @return false if the ledger is not the current one or in history.
+    */
+    bool getAccounts (Ledger::ref ledger, DividendAccounts& accounts) const;
+
+    bool isValid () const;
+    std::uint32_t getLedgerSeq () const;
+
+    /** Write the current state to a checkpoint file. */
+    bool save (std::string const& path) const;
+
+    /** Replace the index with a checkpoint written by save. History is
+        not part of the checkpoint.
+    */
+    bool load (std::string const& path);
+
+private:
+    // Prior values of the entries one ledger changed
+    struct Delta
+    {
+        std::uint32_t seq;
+        uint256 parentHash;
+        std::vector <std::pair <uint256, boost::optional <DividendAccount>>> accounts;
+        std::vector <std::pair <uint256, bool>> refers;
+    };
+
+    static DividendAccount makeAccount (SLE const& sle);
+
+    void setEntry (uint256 const& index, SLE::pointer const& sle, Delta& delta);
+
+    beast::Journal m_journal;
+    std::size_t const m_historyDepth;
+
+    mutable std::mutex m_mutex;
+    std::uint32_t m_seq;
+    uint256 m_hash;
+    std::map <uint256, DividendAccount> m_accounts;
+    std::set <uint256> m_refers;
+    std::deque <Delta> m_history;
+};
+
+}
+
+#endif //RIPPLE_APP_DIVIDEND_INDEX_H_INCLUDED
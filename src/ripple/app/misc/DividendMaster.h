@@ -6,6 +6,9 @@
 
 namespace ripple {
 
+class AcceptedLedger;
+class DividendIndex;
+
 class DividendMaster
 {
 public:
@@ -40,11 +43,34 @@ public:
     virtual void setLedgerSeq(uint32_t seq) = 0;
     virtual uint32_t getLedgerSeq() = 0;
     
+    virtual DividendIndex& getIndex() = 0;
+    /// Keep the dividend index current with a newly published ledger.
+    virtual void applyLedger(std::shared_ptr<AcceptedLedger> const& ledger) = 0;
+    
+    // An AccountRoot taking part in the dividend, as read from the base ledger.
+    struct DividendAccount
+    {
+        Account account;
+        Account referee;
+        uint64_t balanceVBC;
+        uint32_t height;
+    };
+    // Accounts in state map order.
+    typedef std::vector<DividendAccount> DividendAccounts;
+
     static void calcDividend(Ledger::ref lastClosedLedger);
     
     
     /// @return true: needs dividend.
     static bool calcDividendFunc(Ledger::ref baseLedger, uint64_t dividendCoins, uint64_t dividendCoinsVBC, AccountsDividend& accountsOut, uint64_t& actualTotalDividend, uint64_t& actualTotalDividendVBC, uint64_t& sumVRank, uint64_t& sumVSpd);
+
+    /// Same as above, for accounts already collected from the base ledger.
+    static bool calcDividendFunc(DividendAccounts const& accounts, uint64_t dividendCoins, uint64_t dividendCoinsVBC, AccountsDividend& accountsOut, uint64_t& actualTotalDividend, uint64_t& actualTotalDividendVBC, uint64_t& sumVRank, uint64_t& sumVSpd);
+
+    /// Load the AccountRoots the dividend apply transactions among txns will
+    /// modify into the ledger's state map, reading them concurrently, so the
+    /// transactions applied one by one afterwards do not wait on the node store.
+    static void prefetchApply(Ledger::ref ledger, std::vector<STTx::pointer> const& txns);
 };
 
 std::unique_ptr<DividendMaster>
@@ -11,13 +11,21 @@
 #include <ripple/app/ledger/LedgerMaster.h>
 #include <ripple/app/main/Application.h>
 #include <ripple/app/misc/DefaultMissingNodeHandler.h>
+#include <ripple/app/misc/DividendIndex.h>
 #include <ripple/app/misc/DividendMaster.h>
 #include <ripple/app/misc/NetworkOPs.h>
 #include <ripple/basics/Log.h>
+#include <ripple/core/ParallelFor.h>
+#include <ripple/protocol/Indexes.h>
 #include <ripple/protocol/SystemParameters.h>
+#include <algorithm>
+#include <array>
 
 namespace ripple {
         
+// Indexes each thread takes at a time in the parallel loops
+static std::size_t const parallelGrain = 256;
+
 static inline uint64_t memUsed(void) {
 #if (defined (_WIN32) || defined (_WIN64))
     //CARL windows implementation
@@ -39,7 +47,10 @@ public:
         : m_journal(journal),
         m_ready(false),
         m_dividendLedgerSeq(0),
-        m_running(false)
+        m_running(false),
+        m_index(journal),
+        m_indexLoaded(false),
+        m_indexRebuilding(false)
     {
     }
 
@@ -137,31 +148,10 @@ public:
                                         DefaultMissingNodeHandler(),
                                         deprecatedLogs().journal("SHAMap"));
         
-        for (const auto& it : m_divResult)
+        auto items = makeDivResultItems();
+        if (txMap->addGiveItems(items, true, false) != static_cast<int>(items.size()))
         {
-            STTx trans(ttDIVIDEND);
-            trans.setFieldU8(sfDividendType, DividendMaster::DivType_Apply);
-            trans.setFieldAccount(sfAccount, Account());
-            trans.setFieldAccount(sfDestination, std::get<0>(it));
-            trans.setFieldU32(sfDividendLedger, m_dividendLedgerSeq);
-            trans.setFieldU64(sfDividendCoins, std::get<1>(it));
-            trans.setFieldU64(sfDividendCoinsVBC, std::get<2>(it));
-            trans.setFieldU64(sfDividendCoinsVBCRank, std::get<3>(it));
-            trans.setFieldU64(sfDividendCoinsVBCSprd, std::get<4>(it));
-            trans.setFieldU64(sfDividendVRank, std::get<5>(it));
-            trans.setFieldU64(sfDividendVSprd, std::get<6>(it));
-            trans.setFieldU64(sfDividendTSprd, std::get<7>(it));
-
-            uint256 txID = trans.getTransactionID();
-            Serializer s;
-            trans.add(s, true);
-            
-            SHAMapItem::pointer tItem = std::make_shared<SHAMapItem>(txID, s.peekData());
-            
-            if (!txMap->addGiveItem(tItem, true, false))
-            {
-                return false;
-            }
+            return false;
         }
         m_resultHash = txMap->getHash();
 #endif // RADAR_ASYNC_DIVIDEND
@@ -213,7 +203,78 @@ public:
 
     void fillDivResult(SHAMap::pointer initialPosition) override
     {
-        for (const auto& it : m_divResult) {
+        auto items = makeDivResultItems();
+        int added = initialPosition->addGiveItems(items, true, false);
+        if (added != static_cast<int>(items.size())) {
+            if (m_journal.warning.active())
+                m_journal.warning << "Ledger already had " << (items.size() - added) << " dividend TXs";
+        }
+        if (m_journal.trace.active()) {
+            for (std::size_t i = 0; i < items.size(); ++i)
+                m_journal.trace << "dividend add TX " << items[i]->getTag() << " for " << std::get<0>(m_divResult[i]);
+        }
+        if (m_journal.info)
+            m_journal.info << "dividend add " << added << " TXs done. Mem" << memUsed();
+    }
+
+    void setLedgerSeq(uint32_t seq) override
+    {
+        m_dividendLedgerSeq = seq;
+    }
+
+    uint32_t getLedgerSeq() override
+    {
+        return m_dividendLedgerSeq;
+    }
+
+    DividendIndex& getIndex() override
+    {
+        return m_index;
+    }
+
+    void applyLedger(AcceptedLedger::pointer const& accepted) override
+    {
+        std::lock_guard<std::mutex> lock(m_indexLock);
+        
+        if (m_indexRebuilding)
+        {
+            m_pendingLedgers.push_back(accepted);
+            return;
+        }
+        
+        if (!m_indexLoaded)
+        {
+            m_indexLoaded = true;
+            if (m_index.load(checkpointPath()) && m_journal.info)
+                m_journal.info << "dividend index loaded at ledger " << m_index.getLedgerSeq();
+        }
+        
+        if (m_index.applyLedger(*accepted))
+        {
+            if ((accepted->getLedgerSeq() % 256) == 0)
+            {
+                getApp().getJobQueue().addJob(jtDIVIDEND, "DividendIndex::save",
+                    std::bind(&DividendMasterImpl::saveIndex, this));
+            }
+            return;
+        }
+        
+        // the index is not at the parent of this ledger, rebuild from it
+        m_indexRebuilding = true;
+        getApp().getJobQueue().addJob(jtDIVIDEND, "DividendIndex::reset",
+            std::bind(&DividendMasterImpl::rebuildIndex, this, accepted->getLedger()));
+    }
+
+
+private:
+    // One ttDIVIDEND apply transaction per result, in result order. The
+    // transactions are serialized and hashed concurrently.
+    std::vector<SHAMapItem::pointer> makeDivResultItems()
+    {
+        std::vector<SHAMapItem::pointer> items(m_divResult.size());
+        parallelFor(items.size(), [&](std::size_t i)
+        {
+            auto const& it = m_divResult[i];
             STTx trans(ttDIVIDEND);
             trans.setFieldU8(sfDividendType, DividendMaster::DivType_Apply);
             trans.setFieldAccount(sfAccount, Account());
@@ -227,37 +288,64 @@ public:
             trans.setFieldU64(sfDividendVSprd, std::get<6>(it));
             trans.setFieldU64(sfDividendTSprd, std::get<7>(it));
 
-            uint256 txID = trans.getTransactionID();
             Serializer s;
             trans.add(s, true);
-
-            SHAMapItem::pointer tItem = std::make_shared<SHAMapItem>(txID, s.peekData());
-
-            if (!initialPosition->addGiveItem(tItem, true, false)) {
-                if (m_journal.warning.active())
-                    m_journal.warning << "Ledger already had dividend for " << std::get<0>(it);
-            }
-            else {
-                if (m_journal.trace.active())
-                    m_journal.trace << "dividend add TX " << txID << " for " << std::get<0>(it);
-            }
-        }
-        if (m_journal.info)
-            m_journal.info << "dividend add " << m_divResult.size() << " TXs done. Mem" << memUsed();
+            items[i] = std::make_shared<SHAMapItem>(trans.getTransactionID(), s.peekData());
+        }, 0, parallelGrain);
+        return items;
     }
 
-    void setLedgerSeq(uint32_t seq) override
+    static std::string checkpointPath()
     {
-        m_dividendLedgerSeq = seq;
+        return (getConfig().DATA_DIR / "dividend.idx").string();
     }
-
-    uint32_t getLedgerSeq() override
+    
+    void saveIndex()
     {
-        return m_dividendLedgerSeq;
+        if (!m_index.save(checkpointPath()) && m_journal.warning)
+            m_journal.warning << "dividend index checkpoint failed";
     }
-
-
-private:
+    
+    void rebuildIndex(Ledger::pointer ledger)
+    {
+        try
+        {
+            m_index.reset(ledger);
+        }
+        catch (SHAMapMissingNode const& e)
+        {
+            if (m_journal.warning)
+                m_journal.warning << "dividend index rebuild failed: " << e;
+        }
+        catch (std::exception const& e)
+        {
+            if (m_journal.warning)
+                m_journal.warning << "dividend index rebuild failed: " << e.what ();
+        }
+        
+        std::lock_guard<std::mutex> lock(m_indexLock);
+        m_indexRebuilding = false;
+        
+        // catch up with the ledgers published during the rebuild
+        Ledger::pointer restart;
+        for (auto const& accepted : m_pendingLedgers)
+        {
+            if (!m_index.isValid()
+                || static_cast<std::uint32_t>(accepted->getLedgerSeq()) <= m_index.getLedgerSeq())
+                continue;
+            if (!m_index.applyLedger(*accepted))
+                restart = accepted->getLedger();
+        }
+        m_pendingLedgers.clear();
+        
+        if (restart)
+        {
+            m_indexRebuilding = true;
+            getApp().getJobQueue().addJob(jtDIVIDEND, "DividendIndex::reset",
+                std::bind(&DividendMasterImpl::rebuildIndex, this, restart));
+        }
+    }
+    
     beast::Journal m_journal;
     beast::RecursiveMutex m_lock;
     bool m_ready;
@@ -269,6 +357,12 @@ private:
     uint64_t m_sumVSpd=0;
     uint256 m_resultHash;
     bool m_running;
+    
+    DividendIndex m_index;
+    std::mutex m_indexLock;
+    bool m_indexLoaded;
+    bool m_indexRebuilding;
+    std::vector<AcceptedLedger::pointer> m_pendingLedgers;
 };
 
 void DividendMaster::calcDividend(Ledger::ref lastClosedLedger)
@@ -306,7 +400,18 @@ void DividendMaster::calcDividend(Ledger::ref lastClosedLedger)
     uint64_t actualTotalDividend = 0;
     uint64_t actualTotalDividendVBC = 0, sumVRank=0, sumVSpd=0;
     
-    if (!DividendMaster::calcDividendFunc(baseLedger,
+    DividendAccounts accounts;
+    if (dividendMaster->getIndex().getAccounts(baseLedger, accounts))
+    {
+        WriteLog(lsINFO, DividendMaster) << "calcDividend got " << accounts.size() << " accounts from index for ledger " << baseLedgerSeq;
+    }
+    else
+    {
+        WriteLog(lsINFO, DividendMaster) << "calcDividend index at " << dividendMaster->getIndex().getLedgerSeq() << " walking ledger " << baseLedgerSeq;
+        DividendIndex::readAccounts(baseLedger, accounts);
+    }
+    
+    if (!DividendMaster::calcDividendFunc(accounts,
                                       dividendCoins,
                                       dividendCoinsVBC,
                                       dividendMaster->getDivResult(),
@@ -338,62 +443,95 @@ void DividendMaster::calcDividend(Ledger::ref lastClosedLedger)
     dividendMaster->unlock();
 }
 
+void DividendMaster::prefetchApply(Ledger::ref ledger, std::vector<STTx::pointer> const& txns)
+{
+    std::vector<uint256> indexes;
+    for (auto const& txn : txns)
+    {
+        if (txn && txn->getTxnType() == ttDIVIDEND &&
+            txn->isFieldPresent(sfDividendType) &&
+            txn->getFieldU8(sfDividendType) == DivType_Apply &&
+            txn->isFieldPresent(sfDestination))
+        {
+            indexes.push_back(getAccountRootIndex(txn->getFieldAccount160(sfDestination)));
+        }
+    }
+
+    // only a dividend ledger is worth the threads
+    if (indexes.size() < 256)
+        return;
+
+    // sorted, each chunk reads from one region of the state map
+    std::sort(indexes.begin(), indexes.end());
+
+    SHAMap::ref stateMap = ledger->peekAccountStateMap();
+    parallelFor(indexes.size(), [&](std::size_t i)
+    {
+        try
+        {
+            stateMap->peekItem(indexes[i]);
+        }
+        catch (SHAMapMissingNode const&)
+        {
+            // reported when the transaction itself reads the entry
+        }
+    }, 0, parallelGrain);
+
+    WriteLog(lsDEBUG, DividendMaster) << "prefetched " << indexes.size() << " dividend accounts";
+}
+
 static inline uint64_t adjust(uint64_t coin)
 {
     return coin>=10000000000 ? coin+90000000000 : coin*10;
 }
 
-class AccountsByReference_Less {
-public:
-    template <class T>
-    bool operator()(const T &x, const T &y) const
-    {
-        // Accounts by reference height needs to be descending order
-        if (std::get<2>(x) > std::get<2>(y))
-            return true;
-        else if (std::get<2>(x) == std::get<2>(y))
-            return std::get<1>(x) > std::get<1>(y);
-        return false;
+// Stable LSD radix sort of account positions, one byte per pass. digit(i, b)
+// returns byte b (0 is least significant) of the sort key of account i.
+// Passes where every key has the same digit are skipped.
+template <class Digit>
+static void radixSort(std::vector<uint32_t>& order, std::size_t keyBytes, Digit digit)
+{
+    std::vector<uint32_t> scratch(order.size());
+    for (std::size_t b = 0; b < keyBytes; ++b) {
+        std::array<std::size_t, 257> count {};
+        for (auto i : order)
+            ++count[digit(i, b) + 1];
+        if (std::find(count.begin(), count.end(), order.size()) != count.end())
+            continue;
+        for (std::size_t d = 1; d < count.size(); ++d)
+            count[d] += count[d - 1];
+        for (auto i : order)
+            scratch[count[digit(i, b)]++] = i;
+        order.swap(scratch);
     }
-};
+}
 
 bool DividendMaster::calcDividendFunc(Ledger::ref baseLedger, uint64_t dividendCoins, uint64_t dividendCoinsVBC, AccountsDividend& accountsOut, uint64_t& actualTotalDividend, uint64_t& actualTotalDividendVBC, uint64_t& sumVRank, uint64_t& sumVSpd)
 {
     WriteLog(lsINFO, DividendMaster) << "Expected dividend: " << dividendCoins << " " << dividendCoinsVBC << " for ledger " << baseLedger->getLedgerSeq() << " Mem " << memUsed();
     
-    // <BalanceVBC, <AccountId, ParentAccoutId, Height>>, accounts sorted by balance
-    std::multimap<uint64_t, std::tuple<Account, Account, uint32_t>> accountsByBalance;
-    
-    // <<AccountId, ParentId, Height>, <BalanceVBC, VRank, VSpd, TSpd>>, accounts sorted by reference height and parent desc
-    std::multimap<std::tuple<Account, Account, uint32_t>, std::tuple<uint64_t, uint32_t, uint64_t, uint64_t>, AccountsByReference_Less> accountsByReference;
+    DividendAccounts accounts;
+    DividendIndex::readAccounts(baseLedger, accounts);
     
-    // visit account stats to fill accountsByBalance
-    baseLedger->visitStateItems([&accountsByBalance, &accountsByReference, baseLedger](SLE::ref sle) {
-        if (sle->getType() == ltACCOUNT_ROOT) {
-            uint64_t bal = sle->getFieldAmount(sfBalanceVBC).getNValue();
-            if (bal < SYSTEM_CURRENCY_PARTS_VBC
-                && !baseLedger->hasRefer(sle->getFieldAccount(sfAccount).getAccountID())) {
-                return;
-            }
-            uint32_t height = 0;
-            Account addrParent;
-            if (sle->isFieldPresent(sfReferee) && sle->isFieldPresent(sfReferenceHeight)) {
-                height = sle->getFieldU32(sfReferenceHeight);
-                addrParent = sle->getFieldAccount(sfReferee).getAccountID();
-            }
-            if (bal < SYSTEM_CURRENCY_PARTS_VBC)
-                accountsByReference.emplace(std::piecewise_construct,
-                                            std::forward_as_tuple(sle->getFieldAccount(sfAccount).getAccountID(), addrParent, height),
-                                            std::forward_as_tuple(bal, 0, 0, 0));
-            else
-                accountsByBalance.emplace(std::piecewise_construct,
-                                          std::forward_as_tuple(bal),
-                                          std::forward_as_tuple(sle->getFieldAccount(sfAccount).getAccountID(), addrParent, height));
-        }
-    });
-    WriteLog(lsINFO, DividendMaster) << "calcDividend got " << accountsByBalance.size() << " accounts for ranking " << accountsByReference.size() << " accounts for sprd Mem " << memUsed();
+    return calcDividendFunc(accounts, dividendCoins, dividendCoinsVBC, accountsOut, actualTotalDividend, actualTotalDividendVBC, sumVRank, sumVSpd);
+}
+
+bool DividendMaster::calcDividendFunc(DividendAccounts const& accounts, uint64_t dividendCoins, uint64_t dividendCoinsVBC, AccountsDividend& accountsOut, uint64_t& actualTotalDividend, uint64_t& actualTotalDividendVBC, uint64_t& sumVRank, uint64_t& sumVSpd)
+{
+    // positions into accounts, sorted by balance
+    std::vector<uint32_t> byBalance;
+    // positions into accounts, sorted by reference height and parent desc
+    std::vector<uint32_t> byReference;
+    byReference.reserve(accounts.size());
+    for (uint32_t i = 0; i < accounts.size(); ++i) {
+        if (accounts[i].balanceVBC < SYSTEM_CURRENCY_PARTS_VBC)
+            byReference.push_back(i);
+        else
+            byBalance.push_back(i);
+    }
+    WriteLog(lsINFO, DividendMaster) << "calcDividend got " << byBalance.size() << " accounts for ranking " << byReference.size() << " accounts for sprd Mem " << memUsed();
     
-    if (accountsByBalance.empty() && accountsByReference.empty())
+    if (accounts.empty())
     {
         accountsOut.clear();
         actualTotalDividend = 0;
@@ -403,63 +541,94 @@ bool DividendMaster::calcDividendFunc(Ledger::ref baseLedger, uint64_t dividendC
         return true;
     }
     
-    // traverse accountsByBalance to caculate V ranking into VRank in accountsByReference
+    std::vector<uint32_t> vRank(accounts.size(), 0);
+    std::vector<uint64_t> vSpd(accounts.size(), 0);
+    std::vector<uint64_t> tSpd(accounts.size(), 0);
+    
+    // traverse accounts by balance to caculate V ranking into VRank
+    radixSort(byBalance, sizeof(uint64_t), [&accounts](uint32_t i, std::size_t b) {
+        return static_cast<std::size_t>((accounts[i].balanceVBC >> (8 * b)) & 0xff);
+    });
     sumVRank = 0;
     {
         uint64_t lastBalance = 0;
         uint32_t pos = 1, rank = 1;
-        for (auto it = accountsByBalance.begin(); it != accountsByBalance.end(); ++pos) {
-            if (lastBalance < it->first) {
+        for (auto i : byBalance) {
+            if (lastBalance < accounts[i].balanceVBC) {
                 rank = pos;
-                lastBalance = it->first;
+                lastBalance = accounts[i].balanceVBC;
             }
-            accountsByReference.emplace(std::piecewise_construct, it->second, std::forward_as_tuple(it->first, rank, 0, 0));
+            vRank[i] = rank;
             sumVRank += rank;
-            it = accountsByBalance.erase(it);
+            byReference.push_back(i);
+            ++pos;
         }
     }
+    std::vector<uint32_t>().swap(byBalance);
     WriteLog(lsINFO, DividendMaster) << "calcDividend got v rank total: " << sumVRank << " Mem " << memUsed();
     
-    // traverse accountsByReference to caculate V spreading into VSpd
+    // Reference height desc, then parent desc. Accounts with the same
+    // height and parent keep the order in which they were ranked.
+    radixSort(byReference, Account::bytes, [&accounts](uint32_t i, std::size_t b) {
+        return static_cast<std::size_t>(0xff - accounts[i].referee.begin()[Account::bytes - 1 - b]);
+    });
+    radixSort(byReference, sizeof(uint32_t), [&accounts](uint32_t i, std::size_t b) {
+        return static_cast<std::size_t>(0xff - ((accounts[i].height >> (8 * b)) & 0xff));
+    });
+    
+    // traverse accounts by reference to caculate V spreading into VSpd
     sumVSpd = 0;
     {
-        // <AccountId, <TotalChildrenHolding, TotalChildrenVSpd>>, children holding cache
-        hash_map<Account, std::pair<uint64_t, uint64_t>> childrenHoldings;
+        // positions into accounts, sorted by account id, to find parents
+        std::vector<uint32_t> byAccount(accounts.size());
+        for (uint32_t i = 0; i < byAccount.size(); ++i)
+            byAccount[i] = i;
+        std::sort(byAccount.begin(), byAccount.end(), [&accounts](uint32_t a, uint32_t b) {
+            return accounts[a].account < accounts[b].account;
+        });
+        
+        // <TotalChildrenHolding, TotalChildrenVSpd> waiting for their parent
+        std::vector<std::pair<uint64_t, uint64_t>> childrenHoldings(accounts.size());
+        std::vector<bool> hasChildrenHoldings(accounts.size(), false);
+        
         Account lastParent;
         uint64_t totalChildrenVSpd = 0, totalChildrenHolding = 0, maxHolding = 0;
-        for (auto& it : accountsByReference) {
-            const Account& accountParent = std::get<1>(it.first);
+        for (auto i : byReference) {
+            const Account& accountParent = accounts[i].referee;
             if (lastParent != accountParent) {
                 // no more for lastParent, store it
                 if (totalChildrenVSpd != 0) {
-                    childrenHoldings.emplace(lastParent, std::make_pair(totalChildrenHolding, totalChildrenVSpd - adjust(maxHolding) + (static_cast<uint64_t>(pow(maxHolding/SYSTEM_CURRENCY_PARTS_VBC, 1.0 / 3))*SYSTEM_CURRENCY_PARTS_VBC)));
+                    auto it = std::lower_bound(byAccount.begin(), byAccount.end(), lastParent, [&accounts](uint32_t a, Account const& id) {
+                        return accounts[a].account < id;
+                    });
+                    if (it != byAccount.end() && accounts[*it].account == lastParent && !hasChildrenHoldings[*it]) {
+                        hasChildrenHoldings[*it] = true;
+                        childrenHoldings[*it] = std::make_pair(totalChildrenHolding, totalChildrenVSpd - adjust(maxHolding) + (static_cast<uint64_t>(pow(maxHolding/SYSTEM_CURRENCY_PARTS_VBC, 1.0 / 3))*SYSTEM_CURRENCY_PARTS_VBC));
+                    }
                 }
                 totalChildrenVSpd = totalChildrenHolding = maxHolding = 0;
                 lastParent = accountParent;
             }
             
-            const Account& account = std::get<0>(it.first);
-            
             uint64_t t = 0, v = 0;
             
             // pickup children holding.
-            auto itHolding = childrenHoldings.find(account);
-            if (itHolding != childrenHoldings.end()) {
-                t = itHolding->second.first;
-                v = itHolding->second.second;
-                childrenHoldings.erase(itHolding);
+            if (hasChildrenHoldings[i]) {
+                t = childrenHoldings[i].first;
+                v = childrenHoldings[i].second;
+                hasChildrenHoldings[i] = false;
             }
             
-            uint64_t balance = std::get<0>(it.second);
+            uint64_t balance = accounts[i].balanceVBC;
             
             // store V spreading
             if (balance >= SYSTEM_CURRENCY_PARTS_VBC) {
-                std::get<2>(it.second) = v;
+                vSpd[i] = v;
                 sumVSpd += v;
             }
             
             t += balance;
-            std::get<3>(it.second) = t;
+            tSpd[i] = t;
             
             if (accountParent.isZero())
                 continue;
@@ -473,20 +642,20 @@ bool DividendMaster::calcDividendFunc(Ledger::ref baseLedger, uint64_t dividendC
     }
     WriteLog(lsINFO, DividendMaster) << "calcDividend got v spread total: " << sumVSpd << " Mem " << memUsed();
     
-    // traverse accountsByReference to calc dividend
-    accountsOut.reserve(accountsByReference.size()+1);
+    // traverse accounts by reference to calc dividend
+    accountsOut.reserve(byReference.size()+1);
     actualTotalDividend = 0; actualTotalDividendVBC = 0;
     uint64_t totalDivVBCbyRank = dividendCoinsVBC / 2;
     uint64_t totalDivVBCbyPower = dividendCoinsVBC - totalDivVBCbyRank;
-    for (const auto& it : accountsByReference) {
+    for (auto i : byReference) {
         uint64_t divVBC = 0;
         boost::multiprecision::uint128_t divVBCbyRank(0), divVBCbyPower(0);
         if (dividendCoinsVBC > 0 && sumVSpd > 0 && sumVRank > 0) {
             divVBCbyRank = totalDivVBCbyRank;
-            divVBCbyRank *= std::get<1>(it.second);
+            divVBCbyRank *= vRank[i];
             divVBCbyRank /= sumVRank;
             divVBCbyPower = totalDivVBCbyPower;
-            divVBCbyPower *= std::get<2>(it.second);
+            divVBCbyPower *= vSpd[i];
             divVBCbyPower /= sumVSpd;
             divVBC = static_cast<uint64_t>(divVBCbyRank + divVBCbyPower);
             if (divVBC < VBC_DIVIDEND_MIN) {
@@ -498,17 +667,17 @@ bool DividendMaster::calcDividendFunc(Ledger::ref baseLedger, uint64_t dividendC
         }
         uint64_t div = 0;
         if (dividendCoins > 0 && (dividendCoinsVBC == 0 || divVBC >= VBC_DIVIDEND_MIN)) {
-            div = std::get<0>(it.second) * VRP_INCREASE_RATE / VRP_INCREASE_RATE_PARTS;
+            div = accounts[i].balanceVBC * VRP_INCREASE_RATE / VRP_INCREASE_RATE_PARTS;
             actualTotalDividend += div;
         }
         
         if (ShouldLog(lsINFO, DividendMaster)) {
-            WriteLog(lsINFO, DividendMaster) << "{\"account\":\"" << RippleAddress::createAccountID(std::get<0>(it.first)).humanAccountID() << "\",\"data\":{\"divVBCByRank\":\"" << divVBCbyRank << "\",\"divVBCByPower\":\"" << divVBCbyPower << "\",\"divVBC\":\"" << divVBC << "\",\"balance\":\"" << std::get<0>(it.second) << "\",\"vrank\":\"" << std::get<1>(it.second) << "\",\"vsprd\":\"" << std::get<2>(it.second) << "\",\"tsprd\":\"" << std::get<3>(it.second) << "\"}}";
+            WriteLog(lsINFO, DividendMaster) << "{\"account\":\"" << RippleAddress::createAccountID(accounts[i].account).humanAccountID() << "\",\"data\":{\"divVBCByRank\":\"" << divVBCbyRank << "\",\"divVBCByPower\":\"" << divVBCbyPower << "\",\"divVBC\":\"" << divVBC << "\",\"balance\":\"" << accounts[i].balanceVBC << "\",\"vrank\":\"" << vRank[i] << "\",\"vsprd\":\"" << vSpd[i] << "\",\"tsprd\":\"" << tSpd[i] << "\"}}";
         }
         
-        if (div !=0 || divVBC !=0 || std::get<2>(it.second) > MIN_VSPD_TO_GET_FEE_SHARE)
+        if (div !=0 || divVBC !=0 || vSpd[i] > MIN_VSPD_TO_GET_FEE_SHARE)
         {
-            accountsOut.push_back(std::make_tuple(std::get<0>(it.first), div, divVBC, static_cast<uint64_t>(divVBCbyRank), static_cast<uint64_t>(divVBCbyPower), std::get<1>(it.second), std::get<2>(it.second), std::get<3>(it.second)));
+            accountsOut.push_back(std::make_tuple(accounts[i].account, div, divVBC, static_cast<uint64_t>(divVBCbyRank), static_cast<uint64_t>(divVBCbyPower), vRank[i], vSpd[i], tSpd[i]));
         }
     }
     
@@ -527,7 +696,6 @@ bool DividendMaster::calcDividendFunc(Ledger::ref baseLedger, uint64_t dividendC
     if (remainCoins > 0 || remainCoinsVBC > 0)
         accountsOut.push_back(std::make_tuple(Account("0x56CE5173B6A2CBEDF203BD69159212094C651041"), remainCoins, remainCoinsVBC, 0, 0, 0, 0, 0));
     
-    accountsByReference.clear();
     WriteLog(lsINFO, DividendMaster) << "calcDividend done with " << accountsOut.size() << " accounts Mem " << memUsed();
     
     return true;
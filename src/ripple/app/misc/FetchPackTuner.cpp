@@ -0,0 +1,99 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/app/misc/FetchPackTuner.h>
+#include <algorithm>
+
+namespace ripple {
+
+std::size_t const FetchPackTuner::minBudget;
+std::size_t const FetchPackTuner::maxBudget;
+std::size_t const FetchPackTuner::defaultBudget;
+
+FetchPackTuner::FetchPackTuner (clock_type& clock)
+    : m_clock (clock)
+{
+}
+
+std::size_t FetchPackTuner::getBudget (id_t peer)
+{
+    auto const now = m_clock.now ();
+    std::lock_guard <std::mutex> lock (m_mutex);
+
+    auto const it = m_peers.find (peer);
+
+    if ((it == m_peers.end ()) || (now - it->second.requested > idleTimeout ()))
+    {
+        m_peers[peer] = PeerState {now, defaultBudget, 0};
+        return defaultBudget;
+    }
+
+    PeerState& state = it->second;
+
+    if (state.sent != 0)
+    {
+        double const interval = std::max (1.0, static_cast <double> (
+            std::chrono::duration_cast <std::chrono::milliseconds> (
+                now - state.requested).count ()));
+
+        double const target = state.sent *
+            std::chrono::duration_cast <std::chrono::milliseconds> (
+                targetInterval ()).count () / interval;
+
+        double budget = state.budget;
+        if (target > budget)
+            budget = std::min (target, budget * 2);
+        else
+            budget = (budget + target) / 2;
+
+        state.budget = std::max (minBudget, std::min (maxBudget,
+            static_cast <std::size_t> (budget)));
+    }
+
+    state.requested = now;
+    state.sent = 0;
+    return state.budget;
+}
+
+void FetchPackTuner::sent (id_t peer, std::size_t bytes)
+{
+    std::lock_guard <std::mutex> lock (m_mutex);
+
+    auto const it = m_peers.find (peer);
+
+    if (it != m_peers.end ())
+        it->second.sent = bytes;
+}
+
+void FetchPackTuner::sweep ()
+{
+    auto const cutoff = m_clock.now () - idleTimeout ();
+    std::lock_guard <std::mutex> lock (m_mutex);
+
+    for (auto it = m_peers.begin (); it != m_peers.end ();)
+    {
+        if (it->second.requested < cutoff)
+            it = m_peers.erase (it);
+        else
+            ++it;
+    }
+}
+
+} // ripple
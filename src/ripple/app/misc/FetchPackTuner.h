@@ -0,0 +1,95 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_FETCHPACKTUNER_H_INCLUDED
+#define RIPPLE_FETCHPACKTUNER_H_INCLUDED
+
+#include <ripple/overlay/Peer.h>
+#include <beast/chrono/abstract_clock.h>
+#include <map>
+#include <mutex>
+
+namespace ripple {
+
+/** Sizes the fetch packs we send to each peer.
+
+    A peer that is catching up asks for the next pack soon after it has
+    received and stored the last one, so the bytes of the last pack over
+    the time until the next request measure what the peer can take. Each
+    peer's budget follows that rate times a target interval: it at most
+    doubles when the peer keeps up and moves halfway down when it does
+    not. Peers that have not asked for a while start over from the
+    default.
+
+    Thread safety:
+        Safe to call from any thread.
+*/
+class FetchPackTuner
+{
+public:
+    typedef beast::abstract_clock <std::chrono::steady_clock> clock_type;
+    typedef Peer::id_t id_t;
+
+    static std::size_t const minBudget = 256 * 1024;
+    static std::size_t const maxBudget = 16 * 1024 * 1024;
+    static std::size_t const defaultBudget = 1024 * 1024;
+
+    explicit FetchPackTuner (clock_type& clock);
+
+    /** A peer asked for a fetch pack.
+        @return The most bytes the pack should hold.
+    */
+    std::size_t getBudget (id_t peer);
+
+    /** We finished sending a pack of the given size to a peer. */
+    void sent (id_t peer, std::size_t bytes);
+
+    /** Forget peers that have not asked for a while. */
+    void sweep ();
+
+private:
+    typedef clock_type::time_point time_point;
+
+    struct PeerState
+    {
+        time_point requested;
+        std::size_t budget;
+        std::size_t sent;       // bytes in the last pack
+    };
+
+    // How long the data in one pack should take the peer to absorb
+    static std::chrono::seconds targetInterval ()
+    {
+        return std::chrono::seconds (2);
+    }
+
+    // A longer pause says nothing about the peer's bandwidth
+    static std::chrono::seconds idleTimeout ()
+    {
+        return std::chrono::seconds (30);
+    }
+
+    clock_type& m_clock;
+    std::mutex m_mutex;
+    std::map <id_t, PeerState> m_peers;
+};
+
+} // ripple
+
+#endif
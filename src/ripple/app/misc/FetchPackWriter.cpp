@@ -0,0 +1,94 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/app/misc/FetchPackWriter.h>
+#include <utility>
+
+namespace ripple {
+
+FetchPackWriter::FetchPackWriter (protocol::TMGetObjectByHash const& request,
+        std::size_t budget, std::size_t chunkBytes, clock_type& clock,
+            clock_type::duration timeLimit, Send send)
+    : m_pending (0)
+    , m_budget (budget)
+    , m_chunkLimit (chunkBytes)
+    , m_clock (clock)
+    , m_deadline (clock.now () + timeLimit)
+    , m_send (std::move (send))
+    , m_hasSeq (request.has_seq ())
+    , m_seq (request.seq ())
+    , m_ledgerHash (request.ledgerhash ())
+    , m_bytes (0)
+    , m_objects (0)
+    , m_chunks (0)
+{
+    start ();
+}
+
+void FetchPackWriter::start ()
+{
+    m_chunk.Clear ();
+    m_chunk.set_type (protocol::TMGetObjectByHash::otFETCH_PACK);
+    m_chunk.set_query (false);
+    m_chunk.set_ledgerhash (m_ledgerHash);
+
+    if (m_hasSeq)
+        m_chunk.set_seq (m_seq);
+
+    m_pending = 0;
+}
+
+bool FetchPackWriter::add (std::uint32_t seq, uint256 const& hash,
+    Blob const& data)
+{
+    if (full ())
+        return false;
+
+    protocol::TMIndexedObject& newObj = *m_chunk.add_objects ();
+    newObj.set_ledgerseq (seq);
+    newObj.set_hash (hash.begin (), 256 / 8);
+    newObj.set_data (data.data (), data.size ());
+
+    m_pending += data.size ();
+    m_bytes += data.size ();
+    ++m_objects;
+
+    if (m_pending >= m_chunkLimit)
+        flush ();
+
+    return !full ();
+}
+
+bool FetchPackWriter::full () const
+{
+    return (m_bytes >= m_budget) || (m_clock.now () >= m_deadline);
+}
+
+void FetchPackWriter::flush ()
+{
+    if (m_chunk.objects_size () == 0)
+        return;
+
+    m_send (m_chunk);
+    ++m_chunks;
+    start ();
+}
+
+} // ripple
@@ -0,0 +1,111 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_FETCHPACKWRITER_H_INCLUDED
+#define RIPPLE_FETCHPACKWRITER_H_INCLUDED
+
+#include <ripple/basics/base_uint.h>
+#include <ripple/basics/Blob.h>
+#include <beast/chrono/abstract_clock.h>
+#include <cstdint>
+#include <functional>
+#include "ripple.pb.h"
+
+namespace ripple {
+
+/** Builds a fetch pack reply as a stream of bounded messages.
+
+    Objects are added as the SHAMap delta walk produces them. Whenever the
+    message being built reaches the chunk size it is handed to the send
+    function and a new one is started, so only one chunk is ever held in
+    memory however large the pack grows.
+
+    The writer stops accepting objects once the byte budget is spent or
+    the time limit has passed, which is how the caller knows to end the
+    walk.
+*/
+class FetchPackWriter
+{
+public:
+    typedef beast::abstract_clock <std::chrono::steady_clock> clock_type;
+    typedef std::function <void (protocol::TMGetObjectByHash const&)> Send;
+
+    /** Create a writer answering a fetch pack request.
+        @param request The request, whose sequence and ledger hash are
+                       copied into every chunk.
+        @param budget The most object bytes to send in total.
+        @param chunkBytes The object bytes after which a chunk is sent.
+        @param timeLimit How long objects are accepted for.
+    */
+    FetchPackWriter (protocol::TMGetObjectByHash const& request,
+        std::size_t budget, std::size_t chunkBytes, clock_type& clock,
+            clock_type::duration timeLimit, Send send);
+
+    /** Add an object, sending the pending chunk if it is full.
+        @return false if no more objects should be added.
+    */
+    bool add (std::uint32_t seq, uint256 const& hash, Blob const& data);
+
+    /** True once the budget is spent or the time limit has passed. */
+    bool full () const;
+
+    /** Send whatever is pending. */
+    void flush ();
+
+    /** The object bytes added so far. */
+    std::size_t getBytes () const
+    {
+        return m_bytes;
+    }
+
+    std::size_t getObjects () const
+    {
+        return m_objects;
+    }
+
+    /** The number of messages sent so far. */
+    std::size_t getChunks () const
+    {
+        return m_chunks;
+    }
+
+private:
+    void start ();
+
+    protocol::TMGetObjectByHash m_chunk;
+    std::size_t m_pending;                  // object bytes in m_chunk
+
+    std::size_t const m_budget;
+    std::size_t const m_chunkLimit;
+    clock_type& m_clock;
+    clock_type::time_point const m_deadline;
+    Send m_send;
+
+    bool m_hasSeq;
+    std::uint32_t m_seq;
+    std::string m_ledgerHash;
+
+    std::size_t m_bytes;
+    std::size_t m_objects;
+    std::size_t m_chunks;
+};
+
+} // ripple
+
+#endif
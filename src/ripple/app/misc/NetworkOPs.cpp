@@ -23,6 +23,8 @@
 #include <ripple/app/data/DatabaseCon.h>
 #include <ripple/app/main/Application.h>
 #include <ripple/app/misc/FeeVote.h>
+#include <ripple/app/misc/FetchPackTuner.h>
+#include <ripple/app/misc/FetchPackWriter.h>
 #include <ripple/app/ledger/AcceptedLedger.h>
 #include <ripple/app/ledger/InboundLedger.h>
 #include <ripple/app/ledger/InboundLedgers.h>
@@ -56,10 +58,14 @@
 #include <ripple/resource/Fees.h>
 #include <ripple/resource/Gossip.h>
 #include <ripple/resource/Manager.h>
+#include <ripple/rpc/impl/WriteJson.h>
 #include <beast/module/core/thread/DeadlineTimer.h>
 #include <beast/module/core/system/SystemStats.h>
 #include <beast/cxx14/memory.h> // <memory>
 #include <boost/foreach.hpp>
+#include <deque>
+#include <limits>
+#include <mutex>
 #include <tuple>
 
 namespace ripple {
@@ -106,9 +112,12 @@ public:
         , mFetchPack ("FetchPack", 65536, 45, clock,
             deprecatedLogs().journal("TaggedCache"))
         , mFetchSeq (0)
+        , mFetchPackTuner (clock)
+        , mFetchPackPending (false)
         , mLastLoadBase (256)
         , mLastLoadFactor (256)
         , m_job_queue (job_queue)
+        , mPublishing (false)
         , m_standalone (standalone)
         , m_network_quorum (network_quorum)
     {
@@ -309,6 +318,11 @@ public:
         std::shared_ptr<protocol::TMGetObjectByHash> request,
         uint256 haveLedger, std::uint32_t uUptime);
 
+    void expectFetchPack (std::shared_ptr<Peer> const& peer);
+    bool wantFetchPack (std::shared_ptr<Peer> const& peer);
+    void applyFetchPack (Job&, std::weak_ptr<Peer> peer,
+        std::shared_ptr<protocol::TMGetObjectByHash> packet);
+
     bool shouldFetchPack (std::uint32_t seq);
     void gotFetchPack (bool progress, std::uint32_t seq);
     void addFetchPack (uint256 const& hash, std::shared_ptr< Blob >& data);
@@ -457,6 +471,11 @@ public:
     std::vector<RippleAddress> getLedgerAffectedAccounts (
         std::uint32_t ledgerSeq);
 
+    using NetworkOPs::AccountDividends;
+    AccountDividends getAccountDividends (
+        RippleAddress const& account, std::uint32_t maxDividendLedger,
+        int limit);
+
     DividendMaster::pointer getDividendMaster()
     {
         return m_dividendMaster;
@@ -530,8 +549,9 @@ private:
     Json::Value pubBootstrapAccountInfo (
         Ledger::ref lpAccepted, RippleAddress const& naAccountID);
 
-    void pubValidatedTransaction (
-        Ledger::ref alAccepted, const AcceptedLedgerTx& alTransaction);
+    void publishLedgers (Job&);
+    void publishLedger (AcceptedLedger const& alpAccepted);
+    void pubValidatedTransactions (AcceptedLedger const& alpAccepted);
     void pubAccountTransaction (
         Ledger::ref lpCurrent, const AcceptedLedgerTx& alTransaction,
         bool isAccepted);
@@ -540,6 +560,8 @@ private:
 
     std::string getHostId (bool forAdmin);
 
+    void checkFetchPack (Job&);
+
 private:
     clock_type& m_clock;
 
@@ -604,11 +626,32 @@ private:
     TaggedCache<uint256, Blob>  mFetchPack;
     std::uint32_t mFetchSeq;
 
+    // Sizes the fetch packs we send
+    FetchPackTuner mFetchPackTuner;
+
+    // A fetch pack we asked a peer for
+    struct FetchPackRequest
+    {
+        clock_type::time_point requested;
+        std::size_t bytes;      // accepted so far
+    };
+
+    std::mutex mFetchPackLock;
+    std::map <Peer::id_t, FetchPackRequest> mFetchPackPeers;
+
+    // An InboundLedgers::gotFetchPack job is queued
+    std::atomic <bool> mFetchPackPending;
+
     std::uint32_t mLastLoadBase;
     std::uint32_t mLastLoadFactor;
 
     JobQueue& m_job_queue;
 
+    // Accepted ledgers waiting to be sent to subscribers, oldest first
+    std::mutex mPubLock;
+    std::deque <AcceptedLedger::pointer> mPubQueue;
+    bool mPublishing;
+
     // Whether we are in standalone mode
     bool const m_standalone;
 
@@ -1787,7 +1830,7 @@ void NetworkOPsImp::pubServer ()
         jvObj [jss::load_factor]   =
                 (mLastLoadFactor = getApp().getFeeTrack ().getLoadFactor ());
 
-        std::string sObj = to_string (jvObj);
+        std::string sObj = RPC::jsonAsString (jvObj);
 
 
         for (auto i = mSubServer.begin (); i != mSubServer.end (); )
@@ -1939,8 +1982,8 @@ NetworkOPs::AccountTxs NetworkOPsImp::getAccountTxs (
         minLedger, maxLedger, descending, offset, limit, false, false, bAdmin);
 
     {
-        auto db = getApp().getTxnDB ().getDB ();
-        auto sl (getApp().getTxnDB ().lock ());
+        auto db = getApp().getTxnDB ().getReadDB ();
+        auto sl (getApp().getTxnDB ().lockRead ());
 
         SQL_FOREACH (db, sql)
         {
@@ -1996,8 +2039,8 @@ std::vector<NetworkOPsImp::txnMetaLedgerType> NetworkOPsImp::getAccountTxsB (
         bAdmin);
 
     {
-        auto db = getApp().getTxnDB ().getDB ();
-        auto sl (getApp().getTxnDB ().lock ());
+        auto db = getApp().getTxnDB ().getReadDB ();
+        auto sl (getApp().getTxnDB ().lockRead ());
 
         SQL_FOREACH (db, sql)
         {
@@ -2102,8 +2145,8 @@ NetworkOPsImp::AccountTxs NetworkOPsImp::getTxsAccount (
              % (forward ? "ASC" : "DESC")
              % queryLimit);
     {
-        auto db = getApp().getTxnDB ().getDB ();
-        auto sl (getApp().getTxnDB ().lock ());
+        auto db = getApp().getTxnDB ().getReadDB ();
+        auto sl (getApp().getTxnDB ().lockRead ());
 
         SQL_FOREACH (db, sql)
         {
@@ -2231,8 +2274,8 @@ NetworkOPsImp::MetaTxsList NetworkOPsImp::getTxsAccountB (
              % (forward ? "ASC" : "DESC")
              % queryLimit);
     {
-        auto db = getApp().getTxnDB ().getDB ();
-        auto sl (getApp().getTxnDB ().lock ());
+        auto db = getApp().getTxnDB ().getReadDB ();
+        auto sl (getApp().getTxnDB ().lockRead ());
 
         SQL_FOREACH (db, sql)
         {
@@ -2314,6 +2357,47 @@ NetworkOPsImp::getLedgerAffectedAccounts (std::uint32_t ledgerSeq)
     return accounts;
 }
 
+NetworkOPsImp::AccountDividends
+NetworkOPsImp::getAccountDividends (RippleAddress const& account,
+    std::uint32_t maxDividendLedger, int limit)
+{
+    AccountDividends ret;
+
+    std::string sql = boost::str (boost::format (
+        "SELECT DividendLedger,LedgerSeq,TransID,DividendCoins,"
+        "DividendCoinsVBC,DividendCoinsVBCRank,DividendCoinsVBCSprd,"
+        "DividendTSprd,DividendVRank,DividendVSprd "
+        "FROM AccountDividends WHERE Account = '%s' "
+        "%s"
+        "ORDER BY DividendLedger DESC LIMIT %u;")
+            % account.humanAccountID ()
+            % (maxDividendLedger == 0 ? std::string () : boost::str (
+                boost::format ("AND DividendLedger <= %u ") % maxDividendLedger))
+            % std::max (limit, 1));
+    {
+        auto db = getApp().getTxnDB ().getReadDB ();
+        auto sl (getApp().getTxnDB ().lockRead ());
+
+        SQL_FOREACH (db, sql)
+        {
+            AccountDividend dividend;
+            dividend.dividendLedger = db->getBigInt ("DividendLedger");
+            dividend.ledgerSeq = db->getBigInt ("LedgerSeq");
+            dividend.transID.SetHexExact (db->getStrBinary ("TransID"));
+            dividend.coins = db->getBigInt ("DividendCoins");
+            dividend.coinsVBC = db->getBigInt ("DividendCoinsVBC");
+            dividend.coinsVBCRank = db->getBigInt ("DividendCoinsVBCRank");
+            dividend.coinsVBCSprd = db->getBigInt ("DividendCoinsVBCSprd");
+            dividend.tSprd = db->getBigInt ("DividendTSprd");
+            dividend.vRank = db->getBigInt ("DividendVRank");
+            dividend.vSprd = db->getBigInt ("DividendVSprd");
+            ret.push_back (dividend);
+        }
+    }
+
+    return ret;
+}
+
 bool NetworkOPsImp::recvValidation (
     STValidation::ref val, std::string const& source)
 {
@@ -2538,6 +2622,7 @@ void NetworkOPsImp::pubProposedTransaction (
     Ledger::ref lpCurrent, STTx::ref stTxn, TER terResult)
 {
     Json::Value jvObj   = transJson (*stTxn, terResult, false, lpCurrent);
+    std::string const sObj = RPC::jsonAsString (jvObj);
 
     {
         ScopedLockType sl (mLock);
@@ -2549,7 +2634,7 @@ void NetworkOPsImp::pubProposedTransaction (
 
             if (p)
             {
-                p->send (jvObj, true);
+                p->send (jvObj, sObj, true);
                 ++it;
             }
             else
@@ -2570,7 +2655,54 @@ void NetworkOPsImp::pubLedger (Ledger::ref accepted)
     // Holes are filled across connection loss or other catastrophe
 
     auto alpAccepted = AcceptedLedger::makeAcceptedLedger (accepted);
-    Ledger::ref lpAccepted = alpAccepted->getLedger ();
+
+    m_dividendMaster->applyLedger (alpAccepted);
+    getApp().getOrderBookDB ().applyLedger (alpAccepted);
+
+    // Subscribers are sent the ledger by a job, in the order ledgers are
+    // published, so that slow clients do not hold up the LedgerMaster.
+    {
+        std::lock_guard <std::mutex> sl (mPubLock);
+
+        mPubQueue.push_back (alpAccepted);
+
+        if (mPublishing)
+            return;
+
+        mPublishing = true;
+    }
+
+    m_job_queue.addJob (jtPUBLEDGER, "pubLedger->publish",
+        std::bind (&NetworkOPsImp::publishLedgers, this,
+            std::placeholders::_1));
+}
+
+void NetworkOPsImp::publishLedgers (Job&)
+{
+    for (;;)
+    {
+        AcceptedLedger::pointer alpAccepted;
+
+        {
+            std::lock_guard <std::mutex> sl (mPubLock);
+
+            if (mPubQueue.empty ())
+            {
+                mPublishing = false;
+                return;
+            }
+
+            alpAccepted = mPubQueue.front ();
+            mPubQueue.pop_front ();
+        }
+
+        publishLedger (*alpAccepted);
+    }
+}
+
+void NetworkOPsImp::publishLedger (AcceptedLedger const& alpAccepted)
+{
+    Ledger::ref lpAccepted = alpAccepted.getLedger ();
 
     {
         ScopedLockType sl (mLock);
@@ -2591,7 +2723,7 @@ void NetworkOPsImp::pubLedger (Ledger::ref accepted)
             jvObj[jss::reserve_base] = Json::UInt (lpAccepted->getReserve (0));
             jvObj[jss::reserve_inc] = Json::UInt (lpAccepted->getReserveInc ());
 
-            jvObj[jss::txn_count] = Json::UInt (alpAccepted->getTxnCount ());
+            jvObj[jss::txn_count] = Json::UInt (alpAccepted.getTxnCount ());
 
             if (mMode >= omSYNCING)
             {
@@ -2599,13 +2731,15 @@ void NetworkOPsImp::pubLedger (Ledger::ref accepted)
                         = getApp().getLedgerMaster ().getCompleteLedgers ();
             }
 
+            std::string const sObj = RPC::jsonAsString (jvObj);
+
             auto it = mSubLedger.begin ();
             while (it != mSubLedger.end ())
             {
                 InfoSub::pointer p = it->second.lock ();
                 if (p)
                 {
-                    p->send (jvObj, true);
+                    p->send (jvObj, sObj, true);
                     ++it;
                 }
                 else
@@ -2613,16 +2747,8 @@ void NetworkOPsImp::pubLedger (Ledger::ref accepted)
             }
         }
     }
-    
-    m_journal.info << "start pubAccepted: " << alpAccepted->getMap ().size ();
-    // Don't lock since pubAcceptedTransaction is locking.
-    BOOST_FOREACH (const AcceptedLedger::value_type & vt, alpAccepted->getMap ())
-    {
-        if (m_journal.trace.active())
-            m_journal.trace << "pubAccepted: " << vt.second->getJson ();
-        pubValidatedTransaction (lpAccepted, *vt.second);
-    }
-    m_journal.info << "finish pubAccepted: " << alpAccepted->getMap ().size ();
+
+    pubValidatedTransactions (alpAccepted);
 }
 
 void NetworkOPsImp::reportFeeChange ()
@@ -2690,60 +2816,118 @@ Json::Value NetworkOPs_transJson(
     return jvObj;
 }
 
-void NetworkOPsImp::pubValidatedTransaction (
-    Ledger::ref alAccepted, const AcceptedLedgerTx& alTx)
+// Every subscriber to a transaction stream, or to an account a transaction
+// affects, gets one batch with all of its messages for the ledger. Each
+// transaction is rendered at most once, however many subscribers it has.
+void NetworkOPsImp::pubValidatedTransactions (AcceptedLedger const& alpAccepted)
 {
-    Json::Value jvObj;
+    Ledger::ref lpAccepted = alpAccepted.getLedger ();
+
+    std::vector <AcceptedLedgerTx::pointer> txns;
+    txns.reserve (alpAccepted.getTxnCount ());
+    for (auto const& vt : alpAccepted.getMap ())
+        txns.push_back (vt.second);
+
+    // Subscribers to every transaction. Listed twice if on both streams.
+    std::vector <InfoSub::pointer> streamSubs;
 
-    std::string sObj;
-    bool bSobjInitialized = false;
+    // Account subscribers by transaction index, in transaction order
+    std::vector <std::pair <std::size_t, InfoSub::pointer>> accountSubs;
 
     {
         ScopedLockType sl (mLock);
 
-        auto it = mSubTransactions.begin ();
-        while (it != mSubTransactions.end ())
+        for (auto subMap : {&mSubTransactions, &mSubRTTransactions})
         {
-            InfoSub::pointer p = it->second.lock ();
-
-            if (p)
+            auto it = subMap->begin ();
+            while (it != subMap->end ())
             {
-                if (!bSobjInitialized) {
-                    jvObj = transJson (*alTx.getTxn (), alTx.getResult (), true, alAccepted);
-                    jvObj[jss::meta] = alTx.getMeta ()->getJson (0);
-                    sObj = to_string (jvObj);
-                    bSobjInitialized = true;
+                InfoSub::pointer p = it->second.lock ();
+
+                if (p)
+                {
+                    streamSubs.push_back (p);
+                    ++it;
                 }
-                p->send (jvObj, sObj, true);
-                ++it;
+                else
+                    it = subMap->erase (it);
             }
-            else
-                it = mSubTransactions.erase (it);
         }
 
-        it = mSubRTTransactions.begin ();
-
-        while (it != mSubRTTransactions.end ())
+        if (!mSubAccount.empty () || !mSubRTAccount.empty ())
         {
-            InfoSub::pointer p = it->second.lock ();
+            hash_set<InfoSub::pointer> notify;
 
-            if (p)
+            for (std::size_t i = 0; i < txns.size (); ++i)
             {
-                if (!bSobjInitialized) {
-                    jvObj = transJson (*alTx.getTxn (), alTx.getResult (), true, alAccepted);
-                    jvObj[jss::meta] = alTx.getMeta ()->getJson (0);
-                    sObj = to_string (jvObj);
-                    bSobjInitialized = true;
+                for (auto const& affectedAccount: txns[i]->getAffected ())
+                {
+                    for (auto subMap : {&mSubRTAccount, &mSubAccount})
+                    {
+                        auto simiIt = subMap->find (
+                            affectedAccount.getAccountID ());
+
+                        if (simiIt == subMap->end ())
+                            continue;
+
+                        auto it = simiIt->second.begin ();
+                        while (it != simiIt->second.end ())
+                        {
+                            InfoSub::pointer p = it->second.lock ();
+
+                            if (p)
+                            {
+                                if (notify.insert (p).second)
+                                    accountSubs.emplace_back (i, p);
+                                ++it;
+                            }
+                            else
+                                it = simiIt->second.erase (it);
+                        }
+                    }
                 }
-                p->send (jvObj, sObj, true);
-                ++it;
+
+                notify.clear ();
             }
-            else
-                it = mSubRTTransactions.erase (it);
         }
     }
-    getApp().getOrderBookDB ().processTxn (alAccepted, alTx);
-    pubAccountTransaction (alAccepted, alTx, true);
+
+    hash_map <InfoSub::pointer, InfoSub::Publications> batches;
+    auto accountIt = accountSubs.begin ();
+
+    for (std::size_t i = 0; i < txns.size (); ++i)
+    {
+        if (streamSubs.empty () &&
+            (accountIt == accountSubs.end () || accountIt->first != i))
+            continue;
+
+        AcceptedLedgerTx const& alTx = *txns[i];
+
+        auto message = std::make_shared <InfoSub::Publication> ();
+        message->json = transJson (
+            *alTx.getTxn (), alTx.getResult (), true, lpAccepted);
+
+        if (alTx.isApplied ())
+            message->json[jss::meta] = alTx.getMeta ()->getJson (0);
+
+        message->text = RPC::jsonAsString (message->json);
+
+        for (auto const& p : streamSubs)
+            batches[p].push_back (message);
+
+        for (; accountIt != accountSubs.end () && accountIt->first == i;
+                ++accountIt)
+            batches[accountIt->second].push_back (message);
+    }
+
+    for (auto const& txn : txns)
+        getApp().getOrderBookDB ().processTxn (lpAccepted, *txn);
+
+    m_journal.debug << "pubValidatedTransactions: " << txns.size () <<
+        " transactions to " << batches.size () << " subscribers";
+
+    for (auto const& batch : batches)
+        batch.first->send (batch.second, true);
 }
 
 void NetworkOPsImp::pubAccountTransaction (
@@ -2820,7 +3004,7 @@ void NetworkOPsImp::pubAccountTransaction (
         if (alTx.isApplied ())
             jvObj[jss::meta] = alTx.getMeta ()->getJson (0);
 
-        std::string sObj = to_string (jvObj);
+        std::string sObj = RPC::jsonAsString (jvObj);
 
         BOOST_FOREACH (InfoSub::ref isrListener, notify)
         {
@@ -3438,15 +3622,8 @@ void NetworkOPsImp::getBookPage (
 
 #endif
 
-static void fpAppender (
-    protocol::TMGetObjectByHash* reply, std::uint32_t ledgerSeq,
-    uint256 const& hash, const Blob& blob)
-{
-    protocol::TMIndexedObject& newObj = * (reply->add_objects ());
-    newObj.set_ledgerseq (ledgerSeq);
-    newObj.set_hash (hash.begin (), 256 / 8);
-    newObj.set_data (&blob[0], blob.size ());
-}
+// Fetch packs are sent in messages of about this many bytes
+static std::size_t const fetchPackChunkBytes = 64 * 1024;
 
 void NetworkOPsImp::makeFetchPack (
     Job&, std::weak_ptr<Peer> wPeer,
@@ -3459,8 +3636,7 @@ void NetworkOPsImp::makeFetchPack (
         return;
     }
 
-    if (getApp().getFeeTrack ().isLoadedLocal () ||
-        (m_ledgerMaster.getValidatedLedgerAge() > 40))
+    if (m_ledgerMaster.getValidatedLedgerAge() > 40)
     {
         m_journal.info << "Too busy to make fetch pack";
         return;
@@ -3509,63 +3685,68 @@ void NetworkOPsImp::makeFetchPack (
         return;
     }
 
-    try
-    {
-        protocol::TMGetObjectByHash reply;
-        reply.set_query (false);
+    // Peers that fall behind keep getting small packs while we are loaded
+    std::size_t budget = mFetchPackTuner.getBudget (peer->id ());
 
-        if (request->has_seq ())
-            reply.set_seq (request->seq ());
+    if (getApp().getFeeTrack ().isLoadedLocal ())
+        budget = FetchPackTuner::minBudget;
 
-        reply.set_ledgerhash (request->ledgerhash ());
-        reply.set_type (protocol::TMGetObjectByHash::otFETCH_PACK);
+    try
+    {
+        FetchPackWriter pack (*request, budget, fetchPackChunkBytes, m_clock,
+            std::chrono::milliseconds (500),
+            [&peer] (protocol::TMGetObjectByHash const& chunk)
+            {
+                peer->send (std::make_shared<Message> (
+                    chunk, protocol::mtGET_OBJECTS));
+            });
 
         // Building a fetch pack:
         //  1. Add the header for the requested ledger.
-        //  2. Add the nodes for the AccountStateMap of that ledger.
+        //  2. Add the nodes for the AccountStateMap of that ledger that
+        //     differ from the ledger the peer has.
         //  3. If there are transactions, add the nodes for the
         //     transactions of the ledger.
-        //  4. If the FetchPack now contains greater than or equal to
-        //     256 entries then stop.
-        //  5. If not very much time has elapsed, then loop back and repeat
+        //  4. If the budget or time allows, then loop back and repeat
         //     the same process adding the previous ledger to the FetchPack.
+        // Nodes go out in chunks as the maps are walked.
         do
         {
-            std::uint32_t lSeq = wantLedger->getLedgerSeq ();
+            std::uint32_t const lSeq = wantLedger->getLedgerSeq ();
+
+            auto const append = [&pack, lSeq] (
+                uint256 const& hash, Blob const& data)
+            {
+                return pack.add (lSeq, hash, data);
+            };
 
-            protocol::TMIndexedObject& newObj = *reply.add_objects ();
-            newObj.set_hash (wantLedger->getHash ().begin (), 256 / 8);
             Serializer s (256);
             s.add32 (HashPrefix::ledgerMaster);
             wantLedger->addRaw (s);
-            newObj.set_data (s.getDataPtr (), s.getLength ());
-            newObj.set_ledgerseq (lSeq);
 
-            wantLedger->peekAccountStateMap ()->getFetchPack
-                (haveLedger->peekAccountStateMap ().get (), true, 1024,
-                    std::bind (fpAppender, &reply, lSeq, std::placeholders::_1,
-                               std::placeholders::_2));
+            if (!append (wantLedger->getHash (), s.peekData ()))
+                break;
+
+            wantLedger->peekAccountStateMap ()->getFetchPack (
+                haveLedger->peekAccountStateMap ().get (), true,
+                    std::numeric_limits<int>::max (), append);
 
-            if (wantLedger->getTransHash ().isNonZero ())
+            if (wantLedger->getTransHash ().isNonZero () && !pack.full ())
                 wantLedger->peekTransactionMap ()->getFetchPack (
-                    nullptr, true, 256,
-                    std::bind (fpAppender, &reply, lSeq, std::placeholders::_1,
-                               std::placeholders::_2));
-
-            if (reply.objects ().size () >= 256)
-                break;
+                    nullptr, true, std::numeric_limits<int>::max (), append);
 
             // move may save a ref/unref
             haveLedger = std::move (wantLedger);
             wantLedger = getLedgerByHash (haveLedger->getParentHash ());
         }
-        while (wantLedger &&
-               UptimeTimer::getInstance ().getElapsedSeconds () <= uUptime + 1);
+        while (wantLedger && !pack.full ());
+
+        pack.flush ();
+        mFetchPackTuner.sent (peer->id (), pack.getBytes ());
 
         m_journal.info
-            << "Built fetch pack with " << reply.objects ().size () << " nodes";
-        auto msg = std::make_shared<Message> (reply, protocol::mtGET_OBJECTS);
-        peer->send (msg);
+            << "Built fetch pack with " << pack.getObjects () << " nodes in "
+            << pack.getChunks () << " messages";
     }
     catch (...)
     {
@@ -3573,9 +3754,130 @@ void NetworkOPsImp::makeFetchPack (
     }
 }
 
+void NetworkOPsImp::expectFetchPack (std::shared_ptr<Peer> const& peer)
+{
+    std::lock_guard <std::mutex> lock (mFetchPackLock);
+    mFetchPackPeers[peer->id ()] = FetchPackRequest {m_clock.now (), 0};
+}
+
+bool NetworkOPsImp::wantFetchPack (std::shared_ptr<Peer> const& peer)
+{
+    std::lock_guard <std::mutex> lock (mFetchPackLock);
+    auto const it = mFetchPackPeers.find (peer->id ());
+
+    // A pack arrives in several messages over some time
+    return (it != mFetchPackPeers.end ()) &&
+        (m_clock.now () - it->second.requested <= std::chrono::seconds (60));
+}
+
+void NetworkOPsImp::applyFetchPack (Job&, std::weak_ptr<Peer> wPeer,
+    std::shared_ptr<protocol::TMGetObjectByHash> packet)
+{
+    Peer::ptr peer = wPeer.lock ();
+
+    if (!peer)
+        return;
+
+    std::size_t bytes = 0;
+    for (int i = 0; i < packet->objects_size (); ++i)
+        bytes += packet->objects (i).data ().size ();
+
+    // A pack is never larger than the most a sender budgets for one. Take
+    // this message's share of what is left before looking at the objects.
+    std::size_t allowed;
+    {
+        std::lock_guard <std::mutex> lock (mFetchPackLock);
+        auto const it = mFetchPackPeers.find (peer->id ());
+
+        if (it == mFetchPackPeers.end ())
+            return;
+
+        allowed = std::min (bytes,
+            FetchPackTuner::maxBudget - it->second.bytes);
+        it->second.bytes += allowed;
+
+        if (it->second.bytes >= FetchPackTuner::maxBudget)
+            mFetchPackPeers.erase (it);
+    }
+
+    std::uint32_t seq = 0;
+    bool want = false;
+    bool progress = false;
+    int cached = 0;
+    int bad = 0;
+    std::size_t used = 0;
+
+    for (int i = 0; i < packet->objects_size (); ++i)
+    {
+        protocol::TMIndexedObject const& obj = packet->objects (i);
+
+        if ((used += obj.data ().size ()) > allowed)
+        {
+            m_journal.info << "Fetch pack is over budget";
+            break;
+        }
+
+        if (!obj.has_hash () || (obj.hash ().size () != (256 / 8)))
+        {
+            ++bad;
+            continue;
+        }
+
+        if (obj.has_ledgerseq () && (obj.ledgerseq () != seq))
+        {
+            seq = obj.ledgerseq ();
+            want = !haveLedger (seq);
+
+            if (want)
+                progress = true;
+        }
+
+        // Late data for a ledger we already have
+        if (!want)
+            continue;
+
+        uint256 const hash = uint256::fromVoid (obj.hash ().data ());
+        auto data = std::make_shared <Blob> (
+            obj.data ().begin (), obj.data ().end ());
+
+        if (Serializer::getSHA512Half (*data) != hash)
+        {
+            ++bad;
+            continue;
+        }
+
+        // Held until an inbound ledger claims it, so only nodes of the
+        // ledgers we are acquiring reach the node store
+        addFetchPack (hash, data);
+        ++cached;
+    }
+
+    if (bad != 0)
+    {
+        m_journal.warning << "Fetch pack has " << bad << " bad objects";
+        peer->charge (Resource::feeBadData);
+    }
+
+    m_journal.debug << "Cached " << cached << " fetch pack objects for " << seq;
+
+    gotFetchPack (progress, seq);
+}
+
 void NetworkOPsImp::sweepFetchPack ()
 {
     mFetchPack.sweep ();
+    mFetchPackTuner.sweep ();
+
+    auto const cutoff = m_clock.now () - std::chrono::seconds (60);
+    std::lock_guard <std::mutex> lock (mFetchPackLock);
+
+    for (auto it = mFetchPackPeers.begin (); it != mFetchPackPeers.end ();)
+    {
+        if (it->second.requested < cutoff)
+            it = mFetchPackPeers.erase (it);
+        else
+            ++it;
+    }
 }
 
 void NetworkOPsImp::addFetchPack (
@@ -3617,15 +3919,22 @@ int NetworkOPsImp::getFetchSize ()
 
 void NetworkOPsImp::gotFetchPack (bool progress, std::uint32_t seq)
 {
-
-    // FIXME: Calling this function more than once will result in
-    // InboundLedgers::gotFetchPack being called more than once
-    // which is expensive. A flag should track whether we've already dispatched
+    // A fetch pack arrives in many messages; one pass over the inbound
+    // ledgers after the latest of them is enough.
+    if (mFetchPackPending.exchange (true))
+        return;
 
     m_job_queue.addJob (
         jtLEDGER_DATA, "gotFetchPack",
-        std::bind (&InboundLedgers::gotFetchPack,
-                   &getApp().getInboundLedgers (), std::placeholders::_1));
+        std::bind (&NetworkOPsImp::checkFetchPack, this,
+                   std::placeholders::_1));
+}
+
+void NetworkOPsImp::checkFetchPack (Job& job)
+{
+    // Data arriving from now on needs another pass
+    mFetchPackPending = false;
+    getApp().getInboundLedgers ().gotFetchPack (job);
 }
 
 void NetworkOPsImp::missingNodeInLedger (std::uint32_t seq)
@@ -234,6 +234,18 @@ public:
         std::shared_ptr<protocol::TMGetObjectByHash> request,
         uint256 wantLedger, std::uint32_t uUptime) = 0;
 
+    /** We asked a peer for a fetch pack. */
+    virtual void expectFetchPack (std::shared_ptr<Peer> const& peer) = 0;
+
+    /** True if we recently asked this peer for a fetch pack. */
+    virtual bool wantFetchPack (std::shared_ptr<Peer> const& peer) = 0;
+
+    /** Cache one chunk of a fetch pack we asked for until the inbound
+        ledgers claim its objects.
+    */
+    virtual void applyFetchPack (Job&, std::weak_ptr<Peer> peer,
+        std::shared_ptr<protocol::TMGetObjectByHash> packet) = 0;
+
     virtual bool shouldFetchPack (std::uint32_t seq) = 0;
     virtual void gotFetchPack (bool progress, std::uint32_t seq) = 0;
     virtual void addFetchPack (
@@ -323,6 +335,32 @@ public:
     virtual std::vector<RippleAddress> getLedgerAffectedAccounts (
         std::uint32_t ledgerSeq) = 0;
 
+    // One account's share of a dividend, as recorded when the ledger that
+    // applied it was saved.
+    struct AccountDividend
+    {
+        std::uint32_t dividendLedger;   // the dividend's base ledger
+        std::uint32_t ledgerSeq;        // the ledger that applied it
+        uint256 transID;
+        std::uint64_t coins;
+        std::uint64_t coinsVBC;
+        std::uint64_t coinsVBCRank;
+        std::uint64_t coinsVBCSprd;
+        std::uint64_t tSprd;
+        std::uint64_t vRank;
+        std::uint64_t vSprd;
+    };
+
+    typedef std::vector<AccountDividend> AccountDividends;
+
+    /** Fetch an account's dividends, newest first.
+        @param maxDividendLedger Only dividends based on this ledger or an
+                                 earlier one are returned. Zero for all.
+    */
+    virtual AccountDividends getAccountDividends (
+        RippleAddress const& account, std::uint32_t maxDividendLedger,
+            int limit) = 0;
+
     //--------------------------------------------------------------------------
     //
     // Monitoring: publisher side
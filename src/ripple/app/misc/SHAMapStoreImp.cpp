@@ -624,6 +624,12 @@ SHAMapStoreImp::clearPrior (LedgerIndex lastRotated)
         "DELETE FROM AccountTransactions WHERE LedgerSeq < %u;");
     if (health())
         return;
+
+    clearSql (*transactionDb_, lastRotated,
+        "SELECT MIN(LedgerSeq) FROM AccountDividends;",
+        "DELETE FROM AccountDividends WHERE LedgerSeq < %u;");
+    if (health())
+        return;
 }
 
 SHAMapStoreImp::Health
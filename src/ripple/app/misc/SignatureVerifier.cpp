@@ -0,0 +1,272 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/app/misc/SignatureVerifier.h>
+#include <beast/threads/Thread.h>
+#include <beast/cxx14/memory.h> // <memory>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ripple {
+
+class SignatureVerifierImp
+    : public SignatureVerifier
+    , public beast::LeakChecked <SignatureVerifierImp>
+{
+public:
+    // Checks beyond this many are refused rather than queued
+    static std::size_t const maxQueued = 16384;
+
+    // The most checks a thread takes off the queue at once
+    static std::size_t const maxBatch = 64;
+
+    struct Item
+    {
+        uint256 id;
+        Check check;
+        Handler handler;
+    };
+
+    IHashRouter& m_router;
+    beast::Journal m_journal;
+    beast::insight::Gauge m_queued;
+    beast::insight::Meter m_checks;
+    beast::insight::Meter m_known;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;   // a check was queued, or stopping
+    std::deque <Item> m_queue;
+    std::vector <std::thread> m_threads;
+    std::size_t const m_threadCount;
+    std::size_t m_running;              // threads that have not exited
+    bool m_stopping;
+
+    //--------------------------------------------------------------------------
+
+    SignatureVerifierImp (Stoppable& parent, IHashRouter& router, int threads,
+        beast::insight::Collector::ptr const& collector,
+            beast::Journal journal)
+        : SignatureVerifier (parent)
+        , m_router (router)
+        , m_journal (journal)
+        , m_queued (collector->make_gauge ("sigverify", "queue"))
+        , m_checks (collector->make_meter ("sigverify", "checks"))
+        , m_known (collector->make_meter ("sigverify", "known"))
+        , m_threadCount (threads > 0 ? threads : defaultThreads ())
+        , m_running (0)
+        , m_stopping (false)
+    {
+    }
+
+    ~SignatureVerifierImp ()
+    {
+        for (auto& thread : m_threads)
+            thread.join ();
+    }
+
+    // Leave most of the processors to the job queue
+    static std::size_t defaultThreads ()
+    {
+        return std::max (1u, std::min (8u,
+            std::thread::hardware_concurrency () / 2));
+    }
+
+    //--------------------------------------------------------------------------
+    //
+    // Stoppable
+    //
+    //--------------------------------------------------------------------------
+
+    void onStart ()
+    {
+        std::lock_guard <std::mutex> lock (m_mutex);
+
+        m_threads.reserve (m_threadCount);
+        for (std::size_t i = 0; i < m_threadCount; ++i)
+            m_threads.emplace_back (&SignatureVerifierImp::run, this);
+        m_running = m_threadCount;
+
+        m_journal.info << "Checking signatures on " <<
+            m_threadCount << " threads";
+    }
+
+    void onStop ()
+    {
+        bool running;
+        {
+            std::lock_guard <std::mutex> lock (m_mutex);
+            m_stopping = true;
+            running = m_running != 0;
+            m_wakeup.notify_all ();
+        }
+
+        // Otherwise the last thread to exit reports that we stopped
+        if (! running)
+            stopped ();
+    }
+
+    //--------------------------------------------------------------------------
+    //
+    // SignatureVerifier
+    //
+    //--------------------------------------------------------------------------
+
+    bool verify (uint256 const& id, Check check, Handler handler) override
+    {
+        Item item {id, std::move (check), std::move (handler)};
+
+        {
+            std::lock_guard <std::mutex> lock (m_mutex);
+
+            if (m_running != 0 && ! m_stopping)
+            {
+                if (m_queue.size () >= maxQueued)
+                    return false;
+
+                m_queue.push_back (std::move (item));
+                m_queued.set (m_queue.size ());
+                m_wakeup.notify_one ();
+                return true;
+            }
+        }
+
+        process (item);
+        return true;
+    }
+
+    std::size_t getQueueSize () override
+    {
+        std::lock_guard <std::mutex> lock (m_mutex);
+        return m_queue.size ();
+    }
+
+    //--------------------------------------------------------------------------
+
+    void process (Item& item)
+    {
+        bool good;
+        int const flags = m_router.getFlags (item.id);
+
+        if (flags & (SF_BAD | SF_SIGGOOD))
+        {
+            // Another copy of this message was judged while we waited
+            good = (flags & SF_BAD) == 0;
+            ++m_known;
+        }
+        else
+        {
+            try
+            {
+                good = item.check ();
+            }
+            catch (...)
+            {
+                good = false;
+            }
+
+            m_router.setFlag (item.id, good ? SF_SIGGOOD : SF_BAD);
+            ++m_checks;
+        }
+
+        item.handler (good);
+    }
+
+    void run ()
+    {
+        beast::Thread::setCurrentThreadName ("SigVerify");
+
+        std::vector <Item> batch;
+        batch.reserve (maxBatch);
+
+        std::unique_lock <std::mutex> lock (m_mutex);
+
+        for (;;)
+        {
+            m_wakeup.wait (lock, [this]
+            {
+                return m_stopping || ! m_queue.empty ();
+            });
+
+            if (m_stopping)
+                break;
+
+            // Share a backlog between the threads instead of letting the
+            // first one to wake take all of it.
+            std::size_t const count = std::min (maxBatch,
+                (m_queue.size () + m_threadCount - 1) / m_threadCount);
+
+            batch.assign (std::make_move_iterator (m_queue.begin ()),
+                std::make_move_iterator (m_queue.begin () + count));
+            m_queue.erase (m_queue.begin (), m_queue.begin () + count);
+            m_queued.set (m_queue.size ());
+
+            if (! m_queue.empty ())
+                m_wakeup.notify_one ();
+
+            lock.unlock ();
+
+            for (auto& item : batch)
+                process (item);
+            batch.clear ();
+
+            lock.lock ();
+        }
+
+        // Messages still waiting are dropped, as they would be if the
+        // job queue were stopping.
+        if (--m_running == 0)
+        {
+            m_queue.clear ();
+            m_queued.set (0);
+            lock.unlock ();
+            stopped ();
+        }
+    }
+};
+
+std::size_t const SignatureVerifierImp::maxQueued;
+std::size_t const SignatureVerifierImp::maxBatch;
+
+//------------------------------------------------------------------------------
+
+SignatureVerifier::SignatureVerifier (Stoppable& parent)
+    : Stoppable ("SignatureVerifier", parent)
+{
+}
+
+SignatureVerifier::~SignatureVerifier ()
+{
+}
+
+std::unique_ptr <SignatureVerifier>
+make_SignatureVerifier (beast::Stoppable& parent, IHashRouter& router,
+    int threads, beast::insight::Collector::ptr const& collector,
+        beast::Journal journal)
+{
+    return std::make_unique <SignatureVerifierImp> (parent, router, threads,
+        collector, journal);
+}
+
+} // ripple
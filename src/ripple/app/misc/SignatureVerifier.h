@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_SIGNATUREVERIFIER_H_INCLUDED
+#define RIPPLE_SIGNATUREVERIFIER_H_INCLUDED
+
+#include <ripple/app/misc/IHashRouter.h>
+#include <ripple/basics/base_uint.h>
+#include <beast/insight/Collector.h>
+#include <beast/threads/Stoppable.h>
+#include <beast/utility/Journal.h>
+#include <functional>
+#include <memory>
+
+namespace ripple {
+
+/** Checks the signatures of messages received from peers.
+
+    Transactions, proposals and validations are queued here before they
+    reach the job queue. A fixed set of threads takes them off the queue
+    in batches and runs their checks, so signature checking does not
+    occupy job queue threads and cannot starve the jobs that use the
+    verdicts.
+
+    Each verdict is recorded in the HashRouter as SF_SIGGOOD or SF_BAD
+    under the message's hash. A message whose hash already carries a
+    verdict is answered from the HashRouter without being checked again.
+*/
+class SignatureVerifier
+    : public beast::Stoppable
+{
+protected:
+    explicit SignatureVerifier (Stoppable& parent);
+
+public:
+    /** Returns `true` if the signature is good. May throw. */
+    typedef std::function <bool ()> Check;
+
+    /** Called with the verdict. */
+    typedef std::function <void (bool)> Handler;
+
+    /** Destroy the object. */
+    virtual ~SignatureVerifier () = 0;
+
+    /** Queue a signature check.
+        The handler is called with the verdict on a verifier thread, or
+        before returning if the verdict is already known or the verifier
+        is not running. A check that throws is treated as a bad signature.
+
+        Thread safety:
+            Safe to call from any thread at any time.
+
+        @param id The hash the verdict is recorded under.
+        @return `false` if the queue is full and the check was dropped.
+                The handler is not called in that case.
+    */
+    virtual bool verify (uint256 const& id, Check check,
+        Handler handler) = 0;
+
+    /** The number of checks waiting to be run. */
+    virtual std::size_t getQueueSize () = 0;
+};
+
+/** Create a SignatureVerifier.
+    @param threads The number of verifier threads, or zero to pick one
+                   from the number of processors.
+*/
+std::unique_ptr <SignatureVerifier> make_SignatureVerifier (
+    beast::Stoppable& parent, IHashRouter& router, int threads,
+        beast::insight::Collector::ptr const& collector,
+            beast::Journal journal);
+
+} // ripple
+
+#endif
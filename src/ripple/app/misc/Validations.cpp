@@ -20,50 +20,94 @@
 #include <BeastConfig.h>
 #include <ripple/app/misc/Validations.h>
 #include <ripple/app/data/DatabaseCon.h>
+#include <ripple/app/data/SqliteDatabase.h>
 #include <ripple/app/ledger/LedgerMaster.h>
 #include <ripple/app/ledger/LedgerTiming.h>
 #include <ripple/app/main/Application.h>
 #include <ripple/app/misc/NetworkOPs.h>
 #include <ripple/app/peers/UniqueNodeList.h>
 #include <ripple/basics/Log.h>
+#include <ripple/basics/ShardedTaggedCache.h>
 #include <ripple/basics/StringUtilities.h>
 #include <ripple/basics/seconds_clock.h>
 #include <ripple/core/JobQueue.h>
 #include <beast/cxx14/memory.h> // <memory>
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
-#include <thread>
 
 namespace ripple {
 
+/*
+
+Validations
+
+The validations for each ledger hash are kept in a sharded cache, and each
+ledger's set has its own lock, so the burst of validations that arrives at
+the top of a ledger interval does not serialize on one lock, nor wait for
+LedgerMaster counting the validations of another ledger. The number of
+trusted and untrusted validations in each set is kept in atomic counters
+and read without taking the set's lock.
+
+The latest validation from each validator and the stale validations waiting
+to be written have their own locks. Neither lock is held while taking a
+set's lock. The stale validation lock may be taken while holding the lock
+of the latest validations.
+
+Stale validations are written by a job, in one database transaction per
+batch, with multi-row prepared statements.
+
+*/
+
 class ValidationsImp : public Validations
 {
 private:
-    using LockType = std::mutex;
-    typedef std::lock_guard <LockType> ScopedLockType;
-    typedef beast::GenericScopedUnlock <LockType> ScopedUnlockType;
-    std::mutex mutable mLock;
+    typedef std::lock_guard <std::mutex> ScopedLockType;
+
+    // Rows per multi-row insert. SQLite allows at most 999 parameters in a
+    // statement.
+    static int const insertRows = 200;      // 4 parameters each
 
-    TaggedCache<uint256, ValidationSet> mValidations;
+    // The validations of one ledger
+    struct LedgerValidations
+    {
+        LedgerValidations ()
+            : trusted (0)
+            , untrusted (0)
+        {
+        }
+
+        std::mutex mutex;           // protects set
+        ValidationSet set;
+        std::atomic <int> trusted;
+        std::atomic <int> untrusted;
+    };
+
+    ShardedTaggedCache <uint256, LedgerValidations> mValidations;
+
+    std::mutex mCurrentLock;        // protects mCurrentValidations
     ValidationSet mCurrentValidations;
-    ValidationVector mStaleValidations;
 
+    std::mutex mStaleLock;          // protects mStaleValidations and mWriting
+    std::condition_variable mWritten;
+    ValidationVector mStaleValidations;
     bool mWriting;
 
 private:
-    std::shared_ptr<ValidationSet> findCreateSet (uint256 const& ledgerHash)
+    std::shared_ptr<LedgerValidations> findCreateSet (uint256 const& ledgerHash)
     {
         auto j = mValidations.fetch (ledgerHash);
 
         if (!j)
         {
-            j = std::make_shared<ValidationSet> ();
+            j = std::make_shared<LedgerValidations> ();
             mValidations.canonicalize (ledgerHash, j);
         }
 
         return j;
     }
 
-    std::shared_ptr<ValidationSet> findSet (uint256 const& ledgerHash)
+    std::shared_ptr<LedgerValidations> findSet (uint256 const& ledgerHash)
     {
         return mValidations.fetch (ledgerHash);
     }
@@ -105,11 +149,17 @@ private:
 
         if (val->isTrusted () && isCurrent)
         {
-            ScopedLockType sl (mLock);
+            {
+                auto set = findCreateSet (hash);
+                ScopedLockType sl (set->mutex);
 
-            if (!findCreateSet (hash)->insert (std::make_pair (node, val)).second)
-                return false;
+                if (!set->set.insert (std::make_pair (node, val)).second)
+                    return false;
 
+                ++(val->isTrusted () ? set->trusted : set->untrusted);
+            }
+
+            ScopedLockType sl (mCurrentLock);
             auto it = mCurrentValidations.find (node);
 
             if (it == mCurrentValidations.end ())
@@ -126,9 +176,8 @@ private:
             {
                 // This is a newer validation
                 val->setPreviousHash (it->second->getLedgerHash ());
-                mStaleValidations.push_back (it->second);
+                addStale (it->second);
                 it->second = val;
-                condWrite ();
             }
             else
             {
@@ -158,12 +207,12 @@ private:
 
     ValidationSet getValidations (uint256 const& ledger)
     {
-        {
-            ScopedLockType sl (mLock);
-            auto set = findSet (ledger);
+        auto set = findSet (ledger);
 
-            if (set)
-                return *set;
+        if (set)
+        {
+            ScopedLockType sl (set->mutex);
+            return set->set;
         }
         return ValidationSet ();
     }
@@ -171,17 +220,22 @@ private:
     void getValidationCount (uint256 const& ledger, bool currentOnly, int& trusted, int& untrusted)
     {
         trusted = untrusted = 0;
-        ScopedLockType sl (mLock);
         auto set = findSet (ledger);
 
-        if (set)
+        if (set && !currentOnly)
+        {
+            trusted = set->trusted.load ();
+            untrusted = set->untrusted.load ();
+        }
+        else if (set)
         {
             std::uint32_t now = getApp().getOPs ().getNetworkTimeNC ();
-            for (auto& it: *set)
+            ScopedLockType sl (set->mutex);
+            for (auto& it: set->set)
             {
                 bool isTrusted = it.second->isTrusted ();
 
-                if (isTrusted && currentOnly)
+                if (isTrusted)
                 {
                     std::uint32_t closeTime = it.second->getSignTime ();
 
@@ -206,12 +260,12 @@ private:
     void getValidationTypes (uint256 const& ledger, int& full, int& partial)
     {
         full = partial = 0;
-        ScopedLockType sl (mLock);
         auto set = findSet (ledger);
 
         if (set)
         {
-            for (auto& it:*set)
+            ScopedLockType sl (set->mutex);
+            for (auto& it: set->set)
             {
                 if (it.second->isTrusted ())
                 {
@@ -229,31 +283,21 @@ private:
 
     int getTrustedValidationCount (uint256 const& ledger)
     {
-        int trusted = 0;
-        ScopedLockType sl (mLock);
         auto set = findSet (ledger);
 
-        if (set)
-        {
-            for (auto& it: *set)
-            {
-                if (it.second->isTrusted ())
-                    ++trusted;
-            }
-        }
-
-        return trusted;
+        return set ? set->trusted.load () : 0;
     }
 
     std::vector <std::uint64_t>
     fees (uint256 const& ledger, std::uint64_t base) override
     {
         std::vector <std::uint64_t> result;
-        std::lock_guard <std::mutex> lock (mLock);
         auto const set = findSet (ledger);
         if (set)
         {
-            for (auto const& v : *set)
+            result.reserve (set->trusted.load ());
+            std::lock_guard <std::mutex> lock (set->mutex);
+            for (auto const& v : set->set)
             {
                 if (v.second->isTrusted())
                 {
@@ -272,10 +316,11 @@ private:
     {
         // Number of trusted nodes that have moved past this ledger
         int count = 0;
-        ScopedLockType sl (mLock);
+        ScopedLockType sl (mCurrentLock);
         for (auto& it: mCurrentValidations)
         {
-            if (it.second->isTrusted () && it.second->isPreviousHash (ledger))
+            if (it.second && it.second->isTrusted () &&
+                it.second->isPreviousHash (ledger))
                 ++count;
         }
         return count;
@@ -287,10 +332,10 @@ private:
         int goodNodes = overLoaded ? 1 : 0;
         int badNodes = overLoaded ? 0 : 1;
         {
-            ScopedLockType sl (mLock);
+            ScopedLockType sl (mCurrentLock);
             for (auto& it: mCurrentValidations)
             {
-                if (it.second->isTrusted ())
+                if (it.second && it.second->isTrusted ())
                 {
                     if (it.second->isFull ())
                         ++goodNodes;
@@ -308,7 +353,7 @@ private:
 
         std::list<STValidation::pointer> ret;
 
-        ScopedLockType sl (mLock);
+        ScopedLockType sl (mCurrentLock);
         auto it = mCurrentValidations.begin ();
 
         while (it != mCurrentValidations.end ())
@@ -318,9 +363,7 @@ private:
             else if (it->second->getSignTime () < cutoff)
             {
                 // contains a stale record
-                mStaleValidations.push_back (it->second);
-                it->second.reset ();
-                condWrite ();
+                addStale (it->second);
                 it = mCurrentValidations.erase (it);
             }
             else
@@ -345,7 +388,7 @@ private:
 
         LedgerToValidationCounter ret;
 
-        ScopedLockType sl (mLock);
+        ScopedLockType sl (mCurrentLock);
         auto it = mCurrentValidations.begin ();
 
         while (it != mCurrentValidations.end ())
@@ -355,9 +398,7 @@ private:
             else if (it->second->getSignTime () < cutoff)
             {
                 // contains a stale record
-                mStaleValidations.push_back (it->second);
-                it->second.reset ();
-                condWrite ();
+                addStale (it->second);
                 it = mCurrentValidations.erase (it);
             }
             else
@@ -389,31 +430,38 @@ private:
 
     void flush ()
     {
-        bool anyNew = false;
-
         WriteLog (lsINFO, Validations) << "Flushing validations";
-        ScopedLockType sl (mLock);
-        for (auto& it: mCurrentValidations)
+
+        ValidationSet current;
+        {
+            ScopedLockType sl (mCurrentLock);
+            current.swap (mCurrentValidations);
+        }
+
+        std::unique_lock <std::mutex> sl (mStaleLock);
+        for (auto& it: current)
         {
             if (it.second)
                 mStaleValidations.push_back (it.second);
-
-            anyNew = true;
         }
-        mCurrentValidations.clear ();
 
-        if (anyNew)
+        if (!current.empty ())
             condWrite ();
 
-        while (mWriting)
-        {
-            ScopedUnlockType sul (mLock);
-            std::this_thread::sleep_for (std::chrono::milliseconds (100));
-        }
+        mWritten.wait (sl, [this] { return !mWriting; });
 
         WriteLog (lsDEBUG, Validations) << "Validations flushed";
     }
 
+    // Queue a validation to be written
+    void addStale (STValidation::ref val)
+    {
+        ScopedLockType sl (mStaleLock);
+        mStaleValidations.push_back (val);
+        condWrite ();
+    }
+
+    // Called with mStaleLock held
     void condWrite ()
     {
         if (mWriting)
@@ -428,10 +476,8 @@ private:
     void doWrite (Job&)
     {
         LoadEvent::autoptr event (getApp().getJobQueue ().getLoadEventAP (jtDISK, "ValidationWrite"));
-        boost::format insVal ("INSERT INTO Validations "
-                              "(LedgerHash,NodePubKey,SignTime,RawData) VALUES ('%s','%s','%u',%s);");
 
-        ScopedLockType sl (mLock);
+        std::unique_lock <std::mutex> sl (mStaleLock);
         assert (mWriting);
 
         while (!mStaleValidations.empty ())
@@ -440,36 +486,115 @@ private:
             vector.reserve (512);
             mStaleValidations.swap (vector);
 
+            sl.unlock ();
+            write (vector);
+            sl.lock ();
+        }
+
+        mWriting = false;
+        mWritten.notify_all ();
+    }
+
+    // Write a batch of validations in one database transaction
+    void write (ValidationVector const& vector)
+    {
+        auto db = getApp().getLedgerDB ().getDB ();
+        auto dbl (getApp().getLedgerDB ().lock ());
+
+        db->beginTransaction();
+
+#ifndef NO_SQLITE3_PREPARE
+        if (db->getDBType () == Database::Type::Sqlite)
+            writeSqlite (db->getSqliteDB (), vector);
+        else
+#endif
+            writeText (db, vector);
+
+        db->endTransaction();
+    }
+
+#ifndef NO_SQLITE3_PREPARE
+    // Returns "INSERT ... VALUES (?,?,?,?),..." with the given number of rows
+    static std::string insertSql (int rows)
+    {
+        std::string sql ("INSERT INTO Validations "
+            "(LedgerHash,NodePubKey,SignTime,RawData) VALUES ");
+        for (int i = 0; i < rows; ++i)
+            sql += (i == 0) ? "(?,?,?,?)" : ",(?,?,?,?)";
+        return sql + ";";
+    }
+
+    void writeSqlite (SqliteDatabase* db, ValidationVector const& vector)
+    {
+        Serializer s (1024);
+
+        auto bind = [&s] (SqliteStatement& statement, int p,
+            STValidation const& val)
+        {
+            s.erase ();
+            val.add (s);
+            statement.bind (p + 1, to_string (val.getLedgerHash ()));
+            statement.bind (p + 2, val.getSignerPublic ().humanNodePublic ());
+            statement.bind (p + 3, val.getSignTime ());
+            statement.bind (p + 4, s.peekData ().data (), s.peekData ().size ());
+        };
+
+        auto step = [] (SqliteStatement& statement)
+        {
+            int const ret = statement.step ();
+            statement.reset ();
+
+            if (!statement.isDone (ret))
             {
-                ScopedUnlockType sul (mLock);
-                {
-                    auto db = getApp().getLedgerDB ().getDB ();
-                    auto dbl (getApp().getLedgerDB ().lock ());
+                WriteLog (lsWARNING, Validations) << "Writing validations: " <<
+                    statement.getError (ret);
+            }
+        };
 
-                    Serializer s (1024);
-//                    db->executeSQL ("BEGIN TRANSACTION;");
-                    db->beginTransaction();
-                    for (auto it: vector)
-                    {
-                        s.erase ();
-                        it->add (s);
-                        db->executeSQL (boost::str (
-                            insVal % to_string (it->getLedgerHash ()) %
-                            it->getSignerPublic ().humanNodePublic () %
-                            it->getSignTime () % sqlEscape (s.peekData ())));
-                    }
-//                    db->executeSQL ("END TRANSACTION;");
-                    db->endTransaction();
-                }
+        std::size_t i = 0;
+
+        if (vector.size () >= insertRows)
+        {
+            SqliteStatement batch (db, insertSql (insertRows));
+            for (; i + insertRows <= vector.size (); i += insertRows)
+            {
+                for (int j = 0; j < insertRows; ++j)
+                    bind (batch, j * 4, *vector[i + j]);
+                step (batch);
             }
         }
 
-        mWriting = false;
+        if (i < vector.size ())
+        {
+            SqliteStatement single (db, insertSql (1));
+            for (; i < vector.size (); ++i)
+            {
+                bind (single, 0, *vector[i]);
+                step (single);
+            }
+        }
+    }
+#endif
+
+    void writeText (Database* db, ValidationVector const& vector)
+    {
+        boost::format insVal ("INSERT INTO Validations "
+                              "(LedgerHash,NodePubKey,SignTime,RawData) VALUES ('%s','%s','%u',%s);");
+
+        Serializer s (1024);
+        for (auto it: vector)
+        {
+            s.erase ();
+            it->add (s);
+            db->executeSQL (boost::str (
+                insVal % to_string (it->getLedgerHash ()) %
+                it->getSignerPublic ().humanNodePublic () %
+                it->getSignTime () % sqlEscape (s.peekData ())));
+        }
     }
 
     void sweep ()
     {
-        ScopedLockType sl (mLock);
         mValidations.sweep ();
     }
 };
@@ -0,0 +1,208 @@
+#include <BeastConfig.h>
+#include <ripple/app/consensus/LedgerConsensus.h>
+#include <ripple/app/misc/CanonicalTXSet.h>
+#include <ripple/app/misc/DefaultMissingNodeHandler.h>
+#include <ripple/app/misc/DividendMaster.h>
+#include <ripple/app/tx/TransactionEngine.h>
+#include <ripple/protocol/Indexes.h>
+#include <beast/module/core/text/LexicalCast.h>
+#include <beast/unit_test/suite.h>
+#include <chrono>
+
+namespace ripple {
+
+// Builds a base ledger holding many payees and the set of dividend apply
+// transactions paying them, as the consensus round of a dividend ledger does.
+class DividendApplyFixture
+{
+public:
+    static Ledger::pointer
+    makeBaseLedger(std::size_t payees, std::uint32_t& dividendLedger)
+    {
+        std::uint64_t const vrp = SYSTEM_CURRENCY_PARTS;
+        std::uint64_t const vbc = SYSTEM_CURRENCY_PARTS_VBC;
+
+        RippleAddress const master = RippleAddress::createAccountPublic(
+            RippleAddress::createGeneratorPublic(
+                RippleAddress::createSeedGeneric("masterpassphrase")), 0);
+        Ledger::pointer ledger = std::make_shared<Ledger>(master,
+            100000 * vrp, 100000 * vbc);
+
+        for (std::size_t i = 0; i < payees; ++i)
+        {
+            Account const account = payee(i);
+            auto sle = std::make_shared<SLE>(ltACCOUNT_ROOT, getAccountRootIndex(account));
+            sle->setFieldAccount(sfAccount, account);
+            sle->setFieldAmount(sfBalance, STAmount(vrp + i));
+            sle->setFieldAmount(sfBalanceVBC, STAmount(vbc + i));
+            sle->setFieldU32(sfSequence, 1);
+            ledger->writeBack(lepCREATE, sle);
+        }
+
+        dividendLedger = ledger->getLedgerSeq();
+        auto dividend = std::make_shared<SLE>(ltDIVIDEND, getLedgerDividendIndex());
+        dividend->setFieldU8(sfDividendState, DividendMaster::DivState_Start);
+        dividend->setFieldU32(sfDividendLedger, dividendLedger);
+        dividend->setFieldU64(sfDividendCoins, payees * 10);
+        dividend->setFieldU64(sfDividendCoinsVBC, payees * 20);
+        ledger->writeBack(lepCREATE, dividend);
+
+        ledger->peekAccountStateMap()->flushDirty(hotACCOUNT_NODE, ledger->getLedgerSeq());
+        ledger->updateHash();
+        ledger->setClosed();
+        return ledger;
+    }
+
+    static SHAMap::pointer
+    makeDividendSet(std::size_t payees, std::uint32_t dividendLedger)
+    {
+        Application& app = getApp();
+        SHAMap::pointer set = std::make_shared<SHAMap>(smtTRANSACTION,
+            app.getFullBelowCache(), app.getTreeNodeCache(), app.getNodeStore(),
+            DefaultMissingNodeHandler(), deprecatedLogs().journal("SHAMap"));
+
+        std::vector<SHAMapItem::pointer> items;
+        for (std::size_t i = 0; i < payees; ++i)
+        {
+            STTx trans(ttDIVIDEND);
+            trans.setFieldU8(sfDividendType, DividendMaster::DivType_Apply);
+            trans.setFieldAccount(sfAccount, Account());
+            trans.setFieldAccount(sfDestination, payee(i));
+            trans.setFieldU32(sfDividendLedger, dividendLedger);
+            trans.setFieldU64(sfDividendCoins, 10);
+            trans.setFieldU64(sfDividendCoinsVBC, 20);
+            trans.setFieldU64(sfDividendCoinsVBCRank, 15);
+            trans.setFieldU64(sfDividendCoinsVBCSprd, 5);
+            trans.setFieldU64(sfDividendVRank, i);
+            trans.setFieldU64(sfDividendVSprd, i * 2);
+            trans.setFieldU64(sfDividendTSprd, i * 3);
+            items.push_back(makeItem(trans));
+        }
+
+        STTx done(ttDIVIDEND);
+        done.setFieldU8(sfDividendType, DividendMaster::DivType_Done);
+        done.setFieldAccount(sfAccount, Account());
+        done.setFieldU32(sfDividendLedger, dividendLedger);
+        done.setFieldU64(sfDividendCoins, payees * 10);
+        done.setFieldU64(sfDividendCoinsVBC, payees * 20);
+        done.setFieldU64(sfDividendVRank, payees);
+        done.setFieldU64(sfDividendVSprd, payees * 2);
+        done.setFieldH256(sfDividendResultHash, uint256());
+        items.push_back(makeItem(done));
+
+        set->addGiveItems(items, true, false);
+        return set;
+    }
+
+    static Account
+    payee(std::size_t i)
+    {
+        return Account(static_cast<std::uint64_t>(i) + 0x1000);
+    }
+
+private:
+    static SHAMapItem::pointer
+    makeItem(STTx const& trans)
+    {
+        Serializer s;
+        trans.add(s, true);
+        return std::make_shared<SHAMapItem>(trans.getTransactionID(), s.peekData());
+    }
+};
+
+class DividendApply_test : public beast::unit_test::suite
+{
+public:
+    void testSameAsOneByOne()
+    {
+        testcase("same result as one by one");
+
+        // enough payees for the batch prefetch to run
+        std::size_t const payees = 1000;
+        std::uint32_t dividendLedger;
+        Ledger::pointer base = DividendApplyFixture::makeBaseLedger(payees, dividendLedger);
+        SHAMap::pointer set = DividendApplyFixture::makeDividendSet(payees, dividendLedger);
+
+        Ledger::pointer batched = std::make_shared<Ledger>(false, *base);
+        CanonicalTXSet retriable(set->getHash());
+        applyTransactions(set, batched, batched, retriable, false);
+        expect(retriable.empty());
+
+        Ledger::pointer oneByOne = std::make_shared<Ledger>(false, *base);
+        TransactionEngine engine(oneByOne);
+        for (auto item = set->peekFirstItem(); item; item = set->peekNextItem(item->getTag()))
+        {
+            SerializerIterator sit(item->peekSerializer());
+            STTx txn(sit);
+            bool didApply = false;
+            engine.applyTransaction(txn, tapRETRY, didApply);
+            expect(didApply, "dividend not applied");
+        }
+
+        expect(batched->peekAccountStateMap()->getHash() ==
+            oneByOne->peekAccountStateMap()->getHash(), "state differs");
+        expect(batched->peekTransactionMap()->getHash() ==
+            oneByOne->peekTransactionMap()->getHash(), "metadata differs");
+
+        SLE::pointer sle = batched->getSLEi(getAccountRootIndex(DividendApplyFixture::payee(7)));
+        expect(sle && sle->getFieldAmount(sfBalance).getNValue() == SYSTEM_CURRENCY_PARTS + 7 + 10,
+            "dividend not paid");
+    }
+
+    void run()
+    {
+        testSameAsOneByOne();
+    }
+};
+
+// Measures closing a dividend ledger. Pass the number of payees as the
+// argument, the default is 500000.
+class DividendApplyTiming_test : public beast::unit_test::suite
+{
+public:
+    void run()
+    {
+        std::size_t payees = 500000;
+        if (!arg().empty())
+            payees = beast::lexicalCastThrow<std::size_t>(arg());
+
+        testcase("close " + std::to_string(payees) + " payees");
+
+        using clock = std::chrono::steady_clock;
+        auto ms = [](clock::time_point start)
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                clock::now() - start).count();
+        };
+
+        std::uint32_t dividendLedger;
+        auto start = clock::now();
+        Ledger::pointer base = DividendApplyFixture::makeBaseLedger(payees, dividendLedger);
+        log << "base ledger: " << ms(start) << "ms";
+
+        start = clock::now();
+        SHAMap::pointer set = DividendApplyFixture::makeDividendSet(payees, dividendLedger);
+        log << "dividend set: " << ms(start) << "ms";
+
+        Ledger::pointer ledger = std::make_shared<Ledger>(false, *base);
+        CanonicalTXSet retriable(set->getHash());
+        start = clock::now();
+        applyTransactions(set, ledger, ledger, retriable, false);
+        log << "apply: " << ms(start) << "ms";
+
+        start = clock::now();
+        ledger->setClosed();
+        ledger->peekAccountStateMap()->flushDirty(hotACCOUNT_NODE, ledger->getLedgerSeq());
+        ledger->peekTransactionMap()->flushDirty(hotTRANSACTION_NODE, ledger->getLedgerSeq());
+        ledger->updateHash();
+        log << "flush: " << ms(start) << "ms";
+
+        expect(retriable.empty());
+        expect(ledger->peekTransactionMap()->getHash() != base->peekTransactionMap()->getHash());
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(DividendApply,ripple_app,ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(DividendApplyTiming,ripple_app,ripple);
+
+}
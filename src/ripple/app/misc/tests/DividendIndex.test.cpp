@@ -0,0 +1,238 @@
+#include <BeastConfig.h>
+#include <ripple/app/misc/DividendIndex.h>
+#include <ripple/app/consensus/LedgerConsensus.h>
+#include <ripple/app/ledger/LedgerTiming.h>
+#include <ripple/app/misc/CanonicalTXSet.h>
+#include <ripple/app/transactors/Transactor.h>
+#include <ripple/protocol/RippleAddress.h>
+#include <ripple/protocol/STParsedJSON.h>
+#include <ripple/protocol/TxFlags.h>
+#include <beast/unit_test/suite.h>
+#include <boost/filesystem.hpp>
+
+namespace ripple {
+
+class DividendIndex_test : public beast::unit_test::suite
+{
+    using TestAccount = std::pair<RippleAddress, unsigned>;
+    typedef DividendIndex::DividendAccounts DividendAccounts;
+
+    STTx
+    parseTransaction(TestAccount& account, Json::Value const& tx_json)
+    {
+        STParsedJSONObject parsed("tx_json", tx_json);
+        std::unique_ptr<STObject> sopTrans = std::move(parsed.object);
+        expect(sopTrans != nullptr);
+        sopTrans->setFieldVL(sfSigningPubKey, account.first.getAccountPublic());
+        return STTx(*sopTrans);
+    }
+
+    void
+    applyTransaction(Ledger::pointer const& ledger, STTx const& tx)
+    {
+        TransactionEngine engine(ledger);
+        bool didApply = false;
+        auto r = engine.applyTransaction(tx, tapOPEN_LEDGER | tapNO_CHECK_SIGN,
+                                         didApply);
+        expect(r == tesSUCCESS);
+        expect(didApply);
+    }
+
+    TestAccount
+    createAccount()
+    {
+        static RippleAddress const seed
+                = RippleAddress::createSeedGeneric ("masterpassphrase");
+        static RippleAddress const generator
+                = RippleAddress::createGeneratorPublic (seed);
+        static int iSeq = -1;
+        ++iSeq;
+        return std::make_pair(RippleAddress::createAccountPublic(generator, iSeq),
+                              std::uint64_t(0));
+    }
+
+    void
+    makePayment(TestAccount& from, TestAccount const& to,
+                std::string const& currency, std::uint64_t amountDrops,
+                Ledger::pointer const& ledger)
+    {
+        Json::Value tx_json;
+        tx_json["Account"] = from.first.humanAccountID();
+        if (currency.empty())
+        {
+            tx_json["Amount"] = std::to_string(amountDrops);
+        }
+        else
+        {
+            tx_json["Amount"]["currency"] = currency;
+            tx_json["Amount"]["value"] = std::to_string(amountDrops);
+        }
+        tx_json["Destination"] = to.first.humanAccountID();
+        tx_json["TransactionType"] = "Payment";
+        tx_json["Fee"] = std::to_string(SYSTEM_CURRENCY_PARTS);
+        tx_json["Sequence"] = ++from.second;
+        tx_json["Flags"] = tfUniversal;
+        applyTransaction(ledger, parseTransaction(from, tx_json));
+    }
+
+    void
+    addReferee(TestAccount& from, TestAccount const& referee,
+               Ledger::pointer const& ledger)
+    {
+        Json::Value tx_json;
+        tx_json["Account"] = from.first.humanAccountID();
+        tx_json["Destination"] = referee.first.humanAccountID();
+        tx_json["TransactionType"] = "AddReferee";
+        tx_json["Fee"] = std::to_string(SYSTEM_CURRENCY_PARTS);
+        tx_json["Sequence"] = ++from.second;
+        applyTransaction(ledger, parseTransaction(from, tx_json));
+    }
+
+    Ledger::pointer
+    close_and_advance(Ledger::pointer ledger, Ledger::pointer LCL)
+    {
+        SHAMap::pointer set = ledger->peekTransactionMap();
+        CanonicalTXSet retriableTransactions(set->getHash());
+        Ledger::pointer newLCL = std::make_shared<Ledger>(false, *LCL);
+        applyTransactions(set, newLCL, newLCL, retriableTransactions, false);
+        newLCL->updateSkipList();
+        newLCL->setClosed();
+        newLCL->peekAccountStateMap()->flushDirty(
+            hotACCOUNT_NODE, newLCL->getLedgerSeq());
+        newLCL->peekTransactionMap()->flushDirty(
+            hotTRANSACTION_NODE, newLCL->getLedgerSeq());
+        using namespace std::chrono;
+        auto const epoch_offset = days(10957);  // 2000-01-01
+        std::uint32_t closeTime = time_point_cast<seconds>  // now
+                                         (system_clock::now()-epoch_offset).
+                                         time_since_epoch().count();
+        int CloseResolution = seconds(LEDGER_TIME_ACCURACY).count();
+        bool closeTimeCorrect = true;
+        newLCL->setAccepted(closeTime, CloseResolution, closeTimeCorrect);
+        return newLCL;
+    }
+
+    bool
+    sameAccounts(DividendAccounts const& a, DividendAccounts const& b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            if (a[i].account != b[i].account ||
+                a[i].referee != b[i].referee ||
+                a[i].balanceVBC != b[i].balanceVBC ||
+                a[i].height != b[i].height)
+                return false;
+        }
+        return true;
+    }
+
+    // The index must agree with a full walk of the ledger's state
+    void
+    expectMatchesLedger(DividendIndex const& index, Ledger::ref ledger)
+    {
+        DividendAccounts indexed, walked;
+        expect(index.getAccounts(ledger, indexed), "ledger not indexed");
+        DividendIndex::readAccounts(ledger, walked);
+        expect(!walked.empty());
+        expect(sameAccounts(indexed, walked), "index differs from ledger");
+
+        DividendMaster::AccountsDividend indexedOut, walkedOut;
+        std::uint64_t t1, t2, r1, r2, s1, s2, v1, v2;
+        DividendMaster::calcDividendFunc(indexed, 1000000, 50000000000,
+            indexedOut, t1, v1, r1, s1);
+        DividendMaster::calcDividendFunc(walked, 1000000, 50000000000,
+            walkedOut, t2, v2, r2, s2);
+        expect(indexedOut == walkedOut && t1 == t2 && v1 == v2 &&
+            r1 == r2 && s1 == s2, "dividend differs from full recompute");
+    }
+
+    void
+    apply(DividendIndex& index, Ledger::ref ledger)
+    {
+        expect(index.applyLedger(*AcceptedLedger::makeAcceptedLedger(ledger)),
+            "ledger not applied");
+    }
+
+    void testIncremental()
+    {
+        std::uint64_t const vrp = SYSTEM_CURRENCY_PARTS;
+        std::uint64_t const vbc = SYSTEM_CURRENCY_PARTS_VBC;
+
+        auto master = createAccount();
+        Ledger::pointer LCL = std::make_shared<Ledger>(master.first,
+            100000*vrp, 100000*vbc);
+        LCL->updateHash();
+        LCL->setClosed();
+
+        DividendIndex index(beast::Journal(), 4);
+        index.reset(LCL);
+        expectMatchesLedger(index, LCL);
+
+        auto alice = createAccount();
+        auto bob = createAccount();
+        auto carol = createAccount();
+        auto dave = createAccount();
+
+        Ledger::pointer ledger = std::make_shared<Ledger>(false, *LCL);
+        makePayment(master, alice, "", 5000*vrp, ledger);
+        makePayment(master, bob, "", 4000*vrp, ledger);
+        makePayment(master, carol, "", 3000*vrp, ledger);
+        makePayment(master, dave, "", 2000*vrp, ledger);
+        makePayment(master, alice, "VBC", 500*vbc, ledger);
+        makePayment(master, bob, "VBC", 20*vbc, ledger);
+        Ledger::pointer const first = close_and_advance(ledger, LCL);
+        apply(index, first);
+        expectMatchesLedger(index, first);
+
+        // referrals create Refer entries and move carol and dave into
+        // the dividend with less than one VBC
+        ledger = std::make_shared<Ledger>(false, *first);
+        addReferee(bob, alice, ledger);
+        addReferee(carol, bob, ledger);
+        addReferee(dave, carol, ledger);
+        makePayment(alice, dave, "VBC", vbc / 2, ledger);
+        Ledger::pointer const second = close_and_advance(ledger, first);
+        apply(index, second);
+        expectMatchesLedger(index, second);
+
+        ledger = std::make_shared<Ledger>(false, *second);
+        makePayment(bob, carol, "VBC", 15*vbc, ledger);
+        makePayment(alice, bob, "VBC", 100*vbc, ledger);
+        Ledger::pointer const third = close_and_advance(ledger, second);
+
+        testcase("out of order ledgers");
+        expect(!index.applyLedger(*AcceptedLedger::makeAcceptedLedger(first)));
+        apply(index, third);
+        expectMatchesLedger(index, third);
+
+        testcase("history");
+        expectMatchesLedger(index, second);
+        expectMatchesLedger(index, first);
+        expectMatchesLedger(index, LCL);
+
+        testcase("checkpoint");
+        auto const path = (boost::filesystem::temp_directory_path() /
+            boost::filesystem::unique_path()).string();
+        expect(index.save(path));
+        DividendIndex loaded{beast::Journal()};
+        expect(loaded.load(path));
+        expect(loaded.getLedgerSeq() == third->getLedgerSeq());
+        expectMatchesLedger(loaded, third);
+        DividendAccounts accounts;
+        expect(!loaded.getAccounts(second, accounts));
+        boost::filesystem::remove(path);
+    }
+
+public:
+    void run()
+    {
+        testcase("incremental updates");
+        testIncremental();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(DividendIndex,ripple_app,ripple);
+
+}
@@ -0,0 +1,248 @@
+#include <BeastConfig.h>
+#include <ripple/app/misc/DividendMaster.h>
+#include <ripple/protocol/Serializer.h>
+#include <ripple/protocol/SystemParameters.h>
+#include <beast/unit_test/suite.h>
+#include <boost/multiprecision/cpp_int.hpp>
+#include <map>
+#include <random>
+
+namespace ripple {
+
+class DividendMaster_test : public beast::unit_test::suite
+{
+    typedef DividendMaster::DividendAccount DividendAccount;
+    typedef DividendMaster::DividendAccounts DividendAccounts;
+    typedef DividendMaster::AccountsDividend AccountsDividend;
+
+    struct Result
+    {
+        AccountsDividend accounts;
+        uint64_t totalDividend = 0;
+        uint64_t totalDividendVBC = 0;
+        uint64_t sumVRank = 0;
+        uint64_t sumVSpd = 0;
+    };
+
+    static uint64_t adjust(uint64_t coin)
+    {
+        return coin>=10000000000 ? coin+90000000000 : coin*10;
+    }
+
+    class AccountsByReference_Less {
+    public:
+        template <class T>
+        bool operator()(const T &x, const T &y) const
+        {
+            if (std::get<2>(x) > std::get<2>(y))
+                return true;
+            else if (std::get<2>(x) == std::get<2>(y))
+                return std::get<1>(x) > std::get<1>(y);
+            return false;
+        }
+    };
+
+    // The multimap based calculation the dividend engine replaced,
+    // kept here as the reference for the results.
+    static Result legacyCalc(DividendAccounts const& accounts, uint64_t dividendCoins, uint64_t dividendCoinsVBC)
+    {
+        Result r;
+        std::multimap<uint64_t, std::tuple<Account, Account, uint32_t>> accountsByBalance;
+        std::multimap<std::tuple<Account, Account, uint32_t>, std::tuple<uint64_t, uint32_t, uint64_t, uint64_t>, AccountsByReference_Less> accountsByReference;
+
+        for (auto const& a : accounts) {
+            if (a.balanceVBC < SYSTEM_CURRENCY_PARTS_VBC)
+                accountsByReference.emplace(std::piecewise_construct,
+                                            std::forward_as_tuple(a.account, a.referee, a.height),
+                                            std::forward_as_tuple(a.balanceVBC, 0, 0, 0));
+            else
+                accountsByBalance.emplace(std::piecewise_construct,
+                                          std::forward_as_tuple(a.balanceVBC),
+                                          std::forward_as_tuple(a.account, a.referee, a.height));
+        }
+        if (accountsByBalance.empty() && accountsByReference.empty())
+            return r;
+
+        {
+            uint64_t lastBalance = 0;
+            uint32_t pos = 1, rank = 1;
+            for (auto it = accountsByBalance.begin(); it != accountsByBalance.end(); ++pos) {
+                if (lastBalance < it->first) {
+                    rank = pos;
+                    lastBalance = it->first;
+                }
+                accountsByReference.emplace(std::piecewise_construct, it->second, std::forward_as_tuple(it->first, rank, 0, 0));
+                r.sumVRank += rank;
+                it = accountsByBalance.erase(it);
+            }
+        }
+
+        {
+            hash_map<Account, std::pair<uint64_t, uint64_t>> childrenHoldings;
+            Account lastParent;
+            uint64_t totalChildrenVSpd = 0, totalChildrenHolding = 0, maxHolding = 0;
+            for (auto& it : accountsByReference) {
+                const Account& accountParent = std::get<1>(it.first);
+                if (lastParent != accountParent) {
+                    if (totalChildrenVSpd != 0) {
+                        childrenHoldings.emplace(lastParent, std::make_pair(totalChildrenHolding, totalChildrenVSpd - adjust(maxHolding) + (static_cast<uint64_t>(pow(maxHolding/SYSTEM_CURRENCY_PARTS_VBC, 1.0 / 3))*SYSTEM_CURRENCY_PARTS_VBC)));
+                    }
+                    totalChildrenVSpd = totalChildrenHolding = maxHolding = 0;
+                    lastParent = accountParent;
+                }
+                uint64_t t = 0, v = 0;
+                auto itHolding = childrenHoldings.find(std::get<0>(it.first));
+                if (itHolding != childrenHoldings.end()) {
+                    t = itHolding->second.first;
+                    v = itHolding->second.second;
+                    childrenHoldings.erase(itHolding);
+                }
+                uint64_t balance = std::get<0>(it.second);
+                if (balance >= SYSTEM_CURRENCY_PARTS_VBC) {
+                    std::get<2>(it.second) = v;
+                    r.sumVSpd += v;
+                }
+                t += balance;
+                std::get<3>(it.second) = t;
+                if (accountParent.isZero())
+                    continue;
+                totalChildrenHolding += t;
+                totalChildrenVSpd += adjust(t);
+                if (maxHolding < t)
+                    maxHolding = t;
+            }
+        }
+
+        uint64_t totalDivVBCbyRank = dividendCoinsVBC / 2;
+        uint64_t totalDivVBCbyPower = dividendCoinsVBC - totalDivVBCbyRank;
+        for (const auto& it : accountsByReference) {
+            uint64_t divVBC = 0;
+            boost::multiprecision::uint128_t divVBCbyRank(0), divVBCbyPower(0);
+            if (dividendCoinsVBC > 0 && r.sumVSpd > 0 && r.sumVRank > 0) {
+                divVBCbyRank = totalDivVBCbyRank;
+                divVBCbyRank *= std::get<1>(it.second);
+                divVBCbyRank /= r.sumVRank;
+                divVBCbyPower = totalDivVBCbyPower;
+                divVBCbyPower *= std::get<2>(it.second);
+                divVBCbyPower /= r.sumVSpd;
+                divVBC = static_cast<uint64_t>(divVBCbyRank + divVBCbyPower);
+                if (divVBC < VBC_DIVIDEND_MIN) {
+                    divVBC = 0;
+                    divVBCbyRank = 0;
+                    divVBCbyPower = 0;
+                }
+                r.totalDividendVBC += divVBC;
+            }
+            uint64_t div = 0;
+            if (dividendCoins > 0 && (dividendCoinsVBC == 0 || divVBC >= VBC_DIVIDEND_MIN)) {
+                div = std::get<0>(it.second) * VRP_INCREASE_RATE / VRP_INCREASE_RATE_PARTS;
+                r.totalDividend += div;
+            }
+            if (div !=0 || divVBC !=0 || std::get<2>(it.second) > MIN_VSPD_TO_GET_FEE_SHARE)
+                r.accounts.push_back(std::make_tuple(std::get<0>(it.first), div, divVBC, static_cast<uint64_t>(divVBCbyRank), static_cast<uint64_t>(divVBCbyPower), std::get<1>(it.second), std::get<2>(it.second), std::get<3>(it.second)));
+        }
+
+        uint64_t remainCoins = 0, remainCoinsVBC = 0;
+        if (dividendCoins > r.totalDividend) {
+            remainCoins = dividendCoins - r.totalDividend;
+            r.totalDividend = dividendCoins;
+        }
+        if (dividendCoinsVBC > r.totalDividendVBC) {
+            remainCoinsVBC = dividendCoinsVBC - r.totalDividendVBC;
+            r.totalDividendVBC = dividendCoinsVBC;
+        }
+        if (remainCoins > 0 || remainCoinsVBC > 0)
+            r.accounts.push_back(std::make_tuple(Account("0x56CE5173B6A2CBEDF203BD69159212094C651041"), remainCoins, remainCoinsVBC, 0, 0, 0, 0, 0));
+        return r;
+    }
+
+    // Hash over everything the dividend transactions are built from.
+    static uint256 resultHash(Result const& r)
+    {
+        Serializer s;
+        s.add64(r.totalDividend);
+        s.add64(r.totalDividendVBC);
+        s.add64(r.sumVRank);
+        s.add64(r.sumVSpd);
+        for (auto const& it : r.accounts) {
+            s.add160(std::get<0>(it));
+            s.add64(std::get<1>(it));
+            s.add64(std::get<2>(it));
+            s.add64(std::get<3>(it));
+            s.add64(std::get<4>(it));
+            s.add32(std::get<5>(it));
+            s.add64(std::get<6>(it));
+            s.add64(std::get<7>(it));
+        }
+        return s.getSHA512Half();
+    }
+
+    // A referral forest in no particular order. Balances are drawn from a
+    // small set so that ties in ranking are common.
+    static DividendAccounts makeAccounts(std::mt19937& gen, std::size_t count)
+    {
+        static uint64_t const balances[] = {
+            0, 1, SYSTEM_CURRENCY_PARTS_VBC - 1, SYSTEM_CURRENCY_PARTS_VBC,
+            5 * SYSTEM_CURRENCY_PARTS_VBC, 1000 * SYSTEM_CURRENCY_PARTS_VBC,
+            9999 * SYSTEM_CURRENCY_PARTS_VBC, 20000 * SYSTEM_CURRENCY_PARTS_VBC,
+            123456789 * SYSTEM_CURRENCY_PARTS_VBC };
+        DividendAccounts accounts;
+        for (std::size_t i = 0; i < count; ++i) {
+            DividendAccount a;
+            a.account = Account(static_cast<std::uint64_t>(gen()) << 32 | gen());
+            a.height = 0;
+            if (i > 0 && gen() % 4 != 0) {
+                auto const& parent = accounts[gen() % i];
+                a.referee = parent.account;
+                a.height = parent.height + 1;
+            }
+            if (gen() % 3 == 0)
+                a.balanceVBC = balances[gen() % (sizeof(balances) / sizeof(balances[0]))];
+            else
+                a.balanceVBC = (gen() % 100000) * (gen() % 100000);
+            accounts.push_back(a);
+        }
+        // orphaned referee, as when the parent account is not in the set
+        if (!accounts.empty()) {
+            DividendAccount a;
+            a.account = Account(0x1234u);
+            a.referee = Account(0x5678u);
+            a.height = 3;
+            a.balanceVBC = 42 * SYSTEM_CURRENCY_PARTS_VBC;
+            accounts.push_back(a);
+        }
+        std::shuffle(accounts.begin(), accounts.end(), gen);
+        return accounts;
+    }
+
+    void testMatchesLegacy(std::size_t count, uint64_t coins, uint64_t coinsVBC)
+    {
+        std::mt19937 gen(static_cast<std::uint32_t>(count));
+        DividendAccounts accounts = makeAccounts(gen, count);
+
+        Result expected = legacyCalc(accounts, coins, coinsVBC);
+        Result actual;
+        expect(DividendMaster::calcDividendFunc(accounts, coins, coinsVBC,
+            actual.accounts, actual.totalDividend, actual.totalDividendVBC,
+            actual.sumVRank, actual.sumVSpd));
+
+        expect(actual.accounts == expected.accounts, "accounts differ");
+        expect(resultHash(actual) == resultHash(expected), "result hash differs");
+    }
+
+    void run()
+    {
+        testcase("empty");
+        testMatchesLegacy(0, 1000, 1000);
+
+        testcase("matches legacy calculation");
+        testMatchesLegacy(1, 1000000, 50000000);
+        testMatchesLegacy(100, 1000000, 0);
+        testMatchesLegacy(1000, 0, 50000000000);
+        testMatchesLegacy(20000, 123456789, 50000000000);
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(DividendMaster,ripple_app,ripple);
+
+}
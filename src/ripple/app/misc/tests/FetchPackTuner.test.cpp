@@ -0,0 +1,81 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/app/misc/FetchPackTuner.h>
+#include <beast/unit_test/suite.h>
+#include <beast/chrono/manual_clock.h>
+
+namespace ripple {
+
+class FetchPackTuner_test : public beast::unit_test::suite
+{
+public:
+    void run ()
+    {
+        std::size_t const megabyte = 1024 * 1024;
+
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        FetchPackTuner tuner (clock);
+
+        expect (tuner.getBudget (1) == FetchPackTuner::defaultBudget);
+
+        // Peer 1 takes a megabyte in half a second, so it can take more
+        tuner.sent (1, megabyte);
+        clock.advance (std::chrono::milliseconds (500));
+        expect (tuner.getBudget (1) == 2 * megabyte, "Growth is limited");
+        tuner.sent (1, 2 * megabyte);
+        clock.advance (std::chrono::milliseconds (500));
+        expect (tuner.getBudget (1) == 4 * megabyte);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            tuner.sent (1, tuner.getBudget (1));
+            clock.advance (std::chrono::milliseconds (100));
+        }
+        expect (tuner.getBudget (1) == FetchPackTuner::maxBudget);
+
+        // Peer 2 needs eight seconds for a megabyte
+        expect (tuner.getBudget (2) == FetchPackTuner::defaultBudget);
+        tuner.sent (2, megabyte);
+        clock.advance (std::chrono::seconds (8));
+        expect (tuner.getBudget (2) == (megabyte + megabyte / 4) / 2);
+
+        // A request that got no pack is not a measurement
+        expect (tuner.getBudget (2) == (megabyte + megabyte / 4) / 2);
+
+        for (int i = 0; i < 2; ++i)
+        {
+            tuner.sent (2, 64 * 1024);
+            clock.advance (std::chrono::seconds (20));
+            tuner.getBudget (2);
+        }
+        expect (tuner.getBudget (2) == FetchPackTuner::minBudget);
+
+        // Peers that stop asking start over
+        clock.advance (std::chrono::seconds (31));
+        tuner.sweep ();
+        expect (tuner.getBudget (1) == FetchPackTuner::defaultBudget);
+        expect (tuner.getBudget (2) == FetchPackTuner::defaultBudget);
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(FetchPackTuner,ripple_app,ripple);
+
+}
@@ -0,0 +1,135 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/app/misc/FetchPackWriter.h>
+#include <beast/unit_test/suite.h>
+#include <beast/chrono/manual_clock.h>
+#include <vector>
+
+namespace ripple {
+
+class FetchPackWriter_test : public beast::unit_test::suite
+{
+public:
+    typedef std::vector <protocol::TMGetObjectByHash> Chunks;
+
+    static protocol::TMGetObjectByHash makeRequest ()
+    {
+        protocol::TMGetObjectByHash request;
+        request.set_type (protocol::TMGetObjectByHash::otFETCH_PACK);
+        request.set_query (true);
+        request.set_seq (7);
+        request.set_ledgerhash (std::string (32, 'L'));
+        return request;
+    }
+
+    static FetchPackWriter::Send collect (Chunks& chunks)
+    {
+        return [&chunks] (protocol::TMGetObjectByHash const& chunk)
+        {
+            chunks.push_back (chunk);
+        };
+    }
+
+    void testChunks ()
+    {
+        testcase ("chunks");
+
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        Chunks chunks;
+        FetchPackWriter pack (makeRequest (), 100000, 1000, clock,
+            std::chrono::seconds (1), collect (chunks));
+
+        Blob const data (300, 0x5a);
+        for (int i = 0; i < 10; ++i)
+            expect (pack.add (100 + i / 5, uint256 (i + 1), data));
+
+        // Every fourth object fills a chunk
+        expect (chunks.size () == 2);
+        pack.flush ();
+        pack.flush ();
+        expect (chunks.size () == 3, "Only pending objects are flushed");
+        expect (pack.getChunks () == 3);
+        expect (pack.getObjects () == 10);
+        expect (pack.getBytes () == 3000);
+
+        int objects = 0;
+        bool copied = true;
+        for (auto const& chunk : chunks)
+        {
+            objects += chunk.objects_size ();
+            copied = copied && ! chunk.query () && chunk.seq () == 7 &&
+                (chunk.type () == protocol::TMGetObjectByHash::otFETCH_PACK) &&
+                    (chunk.ledgerhash () == std::string (32, 'L'));
+        }
+        expect (objects == 10);
+        expect (copied, "Every chunk answers the request");
+
+        auto const& last = chunks.back ().objects (1);
+        expect (last.ledgerseq () == 101);
+        expect (last.data ().size () == 300);
+        expect (uint256::fromVoid (last.hash ().data ()) == uint256 (10));
+    }
+
+    void testLimits ()
+    {
+        testcase ("limits");
+
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        Blob const data (100, 0x5a);
+
+        {
+            Chunks chunks;
+            FetchPackWriter pack (makeRequest (), 250, 1000, clock,
+                std::chrono::seconds (1), collect (chunks));
+
+            expect (pack.add (1, uint256 (1), data));
+            expect (pack.add (1, uint256 (2), data));
+            expect (! pack.add (1, uint256 (3), data), "Budget spent");
+            expect (pack.full ());
+            expect (! pack.add (1, uint256 (4), data));
+            expect (pack.getObjects () == 3);
+        }
+
+        {
+            Chunks chunks;
+            FetchPackWriter pack (makeRequest (), 100000, 1000, clock,
+                std::chrono::milliseconds (500), collect (chunks));
+
+            expect (pack.add (1, uint256 (1), data));
+            clock.advance (std::chrono::milliseconds (500));
+            expect (pack.full (), "Out of time");
+            expect (! pack.add (1, uint256 (2), data));
+
+            pack.flush ();
+            expect (chunks.size () == 1 && chunks[0].objects_size () == 1);
+        }
+    }
+
+    void run ()
+    {
+        testChunks ();
+        testLimits ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(FetchPackWriter,ripple_app,ripple);
+
+}
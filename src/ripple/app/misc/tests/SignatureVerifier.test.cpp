@@ -0,0 +1,204 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/app/misc/SignatureVerifier.h>
+#include <beast/insight/NullCollector.h>
+#include <beast/unit_test/suite.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace ripple {
+
+class SignatureVerifier_test : public beast::unit_test::suite
+{
+public:
+    class Root : public beast::RootStoppable
+    {
+    public:
+        Root ()
+            : RootStoppable ("SignatureVerifierTest")
+        {
+        }
+    };
+
+    // Collects the verdicts delivered to the handlers
+    class Verdicts
+    {
+    public:
+        explicit Verdicts (std::size_t count)
+            : m_verdicts (count, -1)
+            , m_pending (count)
+        {
+        }
+
+        SignatureVerifier::Handler handler (std::size_t i)
+        {
+            return [this, i] (bool good)
+            {
+                std::lock_guard <std::mutex> lock (m_mutex);
+                if (m_verdicts[i] == -1)
+                    --m_pending;
+                m_verdicts[i] = good ? 1 : 0;
+                m_done.notify_all ();
+            };
+        }
+
+        bool wait ()
+        {
+            std::unique_lock <std::mutex> lock (m_mutex);
+            return m_done.wait_for (lock, std::chrono::seconds (30),
+                [this] { return m_pending == 0; });
+        }
+
+        int operator[] (std::size_t i)
+        {
+            std::lock_guard <std::mutex> lock (m_mutex);
+            return m_verdicts[i];
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_done;
+        std::vector <int> m_verdicts;   // -1 until the handler is called
+        std::size_t m_pending;
+    };
+
+    static uint256 makeId (std::size_t i)
+    {
+        return uint256 (i + 1);
+    }
+
+    static bool isGood (std::size_t i)
+    {
+        return (i % 5) != 0;
+    }
+
+    void testInline ()
+    {
+        testcase ("not running");
+
+        Root root;
+        std::unique_ptr <IHashRouter> router (IHashRouter::New (
+            IHashRouter::getDefaultHoldTime ()));
+        auto verifier = make_SignatureVerifier (root, *router, 2,
+            beast::insight::NullCollector::New (), beast::Journal ());
+
+        int checks = 0;
+        Verdicts verdicts (3);
+
+        expect (verifier->verify (makeId (0),
+            [&checks] { ++checks; return true; }, verdicts.handler (0)));
+        expect (verdicts[0] == 1, "Verdict delivered before returning");
+        expect (router->getFlags (makeId (0)) & SF_SIGGOOD);
+
+        expect (verifier->verify (makeId (0),
+            [&checks] { ++checks; return false; }, verdicts.handler (1)));
+        expect (verdicts[1] == 1, "Known verdict reused");
+        expect (checks == 1, "Known verdict not checked again");
+
+        verifier->verify (makeId (1),
+            [] () -> bool { throw std::runtime_error ("malformed"); },
+                verdicts.handler (2));
+        expect (verdicts[2] == 0, "Throwing check is bad");
+        expect (router->getFlags (makeId (1)) & SF_BAD);
+    }
+
+    void testThreads ()
+    {
+        testcase ("threads");
+
+        std::size_t const count = 2000;
+
+        Root root;
+        std::unique_ptr <IHashRouter> router (IHashRouter::New (
+            IHashRouter::getDefaultHoldTime ()));
+        auto verifier = make_SignatureVerifier (root, *router, 4,
+            beast::insight::NullCollector::New (), beast::Journal ());
+        root.start ();
+
+        std::atomic <int> checks (0);
+
+        {
+            Verdicts verdicts (count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                expect (verifier->verify (makeId (i), [i, &checks]
+                    {
+                        ++checks;
+                        return isGood (i);
+                    }, verdicts.handler (i)));
+            }
+
+            expect (verdicts.wait (), "All verdicts delivered");
+
+            bool allRight = true;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                int const flags = router->getFlags (makeId (i));
+                if (isGood (i))
+                    allRight = allRight && verdicts[i] == 1 &&
+                        (flags & SF_SIGGOOD) && ! (flags & SF_BAD);
+                else
+                    allRight = allRight && verdicts[i] == 0 &&
+                        (flags & SF_BAD) && ! (flags & SF_SIGGOOD);
+            }
+            expect (allRight, "Verdicts match and are recorded");
+            expect (checks == count, "Each message checked once");
+        }
+
+        {
+            // Copies relayed by other peers are not checked again
+            Verdicts verdicts (count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                verifier->verify (makeId (i), [&checks]
+                    {
+                        ++checks;
+                        return false;
+                    }, verdicts.handler (i));
+            }
+
+            expect (verdicts.wait (), "All known verdicts delivered");
+
+            bool allRight = true;
+            for (std::size_t i = 0; i < count; ++i)
+                allRight = allRight && verdicts[i] == (isGood (i) ? 1 : 0);
+            expect (allRight, "Known verdicts reused");
+            expect (checks == count, "Known verdicts not checked again");
+        }
+
+        root.stop ();
+        expect (verifier->getQueueSize () == 0);
+    }
+
+    void run ()
+    {
+        testInline ();
+        testThreads ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SignatureVerifier,ripple_app,ripple);
+
+}
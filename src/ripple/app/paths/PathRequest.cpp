@@ -106,6 +106,12 @@ bool PathRequest::isNew ()
     return mLastIndex == 0;
 }
 
+LedgerIndex PathRequest::getLastIndex ()
+{
+    ScopedLockType sl (mIndexLock);
+    return mLastIndex;
+}
+
 bool PathRequest::needsUpdate (bool newOnly, LedgerIndex index)
 {
     ScopedLockType sl (mIndexLock);
@@ -127,6 +133,7 @@ bool PathRequest::needsUpdate (bool newOnly, LedgerIndex index)
         return false;
     }
 
+    mLastIndex = index;
     mInProgress = true;
     return true;
 }
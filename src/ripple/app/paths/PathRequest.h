@@ -61,6 +61,7 @@ public:
 
     bool        isValid ();
     bool        isNew ();
+    LedgerIndex getLastIndex ();
     bool        needsUpdate (bool newOnly, LedgerIndex index);
     void        updateComplete ();
     Json::Value getStatus ();
@@ -19,11 +19,14 @@
 
 #include <BeastConfig.h>
 #include <ripple/app/paths/PathRequests.h>
+#include <ripple/app/paths/Tuning.h>
 #include <ripple/app/ledger/LedgerMaster.h>
 #include <ripple/app/main/Application.h>
 #include <ripple/core/JobQueue.h>
+#include <ripple/core/ParallelFor.h>
 #include <ripple/resource/Fees.h>
-#include <boost/foreach.hpp>
+#include <algorithm>
+#include <chrono>
 
 namespace ripple {
 
@@ -43,7 +46,24 @@ RippleLineCache::pointer PathRequests::getLineCache (Ledger::pointer& ledger, bo
          (lgrSeq > (lineSeq + 8)))                         // we jumped way forward for some reason
     {
         ledger = std::make_shared<Ledger>(*ledger, false); // Take a snapshot of the ledger
-        mLineCache = std::make_shared<RippleLineCache> (ledger);
+
+        if (mLineCache)
+            mLineCache = std::make_shared<RippleLineCache> (ledger, *mLineCache);
+        else
+            mLineCache = std::make_shared<RippleLineCache> (ledger);
+
+        mJournal.debug << "Line cache for " << lgrSeq << " carried " <<
+            mLineCache->getCarried () << " accounts forward";
+
+        if (mLineCache->needsPrewarm ())
+        {
+            RippleLineCache::pointer cache = mLineCache;
+            getApp().getJobQueue().addJob (jtUPDATE_PF, "RippleLineCache::prewarm",
+                [cache] (Job&)
+                {
+                    cache->prewarm ();
+                });
+        }
     }
     else
     {
@@ -69,75 +89,67 @@ void PathRequests::updateAll (Ledger::ref inLedger,
     }
 
     bool newRequests = getApp().getLedgerMaster().isNewPathRequest();
-    bool mustBreak = false;
+    std::atomic<bool> mustBreak (false);
+    std::atomic<bool> superseded (false);
 
     mJournal.trace << "updateAll seq=" << ledger->getLedgerSeq() << ", " <<
         requests.size() << " requests";
-    int processed = 0, removed = 0;
+    std::atomic<int> processed (0), removed (0);
 
     do
     {
-        BOOST_FOREACH (PathRequest::wref wRequest, requests)
+        // Requests that have never been answered go first, then the ones
+        // answered longest ago.
+        std::vector<std::pair<LedgerIndex, PathRequest::pointer>> work;
+        work.reserve (requests.size ());
+        for (auto const& wRequest : requests)
         {
-            if (shouldCancel())
-                break;
-
-            bool remove = true;
             PathRequest::pointer pRequest = wRequest.lock ();
-
-            if (pRequest)
+            work.emplace_back (pRequest ? pRequest->getLastIndex () : 0, pRequest);
+        }
+        std::stable_sort (work.begin (), work.end (),
+            [](std::pair<LedgerIndex, PathRequest::pointer> const& lhs,
+                std::pair<LedgerIndex, PathRequest::pointer> const& rhs)
             {
-                if (!pRequest->needsUpdate (newRequests, ledger->getLedgerSeq ()))
-                    remove = false;
-                else
-                {
-                    InfoSub::pointer ipSub = pRequest->getSubscriber ();
-                    if (ipSub)
-                    {
-                        ipSub->getConsumer ().charge (Resource::feePathFindUpdate);
-                        if (!ipSub->getConsumer ().warn ())
-                        {
-                            Json::Value update = pRequest->doUpdate (cache, false);
-                            pRequest->updateComplete ();
-                            update["type"] = "path_find";
-                            ipSub->send (update, false);
-                            remove = false;
-                            ++processed;
-                        }
-                    }
-                }
-            }
+                return lhs.first < rhs.first;
+            });
+
+        parallelFor (work.size (), [&](std::size_t i)
+        {
+            if (mustBreak || superseded || shouldCancel())
+                return;
 
-            if (remove)
+            // A newer validated ledger makes this pass pointless. The
+            // requests not yet updated are answered from that one.
+            if (getApp().getLedgerMaster().getValidLedgerIndex () >
+                ledger->getLedgerSeq ())
             {
-                PathRequest::pointer pRequest = wRequest.lock ();
+                superseded = true;
+                return;
+            }
 
-                ScopedLockType sl (mLock);
+            if (!updateRequest (work[i].second, ledger, cache,
+                    newRequests, processed))
+                removed += removeRequest (work[i].second);
 
-                // Remove any dangling weak pointers or weak pointers that refer to this path request.
-                std::vector<PathRequest::wptr>::iterator it = mRequests.begin();
-                while (it != mRequests.end())
-                {
-                    PathRequest::pointer itRequest = it->lock ();
-                    if (!itRequest || (itRequest == pRequest))
-                    {
-                        ++removed;
-                        it = mRequests.erase (it);
-                    }
-                    else
-                        ++it;
-                }
+            if (!newRequests && getApp().getLedgerMaster().isNewPathRequest())
+            {
+                // We weren't handling new requests and then there was a new request
+                mustBreak = true;
             }
+        }, PATHFINDER_UPDATE_THREADS);
 
-            mustBreak = !newRequests && getApp().getLedgerMaster().isNewPathRequest();
-            if (mustBreak) // We weren't handling new requests and then there was a new request
-                break;
-
+        if (superseded)
+        {
+            mJournal.debug << "updateAll seq=" << ledger->getLedgerSeq() <<
+                " superseded by a newer ledger";
+            break;
         }
 
         if (mustBreak)
         { // a new request came in while we were working
             newRequests = true;
+            mustBreak = false;
         }
         else if (newRequests)
         { // we only did new requests, so we always need a last pass
@@ -147,7 +159,7 @@ void PathRequests::updateAll (Ledger::ref inLedger,
         { // check if there are any new requests, otherwise we are done
             newRequests = getApp().getLedgerMaster().isNewPathRequest();
             if (!newRequests) // We did a full pass and there are no new requests
-                return;
+                break;
         }
 
         {
@@ -168,6 +180,58 @@ void PathRequests::updateAll (Ledger::ref inLedger,
         removed << " removed";
 }
 
+bool PathRequests::updateRequest (PathRequest::ref pRequest,
+    Ledger::ref ledger, RippleLineCache::ref cache, bool newOnly,
+        std::atomic<int>& processed)
+{
+    if (!pRequest)
+        return false;
+
+    if (!pRequest->needsUpdate (newOnly, ledger->getLedgerSeq ()))
+        return true;
+
+    InfoSub::pointer ipSub = pRequest->getSubscriber ();
+    if (!ipSub)
+        return false;
+
+    ipSub->getConsumer ().charge (Resource::feePathFindUpdate);
+    if (ipSub->getConsumer ().warn ())
+        return false;
+
+    auto const start = std::chrono::steady_clock::now ();
+    Json::Value update = pRequest->doUpdate (cache, false);
+    pRequest->updateComplete ();
+    mUpdate.notify (std::chrono::duration_cast<std::chrono::milliseconds> (
+        std::chrono::steady_clock::now () - start));
+
+    update["type"] = "path_find";
+    ipSub->send (update, false);
+    ++processed;
+    return true;
+}
+
+int PathRequests::removeRequest (PathRequest::ref pRequest)
+{
+    int removed = 0;
+
+    ScopedLockType sl (mLock);
+
+    // Remove any dangling weak pointers or weak pointers that refer to this path request.
+    std::vector<PathRequest::wptr>::iterator it = mRequests.begin();
+    while (it != mRequests.end())
+    {
+        PathRequest::pointer itRequest = it->lock ();
+        if (!itRequest || (itRequest == pRequest))
+        {
+            ++removed;
+            it = mRequests.erase (it);
+        }
+        else
+            ++it;
+    }
+    return removed;
+}
+
 Json::Value PathRequests::makePathRequest(
     std::shared_ptr <InfoSub> const& subscriber,
     const std::shared_ptr<Ledger>& inLedger,
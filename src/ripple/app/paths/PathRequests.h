@@ -36,6 +36,7 @@ public:
     {
         mFast = collector->make_event ("pathfind_fast");
         mFull = collector->make_event ("pathfind_full");
+        mUpdate = collector->make_event ("pathfind_update");
     }
 
     void updateAll (const std::shared_ptr<Ledger>& ledger,
@@ -60,11 +61,21 @@ public:
     }
 
 private:
+    // Returns false if the request should be removed
+    bool updateRequest (PathRequest::ref, Ledger::ref,
+        RippleLineCache::ref, bool newOnly, std::atomic<int>& processed);
+
+    // Returns the number of requests removed
+    int removeRequest (PathRequest::ref);
+
     beast::Journal                   mJournal;
 
     beast::insight::Event            mFast;
     beast::insight::Event            mFull;
 
+    // Time taken to update one request
+    beast::insight::Event            mUpdate;
+
     // Track all requests
     std::vector<PathRequest::wptr>   mRequests;
 
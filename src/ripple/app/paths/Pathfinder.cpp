@@ -25,8 +25,12 @@
 #include <ripple/app/paths/RippleLineCache.h>
 #include <ripple/app/ledger/OrderBookDB.h>
 #include <ripple/basics/Log.h>
+#include <ripple/basics/seconds_clock.h>
+#include <ripple/basics/TaggedCache.h>
 #include <ripple/json/to_string.h>
 #include <ripple/core/JobQueue.h>
+#include <atomic>
+#include <chrono>
 #include <tuple>
 
 /*
@@ -132,6 +136,35 @@ typedef std::vector<PathCost> PathCostList;
 
 static PathTable mPathTable;
 
+// The complete paths found by one search
+struct CachedPaths
+{
+    STPathSet paths;
+    LedgerIndex seq;                    // the ledger searched
+    std::chrono::milliseconds cost;     // how long the search took
+};
+
+static TaggedCache <uint256, CachedPaths> sPathCache (
+    "PathCache", 4096, 60, get_seconds_clock (),
+        deprecatedLogs().journal("TaggedCache"));
+
+static std::atomic <std::uint64_t> sPathCacheHits (0);
+static std::atomic <std::uint64_t> sPathCacheMisses (0);
+static std::atomic <std::uint64_t> sPathCacheSaved (0);
+
+// The power of ten of an amount. Payments of a similar size share
+// cached paths.
+static int getMagnitude (STAmount const& amount)
+{
+    if (!amount.native ())
+        return amount.exponent () + 15; // the mantissa has 16 digits
+
+    int magnitude = 0;
+    for (auto value = amount.mantissa (); value >= 10; value /= 10)
+        ++magnitude;
+    return magnitude;
+}
+
 std::string pathTypeToString (Pathfinder::PathType const& type)
 {
     std::string ret;
@@ -322,6 +355,30 @@ bool Pathfinder::findPaths (int searchLevel)
         paymentType = pt_nonXRP_to_nonXRP;
     }
 
+    uint256 const cacheKey = getCacheKey (searchLevel);
+    LedgerIndex const seq = mLedger->getLedgerSeq ();
+
+    if (auto cached = sPathCache.fetch (cacheKey))
+    {
+        LedgerIndex const age = (seq > cached->seq) ?
+            (seq - cached->seq) : (cached->seq - seq);
+
+        if (age <= PATHFINDER_CACHE_MAX_AGE)
+        {
+            mCompletePaths = cached->paths;
+            ++sPathCacheHits;
+            sPathCacheSaved += cached->cost.count ();
+
+            WriteLog (lsDEBUG, Pathfinder)
+                    << mCompletePaths.size () << " complete paths from ledger "
+                    << cached->seq;
+            return true;
+        }
+    }
+
+    ++sPathCacheMisses;
+    auto const start = std::chrono::steady_clock::now ();
+
     // Now iterate over all paths for that paymentType.
     for (auto const& costedPath : mPathTable[paymentType])
     {
@@ -340,11 +397,50 @@ bool Pathfinder::findPaths (int searchLevel)
     WriteLog (lsDEBUG, Pathfinder)
             << mCompletePaths.size () << " complete paths found";
 
+    auto cached = std::make_shared <CachedPaths> ();
+    cached->paths = mCompletePaths;
+    cached->seq = seq;
+    cached->cost = std::chrono::duration_cast <std::chrono::milliseconds> (
+        std::chrono::steady_clock::now () - start);
+    sPathCache.canonicalize (cacheKey, cached, true);
+
     // Even if we find no paths, default paths may work, and we don't check them
     // currently.
     return true;
 }
 
+uint256 Pathfinder::getCacheKey (int searchLevel) const
+{
+    Serializer s (128);
+    s.add160 (mSrcAccount);
+    s.add160 (mSrcCurrency);
+    s.add8 (mSrcIssuer ? 1 : 0);
+    s.add160 (mSrcIssuer ? *mSrcIssuer : Account ());
+    s.add160 (mDstAccount);
+    s.add160 (mDstAmount.getCurrency ());
+    s.add160 (mDstAmount.getIssuer ());
+    s.add32 (static_cast <std::uint32_t> (getMagnitude (mDstAmount)));
+    s.add32 (static_cast <std::uint32_t> (searchLevel));
+    return s.getSHA512Half ();
+}
+
+void Pathfinder::sweepCache ()
+{
+    sPathCache.sweep ();
+}
+
+float Pathfinder::getCacheHitRate ()
+{
+    std::uint64_t const hits = sPathCacheHits;
+    std::uint64_t const total = hits + sPathCacheMisses;
+    return (total == 0) ? 0 : (hits * 100.0f) / total;
+}
+
+std::uint64_t Pathfinder::getCacheSavedTime ()
+{
+    return sPathCacheSaved;
+}
+
 TER Pathfinder::getPathLiquidity (
     STPath const& path,            // IN:  The path to check.
     STAmount const& minDstAmount,  // IN:  The minimum output this path must
@@ -58,6 +58,22 @@ public:
 
     static void initPathTable ();
 
+    /** Discard cached paths that have not been used recently. */
+    static void sweepCache ();
+
+    /** The percentage of searches answered with paths found earlier,
+        from 0 to 100 like the other hit rates in get_counts.
+    */
+    static float getCacheHitRate ();
+
+    /** The search time the path cache saved, in milliseconds. */
+    static std::uint64_t getCacheSavedTime ();
+
+    /** Find the complete paths.
+        The paths found for the same payment within
+        PATHFINDER_CACHE_MAX_AGE ledgers are reused instead of searching
+        again. computePathRanks checks them against this ledger.
+    */
     bool findPaths (int searchLevel);
 
     /** Compute the rankings of the paths. */
@@ -137,6 +153,9 @@ private:
     // Add all paths of one type to mCompletePaths.
     STPathSet& addPathsForType (PathType const& type);
 
+    // Identifies searches that find the same paths.
+    uint256 getCacheKey (int searchLevel) const;
+
     bool issueMatchesOrigin (Issue const&);
 
     int getPathsOut (
@@ -19,27 +19,129 @@
 
 #include <BeastConfig.h>
 #include <ripple/app/paths/RippleLineCache.h>
+#include <ripple/app/ledger/AcceptedLedger.h>
+#include <algorithm>
 
 namespace ripple {
 
 RippleLineCache::RippleLineCache (Ledger::ref l)
     : mLedger (l)
+    , mCarried (0)
+    , mReplaced (false)
 {
 }
 
+RippleLineCache::RippleLineCache (Ledger::ref l, RippleLineCache& previous)
+    : mLedger (l)
+    , mCarried (0)
+    , mReplaced (false)
+{
+    previous.mReplaced = true;
+
+    Ledger::ref prior = previous.getLedger ();
+
+    // Only a closed ledger has metadata saying what changed
+    if (!prior->isClosed () || !mLedger->isClosed () ||
+        (mLedger->getLedgerSeq () != (prior->getLedgerSeq () + 1)) ||
+        (mLedger->getParentHash () != prior->getHash ()))
+        return;
+
+    hash_set <Account> touched;
+    auto const accepted = AcceptedLedger::makeAcceptedLedger (mLedger);
+    for (auto const& item : accepted->getMap ())
+    {
+        for (auto const& account : item.second->getAffected ())
+            touched.insert (account.getAccountID ());
+    }
+
+    std::vector <std::pair <std::size_t, Account>> busy;
+
+    for (auto& shard : previous.mShards)
+    {
+        ScopedLockType sl (shard.mLock);
+
+        for (auto const& item : shard.mRLMap)
+        {
+            // Lines nobody asked for in the previous ledger are dropped
+            if (item.second.uses == 0)
+                continue;
+
+            Account const& account = item.first.account_;
+
+            if (touched.count (account) != 0)
+            {
+                busy.emplace_back (item.second.uses, account);
+                continue;
+            }
+
+            AccountKey key (account, hasher_ (account));
+            Shard& ours = getShard (key);
+            ScopedLockType sl2 (ours.mLock);
+            ours.mRLMap.emplace (key, Entry {item.second.lines, 0});
+            ++mCarried;
+        }
+    }
+
+    std::size_t const count = std::min (busy.size (),
+        static_cast <std::size_t> (LINE_CACHE_PREWARM_MAX));
+    std::partial_sort (busy.begin (), busy.begin () + count, busy.end (),
+        [](std::pair <std::size_t, Account> const& lhs,
+            std::pair <std::size_t, Account> const& rhs)
+        {
+            return lhs.first > rhs.first;
+        });
+
+    mPrewarm.reserve (count);
+    for (std::size_t i = 0; i < count; ++i)
+        mPrewarm.push_back (busy[i].second);
+}
+
 RippleLineCache::RippleStateVector const&
 RippleLineCache::getRippleLines (Account const& accountID)
+{
+    return fetch (accountID, true);
+}
+
+void RippleLineCache::prewarm ()
+{
+    for (auto const& account : mPrewarm)
+    {
+        if (mReplaced)
+            return;
+
+        fetch (account, false);
+    }
+}
+
+RippleLineCache::RippleStateVector const&
+RippleLineCache::fetch (Account const& accountID, bool used)
 {
     AccountKey key (accountID, hasher_ (accountID));
+    Shard& shard = getShard (key);
+
+    {
+        ScopedLockType sl (shard.mLock);
 
-    ScopedLockType sl (mLock);
+        auto it = shard.mRLMap.find (key);
+        if (it != shard.mRLMap.end ())
+        {
+            if (used)
+                ++it->second.uses;
+            return *it->second.lines;
+        }
+    }
 
-    auto it = mRLMap.emplace (key, RippleStateVector ());
+    // Walk the account's directory without holding the lock. If another
+    // thread stores the lines first, theirs are kept.
+    auto lines = std::make_shared <RippleStateVector const> (
+        ripple::getRippleStateItems (accountID, mLedger));
 
-    if (it.second)
-        it.first->second = ripple::getRippleStateItems (accountID, mLedger);
+    ScopedLockType sl (shard.mLock);
 
-    return it.first->second;
+    auto it = shard.mRLMap.emplace (key, Entry {lines, 0}).first;
+    if (used)
+        ++it->second.uses;
+    return *it->second.lines;
 }
 
 } // ripple
@@ -21,7 +21,10 @@
 #define RIPPLE_RIPPLELINECACHE_H
 
 #include <ripple/app/paths/RippleState.h>
+#include <ripple/app/paths/Tuning.h>
 #include <ripple/basics/hardened_hash.h>
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <memory>
 #include <vector>
@@ -38,6 +41,15 @@ public:
 
     explicit RippleLineCache (Ledger::ref l);
 
+    /** Create a cache for the ledger that follows the previous cache's.
+        The lines of accounts that were used in the previous cache and
+        that the ledger did not touch are carried forward. The touched
+        ones are listed for prewarm. If the ledger does not follow the
+        previous cache's, the cache starts empty. Either way the previous
+        cache stops prewarming.
+    */
+    RippleLineCache (Ledger::ref l, RippleLineCache& previous);
+
     Ledger::ref getLedger () // VFALCO TODO const?
     {
         return mLedger;
@@ -46,10 +58,24 @@ public:
     std::vector<RippleState::pointer> const&
     getRippleLines (Account const& accountID);
 
+    /** Load the lines of the busiest accounts the ledger touched.
+        Returns early if a newer cache replaced this one.
+    */
+    void prewarm ();
+
+    bool needsPrewarm () const
+    {
+        return !mPrewarm.empty ();
+    }
+
+    std::size_t getCarried () const
+    {
+        return mCarried;
+    }
+
 private:
-    typedef RippleMutex LockType;
-    typedef std::lock_guard <LockType> ScopedLockType;
-    LockType mLock;
+    std::vector<RippleState::pointer> const&
+    fetch (Account const& accountID, bool used);
 
     ripple::hardened_hash<> hasher_;
     Ledger::pointer mLedger;
@@ -90,7 +116,37 @@ private:
         };
     };
 
-    hash_map <AccountKey, RippleStateVector, AccountKey::Hash> mRLMap;
+    // Vectors are shared with the caches of later ledgers, so they are
+    // never changed once stored.
+    struct Entry
+    {
+        std::shared_ptr <RippleStateVector const> lines;
+
+        // path finding requests for the lines in this ledger
+        std::size_t uses;
+    };
+
+    typedef RippleMutex LockType;
+    typedef std::lock_guard <LockType> ScopedLockType;
+
+    // Accounts are spread over the shards by hash so that concurrent
+    // path finding jobs rarely wait on each other.
+    struct Shard
+    {
+        LockType mLock;
+        hash_map <AccountKey, Entry, AccountKey::Hash> mRLMap;
+    };
+
+    Shard& getShard (AccountKey const& key)
+    {
+        return mShards[key.get_hash () % mShards.size ()];
+    }
+
+    std::array <Shard, LINE_CACHE_SHARDS> mShards;
+
+    std::vector <Account> mPrewarm;
+    std::size_t mCarried;
+    std::atomic <bool> mReplaced;
 };
 
 } // ripple
@@ -28,6 +28,10 @@ int const PATHFINDER_HIGH_PRIORITY = 100000;
 int const PATHFINDER_MAX_PATHS = 50;
 int const PATHFINDER_MAX_COMPLETE_PATHS = 1000;
 int const PATHFINDER_MAX_PATHS_FROM_SOURCE = 10;
+int const PATHFINDER_UPDATE_THREADS = 4;
+int const PATHFINDER_CACHE_MAX_AGE = 4;
+int const LINE_CACHE_SHARDS = 16;
+int const LINE_CACHE_PREWARM_MAX = 256;
 
 } // ripple
 
@@ -0,0 +1,280 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/app/peers/AcquireScheduler.h>
+#include <algorithm>
+#include <utility>
+
+namespace ripple {
+
+// The subtree of the root a node belongs to, or -1 for the root itself
+static int subtreeOf (SHAMapNodeID const& node)
+{
+    if (node.getDepth () == 0)
+        return -1;
+
+    return node.getNodeID ().begin ()[0] >> 4;
+}
+
+AcquireScheduler::PeerState::PeerState ()
+    : latency (0)
+    , nodesPerReply (0)
+    , nodes (0)
+    , bytes (0)
+    , timeouts (0)
+{
+}
+
+AcquireScheduler::AcquireScheduler (clock_type& clock, int maxInFlight,
+        int maxNodesPerRequest, clock_type::duration timeout)
+    : m_clock (clock)
+    , m_maxInFlight (std::max (1, maxInFlight))
+    , m_maxNodesPerRequest (std::max (1, maxNodesPerRequest))
+    , m_timeout (timeout)
+    , m_nodeRate (clock.now ())
+    , m_byteRate (clock.now ())
+    , m_totalNodes (0)
+    , m_totalBytes (0)
+{
+}
+
+double AcquireScheduler::score (PeerState const& state)
+{
+    if (state.latency <= 0)
+        return -1;
+
+    return (state.nodesPerReply * 1000 / state.latency) /
+        (1 + state.timeouts);
+}
+
+std::size_t AcquireScheduler::freeSlots (id_t peer) const
+{
+    auto const it = m_peers.find (peer);
+
+    if (it == m_peers.end ())
+        return m_maxInFlight;
+
+    std::size_t const limit = m_maxInFlight;
+    std::size_t const used = it->second.outstanding.size ();
+    return (used < limit) ? (limit - used) : 0;
+}
+
+std::size_t AcquireScheduler::getCapacity (std::vector <id_t> const& peers) const
+{
+    std::size_t slots = 0;
+
+    for (auto const peer : peers)
+        slots += freeSlots (peer);
+
+    return slots * m_maxNodesPerRequest;
+}
+
+std::vector <AcquireScheduler::Request>
+AcquireScheduler::assign (std::vector <SHAMapNodeID> const& nodes,
+    std::vector <id_t> const& peers)
+{
+    std::vector <Request> requests;
+
+    // Peers with free slots, unscored ones first and then the best first
+    std::vector <std::pair <double, id_t>> ranked;
+    for (auto const peer : peers)
+    {
+        if (freeSlots (peer) == 0)
+            continue;
+
+        auto const it = m_peers.find (peer);
+        ranked.emplace_back (
+            (it == m_peers.end ()) ? -1 : score (it->second), peer);
+    }
+
+    if (ranked.empty () || nodes.empty ())
+        return requests;
+
+    std::stable_sort (ranked.begin (), ranked.end (),
+        [] (std::pair <double, id_t> const& a, std::pair <double, id_t> const& b)
+        {
+            if ((a.first < 0) != (b.first < 0))
+                return a.first < 0;
+            return a.first > b.first;
+        });
+
+    // Keep the nodes of each subtree next to each other so that
+    // consecutive chunks, and so different peers, cover different subtrees
+    std::vector <SHAMapNodeID> ordered (nodes);
+    std::stable_sort (ordered.begin (), ordered.end (),
+        [] (SHAMapNodeID const& a, SHAMapNodeID const& b)
+        {
+            return subtreeOf (a) < subtreeOf (b);
+        });
+
+    // A small frontier is still spread across the peers
+    std::size_t const chunk = std::max <std::size_t> (1, std::min <std::size_t> (
+        m_maxNodesPerRequest,
+        (ordered.size () + ranked.size () - 1) / ranked.size ()));
+
+    std::vector <std::size_t> slots;
+    slots.reserve (ranked.size ());
+    for (auto const& peer : ranked)
+        slots.push_back (freeSlots (peer.second));
+
+    auto next = ordered.cbegin ();
+    bool assigned = true;
+
+    while ((next != ordered.cend ()) && assigned)
+    {
+        assigned = false;
+
+        for (std::size_t i = 0;
+            (i < ranked.size ()) && (next != ordered.cend ()); ++i)
+        {
+            if (slots[i] == 0)
+                continue;
+
+            std::size_t const count = std::min <std::size_t> (
+                chunk, ordered.cend () - next);
+
+            Request request;
+            request.peer = ranked[i].second;
+            request.nodes.assign (next, next + count);
+            requests.push_back (std::move (request));
+
+            next += count;
+            --slots[i];
+            assigned = true;
+        }
+    }
+
+    auto const now = m_clock.now ();
+    for (auto const& request : requests)
+        m_peers[request.peer].outstanding.push_back (now);
+
+    return requests;
+}
+
+void AcquireScheduler::onReply (id_t peer, std::size_t nodes, std::size_t bytes)
+{
+    auto const now = m_clock.now ();
+    PeerState& state = m_peers[peer];
+
+    // A late reply to a request we gave up on would score the peer
+    // against a newer request
+    expire (state, now - m_timeout);
+
+    if (!state.outstanding.empty ())
+    {
+        double const latency = std::max (1.0, static_cast <double> (
+            std::chrono::duration_cast <std::chrono::milliseconds> (
+                now - state.outstanding.front ()).count ()));
+        state.outstanding.pop_front ();
+
+        if (state.latency <= 0)
+        {
+            state.latency = latency;
+            state.nodesPerReply = nodes;
+        }
+        else
+        {
+            state.latency = state.latency * 0.75 + latency * 0.25;
+            state.nodesPerReply = state.nodesPerReply * 0.75 + nodes * 0.25;
+        }
+
+        if (state.timeouts > 0)
+            --state.timeouts;
+    }
+
+    state.nodes += nodes;
+    state.bytes += bytes;
+
+    m_nodeRate.add (nodes, now);
+    m_byteRate.add (bytes, now);
+    m_totalNodes += nodes;
+    m_totalBytes += bytes;
+}
+
+void AcquireScheduler::expire (PeerState& state, time_point cutoff)
+{
+    auto& outstanding = state.outstanding;
+
+    if (outstanding.empty () || (outstanding.front () > cutoff))
+        return;
+
+    while (!outstanding.empty () && (outstanding.front () <= cutoff))
+        outstanding.pop_front ();
+
+    ++state.timeouts;
+}
+
+void AcquireScheduler::expire ()
+{
+    auto const cutoff = m_clock.now () - m_timeout;
+
+    for (auto& peer : m_peers)
+        expire (peer.second, cutoff);
+}
+
+void AcquireScheduler::removePeer (id_t peer)
+{
+    m_peers.erase (peer);
+}
+
+std::size_t AcquireScheduler::getInFlight () const
+{
+    std::size_t ret = 0;
+
+    for (auto const& peer : m_peers)
+        ret += peer.second.outstanding.size ();
+
+    return ret;
+}
+
+Json::Value AcquireScheduler::getJson ()
+{
+    auto const now = m_clock.now ();
+    Json::Value ret (Json::objectValue);
+
+    ret["nodes_per_second"] = static_cast <Json::UInt> (m_nodeRate.value (now));
+    ret["bytes_per_second"] = static_cast <Json::UInt> (m_byteRate.value (now));
+    ret["nodes"] = static_cast <Json::UInt> (m_totalNodes);
+    ret["bytes"] = static_cast <Json::UInt> (m_totalBytes);
+    ret["in_flight"] = static_cast <Json::UInt> (getInFlight ());
+
+    Json::Value& peers = (ret["peers"] = Json::arrayValue);
+    for (auto const& peer : m_peers)
+    {
+        Json::Value& entry = peers.append (Json::objectValue);
+        entry["id"] = peer.first;
+        entry["in_flight"] = static_cast <Json::UInt> (
+            peer.second.outstanding.size ());
+        entry["nodes"] = static_cast <Json::UInt> (peer.second.nodes);
+
+        if (peer.second.latency > 0)
+        {
+            entry["latency_ms"] = static_cast <Json::UInt> (peer.second.latency);
+            entry["score"] = score (peer.second);
+        }
+
+        if (peer.second.timeouts != 0)
+            entry["timeouts"] = peer.second.timeouts;
+    }
+
+    return ret;
+}
+
+} // ripple
@@ -0,0 +1,140 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_ACQUIRESCHEDULER_H_INCLUDED
+#define RIPPLE_ACQUIRESCHEDULER_H_INCLUDED
+
+#include <ripple/basics/DecayingSample.h>
+#include <ripple/json/json_value.h>
+#include <ripple/overlay/Peer.h>
+#include <ripple/shamap/SHAMapNodeID.h>
+#include <beast/chrono/abstract_clock.h>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace ripple {
+
+/** Decides which peers to ask for which missing tree nodes.
+
+    The missing nodes are grouped by the subtree of the root they belong
+    to, so each peer is asked for whole subtrees and different peers work
+    on different parts of the tree. Every peer may have a fixed number of
+    requests in flight; the next request is sent as soon as a reply frees
+    a slot instead of waiting for all peers to answer.
+
+    Peers are scored by the nodes they deliver per second of observed
+    latency. Better peers are offered work first, and since they answer
+    sooner they also get their slots back sooner. Peers we have not heard
+    from yet are tried before scored ones.
+
+    Replies cannot be matched to requests by a cookie, so each reply from
+    a peer answers its oldest outstanding request. Requests older than the
+    timeout are dropped first, as a timeout of the peer, so a reply is
+    never scored against a request that was already given up on. A reply
+    that finds no request left is counted but not scored.
+
+    Thread safety:
+        Not thread safe. The owner serializes all calls.
+*/
+class AcquireScheduler
+{
+public:
+    typedef beast::abstract_clock <std::chrono::steady_clock> clock_type;
+    typedef Peer::id_t id_t;
+
+    /** Nodes to ask one peer for in one message. */
+    struct Request
+    {
+        id_t peer;
+        std::vector <SHAMapNodeID> nodes;
+    };
+
+    AcquireScheduler (clock_type& clock, int maxInFlight,
+        int maxNodesPerRequest, clock_type::duration timeout);
+
+    /** The number of nodes the given peers can be asked for right now. */
+    std::size_t getCapacity (std::vector <id_t> const& peers) const;
+
+    /** Split nodes between peers and record the requests as sent.
+        Nodes that do not fit in the peers' free slots are left out.
+    */
+    std::vector <Request> assign (std::vector <SHAMapNodeID> const& nodes,
+        std::vector <id_t> const& peers);
+
+    /** A peer answered with the given number of nodes. */
+    void onReply (id_t peer, std::size_t nodes, std::size_t bytes);
+
+    /** Forget requests sent longer ago than the timeout.
+        Peers that let a request expire are scored lower.
+    */
+    void expire ();
+
+    /** Forget everything about a peer. */
+    void removePeer (id_t peer);
+
+    /** The number of requests that have not been answered yet. */
+    std::size_t getInFlight () const;
+
+    Json::Value getJson ();
+
+private:
+    typedef clock_type::time_point time_point;
+
+    struct PeerState
+    {
+        PeerState ();
+
+        // Send times of unanswered requests, oldest first
+        std::deque <time_point> outstanding;
+
+        // Moving averages, zero until the first reply
+        double latency;         // milliseconds
+        double nodesPerReply;
+
+        std::uint64_t nodes;
+        std::uint64_t bytes;
+        int timeouts;
+    };
+
+    // Expected nodes per second, or a negative number if unknown
+    static double score (PeerState const& state);
+
+    std::size_t freeSlots (id_t peer) const;
+
+    // Drop the peer's requests sent at or before cutoff
+    static void expire (PeerState& state, time_point cutoff);
+
+    clock_type& m_clock;
+    int const m_maxInFlight;
+    int const m_maxNodesPerRequest;
+    clock_type::duration const m_timeout;
+
+    std::map <id_t, PeerState> m_peers;
+
+    DecayWindow <10, clock_type> m_nodeRate;
+    DecayWindow <10, clock_type> m_byteRate;
+    std::uint64_t m_totalNodes;
+    std::uint64_t m_totalBytes;
+};
+
+} // ripple
+
+#endif
@@ -0,0 +1,221 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/app/peers/AcquireScheduler.h>
+#include <beast/unit_test/suite.h>
+#include <beast/chrono/manual_clock.h>
+#include <set>
+
+namespace ripple {
+
+class AcquireScheduler_test : public beast::unit_test::suite
+{
+public:
+    typedef AcquireScheduler::id_t id_t;
+
+    static std::chrono::seconds timeout ()
+    {
+        return std::chrono::seconds (2);
+    }
+
+    // Up to 64 nodes at depth 2, four in each subtree of the root
+    static std::vector <SHAMapNodeID> makeNodes (int count)
+    {
+        std::vector <SHAMapNodeID> nodes;
+
+        for (int i = 0; i < count; ++i)
+        {
+            uint256 id;
+            id.begin ()[0] = static_cast <unsigned char> (
+                (((i / 4) % 16) << 4) | (i % 4));
+            nodes.push_back (SHAMapNodeID (2, id));
+        }
+
+        return nodes;
+    }
+
+    static std::size_t countNodes (
+        std::vector <AcquireScheduler::Request> const& requests)
+    {
+        std::size_t ret = 0;
+        for (auto const& request : requests)
+            ret += request.nodes.size ();
+        return ret;
+    }
+
+    void testAssign ()
+    {
+        testcase ("assign");
+
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        AcquireScheduler scheduler (clock, 2, 4, timeout ());
+        std::vector <id_t> const peers { 1, 2, 3 };
+
+        expect (scheduler.getCapacity (peers) == 24);
+
+        auto const requests = scheduler.assign (makeNodes (48), peers);
+        expect (requests.size () == 6, "Every free slot is used");
+        expect (countNodes (requests) == 24);
+        expect (scheduler.getInFlight () == 6);
+        expect (scheduler.getCapacity (peers) == 0);
+
+        bool grouped = true;
+        std::set <SHAMapNodeID> seen;
+        std::map <id_t, int> perPeer;
+        for (auto const& request : requests)
+        {
+            ++perPeer[request.peer];
+            expect (request.nodes.size () == 4);
+
+            // Each request covers a single subtree
+            int const subtree = request.nodes.front ().getNodeID ().begin ()[0] >> 4;
+            for (auto const& node : request.nodes)
+            {
+                grouped = grouped &&
+                    ((node.getNodeID ().begin ()[0] >> 4) == subtree);
+                expect (seen.insert (node).second, "No node is sent twice");
+            }
+        }
+        expect (grouped, "Requests keep subtrees together");
+        expect (perPeer.size () == 3 && perPeer[1] == 2 &&
+            perPeer[2] == 2 && perPeer[3] == 2, "Work is spread");
+
+        expect (scheduler.assign (makeNodes (4), peers).empty (),
+            "Nothing is sent past the limit");
+
+        // A reply frees a slot
+        scheduler.onReply (2, 4, 400);
+        expect (scheduler.getInFlight () == 5);
+        auto const more = scheduler.assign (makeNodes (48), peers);
+        expect (more.size () == 1 && more.front ().peer == 2);
+
+        // A small frontier is still split between the peers
+        AcquireScheduler fresh (clock, 2, 128, timeout ());
+        auto const small = fresh.assign (makeNodes (9), peers);
+        expect (small.size () == 3 && countNodes (small) == 9);
+    }
+
+    void testScore ()
+    {
+        testcase ("score");
+
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        AcquireScheduler scheduler (clock, 2, 8, timeout ());
+        std::vector <id_t> const peers { 1, 2, 3 };
+
+        expect (scheduler.assign (makeNodes (24), peers).size () == 3);
+
+        clock.advance (std::chrono::milliseconds (100));
+        scheduler.onReply (2, 8, 800);
+        clock.advance (std::chrono::milliseconds (900));
+        scheduler.onReply (1, 8, 800);
+        scheduler.onReply (3, 8, 800);
+
+        auto requests = scheduler.assign (makeNodes (3), { 3, 1, 2 });
+        expect (requests.size () == 3 && requests.front ().peer == 2,
+            "The fastest peer is asked first");
+
+        // A peer we have not heard from is tried before scored ones
+        requests = scheduler.assign (makeNodes (3), { 1, 3, 4 });
+        expect (requests.size () == 3 && requests.front ().peer == 4);
+
+        Json::Value const json = scheduler.getJson ();
+        expect (json["nodes"].asUInt () == 24);
+        expect (json["bytes"].asUInt () == 2400);
+        expect (json["nodes_per_second"].asUInt () > 0);
+        expect (json["peers"].size () == 4);
+    }
+
+    void testExpire ()
+    {
+        testcase ("expire");
+
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        AcquireScheduler scheduler (clock, 2, 4, timeout ());
+        std::vector <id_t> const peers { 1, 2 };
+
+        scheduler.assign (makeNodes (16), peers);
+        expect (scheduler.getInFlight () == 4);
+
+        clock.advance (std::chrono::seconds (1));
+        scheduler.expire ();
+        expect (scheduler.getInFlight () == 4, "Recent requests are kept");
+
+        clock.advance (std::chrono::seconds (2));
+        scheduler.expire ();
+        expect (scheduler.getInFlight () == 0, "Old requests are dropped");
+        expect (scheduler.getCapacity (peers) == 16);
+
+        Json::Value const json = scheduler.getJson ();
+        expect (json["peers"][0u]["timeouts"].asInt () == 1);
+
+        // A late reply drops the requests that timed out instead of
+        // being scored against a newer one
+        expect (scheduler.assign (makeNodes (4), { 1 }).size () == 1);
+        clock.advance (std::chrono::seconds (2));
+        expect (scheduler.assign (makeNodes (4), { 1 }).size () == 1);
+        clock.advance (std::chrono::milliseconds (100));
+        scheduler.onReply (1, 4, 400);
+        expect (scheduler.getInFlight () == 0);
+        expect (scheduler.getJson ()["peers"][0u]["latency_ms"].asUInt () == 100);
+        expect (scheduler.getJson ()["peers"][0u]["timeouts"].asInt () == 1);
+
+        // A reply that finds no request is counted but not scored
+        scheduler.onReply (2, 4, 400);
+        expect (scheduler.getJson ()["peers"][1u]["nodes"].asUInt () == 4);
+        expect (! scheduler.getJson ()["peers"][1u].isMember ("latency_ms"));
+
+        scheduler.removePeer (1);
+        expect (scheduler.getJson ()["peers"].size () == 1);
+    }
+
+    void testRate ()
+    {
+        testcase ("rate");
+
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        AcquireScheduler scheduler (clock, 2, 4, timeout ());
+
+        // Replies come several times a second while fetching
+        for (int i = 0; i < 120; ++i)
+        {
+            clock.advance (std::chrono::milliseconds (500));
+            scheduler.onReply (1 + i % 2, 100, 10000);
+        }
+
+        Json::Value const json = scheduler.getJson ();
+        expect (json["nodes_per_second"].asUInt () >= 190 &&
+            json["nodes_per_second"].asUInt () <= 215, "Steady node rate");
+        expect (json["bytes_per_second"].asUInt () >= 19000 &&
+            json["bytes_per_second"].asUInt () <= 21500, "Steady byte rate");
+    }
+
+    void run ()
+    {
+        testAssign ();
+        testScore ();
+        testExpire ();
+        testRate ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(AcquireScheduler,ripple_app,ripple);
+
+}
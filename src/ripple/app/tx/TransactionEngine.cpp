@@ -79,7 +79,7 @@ void TransactionEngine::txnWrite ()
     }
 }
 
-TER TransactionEngine::applyTransaction (
+TER TransactionEngine::applyToView (
     STTx const& txn,
     TransactionEngineParams params,
     bool& didApply)
@@ -206,44 +206,63 @@ TER TransactionEngine::applyTransaction (
             didApply = false;
             terResult = tefINTERNAL;
         }
-        else
-        {
-            // Transaction succeeded fully or (retries are not allowed and the
-            // transaction could claim a fee)
-            Serializer m;
-            mNodes.calcRawMeta (m, terResult, mTxnSeq++);
+    }
 
-            txnWrite ();
+    return terResult;
+}
 
-            Serializer s;
-            txn.add (s);
+void TransactionEngine::commitView (
+    STTx const& txn,
+    TER terResult,
+    TransactionEngineParams params)
+{
+    uint256 const& txID = txn.getTransactionID ();
 
-            if (params & tapOPEN_LEDGER)
-            {
-                if (!mLedger->addTransaction (txID, s))
-                {
-                    WriteLog (lsFATAL, TransactionEngine) <<
-                        "Tried to add transaction to open ledger that already had it";
-                    assert (false);
-                    throw std::runtime_error ("Duplicate transaction applied");
-                }
-            }
-            else
-            {
-                if (!mLedger->addTransaction (txID, s, m))
-                {
-                    WriteLog (lsFATAL, TransactionEngine) <<
-                        "Tried to add transaction to ledger that already had it";
-                    assert (false);
-                    throw std::runtime_error ("Duplicate transaction applied to closed ledger");
-                }
+    // Transaction succeeded fully or (retries are not allowed and the
+    // transaction could claim a fee)
+    Serializer m;
+    mNodes.calcRawMeta (m, terResult, mTxnSeq++);
 
-                // Charge whatever fee they specified.
-                STAmount saPaid = txn.getTransactionFee ();
-                mLedger->destroyCoins (saPaid.getNValue ());
-            }
+    txnWrite ();
+
+    Serializer s;
+    txn.add (s);
+
+    if (params & tapOPEN_LEDGER)
+    {
+        if (!mLedger->addTransaction (txID, s))
+        {
+            WriteLog (lsFATAL, TransactionEngine) <<
+                "Tried to add transaction to open ledger that already had it";
+            assert (false);
+            throw std::runtime_error ("Duplicate transaction applied");
+        }
+    }
+    else
+    {
+        if (!mLedger->addTransaction (txID, s, m))
+        {
+            WriteLog (lsFATAL, TransactionEngine) <<
+                "Tried to add transaction to ledger that already had it";
+            assert (false);
+            throw std::runtime_error ("Duplicate transaction applied to closed ledger");
         }
+
+        // Charge whatever fee they specified.
+        STAmount saPaid = txn.getTransactionFee ();
+        mLedger->destroyCoins (saPaid.getNValue ());
     }
+}
+
+TER TransactionEngine::applyTransaction (
+    STTx const& txn,
+    TransactionEngineParams params,
+    bool& didApply)
+{
+    TER terResult = applyToView (txn, params, didApply);
+
+    if (didApply)
+        commitView (txn, terResult, params);
 
     mTxnAccount.reset ();
     mNodes.clear ();
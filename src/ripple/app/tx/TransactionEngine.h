@@ -99,6 +99,13 @@ public:
     }
 
     TER applyTransaction (const STTx&, TransactionEngineParams, bool & didApply);
+
+    /** Apply a transaction to view () without changing the ledger.
+        If didApply is set, commitView writes the view to the ledger.
+        Either way the caller clears the view before the next transaction.
+    */
+    TER applyToView (const STTx&, TransactionEngineParams, bool & didApply);
+    void commitView (const STTx&, TER, TransactionEngineParams);
     bool checkInvariants (TER result, const STTx & txn, TransactionEngineParams params);
 };
 
@@ -159,6 +159,14 @@ public:
             m_serverHandler.send (ptr, sObj, broadcast);
     }
 
+    void send (Publications const& messages, bool broadcast)
+    {
+        connection_ptr ptr = m_connection.lock ();
+
+        if (ptr)
+            m_serverHandler.send (ptr, messages, broadcast);
+    }
+
     void disconnect ()
     {
         connection_ptr ptr = m_connection.lock ();
@@ -133,6 +133,27 @@ public:
         }
     }
 
+    static void ssendbatch (connection_ptr cpClient,
+                            InfoSub::Publications const& messages,
+                            bool broadcast)
+    {
+        try
+        {
+            for (auto const& message : messages)
+            {
+                WriteLog (broadcast ? lsTRACE : lsDEBUG, WSServerHandlerLog)
+                        << "Ws:: Sending '" << message->text << "'";
+
+                cpClient->send (message->text);
+            }
+        }
+        catch (...)
+        {
+            cpClient->close (websocketpp_02::close::status::value (crTooSlow),
+                             std::string ("Client is too slow."));
+        }
+    }
+
     void send (connection_ptr cpClient, message_ptr mpMessage)
     {
         cpClient->get_strand ().post (
@@ -155,6 +176,16 @@ public:
         send (cpClient, to_string (jvObj), broadcast);
     }
 
+    // The messages are shared with the other subscribers, not copied
+    void send (connection_ptr cpClient, InfoSub::Publications const& messages,
+               bool broadcast)
+    {
+        cpClient->get_strand ().post (
+            std::bind (
+                &WSServerHandler<endpoint_type>::ssendbatch, cpClient,
+                messages, broadcast));
+    }
+
     void pingTimer (connection_ptr cpClient)
     {
         wsc_ptr ptr;
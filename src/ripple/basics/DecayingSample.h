@@ -21,7 +21,8 @@
 #define RIPPLE_BASICS_DECAYINGSAMPLE_H_INCLUDED
 
 #include <chrono>
-    
+#include <cmath>
+
 namespace ripple {
 
 /** Sampling function using exponential decay to provide a continuous value.
@@ -100,6 +101,62 @@ private:
     time_point m_when;
 };
 
+//------------------------------------------------------------------------------
+
+/** Rate of events using continuous exponential decay.
+
+    Unlike DecayingSample, samples may arrive any number of times a second:
+    the value decays by the exact time elapsed. A steady rate is reported
+    as itself.
+
+    @tparam Window The time constant of the decay, in seconds.
+*/
+template <int Window, typename Clock>
+class DecayWindow
+{
+public:
+    typedef typename Clock::time_point time_point;
+
+    DecayWindow () = delete;
+
+    explicit DecayWindow (time_point now)
+        : m_value (0)
+        , m_when (now)
+    {
+    }
+
+    /** Add a new sample. */
+    void add (double value, time_point now)
+    {
+        decay (now);
+        m_value += value;
+    }
+
+    /** Retrieve the rate per second. */
+    double value (time_point now)
+    {
+        decay (now);
+        return m_value / Window;
+    }
+
+private:
+    static_assert (Window > 0, "Window must be positive");
+
+    void decay (time_point now)
+    {
+        if (now <= m_when)
+            return;
+
+        double const elapsed = std::chrono::duration_cast <
+            std::chrono::duration <double>> (now - m_when).count ();
+        m_value *= std::exp (-elapsed / Window);
+        m_when = now;
+    }
+
+    double m_value;
+    time_point m_when;
+};
+
 }
 
 #endif
@@ -0,0 +1,625 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_BASICS_SHARDEDTAGGEDCACHE_H_INCLUDED
+#define RIPPLE_BASICS_SHARDEDTAGGEDCACHE_H_INCLUDED
+
+#include <ripple/basics/hardened_hash.h>
+#include <ripple/basics/UnorderedContainers.h>
+#include <beast/chrono/abstract_clock.h>
+#include <beast/chrono/chrono_io.h>
+#include <beast/Insight.h>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace ripple {
+
+/** A TaggedCache split into independently locked shards.
+
+    Behaves like TaggedCache, but a key's shard is picked from its hash and
+    each shard has its own lock, map, sweep and hit/miss counters, so
+    threads working on different keys rarely wait for each other.
+
+    A fetch of an object that is strongly cached only takes its shard's
+    lock shared. Everything that changes a shard's map, including a fetch
+    that finds only a weak reference, takes the lock exclusively.
+
+    There is no lock over the whole cache, so callers that need several
+    operations to be atomic must use TaggedCache instead.
+
+    @note Callers must not modify data objects that are stored in the cache.
+*/
+template <
+    class Key,
+    class T,
+    class Hash = hardened_hash <>,
+    class KeyEqual = std::equal_to <Key>,
+    std::size_t Shards = 16
+>
+class ShardedTaggedCache
+{
+public:
+    typedef Key key_type;
+    typedef T mapped_type;
+    typedef std::weak_ptr <mapped_type> weak_mapped_ptr;
+    typedef std::shared_ptr <mapped_type> mapped_ptr;
+    typedef beast::abstract_clock <std::chrono::steady_clock> clock_type;
+
+public:
+    ShardedTaggedCache (std::string const& name, int size,
+        clock_type::rep expiration_seconds, clock_type& clock, beast::Journal journal,
+            beast::insight::Collector::ptr const& collector = beast::insight::NullCollector::New ())
+        : m_journal (journal)
+        , m_clock (clock)
+        , m_stats (name,
+            std::bind (&ShardedTaggedCache::collect_metrics, this),
+                collector)
+        , m_name (name)
+        , m_target_size (size)
+        , m_target_age (std::chrono::seconds (expiration_seconds).count ())
+    {
+    }
+
+public:
+    /** Return the clock associated with the cache. */
+    clock_type& clock ()
+    {
+        return m_clock;
+    }
+
+    int getTargetSize () const
+    {
+        return m_target_size;
+    }
+
+    void setTargetSize (int s)
+    {
+        m_target_size = s;
+
+        if (s > 0)
+        {
+            int const perShard = s / Shards + 1;
+
+            for (auto& shard : m_shards)
+            {
+                unique_lock lock (shard.mutex);
+                shard.cache.rehash (static_cast<std::size_t> (
+                    (perShard + (perShard >> 2)) / shard.cache.max_load_factor () + 1));
+            }
+        }
+
+        if (m_journal.debug) m_journal.debug <<
+            m_name << " target size set to " << s;
+    }
+
+    clock_type::rep getTargetAge () const
+    {
+        return std::chrono::duration_cast <std::chrono::seconds> (
+            clock_type::duration (m_target_age.load ())).count ();
+    }
+
+    void setTargetAge (clock_type::rep s)
+    {
+        m_target_age = std::chrono::seconds (s).count ();
+        if (m_journal.debug) m_journal.debug <<
+            m_name << " target age set to " << clock_type::duration (m_target_age.load ());
+    }
+
+    int getCacheSize ()
+    {
+        int count = 0;
+        for (auto& shard : m_shards)
+        {
+            shared_lock lock (shard.mutex);
+            count += shard.cache_count;
+        }
+        return count;
+    }
+
+    int getTrackSize ()
+    {
+        int count = 0;
+        for (auto& shard : m_shards)
+        {
+            shared_lock lock (shard.mutex);
+            count += shard.cache.size ();
+        }
+        return count;
+    }
+
+    float getHitRate ()
+    {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        for (auto const& shard : m_shards)
+        {
+            hits += shard.hits;
+            misses += shard.misses;
+        }
+        auto const total = static_cast<float> (hits + misses);
+        return hits * (100.0f / std::max (1.0f, total));
+    }
+
+    /** Hits and misses of each shard, in shard order. */
+    std::vector <std::pair <std::uint64_t, std::uint64_t>> getShardStats () const
+    {
+        std::vector <std::pair <std::uint64_t, std::uint64_t>> v;
+        v.reserve (Shards);
+        for (auto const& shard : m_shards)
+            v.emplace_back (shard.hits.load (), shard.misses.load ());
+        return v;
+    }
+
+    void clearStats ()
+    {
+        for (auto& shard : m_shards)
+        {
+            shard.hits = 0;
+            shard.misses = 0;
+        }
+    }
+
+    void clear ()
+    {
+        for (auto& shard : m_shards)
+        {
+            unique_lock lock (shard.mutex);
+            shard.cache.clear ();
+            shard.cache_count = 0;
+        }
+    }
+
+    /** Sweep each shard in turn, holding only that shard's lock. */
+    void sweep ()
+    {
+        int cacheRemovals = 0;
+        int mapRemovals = 0;
+        int trackSize = 0;
+
+        int const targetSize = m_target_size;
+        int const shardTarget = (targetSize + Shards - 1) / Shards;
+        clock_type::duration const targetAge (m_target_age.load ());
+
+        for (auto& shard : m_shards)
+        {
+            // Keep references to all the stuff we sweep
+            // so that we can destroy them outside the lock.
+            std::vector <mapped_ptr> stuffToSweep;
+
+            {
+                clock_type::time_point const now (m_clock.now());
+                clock_type::time_point when_expire;
+
+                unique_lock lock (shard.mutex);
+
+                if (targetSize == 0 ||
+                    (static_cast<int> (shard.cache.size ()) <= shardTarget))
+                {
+                    when_expire = now - targetAge;
+                }
+                else
+                {
+                    when_expire = now - clock_type::duration (
+                        targetAge.count() * shardTarget / shard.cache.size ());
+
+                    clock_type::duration const minimumAge (
+                        std::chrono::seconds (1));
+                    if (when_expire > (now - minimumAge))
+                        when_expire = now - minimumAge;
+                }
+
+                stuffToSweep.reserve (shard.cache.size ());
+
+                cache_iterator cit = shard.cache.begin ();
+
+                while (cit != shard.cache.end ())
+                {
+                    if (cit->second.isWeak ())
+                    {
+                        // weak
+                        if (cit->second.isExpired ())
+                        {
+                            ++mapRemovals;
+                            cit = shard.cache.erase (cit);
+                        }
+                        else
+                        {
+                            ++cit;
+                        }
+                    }
+                    else if (cit->second.lastAccess () <= when_expire)
+                    {
+                        // strong, expired
+                        --shard.cache_count;
+                        ++cacheRemovals;
+                        if (cit->second.ptr.unique ())
+                        {
+                            stuffToSweep.push_back (cit->second.ptr);
+                            ++mapRemovals;
+                            cit = shard.cache.erase (cit);
+                        }
+                        else
+                        {
+                            // remains weakly cached
+                            cit->second.ptr.reset ();
+                            ++cit;
+                        }
+                    }
+                    else
+                    {
+                        // strong, not expired
+                        ++cit;
+                    }
+                }
+
+                trackSize += shard.cache.size ();
+            }
+        }
+
+        if (m_journal.trace && (mapRemovals || cacheRemovals)) m_journal.trace <<
+            m_name << ": cache = " << trackSize << "-" << cacheRemovals <<
+                ", map-=" << mapRemovals;
+    }
+
+    bool del (const key_type& key, bool valid)
+    {
+        // Remove from cache, if !valid, remove from map too. Returns true if removed from cache
+        Shard& shard = getShard (key);
+        unique_lock lock (shard.mutex);
+
+        cache_iterator cit = shard.cache.find (key);
+
+        if (cit == shard.cache.end ())
+            return false;
+
+        Entry& entry = cit->second;
+
+        bool ret = false;
+
+        if (entry.isCached ())
+        {
+            --shard.cache_count;
+            entry.ptr.reset ();
+            ret = true;
+        }
+
+        if (!valid || entry.isExpired ())
+            shard.cache.erase (cit);
+
+        return ret;
+    }
+
+    /** Replace aliased objects with originals.
+        @see TaggedCache::canonicalize
+    */
+    bool canonicalize (const key_type& key, std::shared_ptr<T>& data, bool replace = false)
+    {
+        // Return canonical value, store if needed, refresh in cache
+        // Return values: true=we had the data already
+        Shard& shard = getShard (key);
+        unique_lock lock (shard.mutex);
+
+        cache_iterator cit = shard.cache.find (key);
+
+        if (cit == shard.cache.end ())
+        {
+            shard.cache.emplace (std::piecewise_construct,
+                std::forward_as_tuple(key),
+                std::forward_as_tuple(m_clock.now(), data));
+            ++shard.cache_count;
+            return false;
+        }
+
+        Entry& entry = cit->second;
+        entry.touch (m_clock.now());
+
+        if (entry.isCached ())
+        {
+            if (replace)
+            {
+                entry.ptr = data;
+                entry.weak_ptr = data;
+            }
+            else
+            {
+                data = entry.ptr;
+            }
+
+            return true;
+        }
+
+        mapped_ptr cachedData = entry.lock ();
+
+        if (cachedData)
+        {
+            if (replace)
+            {
+                entry.ptr = data;
+                entry.weak_ptr = data;
+            }
+            else
+            {
+                entry.ptr = cachedData;
+                data = cachedData;
+            }
+
+            ++shard.cache_count;
+            return true;
+        }
+
+        entry.ptr = data;
+        entry.weak_ptr = data;
+        ++shard.cache_count;
+
+        return false;
+    }
+
+    std::shared_ptr<T> fetch (const key_type& key)
+    {
+        Shard& shard = getShard (key);
+
+        {
+            // Strong hits only read the map
+            shared_lock lock (shard.mutex);
+
+            cache_iterator cit = shard.cache.find (key);
+
+            if (cit == shard.cache.end ())
+            {
+                ++shard.misses;
+                return mapped_ptr ();
+            }
+
+            Entry& entry = cit->second;
+
+            if (entry.isCached ())
+            {
+                entry.touch (m_clock.now());
+                ++shard.hits;
+                return entry.ptr;
+            }
+        }
+
+        unique_lock lock (shard.mutex);
+
+        cache_iterator cit = shard.cache.find (key);
+
+        if (cit == shard.cache.end ())
+        {
+            ++shard.misses;
+            return mapped_ptr ();
+        }
+
+        Entry& entry = cit->second;
+        entry.touch (m_clock.now());
+
+        if (entry.isCached ())
+        {
+            ++shard.hits;
+            return entry.ptr;
+        }
+
+        entry.ptr = entry.lock ();
+
+        if (entry.isCached ())
+        {
+            // independent of cache size, so not counted as a hit
+            ++shard.cache_count;
+            return entry.ptr;
+        }
+
+        shard.cache.erase (cit);
+        ++shard.misses;
+        return mapped_ptr ();
+    }
+
+    /** Insert the element into the container.
+        If the key already exists, nothing happens.
+        @return `true` If the element was inserted
+    */
+    bool insert (key_type const& key, T const& value)
+    {
+        mapped_ptr p (std::make_shared <T> (
+            std::cref (value)));
+        return canonicalize (key, p);
+    }
+
+    bool retrieve (const key_type& key, T& data)
+    {
+        // retrieve the value of the stored data
+        mapped_ptr entry = fetch (key);
+
+        if (!entry)
+            return false;
+
+        data = *entry;
+        return true;
+    }
+
+    /** Refresh the expiration time on a key.
+
+        @param key The key to refresh.
+        @return `true` if the key was found and the object is cached.
+    */
+    bool refreshIfPresent (const key_type& key)
+    {
+        bool found = false;
+
+        // If present, make current in cache
+        Shard& shard = getShard (key);
+        unique_lock lock (shard.mutex);
+
+        cache_iterator cit = shard.cache.find (key);
+
+        if (cit != shard.cache.end ())
+        {
+            Entry& entry = cit->second;
+
+            if (! entry.isCached ())
+            {
+                // Convert weak to strong.
+                entry.ptr = entry.lock ();
+
+                if (entry.isCached ())
+                {
+                    // We just put the object back in cache
+                    ++shard.cache_count;
+                    entry.touch (m_clock.now());
+                    found = true;
+                }
+                else
+                {
+                    // Couldn't get strong pointer,
+                    // object fell out of the cache so remove the entry.
+                    shard.cache.erase (cit);
+                }
+            }
+            else
+            {
+                // It's cached so update the timer
+                entry.touch (m_clock.now());
+                found = true;
+            }
+        }
+
+        return found;
+    }
+
+    std::vector <key_type> getKeys ()
+    {
+        std::vector <key_type> v;
+
+        for (auto& shard : m_shards)
+        {
+            shared_lock lock (shard.mutex);
+            v.reserve (v.size () + shard.cache.size());
+            for (auto const& _ : shard.cache)
+                v.push_back (_.first);
+        }
+
+        return v;
+    }
+
+private:
+    typedef boost::shared_lock <boost::shared_mutex> shared_lock;
+    typedef boost::unique_lock <boost::shared_mutex> unique_lock;
+
+    void collect_metrics ()
+    {
+        m_stats.size.set (getCacheSize ());
+        m_stats.hit_rate.set (static_cast <beast::insight::Gauge::value_type> (
+            getHitRate ()));
+    }
+
+private:
+    struct Stats
+    {
+        template <class Handler>
+        Stats (std::string const& prefix, Handler const& handler,
+            beast::insight::Collector::ptr const& collector)
+            : hook (collector->make_hook (handler))
+            , size (collector->make_gauge (prefix, "size"))
+            , hit_rate (collector->make_gauge (prefix, "hit_rate"))
+            { }
+
+        beast::insight::Hook hook;
+        beast::insight::Gauge size;
+        beast::insight::Gauge hit_rate;
+    };
+
+    class Entry
+    {
+    public:
+        mapped_ptr ptr;
+        weak_mapped_ptr weak_ptr;
+
+        Entry (clock_type::time_point const& last_access_,
+            mapped_ptr const& ptr_)
+            : ptr (ptr_)
+            , weak_ptr (ptr_)
+            , last_access (last_access_.time_since_epoch ().count ())
+        {
+        }
+
+        bool isWeak () const { return ptr == nullptr; }
+        bool isCached () const { return ptr != nullptr; }
+        bool isExpired () const { return weak_ptr.expired (); }
+        mapped_ptr lock () { return weak_ptr.lock (); }
+
+        // May be called with the shard's lock held shared
+        void touch (clock_type::time_point const& now)
+        {
+            last_access.store (now.time_since_epoch ().count (),
+                std::memory_order_relaxed);
+        }
+
+        clock_type::time_point lastAccess () const
+        {
+            return clock_type::time_point (clock_type::duration (
+                last_access.load (std::memory_order_relaxed)));
+        }
+
+    private:
+        std::atomic <clock_type::rep> last_access;
+    };
+
+    typedef hardened_hash_map <key_type, Entry, Hash, KeyEqual> cache_type;
+    typedef typename cache_type::iterator cache_iterator;
+
+    struct Shard
+    {
+        boost::shared_mutex mutex;
+        cache_type cache;
+        int cache_count = 0;
+        std::atomic <std::uint64_t> hits {0};
+        std::atomic <std::uint64_t> misses {0};
+    };
+
+    Shard& getShard (key_type const& key)
+    {
+        // The map inside the shard hashes the key too, so the shard is
+        // picked from the high bits to keep the shard's buckets spread.
+        std::size_t const h = m_hash (key);
+        return m_shards[(h >> (8 * sizeof (std::size_t) - 8)) % Shards];
+    }
+
+    beast::Journal m_journal;
+    clock_type& m_clock;
+    Stats m_stats;
+
+    // Used for logging
+    std::string m_name;
+
+    // Desired number of cache entries across all shards (0 = ignore)
+    std::atomic <int> m_target_size;
+
+    // Desired maximum cache age, in clock ticks
+    std::atomic <clock_type::rep> m_target_age;
+
+    Hash m_hash;
+    std::array <Shard, Shards> m_shards;
+};
+
+}
+
+#endif
@@ -0,0 +1,74 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <ripple/basics/DecayingSample.h>
+#include <beast/unit_test/suite.h>
+#include <beast/chrono/manual_clock.h>
+
+namespace ripple {
+
+class DecayWindow_test : public beast::unit_test::suite
+{
+public:
+    typedef beast::manual_clock <std::chrono::steady_clock> clock_type;
+
+    // Feeds a steady 200 per second in samples the given interval apart
+    // and returns the rate seen after a minute
+    double steadyRate (std::chrono::milliseconds interval)
+    {
+        clock_type clock;
+        DecayWindow <10, clock_type> rate (clock.now ());
+
+        double const perSample = 200.0 * interval.count () / 1000;
+        for (auto elapsed = interval; elapsed <= std::chrono::seconds (60);
+            elapsed += interval)
+        {
+            clock.advance (interval);
+            rate.add (perSample, clock.now ());
+        }
+
+        return rate.value (clock.now ());
+    }
+
+    void run ()
+    {
+        for (int ms : { 50, 500, 1000, 2000 })
+        {
+            double const value = steadyRate (std::chrono::milliseconds (ms));
+            expect (value > 190 && value < 230, "Rate with samples " +
+                std::to_string (ms) + "ms apart is " + std::to_string (value));
+        }
+
+        // With no more samples the rate falls away
+        clock_type clock;
+        DecayWindow <10, clock_type> rate (clock.now ());
+        rate.add (1000, clock.now ());
+        expect (rate.value (clock.now ()) == 100);
+        clock.advance (std::chrono::seconds (10));
+        expect (rate.value (clock.now ()) < 37);
+        clock.advance (std::chrono::seconds (60));
+        expect (rate.value (clock.now ()) < 1);
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(DecayWindow,common,ripple);
+
+}
@@ -0,0 +1,321 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/basics/Blob.h>
+#include <ripple/basics/ShardedTaggedCache.h>
+#include <ripple/basics/TaggedCache.h>
+#include <ripple/basics/base_uint.h>
+#include <beast/chrono/manual_clock.h>
+#include <beast/module/core/text/LexicalCast.h>
+#include <beast/unit_test/suite.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace ripple {
+
+class ShardedTaggedCache_test : public beast::unit_test::suite
+{
+public:
+    typedef int Key;
+    typedef std::string Value;
+    typedef ShardedTaggedCache <Key, Value> Cache;
+
+    // The same checks as TaggedCache_test
+    void testBasics ()
+    {
+        testcase ("basics");
+
+        beast::Journal const j;
+
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        clock.set (0);
+
+        Cache c ("test", 1, 1, clock, j);
+
+        // Insert an item, retrieve it, and age it so it gets purged.
+        {
+            expect (c.getCacheSize() == 0);
+            expect (c.getTrackSize() == 0);
+            expect (! c.insert (1, "one"));
+            expect (c.getCacheSize() == 1);
+            expect (c.getTrackSize() == 1);
+
+            {
+                std::string s;
+                expect (c.retrieve (1, s));
+                expect (s == "one");
+            }
+
+            ++clock;
+            c.sweep ();
+            expect (c.getCacheSize () == 0);
+            expect (c.getTrackSize () == 0);
+        }
+
+        // Insert an item, maintain a strong pointer, age it, and
+        // verify that the entry still exists.
+        {
+            expect (! c.insert (2, "two"));
+            expect (c.getCacheSize() == 1);
+            expect (c.getTrackSize() == 1);
+
+            {
+                Cache::mapped_ptr p (c.fetch (2));
+                expect (p != nullptr);
+                ++clock;
+                c.sweep ();
+                expect (c.getCacheSize() == 0);
+                expect (c.getTrackSize() == 1);
+
+                // A fetch makes a weak entry strong again
+                expect (c.fetch (2) == p);
+                expect (c.getCacheSize() == 1);
+                ++clock;
+                c.sweep ();
+                expect (c.getCacheSize() == 0);
+            }
+
+            // Make sure its gone now that our reference is gone
+            ++clock;
+            c.sweep ();
+            expect (c.getCacheSize() == 0);
+            expect (c.getTrackSize() == 0);
+            expect (c.fetch (2) == nullptr);
+        }
+
+        // Put an object in but keep a strong pointer to it, advance the
+        // clock a lot, then canonicalize a new object with the same key,
+        // make sure you get the original object.
+        {
+            expect (! c.insert (4, "four"));
+
+            {
+                Cache::mapped_ptr p1 (c.fetch (4));
+                expect (p1 != nullptr);
+                ++clock;
+                c.sweep ();
+                expect (c.getCacheSize() == 0);
+                expect (c.getTrackSize() == 1);
+                Cache::mapped_ptr p2 (std::make_shared <std::string> ("four"));
+                expect (c.canonicalize (4, p2, false));
+                expect (c.getCacheSize() == 1);
+                expect (c.getTrackSize() == 1);
+                expect (p1.get() == p2.get());
+            }
+
+            ++clock;
+            c.sweep ();
+            expect (c.getCacheSize() == 0);
+            expect (c.getTrackSize() == 0);
+        }
+    }
+
+    void testShards ()
+    {
+        testcase ("shards");
+
+        beast::Journal const j;
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        clock.set (0);
+
+        Cache c ("test", 0, 10, clock, j);
+
+        int const count = 1000;
+        for (int i = 0; i < count; ++i)
+            expect (! c.insert (i, std::to_string (i)));
+
+        expect (c.getCacheSize () == count);
+        expect (c.getTrackSize () == count);
+        expect (c.getKeys ().size () == count);
+
+        for (int i = 0; i < count; ++i)
+        {
+            Cache::mapped_ptr p (c.fetch (i));
+            expect (p && *p == std::to_string (i));
+        }
+        expect (c.fetch (count) == nullptr);
+
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        int used = 0;
+        for (auto const& s : c.getShardStats ())
+        {
+            hits += s.first;
+            misses += s.second;
+            if (s.first != 0)
+                ++used;
+        }
+        expect (hits == count);
+        expect (misses == 1);
+        expect (used > 1, "keys not spread over shards");
+
+        expect (c.del (7, false));
+        expect (c.getTrackSize () == count - 1);
+
+        c.setTargetAge (1);
+        clock.set (5);
+        c.sweep ();
+        expect (c.getCacheSize () == 0);
+        expect (c.getTrackSize () == 0);
+    }
+
+    void testThreads ()
+    {
+        testcase ("threads");
+
+        beast::Journal const j;
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        clock.set (0);
+
+        Cache c ("test", 0, 10, clock, j);
+
+        // Every thread canonicalizes the same keys; all must end up
+        // holding the same objects.
+        int const count = 2000;
+        int const threads = 8;
+        std::vector <std::vector <Cache::mapped_ptr>> results (threads);
+        std::vector <std::thread> workers;
+
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back ([&c, &results, t, count]
+            {
+                auto& r = results[t];
+                for (int i = 0; i < count; ++i)
+                {
+                    Cache::mapped_ptr p (c.fetch (i));
+                    if (! p)
+                    {
+                        p = std::make_shared <Value> (std::to_string (i));
+                        c.canonicalize (i, p);
+                    }
+                    r.push_back (p);
+                }
+            });
+        }
+
+        for (auto& w : workers)
+            w.join ();
+
+        bool same = true;
+        for (int t = 1; t < threads; ++t)
+            for (int i = 0; i < count; ++i)
+                same = same && (results[t][i] == results[0][i]);
+
+        expect (same, "threads got different objects");
+        expect (c.getCacheSize () == count);
+    }
+
+    void run ()
+    {
+        testBasics ();
+        testShards ();
+        testThreads ();
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// Compares fetch throughput of TaggedCache and ShardedTaggedCache as the
+// number of threads grows. Pass the largest thread count as the argument,
+// the default is 32.
+class ShardedTaggedCacheTiming_test : public beast::unit_test::suite
+{
+public:
+    typedef std::chrono::steady_clock clock_type;
+
+    static int const keys = 100000;
+    static int const fetchesPerThread = 500000;
+
+    template <class Cache>
+    double run (Cache& cache, int threads)
+    {
+        std::atomic <int> found (0);
+        std::vector <std::thread> workers;
+
+        auto const start = clock_type::now ();
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back ([&cache, &found, t]
+            {
+                int n = 0;
+                unsigned int k = t * 7919;
+                for (int i = 0; i < fetchesPerThread; ++i)
+                {
+                    k = k * 1103515245 + 12345;
+                    if (cache.fetch (uint256 (k % keys)))
+                        ++n;
+                }
+                found += n;
+            });
+        }
+
+        for (auto& w : workers)
+            w.join ();
+        auto const elapsed = std::chrono::duration_cast <
+            std::chrono::microseconds> (clock_type::now () - start).count ();
+
+        expect (found == threads * fetchesPerThread);
+
+        // millions of fetches per second
+        return double (threads) * fetchesPerThread / std::max <long long> (elapsed, 1);
+    }
+
+    template <class Cache>
+    void fill (Cache& cache)
+    {
+        for (int i = 0; i < keys; ++i)
+        {
+            auto p = std::make_shared <Blob> (32, static_cast <unsigned char> (i));
+            cache.canonicalize (uint256 (i), p);
+        }
+    }
+
+    void run ()
+    {
+        int maxThreads = 32;
+        if (!arg().empty())
+            maxThreads = beast::lexicalCastThrow <int> (arg());
+
+        beast::Journal const j;
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        clock.set (0);
+
+        TaggedCache <uint256, Blob> single ("single", 0, 60, clock, j);
+        ShardedTaggedCache <uint256, Blob> sharded ("sharded", 0, 60, clock, j);
+        fill (single);
+        fill (sharded);
+
+        for (int threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            testcase (std::to_string (threads) + " threads");
+            double const a = run (single, threads);
+            double const b = run (sharded, threads);
+            log << threads << " threads: TaggedCache " << a <<
+                " M/s, ShardedTaggedCache " << b << " M/s";
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ShardedTaggedCache,common,ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(ShardedTaggedCacheTiming,common,ripple);
+
+}
@@ -307,6 +307,7 @@ public:
     std::uint32_t                      LEDGER_HISTORY;
     std::uint32_t                      LEDGER_HISTORY_INDEX;
     std::uint32_t                      FETCH_DEPTH;
+    int                                LEDGER_FETCH_REQUESTS;  // requests in flight per peer
     int                         NODE_SIZE;
 
     // Client behavior
@@ -45,6 +45,7 @@ struct ConfigSection
 #define SECTION_FETCH_DEPTH             "fetch_depth"
 #define SECTION_LEDGER_HISTORY          "ledger_history"
 #define SECTION_LEDGER_HISTORY_INDEX    "ledger_history_index"
+#define SECTION_LEDGER_FETCH_REQUESTS   "ledger_fetch_requests"
 #define SECTION_INSIGHT                 "insight"
 #define SECTION_IPS                     "ips"
 #define SECTION_IPS_FIXED               "ips_fixed"
@@ -65,7 +65,7 @@ public:
 
         // Received data for a ledger we're acquiring
         add (jtLEDGER_DATA,   "ledgerData",
-            2,        true,   false, 0,     0);
+            4,        true,   false, 0,     0);
 
         // Update pathfinding requests
         add (jtUPDATE_PF,     "updatePaths",
@@ -0,0 +1,56 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_CORE_PARALLELFOR_H_INCLUDED
+#define RIPPLE_CORE_PARALLELFOR_H_INCLUDED
+
+#include <cstddef>
+#include <functional>
+
+namespace ripple {
+
+/** Call f (i) for every i below count, on a shared pool of threads.
+
+    The pool is started once and shared by every caller, so all the
+    loops running at the same time together use at most its threads plus
+    their callers. The calling thread works through indexes too and the
+    call returns only after every f has returned, so f may refer to the
+    caller's locals. A loop always finishes, even when the pool is busy
+    or f itself calls parallelFor.
+
+    If f throws, the indexes not yet handed out are skipped and the first
+    exception is rethrown on the calling thread.
+
+    @param count      The number of indexes.
+    @param f          Called once for each index, on any of the threads.
+    @param maxThreads The most threads to use, counting the caller. Zero
+                      uses all of the pool.
+    @param grain      How many indexes a thread takes at a time. A loop of
+                      one grain or less runs on the calling thread.
+*/
+void parallelFor (std::size_t count,
+    std::function <void (std::size_t)> const& f,
+        std::size_t maxThreads = 0, std::size_t grain = 1);
+
+/** The most threads a call to parallelFor uses, counting the caller. */
+std::size_t parallelForThreads ();
+
+} // ripple
+
+#endif
@@ -261,6 +261,7 @@ Config::Config ()
     LEDGER_HISTORY          = 256;
     LEDGER_HISTORY_INDEX    = 0;
     FETCH_DEPTH             = 1000000000;
+    LEDGER_FETCH_REQUESTS   = 4;
 
     // An explanation of these magical values would be nice.
     PATH_SEARCH_OLD         = 7;
@@ -618,6 +619,14 @@ void Config::load ()
                     FETCH_DEPTH = 10;
             }
 
+            if (getSingleSection (secConfig, SECTION_LEDGER_FETCH_REQUESTS, strTemp))
+            {
+                LEDGER_FETCH_REQUESTS = beast::lexicalCastThrow <int> (strTemp);
+
+                if (LEDGER_FETCH_REQUESTS < 1)
+                    LEDGER_FETCH_REQUESTS = 1;
+            }
+
             if (getSingleSection (secConfig, SECTION_PATH_SEARCH_OLD, strTemp))
                 PATH_SEARCH_OLD     = beast::lexicalCastThrow <int> (strTemp);
             if (getSingleSection (secConfig, SECTION_PATH_SEARCH, strTemp))
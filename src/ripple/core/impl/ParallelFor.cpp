@@ -0,0 +1,213 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/core/ParallelFor.h>
+#include <beast/module/core/thread/Workers.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace ripple {
+
+namespace {
+
+// The indexes of one call to parallelFor. Pool threads that get to it
+// after the caller finished find it closed and leave without calling f.
+class Loop
+{
+public:
+    Loop (std::size_t count, std::size_t grain,
+            std::function <void (std::size_t)> const& f)
+        : m_count (count)
+        , m_grain (grain)
+        , m_f (f)
+        , m_next (0)
+        , m_closed (false)
+        , m_helpers (0)
+    {
+    }
+
+    // Called on a pool thread
+    void help ()
+    {
+        {
+            std::lock_guard <std::mutex> lock (m_mutex);
+
+            if (m_closed)
+                return;
+
+            ++m_helpers;
+        }
+
+        work ();
+
+        std::lock_guard <std::mutex> lock (m_mutex);
+
+        if (--m_helpers == 0)
+            m_cond.notify_all ();
+    }
+
+    // Called on the caller's thread
+    void run ()
+    {
+        work ();
+
+        std::unique_lock <std::mutex> lock (m_mutex);
+        m_closed = true;
+        m_cond.wait (lock, [this] { return m_helpers == 0; });
+
+        if (m_error)
+            std::rethrow_exception (m_error);
+    }
+
+private:
+    void work ()
+    {
+        for (std::size_t begin = m_next.fetch_add (m_grain); begin < m_count;
+            begin = m_next.fetch_add (m_grain))
+        {
+            std::size_t const end = std::min (begin + m_grain, m_count);
+
+            try
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                    m_f (i);
+            }
+            catch (...)
+            {
+                std::lock_guard <std::mutex> lock (m_mutex);
+
+                if (!m_error)
+                    m_error = std::current_exception ();
+
+                m_next = m_count;
+            }
+        }
+    }
+
+    std::size_t const m_count;
+    std::size_t const m_grain;
+    std::function <void (std::size_t)> const& m_f;
+    std::atomic <std::size_t> m_next;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_closed;
+    int m_helpers;
+    std::exception_ptr m_error;
+};
+
+//------------------------------------------------------------------------------
+
+class Pool : private beast::Workers::Callback
+{
+public:
+    Pool ()
+        : m_threads (std::min (16u,
+            std::max (1u, std::thread::hardware_concurrency ())))
+        , m_workers (*this, "Parallel", static_cast <int> (m_threads - 1))
+    {
+    }
+
+    std::size_t getThreads () const
+    {
+        return m_threads;
+    }
+
+    // Ask for the given number of pool threads to work on the loop
+    void add (std::shared_ptr <Loop> const& loop, std::size_t helpers)
+    {
+        {
+            std::lock_guard <std::mutex> lock (m_mutex);
+            m_loops.insert (m_loops.end (), helpers, loop);
+        }
+
+        for (std::size_t i = 0; i < helpers; ++i)
+            m_workers.addTask ();
+    }
+
+private:
+    void processTask () override
+    {
+        std::shared_ptr <Loop> loop;
+        {
+            std::lock_guard <std::mutex> lock (m_mutex);
+            loop = std::move (m_loops.front ());
+            m_loops.pop_front ();
+        }
+
+        loop->help ();
+    }
+
+    std::size_t const m_threads;
+    std::mutex m_mutex;
+    std::deque <std::shared_ptr <Loop>> m_loops;
+
+    // Last, so the threads stop before the rest goes away
+    beast::Workers m_workers;
+};
+
+Pool& getPool ()
+{
+    static Pool pool;
+    return pool;
+}
+
+}
+
+//------------------------------------------------------------------------------
+
+void parallelFor (std::size_t count,
+    std::function <void (std::size_t)> const& f,
+        std::size_t maxThreads, std::size_t grain)
+{
+    grain = std::max <std::size_t> (grain, 1);
+
+    Pool& pool = getPool ();
+    std::size_t threads = pool.getThreads ();
+
+    if (maxThreads != 0)
+        threads = std::min (threads, maxThreads);
+
+    threads = std::min (threads, (count + grain - 1) / grain);
+
+    if (threads < 2)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            f (i);
+        return;
+    }
+
+    auto const loop = std::make_shared <Loop> (count, grain, f);
+    pool.add (loop, threads - 1);
+    loop->run ();
+}
+
+std::size_t parallelForThreads ()
+{
+    return getPool ().getThreads ();
+}
+
+} // ripple
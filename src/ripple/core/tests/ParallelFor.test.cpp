@@ -0,0 +1,118 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/core/ParallelFor.h>
+#include <beast/unit_test/suite.h>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace ripple {
+
+class ParallelFor_test : public beast::unit_test::suite
+{
+public:
+    void testIndexes ()
+    {
+        testcase ("indexes");
+
+        std::size_t const count = 10000;
+
+        for (std::size_t grain : {1, 7, 256})
+        {
+            std::vector <std::atomic <int>> calls (count);
+            for (auto& c : calls)
+                c = 0;
+
+            parallelFor (count, [&calls] (std::size_t i)
+            {
+                ++calls[i];
+            }, 0, grain);
+
+            bool once = true;
+            for (auto const& c : calls)
+                once = once && (c == 1);
+            expect (once, "Every index is called once");
+        }
+
+        parallelFor (0, [this] (std::size_t)
+        {
+            fail ("No indexes");
+        });
+
+        auto const caller = std::this_thread::get_id ();
+        bool onCaller = true;
+        parallelFor (1000, [&] (std::size_t)
+        {
+            onCaller = onCaller && (std::this_thread::get_id () == caller);
+        }, 1);
+        expect (onCaller, "One thread is the caller's");
+    }
+
+    void testNested ()
+    {
+        testcase ("nested");
+
+        std::atomic <int> calls (0);
+        parallelFor (64, [&calls] (std::size_t)
+        {
+            parallelFor (64, [&calls] (std::size_t)
+            {
+                ++calls;
+            });
+        });
+        expect (calls == 64 * 64);
+    }
+
+    void testThrow ()
+    {
+        testcase ("throw");
+
+        std::atomic <int> calls (0);
+        try
+        {
+            parallelFor (100000, [&calls] (std::size_t i)
+            {
+                ++calls;
+                if (i == 10)
+                    throw std::runtime_error ("parallelFor");
+            });
+            fail ("Exception is rethrown");
+        }
+        catch (std::runtime_error const&)
+        {
+            pass ();
+        }
+        expect (calls < 100000, "The rest is skipped");
+    }
+
+    void run ()
+    {
+        expect (parallelForThreads () >= 1);
+        testIndexes ();
+        testNested ();
+        testThrow ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ParallelFor,ripple_core,ripple);
+
+}
@@ -0,0 +1,150 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/json/json_arena.h>
+#include <boost/thread/tss.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace Json {
+
+namespace {
+
+// The tag written before each allocateTagged result.
+char const fromHeap = 0;
+char const fromArena = 1;
+
+// The thread's current arena is not owned by the pointer.
+void leaveArena (ValueArena*)
+{
+}
+
+boost::thread_specific_ptr <ValueArena>& currentArena ()
+{
+    static boost::thread_specific_ptr <ValueArena> current (&leaveArena);
+    return current;
+}
+
+} // namespace
+
+ValueArena::Scope::Scope (ValueArena* arena)
+    : previous_ (nullptr)
+    , set_ (arena != nullptr)
+{
+    if (set_)
+    {
+        previous_ = currentArena ().get ();
+        currentArena ().reset (arena);
+    }
+}
+
+ValueArena::Scope::~Scope ()
+{
+    if (set_)
+        currentArena ().reset (previous_);
+}
+
+//------------------------------------------------------------------------------
+
+std::size_t const ValueArena::firstBlockSize;
+std::size_t const ValueArena::maxBlockSize;
+
+ValueArena::ValueArena ()
+    : block_ (nullptr)
+    , size_ (0)
+    , used_ (0)
+    , nextSize_ (firstBlockSize)
+    , allocated_ (0)
+{
+}
+
+ValueArena::~ValueArena ()
+{
+}
+
+void* ValueArena::allocate (std::size_t bytes, std::size_t alignment)
+{
+    auto offset = (used_ + alignment - 1) & ~(alignment - 1);
+    if (block_ == nullptr || offset + bytes > size_)
+    {
+        // New blocks come from operator new, which satisfies any alignment
+        // a Value needs.
+        grow (bytes);
+        offset = 0;
+    }
+
+    used_ = offset + bytes;
+    allocated_ += bytes;
+    return block_ + offset;
+}
+
+void ValueArena::grow (std::size_t bytes)
+{
+    auto const size = std::max (bytes, nextSize_);
+    nextSize_ = std::min (nextSize_ * 2, maxBlockSize);
+
+    blocks_.emplace_back (new char[size]);
+    block_ = blocks_.back ().get ();
+    size_ = size;
+    used_ = 0;
+}
+
+ValueArena* ValueArena::getCurrent ()
+{
+    return currentArena ().get ();
+}
+
+void* ValueArena::allocateTagged (std::size_t bytes, std::size_t alignment)
+{
+    // The tag is the last byte of a header as large as the alignment, so the
+    // result stays aligned.
+    char* raw;
+    char tag;
+
+    if (auto const arena = getCurrent ())
+    {
+        raw = static_cast <char*> (arena->allocate (
+            bytes + alignment, alignment));
+        tag = fromArena;
+    }
+    else
+    {
+        raw = static_cast <char*> (std::malloc (bytes + alignment));
+        if (raw == nullptr)
+            throw std::bad_alloc ();
+        tag = fromHeap;
+    }
+
+    raw[alignment - 1] = tag;
+    return raw + alignment;
+}
+
+void ValueArena::releaseTagged (void* p, std::size_t alignment)
+{
+    if (p == nullptr)
+        return;
+
+    auto const raw = static_cast <char*> (p) - alignment;
+    if (raw[alignment - 1] == fromHeap)
+        std::free (raw);
+}
+
+} // Json
@@ -89,7 +89,8 @@ public:
         if ( length == unknown )
             length = (unsigned int)strlen (value);
 
-        char* newString = static_cast<char*> ( malloc ( length + 1 ) );
+        char* newString = static_cast<char*> (
+            ValueArena::allocateTagged ( length + 1, 1 ) );
         memcpy ( newString, value, length );
         newString[length] = 0;
         return newString;
@@ -97,8 +98,7 @@ public:
 
     virtual void releaseStringValue ( char* value )
     {
-        if ( value )
-            free ( value );
+        ValueArena::releaseTagged ( value, 1 );
     }
 };
 
@@ -108,6 +108,35 @@ static ValueAllocator*& valueAllocator ()
     return valueAllocator;
 }
 
+#ifndef JSON_VALUE_USE_INTERNAL_MAP
+
+// Object and array storage comes from the current ValueArena, if any, like
+// the nodes inside it.
+template <class... Args>
+static Value::ObjectValues* newObjectValues ( Args&&... args )
+{
+    void* p = ValueArena::allocateTagged (
+        sizeof ( Value::ObjectValues ), alignof ( Value::ObjectValues ) );
+    try
+    {
+        return new ( p ) Value::ObjectValues ( std::forward<Args> ( args )... );
+    }
+    catch ( ... )
+    {
+        ValueArena::releaseTagged ( p, alignof ( Value::ObjectValues ) );
+        throw;
+    }
+}
+
+static void deleteObjectValues ( Value::ObjectValues* map )
+{
+    typedef Value::ObjectValues ObjectValues;
+    map->~ObjectValues ();
+    ValueArena::releaseTagged ( map, alignof ( Value::ObjectValues ) );
+}
+
+#endif // JSON_VALUE_USE_INTERNAL_MAP
+
 static struct DummyValueAllocatorInitializer
 {
     DummyValueAllocatorInitializer ()
@@ -304,7 +333,7 @@ Value::Value ( ValueType type )
 
     case arrayValue:
     case objectValue:
-        value_.map_ = new ObjectValues ();
+        value_.map_ = newObjectValues ();
         break;
 #else
 
@@ -477,7 +506,7 @@ Value::Value ( const Value& other )
 
     case arrayValue:
     case objectValue:
-        value_.map_ = new ObjectValues ( *other.value_.map_ );
+        value_.map_ = newObjectValues ( *other.value_.map_ );
         break;
 #else
 
@@ -529,7 +558,7 @@ Value::~Value ()
 
     case arrayValue:
     case objectValue:
-        delete value_.map_;
+        deleteObjectValues ( value_.map_ );
         break;
 #else
 
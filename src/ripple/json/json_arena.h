@@ -0,0 +1,164 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef JSON_ARENA_H_INCLUDED
+#define JSON_ARENA_H_INCLUDED
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace Json {
+
+/** A region that whole Json::Value trees are allocated from.
+
+    While a ValueArena::Scope is open on a thread, the strings, member names
+    and object and array storage of every Value built on that thread come
+    from the arena. Releasing them costs nothing, and the memory is returned
+    in one piece when the arena is destroyed. Values that do not come from an
+    arena can still be mixed into such a tree and are freed as usual.
+
+    Every Value holding arena memory must be destroyed before its arena, so
+    a Scope must not be open around code that keeps Values after it returns,
+    or around code that may yield to other work on the same thread.
+*/
+class ValueArena
+{
+public:
+    /** The size of the first block. Each block after it doubles in size,
+        up to maxBlockSize.
+    */
+    static std::size_t const firstBlockSize = 16 * 1024;
+    static std::size_t const maxBlockSize = 1024 * 1024;
+
+    /** Make the arena current on this thread until it is destroyed.
+        A null arena leaves Values on the heap, which lets callers open a
+        Scope unconditionally. Scopes may nest.
+    */
+    class Scope
+    {
+    public:
+        explicit Scope (ValueArena* arena);
+        ~Scope ();
+
+        Scope (Scope const&) = delete;
+        Scope& operator= (Scope const&) = delete;
+
+    private:
+        ValueArena* previous_;
+        bool set_;
+    };
+
+    ValueArena ();
+    ~ValueArena ();
+
+    ValueArena (ValueArena const&) = delete;
+    ValueArena& operator= (ValueArena const&) = delete;
+
+    /** Returns memory that lives as long as the arena. */
+    void* allocate (std::size_t bytes, std::size_t alignment);
+
+    /** The number of bytes given out so far. */
+    std::size_t getAllocated () const
+    {
+        return allocated_;
+    }
+
+    /** The number of blocks taken from the heap so far. */
+    std::size_t getBlockCount () const
+    {
+        return blocks_.size ();
+    }
+
+    /** The arena in scope on this thread, or null. */
+    static ValueArena* getCurrent ();
+
+    /** Allocate from the current arena, or from the heap if there is none.
+        The byte before the result records which, so the memory can be
+        released correctly whatever arena is current at the time.
+        @param alignment A power of two no larger than that of malloc.
+    */
+    static void* allocateTagged (std::size_t bytes, std::size_t alignment);
+
+    /** Release memory from allocateTagged. Arena memory is left alone. */
+    static void releaseTagged (void* p, std::size_t alignment);
+
+private:
+    void grow (std::size_t bytes);
+
+    std::vector <std::unique_ptr <char[]>> blocks_;
+    char* block_;
+    std::size_t size_;
+    std::size_t used_;
+    std::size_t nextSize_;
+    std::size_t allocated_;
+};
+
+namespace detail {
+
+/** Allocates the nodes of object and array storage with
+    ValueArena::allocateTagged.
+*/
+template <class T>
+class ArenaAllocator : public std::allocator <T>
+{
+public:
+    template <class U>
+    struct rebind
+    {
+        typedef ArenaAllocator <U> other;
+    };
+
+    ArenaAllocator () = default;
+    ArenaAllocator (ArenaAllocator const&) = default;
+
+    template <class U>
+    ArenaAllocator (ArenaAllocator <U> const&)
+    {
+    }
+
+    T* allocate (std::size_t n, void const* = nullptr)
+    {
+        return static_cast <T*> (ValueArena::allocateTagged (
+            n * sizeof (T), alignof (T)));
+    }
+
+    void deallocate (T* p, std::size_t)
+    {
+        ValueArena::releaseTagged (p, alignof (T));
+    }
+};
+
+template <class T, class U>
+bool operator== (ArenaAllocator <T> const&, ArenaAllocator <U> const&)
+{
+    return true;
+}
+
+template <class T, class U>
+bool operator!= (ArenaAllocator <T> const&, ArenaAllocator <U> const&)
+{
+    return false;
+}
+
+} // detail
+
+} // Json
+
+#endif
@@ -20,6 +20,7 @@
 #ifndef CPPTL_JSON_H_INCLUDED
 #define CPPTL_JSON_H_INCLUDED
 
+#include <ripple/json/json_arena.h>
 #include <ripple/json/json_config.h>
 #include <ripple/json/json_forwards.h>
 #include <beast/strings/String.h>
@@ -172,7 +173,8 @@ private:
 
 public:
 #  ifndef JSON_USE_CPPTL_SMALLMAP
-    typedef std::map<CZString, Value> ObjectValues;
+    typedef std::map<CZString, Value, std::less<CZString>,
+        detail::ArenaAllocator<std::pair<const CZString, Value>>> ObjectValues;
 #  else
     typedef CppTL::SmallMap<CZString, Value> ObjectValues;
 #  endif // ifndef JSON_USE_CPPTL_SMALLMAP
@@ -0,0 +1,220 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/json/json_arena.h>
+#include <ripple/json/json_value.h>
+#include <beast/module/core/text/LexicalCast.h>
+#include <beast/unit_test/suite.h>
+#include <chrono>
+#include <thread>
+
+namespace ripple {
+
+// Builds a page shaped like an account_lines reply.
+static Json::Value makeLines (int count)
+{
+    Json::Value result (Json::objectValue);
+    result["account"] = "rHb9CJAWyB4rj91VRWn96DkukG4bwdtyTh";
+    Json::Value& lines = (result["lines"] = Json::arrayValue);
+    for (int i = 0; i < count; ++i)
+    {
+        Json::Value& line = lines.append (Json::objectValue);
+        line["account"] = "rPEPPER7kfTD9w2To4CQk6UCfuHM9c6GDY";
+        line["balance"] = std::to_string (i * 1000 + 17) + ".25";
+        line["currency"] = "USD";
+        line["limit"] = "1000000000";
+        line["limit_peer"] = "0";
+        line["quality_in"] = 0;
+        line["quality_out"] = 0;
+        if (i % 4 == 0)
+            line["no_ripple"] = true;
+    }
+    return result;
+}
+
+class JsonArena_test : public beast::unit_test::suite
+{
+public:
+    void testScope ()
+    {
+        testcase ("scope");
+
+        expect (Json::ValueArena::getCurrent () == nullptr);
+        {
+            Json::ValueArena::Scope none (nullptr);
+            expect (Json::ValueArena::getCurrent () == nullptr);
+        }
+
+        Json::ValueArena outer;
+        Json::ValueArena inner;
+        {
+            Json::ValueArena::Scope a (&outer);
+            expect (Json::ValueArena::getCurrent () == &outer);
+            {
+                Json::ValueArena::Scope b (&inner);
+                expect (Json::ValueArena::getCurrent () == &inner);
+                {
+                    Json::ValueArena::Scope c (nullptr);
+                    expect (Json::ValueArena::getCurrent () == &inner,
+                        "A null scope leaves the arena alone");
+                }
+
+                Json::ValueArena* seen = &inner;
+                std::thread ([&seen] ()
+                {
+                    seen = Json::ValueArena::getCurrent ();
+                }).join ();
+                expect (seen == nullptr, "Other threads are not affected");
+            }
+            expect (Json::ValueArena::getCurrent () == &outer);
+        }
+        expect (Json::ValueArena::getCurrent () == nullptr);
+    }
+
+    void testTree ()
+    {
+        testcase ("tree");
+
+        auto const expected = makeLines (100);
+        Json::Value heap = makeLines (3);
+
+        Json::ValueArena arena;
+        {
+            Json::Value tree;
+            {
+                Json::ValueArena::Scope scope (&arena);
+                tree = makeLines (100);
+
+                // Heap values mix freely with arena values.
+                tree["extra"] = heap;
+                heap = Json::Value ();
+                tree.removeMember ("extra");
+            }
+
+            expect (arena.getAllocated () != 0);
+            expect (tree == expected);
+
+            // Copies made outside the scope come from the heap.
+            auto const allocated = arena.getAllocated ();
+            Json::Value copy = tree;
+            expect (arena.getAllocated () == allocated);
+            tree = Json::Value ();
+            expect (copy == expected);
+
+            // Growing an arena tree after its scope has closed.
+            {
+                Json::ValueArena::Scope scope (&arena);
+                copy["lines"].append ("more");
+            }
+            copy["lines"].append ("more again");
+            expect (copy["lines"].size () == expected["lines"].size () + 2);
+        }
+
+        expect (arena.getBlockCount () > 1, "Arena grew past its first block");
+    }
+
+    void testAlignment ()
+    {
+        testcase ("alignment");
+
+        Json::ValueArena arena;
+        bool aligned = true;
+        for (std::size_t i = 0; i < 10000; ++i)
+        {
+            auto const alignment = std::size_t (1) << (i % 4);
+            auto const p = reinterpret_cast <std::uintptr_t> (
+                arena.allocate (i % 37 + 1, alignment));
+            aligned = aligned && (p % alignment) == 0;
+        }
+        expect (aligned);
+
+        auto p = arena.allocate (2 * Json::ValueArena::maxBlockSize, 8);
+        expect (p != nullptr, "Allocations larger than a block");
+    }
+
+    void run ()
+    {
+        testScope ();
+        testTree ();
+        testAlignment ();
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// Compares building and destroying account_lines shaped pages with and
+// without an arena. Pass the number of lines per page as the argument, the
+// default is 400.
+class JsonArenaTiming_test : public beast::unit_test::suite
+{
+public:
+    typedef std::chrono::steady_clock clock_type;
+
+    static int const pages = 200;
+
+    template <class Build>
+    double time (Build const& build)
+    {
+        auto const start = clock_type::now ();
+        for (int i = 0; i < pages; ++i)
+            build ();
+        return std::chrono::duration_cast <std::chrono::duration <double,
+            std::milli>> (clock_type::now () - start).count ();
+    }
+
+    void run ()
+    {
+        int lines = 400;
+        if (!arg().empty())
+            lines = beast::lexicalCastThrow <int> (arg());
+
+        testcase (std::to_string (lines) + " lines");
+
+        double const heap = time ([lines] ()
+        {
+            makeLines (lines);
+        });
+
+        std::size_t allocated = 0;
+        std::size_t blocks = 0;
+        double const arena = time ([&] ()
+        {
+            Json::ValueArena arena;
+            {
+                Json::ValueArena::Scope scope (&arena);
+                makeLines (lines);
+            }
+            allocated = arena.getAllocated ();
+            blocks = arena.getBlockCount ();
+        });
+
+        log << pages << " pages of " << lines << " lines: heap " << heap <<
+            " ms, arena " << arena << " ms, " << allocated <<
+            " bytes in " << blocks << " blocks per page";
+        pass ();
+    }
+};
+
+int const JsonArenaTiming_test::pages;
+
+BEAST_DEFINE_TESTSUITE(JsonArena,json,ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(JsonArenaTiming,json,ripple);
+
+}
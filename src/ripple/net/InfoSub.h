@@ -26,7 +26,9 @@
 #include <ripple/resource/Consumer.h>
 #include <ripple/protocol/Book.h>
 #include <beast/threads/Stoppable.h>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 namespace ripple {
 
@@ -108,6 +110,18 @@ public:
     virtual void send (
         Json::Value const& jvObj, std::string const& sObj, bool broadcast);
 
+    /** A message rendered once for every subscriber it is sent to. */
+    struct Publication
+    {
+        Json::Value json;
+        std::string text;
+    };
+
+    typedef std::vector <std::shared_ptr <Publication const>> Publications;
+
+    /** Send several messages, in order. */
+    virtual void send (Publications const& messages, bool broadcast);
+
     std::uint64_t getSeq ();
 
     void onSendEmpty ();
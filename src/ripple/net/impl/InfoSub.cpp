@@ -72,6 +72,12 @@ void InfoSub::send (
     send (jvObj, broadcast);
 }
 
+void InfoSub::send (Publications const& messages, bool broadcast)
+{
+    for (auto const& message : messages)
+        send (message->json, message->text, broadcast);
+}
+
 std::uint64_t InfoSub::getSeq ()
 {
     return mSeq;
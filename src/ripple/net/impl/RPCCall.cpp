@@ -511,7 +511,7 @@ private:
         return jvRequest;
     }
 
-    //dividend_object <time>
+    // account_dividend <account> [limit] [marker]
     Json::Value parseAccountDividend (Json::Value const& jvParams)
     {
         Json::Value jvRequest (Json::objectValue);
@@ -519,6 +519,16 @@ private:
         {
             jvRequest["account"]= jvParams[0u].asString ();
         }
+        if (jvParams.size() >= 2)
+        {
+            jvRequest[jss::limit] = beast::lexicalCast <std::uint32_t> (
+                jvParams[1u].asString ());
+        }
+        if (jvParams.size() >= 3)
+        {
+            jvRequest[jss::marker] = beast::lexicalCast <std::uint32_t> (
+                jvParams[2u].asString ());
+        }
         return jvRequest;
     }
 
@@ -934,7 +944,7 @@ public:
             {   "ledger_header",        &RPCParser::parseLedgerId,              1,  1   },
             {   "ledger_request",       &RPCParser::parseLedgerId,              1,  1   },
             {   "dividend_object",      &RPCParser::parseDividendTime,          0,  1   },
-            {   "account_dividend",     &RPCParser::parseAccountDividend,          0,  1   },
+            {   "account_dividend",     &RPCParser::parseAccountDividend,          0,  3   },
             {   "ancestors",            &RPCParser::parseAncestors,          0,  1   },
             {   "log_level",            &RPCParser::parseLogLevel,              0,  2   },
             {   "logrotate",            &RPCParser::parseAsIs,                  0,  0   },
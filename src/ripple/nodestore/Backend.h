@@ -65,6 +65,29 @@ public:
     */
     virtual Status fetch (void const* key, NodeObject::Ptr* pObject) = 0;
 
+    /** Fetch a group of objects.
+        Backends that can look up several keys at once should override
+        this; the default calls fetch for each key.
+        @note This will be called concurrently.
+        @param keys Pointers to the key data.
+        @param objects [out] One object per key, in key order. An object is
+                       nullptr if the key was not found or on error.
+        @return The result of the operation for each key.
+    */
+    virtual std::vector <Status> fetchBatch (
+        std::vector <void const*> const& keys,
+            std::vector <NodeObject::Ptr>& objects)
+    {
+        std::vector <Status> status;
+        status.reserve (keys.size ());
+        objects.assign (keys.size (), NodeObject::Ptr ());
+
+        for (std::size_t i = 0; i < keys.size (); ++i)
+            status.push_back (fetch (keys[i], &objects[i]));
+
+        return status;
+    }
+
     /** Store a single object.
         Depending on the implementation this may happen immediately
         or deferred using a scheduled task.
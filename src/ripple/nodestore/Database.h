@@ -84,6 +84,19 @@ public:
     */
     virtual bool asyncFetch (uint256 const& hash, NodeObject::pointer& object) = 0;
 
+    /** Fetch a group of objects.
+        Objects in the cache are returned without I/O. The rest are read
+        from the backend with one batch request, which is much cheaper
+        than fetching them one at a time.
+
+        @note This can be called concurrently.
+        @param hashes The keys of the objects to retrieve.
+        @return One object per key, in the same order. An object is nullptr
+                if it couldn't be retrieved.
+    */
+    virtual std::vector <NodeObject::pointer> fetchBatch (
+        std::vector <uint256> const& hashes) = 0;
+
     /** Wait for all currently pending async reads to complete.
     */
     virtual void waitReads () = 0;
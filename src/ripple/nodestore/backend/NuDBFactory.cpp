@@ -30,16 +30,107 @@
 #include <beast/nudb/visit.h>
 #include <beast/hash/xxhasher.h>
 #include <boost/filesystem.hpp>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdint>
 #include <exception>
 #include <memory>
+#include <mutex>
 
 namespace ripple {
 namespace NodeStore {
 
+class NuDBBackend;
+
+// The lookups of one NuDBBackend::fetchBatch call. Tasks that run after
+// the call returned find it closed and leave without touching the keys.
+class BatchFetch
+{
+public:
+    BatchFetch (NuDBBackend& backend, std::vector <void const*> const& keys,
+            std::vector <Status>& status, std::vector <NodeObject::Ptr>& objects)
+        : backend_ (backend)
+        , keys_ (keys)
+        , status_ (status)
+        , objects_ (objects)
+        , next_ (0)
+        , closed_ (false)
+        , helpers_ (0)
+    {
+    }
+
+    // Called by a scheduled task
+    void
+    help ()
+    {
+        {
+            std::lock_guard <std::mutex> lock (mutex_);
+            if (closed_)
+                return;
+            ++helpers_;
+        }
+
+        lookup ();
+
+        std::lock_guard <std::mutex> lock (mutex_);
+        if (--helpers_ == 0)
+            cond_.notify_all ();
+    }
+
+    // Called by fetchBatch
+    void
+    finish ()
+    {
+        lookup ();
+
+        std::unique_lock <std::mutex> lock (mutex_);
+        closed_ = true;
+        cond_.wait (lock, [this] { return helpers_ == 0; });
+
+        if (error_)
+            std::rethrow_exception (error_);
+    }
+
+private:
+    void
+    lookup ();
+
+    NuDBBackend& backend_;
+    std::vector <void const*> const& keys_;
+    std::vector <Status>& status_;
+    std::vector <NodeObject::Ptr>& objects_;
+    std::atomic <std::size_t> next_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool closed_;
+    int helpers_;
+    std::exception_ptr error_;
+};
+
+struct BatchFetchTask : Task
+{
+    explicit BatchFetchTask (std::shared_ptr <BatchFetch> const& batch)
+        : batch_ (batch)
+    {
+    }
+
+    void
+    performScheduledTask () override
+    {
+        batch_->help ();
+        delete this;
+    }
+
+    std::shared_ptr <BatchFetch> batch_;
+};
+
+//------------------------------------------------------------------------------
+
 class NuDBBackend
     : public Backend
 {
@@ -50,6 +141,12 @@ public:
         // distribution of data sizes.
         arena_alloc_size = 16 * 1024 * 1024,
 
+        // Batch fetches are split over at most this many threads,
+        // counting the caller, each doing at least batchFetchPerThread
+        // lookups.
+        batchFetchThreads = 4,
+        batchFetchPerThread = 32,
+
         currentType = 1
     };
 
@@ -149,6 +246,30 @@ public:
         return status;
     }
 
+    // Each lookup is a separate read of the key and data files, so larger
+    // batches are shared with a few scheduler tasks to keep several reads
+    // in flight. The calling thread does lookups too, and returns once
+    // none of the tasks is still doing any.
+    std::vector <Status>
+    fetchBatch (std::vector <void const*> const& keys,
+        std::vector <NodeObject::Ptr>& objects) override
+    {
+        std::vector <Status> status (keys.size (), notFound);
+        objects.assign (keys.size (), NodeObject::Ptr ());
+
+        std::size_t const threads = std::min <std::size_t> (
+            batchFetchThreads, keys.size () / batchFetchPerThread);
+
+        auto const batch = std::make_shared <BatchFetch> (
+            *this, keys, status, objects);
+
+        for (std::size_t i = 1; i < threads; ++i)
+            scheduler_.scheduleTask (*new BatchFetchTask (batch));
+
+        batch->finish ();
+        return status;
+    }
+
     void
     do_insert (std::shared_ptr <NodeObject> const& no)
     {
@@ -236,6 +357,23 @@ public:
     }
 };
 
+void
+BatchFetch::lookup ()
+{
+    try
+    {
+        for (std::size_t i; (i = next_++) < keys_.size ();)
+            status_[i] = backend_.fetch (keys_[i], &objects_[i]);
+    }
+    catch (...)
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        if (! error_)
+            error_ = std::current_exception ();
+        next_ = keys_.size ();
+    }
+}
+
 //------------------------------------------------------------------------------
 
 class NuDBFactory : public Factory
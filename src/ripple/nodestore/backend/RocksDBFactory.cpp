@@ -235,8 +235,6 @@ public:
     {
         pObject->reset ();
 
-        Status status (ok);
-
         rocksdb::ReadOptions const options;
         rocksdb::Slice const slice (static_cast <char const*> (key), m_keyBytes);
 
@@ -244,13 +242,49 @@ public:
 
         rocksdb::Status getStatus = m_db->Get (options, slice, &string);
 
+        return decode (key, getStatus, string, *pObject);
+    }
+
+    std::vector <Status>
+    fetchBatch (std::vector <void const*> const& keys,
+        std::vector <NodeObject::Ptr>& objects) override
+    {
+        rocksdb::ReadOptions const options;
+
+        std::vector <rocksdb::Slice> slices;
+        slices.reserve (keys.size ());
+
+        for (auto key : keys)
+            slices.emplace_back (static_cast <char const*> (key), m_keyBytes);
+
+        std::vector <std::string> strings;
+
+        std::vector <rocksdb::Status> const getStatus =
+            m_db->MultiGet (options, slices, &strings);
+
+        std::vector <Status> status;
+        status.reserve (keys.size ());
+        objects.assign (keys.size (), NodeObject::Ptr ());
+
+        for (std::size_t i = 0; i < keys.size (); ++i)
+            status.push_back (decode (keys[i], getStatus[i], strings[i], objects[i]));
+
+        return status;
+    }
+
+    Status
+    decode (void const* key, rocksdb::Status const& getStatus,
+        std::string const& string, NodeObject::Ptr& object)
+    {
+        Status status (ok);
+
         if (getStatus.ok ())
         {
             DecodedBlob decoded (key, string.data (), string.size ());
 
             if (decoded.wasOk ())
             {
-                *pObject = decoded.createObject ();
+                object = decoded.createObject ();
             }
             else
             {
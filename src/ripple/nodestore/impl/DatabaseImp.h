@@ -23,7 +23,7 @@
 #include <ripple/nodestore/Database.h>
 #include <ripple/nodestore/Scheduler.h>
 #include <ripple/nodestore/impl/Tuning.h>
-#include <ripple/basics/TaggedCache.h>
+#include <ripple/basics/ShardedTaggedCache.h>
 #include <ripple/basics/KeyCache.h>
 #include <ripple/basics/Log.h>
 #include <ripple/basics/seconds_clock.h>
@@ -49,7 +49,7 @@ public:
     std::unique_ptr <Backend> m_fastBackend;
 
     // Positive cache
-    TaggedCache <uint256, NodeObject> m_cache;
+    ShardedTaggedCache <uint256, NodeObject> m_cache;
 
     // Negative cache
     KeyCache <uint256> m_negCache;
@@ -266,11 +266,105 @@ public:
         return obj;
     }
 
+    std::vector <NodeObject::Ptr> fetchBatch (
+        std::vector <uint256> const& hashes) override
+    {
+        std::vector <NodeObject::Ptr> objects (hashes.size ());
+
+        // See which objects are not already in the cache
+        //
+        std::vector <std::size_t> wanted;
+
+        for (std::size_t i = 0; i < hashes.size (); ++i)
+        {
+            objects[i] = m_cache.fetch (hashes[i]);
+
+            if (! objects[i] && ! m_negCache.touch_if_exists (hashes[i]))
+                wanted.push_back (i);
+        }
+
+        if (wanted.empty ())
+            return objects;
+
+        FetchReport report;
+        report.isAsync = false;
+        report.wentToDisk = true;
+
+        auto const before = std::chrono::steady_clock::now();
+
+        // Check the fast backend database if we have one, then the main
+        // database for what is still missing.
+        //
+        std::vector <std::size_t> missing (wanted);
+
+        if (m_fastBackend != nullptr)
+            fetchBatchInternal (*m_fastBackend, hashes, missing, objects);
+
+        std::vector <bool> fromFastBackend (hashes.size (), false);
+        for (auto i : wanted)
+            fromFastBackend[i] = (objects[i] != nullptr);
+
+        if (! missing.empty ())
+        {
+            m_fetchTotalCount += missing.size ();
+            fetchBatchFrom (hashes, missing, objects);
+        }
+
+        for (auto i : wanted)
+        {
+            uint256 const& hash = hashes[i];
+            NodeObject::Ptr& obj = objects[i];
+
+            if (obj == nullptr)
+            {
+                // Just in case a write occurred
+                obj = m_cache.fetch (hash);
+
+                if (obj == nullptr)
+                    m_negCache.insert (hash);
+            }
+            else
+            {
+                // Ensure all threads get the same object
+                //
+                m_cache.canonicalize (hash, obj);
+
+                if (! fromFastBackend[i] && m_fastBackend != nullptr)
+                {
+                    m_fastBackend->store (obj);
+                    ++m_storeCount;
+                    m_storeSize += obj->getData().size();
+                }
+            }
+        }
+
+        report.elapsed = std::chrono::duration_cast <std::chrono::milliseconds>
+            (std::chrono::steady_clock::now() - before);
+        report.wasFound = missing.empty ();
+        m_scheduler.onFetch (report);
+
+        if (m_journal.trace) m_journal.trace <<
+            "fetchBatch: " << hashes.size () << " wanted, " <<
+                wanted.size () << " from db, " << missing.size () << " missing";
+
+        return objects;
+    }
+
     virtual NodeObject::Ptr fetchFrom (uint256 const& hash)
     {
         return fetchInternal (*m_backend, hash);
     }
 
+    /** Fetch the objects at the given indexes from the backend.
+        @param missing [in,out] The indexes to fetch; on return the indexes
+                       of the objects that were not found.
+    */
+    virtual void fetchBatchFrom (std::vector <uint256> const& hashes,
+        std::vector <std::size_t>& missing, std::vector <NodeObject::Ptr>& objects)
+    {
+        fetchBatchInternal (*m_backend, hashes, missing, objects);
+    }
+
     NodeObject::Ptr fetchInternal (Backend& backend,
         uint256 const& hash)
     {
@@ -278,6 +372,44 @@ public:
 
         Status const status = backend.fetch (hash.begin (), &object);
 
+        noteFetch (status, hash, object);
+
+        return object;
+    }
+
+    void fetchBatchInternal (Backend& backend,
+        std::vector <uint256> const& hashes, std::vector <std::size_t>& missing,
+            std::vector <NodeObject::Ptr>& objects)
+    {
+        std::vector <void const*> keys;
+        keys.reserve (missing.size ());
+
+        for (auto i : missing)
+            keys.push_back (hashes[i].begin ());
+
+        std::vector <NodeObject::Ptr> found;
+        std::vector <Status> const status = backend.fetchBatch (keys, found);
+
+        std::size_t stillMissing = 0;
+
+        for (std::size_t j = 0; j < missing.size (); ++j)
+        {
+            std::size_t const i = missing[j];
+
+            noteFetch (status[j], hashes[i], found[j]);
+
+            if (found[j])
+                objects[i] = std::move (found[j]);
+            else
+                missing[stillMissing++] = i;
+        }
+
+        missing.resize (stillMissing);
+    }
+
+    void noteFetch (Status status, uint256 const& hash,
+        NodeObject::Ptr const& object)
+    {
         switch (status)
         {
         case ok:
@@ -299,8 +431,6 @@ public:
                 "Unknown status=" << status;
             break;
         }
-
-        return object;
     }
 
     //------------------------------------------------------------------------------
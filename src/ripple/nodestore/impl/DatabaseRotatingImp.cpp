@@ -50,6 +50,33 @@ NodeObject::Ptr DatabaseRotatingImp::fetchFrom (uint256 const& hash)
 
     return object;
 }
+
+void DatabaseRotatingImp::fetchBatchFrom (std::vector <uint256> const& hashes,
+    std::vector <std::size_t>& missing, std::vector <NodeObject::Ptr>& objects)
+{
+    Backends b = getBackends();
+    fetchBatchInternal (*b.writableBackend, hashes, missing, objects);
+
+    if (missing.empty ())
+        return;
+
+    std::vector <std::size_t> const archived (missing);
+    fetchBatchInternal (*b.archiveBackend, hashes, missing, objects);
+
+    // Copy what was only in the archive into the writable backend
+    std::size_t stillMissing = 0;
+    for (auto i : archived)
+    {
+        if (stillMissing < missing.size () && missing[stillMissing] == i)
+        {
+            ++stillMissing;
+            continue;
+        }
+
+        b.writableBackend->store (objects[i]);
+        m_negCache.erase (hashes[i]);
+    }
+}
 }
 
 }
@@ -123,7 +123,10 @@ public:
     }
 
     NodeObject::Ptr fetchFrom (uint256 const& hash) override;
-    TaggedCache <uint256, NodeObject>& getPositiveCache() override
+    void fetchBatchFrom (std::vector <uint256> const& hashes,
+        std::vector <std::size_t>& missing,
+            std::vector <NodeObject::Ptr>& objects) override;
+    ShardedTaggedCache <uint256, NodeObject>& getPositiveCache() override
     {
         return m_cache;
     }
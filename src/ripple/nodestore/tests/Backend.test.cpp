@@ -85,6 +85,10 @@ public:
             std::sort (batch.begin (), batch.end (), NodeObject::LessThan ());
             std::sort (copy.begin (), copy.end (), NodeObject::LessThan ());
             expect (areBatchesEqual (batch, copy), "Should be equal");
+
+            // Read it back in with one batch fetch
+            fetchBatchCopyOfBatch (*backend, &copy, batch);
+            expect (areBatchesEqual (batch, copy), "Should be equal");
         }
     }
 
@@ -151,6 +151,36 @@ public:
         }
     }
 
+    // Get a copy of a batch in a backend with one batch fetch
+    void fetchBatchCopyOfBatch (Backend& backend, Batch* pCopy, Batch const& batch)
+    {
+        pCopy->clear ();
+
+        std::vector <void const*> keys;
+        keys.reserve (batch.size ());
+
+        for (int i = 0; i < batch.size (); ++i)
+            keys.push_back (batch [i]->getHash ().cbegin ());
+
+        Batch objects;
+        std::vector <Status> const status = backend.fetchBatch (keys, objects);
+
+        expect (status.size () == batch.size (), "Should be one status per key");
+        expect (objects.size () == batch.size (), "Should be one object per key");
+
+        for (int i = 0; i < status.size () && i < objects.size (); ++i)
+        {
+            expect (status [i] == ok, "Should be ok");
+
+            if (status [i] == ok)
+            {
+                expect (objects [i] != nullptr, "Should not be null");
+
+                pCopy->push_back (objects [i]);
+            }
+        }
+    }
+
     void fetchMissing(Backend& backend, Batch const& batch)
     {
         for (int i = 0; i < batch.size (); ++i)
@@ -195,6 +225,26 @@ public:
                 pCopy->push_back (object);
         }
     }
+
+    // Fetch all the hashes with one batch fetch, into another batch.
+    static void fetchBatchCopyOfBatch (Database& db,
+                                       Batch* pCopy,
+                                       Batch const& batch)
+    {
+        std::vector <uint256> hashes;
+        hashes.reserve (batch.size ());
+
+        for (int i = 0; i < batch.size (); ++i)
+            hashes.push_back (batch [i]->getHash ());
+
+        pCopy->clear ();
+
+        for (auto const& object : db.fetchBatch (hashes))
+        {
+            if (object != nullptr)
+                pCopy->push_back (object);
+        }
+    }
 };
 
 }
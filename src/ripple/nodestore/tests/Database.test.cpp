@@ -150,8 +150,15 @@ public:
                 std::unique_ptr <Database> db = Manager::instance().make_Database (
                     "test", scheduler, j, 2, nodeParams);
 
-                // Read it back in
+                // Read it back in with one batch fetch, nothing is cached yet
                 Batch copy;
+                fetchBatchCopyOfBatch (*db, &copy, batch);
+                expect (areBatchesEqual (batch, copy), "Should be equal");
+
+                std::vector <uint256> missing (1, uint256 (1));
+                expect (db->fetchBatch (missing) [0] == nullptr, "Should be missing");
+
+                // And again, now from the cache
                 fetchCopyOfBatch (*db, &copy, batch);
 
                 // Canonicalize the source and destination batches
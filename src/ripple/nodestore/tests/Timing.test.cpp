@@ -142,7 +142,10 @@ public:
     enum
     {
         // percent of fetches for missing nodes
-        missingNodePercent = 20
+        missingNodePercent = 20,
+
+        // number of keys in each batch fetch
+        batchFetchSize = 256
     };
 
     std::size_t const default_repeat = 3;
@@ -383,6 +386,77 @@ public:
         backend->close();
     }
 
+    // Fetch existing keys in batches
+    void
+    do_batch (Section const& config, Params const& params)
+    {
+        beast::Journal journal;
+        DummyScheduler scheduler;
+        auto backend = make_Backend (config, scheduler, journal);
+        expect (backend != nullptr);
+
+        class Body
+        {
+        private:
+            suite& suite_;
+            Backend& backend_;
+            Sequence seq1_;
+            beast::xor_shift_engine gen_;
+            std::uniform_int_distribution<std::size_t> dist_;
+
+        public:
+            Body (std::size_t id, suite& s,
+                    Params const& params, Backend& backend)
+                : suite_(s)
+                , backend_ (backend)
+                , seq1_ (1)
+                , gen_ (id + 1)
+                , dist_ (0, params.items - 1)
+            {
+            }
+
+            void
+            operator()(std::size_t i)
+            {
+                try
+                {
+                    std::vector<NodeObject::Ptr> objs;
+                    std::vector<void const*> keys;
+                    std::vector<NodeObject::Ptr> results;
+                    objs.reserve (batchFetchSize);
+                    keys.reserve (batchFetchSize);
+                    for (std::size_t j = 0; j < batchFetchSize; ++j)
+                    {
+                        objs.push_back (seq1_.obj(dist_(gen_)));
+                        keys.push_back (objs.back()->getHash().data());
+                    }
+                    backend_.fetchBatch(keys, results);
+                    bool ok = results.size() == objs.size();
+                    for (std::size_t j = 0; ok && j < objs.size(); ++j)
+                        ok = results[j] && results[j]->isCloneOf(objs[j]);
+                    suite_.expect (ok);
+                }
+                catch(std::exception const& e)
+                {
+                    suite_.fail(e.what());
+                }
+            }
+        };
+        try
+        {
+            parallel_for_id<Body>(params.items / batchFetchSize, params.threads,
+                std::ref(*this), std::ref(params), std::ref(*backend));
+        }
+        catch(...)
+        {
+        #if NODESTORE_TIMING_DO_VERIFY
+            backend->verify();
+        #endif
+            throw;
+        }
+        backend->close();
+    }
+
     // Perform lookups of non-existent keys
     void
     do_missing (Section const& config, Params const& params)
@@ -720,6 +794,7 @@ public:
             {
                  { "Insert",    &Timing_test::do_insert }
                 ,{ "Fetch",     &Timing_test::do_fetch }
+                ,{ "Batch",     &Timing_test::do_batch }
                 ,{ "Missing",   &Timing_test::do_missing }
                 ,{ "Mixed",     &Timing_test::do_mixed }
                 ,{ "Work",      &Timing_test::do_work }
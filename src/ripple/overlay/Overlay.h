@@ -27,6 +27,7 @@
 #include <beast/http/message.h>
 #include <beast/threads/Stoppable.h>
 #include <beast/utility/PropertyStream.h>
+#include <chrono>
 #include <memory>
 #include <beast/cxx14/type_traits.h> // <type_traits>
 #include <boost/asio/buffer.hpp>
@@ -65,6 +66,12 @@ public:
         bool auto_connect = true;
         bool http_handshake = false;
         Promote promote = Promote::automatic;
+
+        /** How long a peer holds its first queued message so that
+            messages sent soon after it go out in the same write.
+            Zero writes immediately.
+        */
+        std::chrono::milliseconds write_batch = std::chrono::milliseconds (0);
         std::shared_ptr<boost::asio::ssl::context> context;
     };
 
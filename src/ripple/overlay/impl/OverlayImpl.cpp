@@ -31,6 +31,7 @@
 #include <beast/http/rfc2616.h>
 #include <beast/utility/ci_char_traits.h>
 #include <beast/utility/WrappedSink.h>
+#include <algorithm>
 
 namespace ripple {
 
@@ -762,6 +763,10 @@ setup_Overlay (BasicConfig const& config)
     auto const& section = config.section("overlay");
     set (setup.http_handshake, "http_handshake", section);
     set (setup.auto_connect, "auto_connect", section);
+    int write_batch_ms = 0;
+    if (set (write_batch_ms, "write_batch_ms", section) && write_batch_ms > 0)
+        setup.write_batch = std::chrono::milliseconds (
+            std::min (write_batch_ms, 1000));
     std::string promote;
     set (promote, "become_superpeer", section);
     if (promote == "never")
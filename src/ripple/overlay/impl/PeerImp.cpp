@@ -25,6 +25,7 @@
 #include <ripple/app/ledger/LedgerMaster.h>
 #include <ripple/app/misc/IHashRouter.h>
 #include <ripple/app/misc/NetworkOPs.h>
+#include <ripple/app/misc/SignatureVerifier.h>
 #include <ripple/app/peers/ClusterNodeStatus.h>
 #include <ripple/app/peers/UniqueNodeList.h>
 #include <ripple/basics/StringUtilities.h>
@@ -60,6 +61,7 @@ PeerImp::PeerImp (id_t id, endpoint_type remote_endpoint,
     , stream_ (ssl_bundle_->stream)
     , strand_ (socket_.get_io_service())
     , timer_ (socket_.get_io_service())
+    , batch_timer_ (socket_.get_io_service())
     , remote_address_ (
         beast::IPAddressConversion::from_asio(remote_endpoint))
     , overlay_ (overlay)
@@ -167,15 +169,20 @@ PeerImp::send (Message::pointer const& m)
         return;
     if(detaching_)
         return;
-    send_queue_.push(m);
-    if(send_queue_.size() > 1)
+    send_queue_.push_back(m);
+    // A write or batch in progress picks the message up when it completes
+    if(! writing_.empty() || batching_)
         return;
-    setTimer();
-    boost::asio::async_write (stream_, boost::asio::buffer(
-        send_queue_.front()->getBuffer()), strand_.wrap(std::bind(
-            &PeerImp::onWriteMessage, shared_from_this(),
-                beast::asio::placeholders::error,
-                    beast::asio::placeholders::bytes_transferred)));
+    auto const window = overlay_.setup().write_batch;
+    if (window == std::chrono::milliseconds::zero())
+        return doWriteMessages();
+    error_code ec;
+    batch_timer_.expires_from_now(window, ec);
+    if (ec)
+        return doWriteMessages();
+    batching_ = true;
+    batch_timer_.async_wait(strand_.wrap(std::bind(&PeerImp::onBatchTimer,
+        shared_from_this(), beast::asio::placeholders::error)));
 }
 
 void
@@ -330,6 +337,7 @@ PeerImp::close()
         detaching_ = true; // DEPRECATED
         error_code ec;
         timer_.cancel(ec);
+        batch_timer_.cancel(ec);
         socket_.close(ec);
         if(m_inbound)
         {
@@ -376,7 +384,7 @@ PeerImp::gracefulClose()
     while(send_queue_.size() > 1)
         send_queue_.pop_back();
 #endif
-    if (send_queue_.size() > 0)
+    if (! writing_.empty() || send_queue_.size() > 0)
         return;
     setTimer();
     stream_.async_shutdown(strand_.wrap(std::bind(&PeerImp::onShutdown,
@@ -642,6 +650,64 @@ PeerImp::onReadMessage (error_code ec, std::size_t bytes_transferred)
                 beast::asio::placeholders::bytes_transferred)));
 }
 
+void
+PeerImp::doWriteMessages()
+{
+    assert(strand_.running_in_this_thread());
+    assert(writing_.empty());
+    assert(! send_queue_.empty());
+
+    // Take as many queued messages as fit in one write, but at least one
+    std::size_t bytes = 0;
+    do
+    {
+        std::size_t const size = send_queue_.front()->getBuffer().size();
+        if (! writing_.empty() && bytes + size > Tuning::writeCoalesceBytes)
+            break;
+        writing_.push_back(std::move(send_queue_.front()));
+        send_queue_.pop_front();
+        bytes += size;
+    }
+    while (! send_queue_.empty());
+
+    // Timeout on writes only
+    setTimer();
+
+    // TLS encrypts each buffer of a sequence as its own record, so small
+    // messages are copied together to be sealed and sent at once. A lone
+    // message is written straight from its shared buffer.
+    if (writing_.size() == 1)
+        return boost::asio::async_write (stream_, boost::asio::buffer(
+            writing_.front()->getBuffer()), strand_.wrap(std::bind(
+                &PeerImp::onWriteMessage, shared_from_this(),
+                    beast::asio::placeholders::error,
+                        beast::asio::placeholders::bytes_transferred)));
+
+    coalesce_buffer_.clear();
+    coalesce_buffer_.reserve(bytes);
+    for (auto const& m : writing_)
+        coalesce_buffer_.insert(coalesce_buffer_.end(),
+            m->getBuffer().begin(), m->getBuffer().end());
+
+    boost::asio::async_write (stream_, boost::asio::buffer(
+        coalesce_buffer_), strand_.wrap(std::bind(
+            &PeerImp::onWriteMessage, shared_from_this(),
+                beast::asio::placeholders::error,
+                    beast::asio::placeholders::bytes_transferred)));
+}
+
+void
+PeerImp::onBatchTimer (error_code const& ec)
+{
+    batching_ = false;
+    if(! socket_.is_open())
+        return;
+    if(ec == boost::asio::error::operation_aborted)
+        return;
+    if (writing_.empty() && ! send_queue_.empty())
+        doWriteMessages();
+}
+
 void
 PeerImp::onWriteMessage (error_code ec, std::size_t bytes_transferred)
 {
@@ -660,18 +726,10 @@ PeerImp::onWriteMessage (error_code ec, std::size_t bytes_transferred)
             "onWriteMessage";
     }
 
-    assert(! send_queue_.empty());
-    send_queue_.pop();
+    assert(! writing_.empty());
+    writing_.clear();
     if (! send_queue_.empty())
-    {
-        // Timeout on writes only
-        setTimer();
-        return boost::asio::async_write (stream_, boost::asio::buffer(
-            send_queue_.front()->getBuffer()), strand_.wrap(std::bind(
-                &PeerImp::onWriteMessage, shared_from_this(),
-                    beast::asio::placeholders::error,
-                        beast::asio::placeholders::bytes_transferred)));
-    }
+        return doWriteMessages();
 
     if (gracefulClose_)
     {
@@ -1031,11 +1089,13 @@ PeerImp::onMessage (std::shared_ptr <protocol::TMTransaction> const& m)
             p_journal_.info << "Transaction queue is full";
         else if (getApp().getLedgerMaster().getValidatedLedgerAge() > 240)
             p_journal_.trace << "No new transactions until synchronized";
-        else
-            getApp().getJobQueue ().addJob (jtTRANSACTION,
-                "recvTransaction->checkTransaction",
-                std::bind(beast::weak_fn(&PeerImp::checkTransaction,
-                shared_from_this()), std::placeholders::_1, flags, stx));
+        else if (flags & SF_SIGGOOD)
+            queueTransaction (flags, stx, true);
+        else if (! getApp().getSignatureVerifier ().verify (txID,
+            [stx] { return passesLocalChecks (*stx) && stx->checkSign (); },
+            std::bind (beast::weak_fn (&PeerImp::queueTransaction,
+                shared_from_this()), flags, stx, std::placeholders::_1)))
+            p_journal_.info << "Signature queue is full";
     }
     catch (...)
     {
@@ -1187,10 +1247,20 @@ PeerImp::onMessage (std::shared_ptr <protocol::TMProposeSet> const& m)
             set.proposeseq (), proposeHash, set.closetime (),
                 signerPublic, suppression);
 
-    getApp().getJobQueue ().addJob (isTrusted ? jtPROPOSAL_t : jtPROPOSAL_ut,
-        "recvPropose->checkPropose", std::bind(beast::weak_fn(
-            &PeerImp::checkPropose, shared_from_this()), std::placeholders::_1,
-            m, proposal, consensusLCL));
+    // We trust our cluster's signatures
+    if (set.has_previousledger () && cluster ())
+        return queuePropose (m, proposal, consensusLCL, isTrusted, true);
+
+    // Without a previous ledger we cannot tell what was signed
+    if (! set.has_previousledger () && consensusLCL.isZero ())
+        return queuePropose (m, proposal, consensusLCL, isTrusted, false);
+
+    std::string const signature (set.signature ());
+    if (! getApp().getSignatureVerifier ().verify (suppression,
+        [proposal, signature] { return proposal->checkSign (signature); },
+        std::bind (beast::weak_fn (&PeerImp::queuePropose, shared_from_this()),
+            m, proposal, consensusLCL, isTrusted, std::placeholders::_1)))
+        p_journal_.debug << "Proposal: Dropping (signature queue full)";
 }
 
 void
@@ -1316,8 +1386,10 @@ PeerImp::onMessage (std::shared_ptr <protocol::TMValidation> const& m)
             return;
         }
 
+        uint256 const suppression = s.getSHA512Half ();
+
         if (! getApp().getHashRouter ().addSuppressionPeer (
-            s.getSHA512Half(), id_))
+            suppression, id_))
         {
             p_journal_.trace << "Validation: duplicate";
             return;
@@ -1326,11 +1398,15 @@ PeerImp::onMessage (std::shared_ptr <protocol::TMValidation> const& m)
         bool isTrusted = getApp().getUNL ().nodeInUNL (val->getSignerPublic ());
         if (isTrusted || !getApp().getFeeTrack ().isLoadedLocal ())
         {
-            getApp().getJobQueue ().addJob (isTrusted ?
-                jtVALIDATION_t : jtVALIDATION_ut, "recvValidation->checkValidation",
-                    std::bind(beast::weak_fn(&PeerImp::checkValidation,
-                        shared_from_this()), std::placeholders::_1, val,
-                            isTrusted, m));
+            if (cluster ())
+                queueValidation (val, isTrusted, m, true);
+            else if (! getApp().getSignatureVerifier ().verify (suppression,
+                [val] { return val->isValid (val->getSigningHash ()); },
+                std::bind (beast::weak_fn (&PeerImp::queueValidation,
+                    shared_from_this()), val, isTrusted, m,
+                        std::placeholders::_1)))
+                p_journal_.debug <<
+                    "Validation: Dropping (signature queue full)";
         }
         else
         {
@@ -1378,32 +1454,47 @@ PeerImp::onMessage (std::shared_ptr <protocol::TMGetObjectByHash> const& m)
         if (packet.has_ledgerhash ())
             reply.set_ledgerhash (packet.ledgerhash ());
 
-        // This is a very minimal implementation
+        // Look up all the well-formed requests in one batch
+        std::vector <int> requested;
+        std::vector <uint256> hashes;
+        requested.reserve (packet.objects_size ());
+        hashes.reserve (packet.objects_size ());
+
         for (int i = 0; i < packet.objects_size (); ++i)
         {
-            uint256 hash;
             const protocol::TMIndexedObject& obj = packet.objects (i);
 
             if (obj.has_hash () && (obj.hash ().size () == (256 / 8)))
             {
+                uint256 hash;
                 memcpy (hash.begin (), obj.hash ().data (), 256 / 8);
-                // VFALCO TODO Move this someplace more sensible so we dont
-                //             need to inject the NodeStore interfaces.
-                NodeObject::pointer hObj =
-                    getApp().getNodeStore ().fetch (hash);
+                requested.push_back (i);
+                hashes.push_back (hash);
+            }
+        }
 
-                if (hObj)
-                {
-                    protocol::TMIndexedObject& newObj = *reply.add_objects ();
-                    newObj.set_hash (hash.begin (), hash.size ());
-                    newObj.set_data (&hObj->getData ().front (),
-                        hObj->getData ().size ());
+        // VFALCO TODO Move this someplace more sensible so we dont
+        //             need to inject the NodeStore interfaces.
+        std::vector <NodeObject::pointer> const objects =
+            getApp().getNodeStore ().fetchBatch (hashes);
 
-                    if (obj.has_nodeid ())
-                        newObj.set_index (obj.nodeid ());
+        for (std::size_t i = 0; i < objects.size (); ++i)
+        {
+            NodeObject::pointer const& hObj = objects[i];
 
-                    // VFALCO NOTE "seq" in the message is obsolete
-                }
+            if (hObj)
+            {
+                const protocol::TMIndexedObject& obj =
+                    packet.objects (requested[i]);
+                protocol::TMIndexedObject& newObj = *reply.add_objects ();
+                newObj.set_hash (hashes[i].begin (), hashes[i].size ());
+                newObj.set_data (&hObj->getData ().front (),
+                    hObj->getData ().size ());
+
+                if (obj.has_nodeid ())
+                    newObj.set_index (obj.nodeid ());
+
+                // VFALCO NOTE "seq" in the message is obsolete
             }
         }
 
@@ -1412,12 +1503,26 @@ PeerImp::onMessage (std::shared_ptr <protocol::TMGetObjectByHash> const& m)
                 " of " << packet.objects_size ();
         send (std::make_shared<Message> (reply, protocol::mtGET_OBJECTS));
     }
+    else if (packet.type () == protocol::TMGetObjectByHash::otFETCH_PACK)
+    {
+        // Only packs we asked for are accepted
+        if (! getApp().getOPs ().wantFetchPack (shared_from_this ()))
+        {
+            p_journal_.debug << "GetObj: Unwanted fetch pack";
+            charge (Resource::feeUnwantedData);
+            return;
+        }
+
+        getApp().getJobQueue ().addJob (jtLEDGER_DATA, "applyFetchPack",
+            std::bind (&NetworkOPs::applyFetchPack, &getApp().getOPs (),
+                std::placeholders::_1,
+                    std::weak_ptr<PeerImp> (shared_from_this ()), m));
+    }
     else
     {
         // this is a reply
         std::uint32_t pLSeq = 0;
         bool pLDo = true;
-        bool progress = false;
 
         for (int i = 0; i < packet.objects_size (); ++i)
         {
@@ -1440,8 +1545,6 @@ PeerImp::onMessage (std::shared_ptr <protocol::TMGetObjectByHash> const& m)
                         if (!pLDo)
                                 p_journal_.debug <<
                                     "GetObj: Late fetch pack for " << pLSeq;
-                        else
-                            progress = true;
                     }
                 }
 
@@ -1462,9 +1565,6 @@ PeerImp::onMessage (std::shared_ptr <protocol::TMGetObjectByHash> const& m)
         if ((pLDo && (pLSeq != 0)) &&
                p_journal_.active(beast::Journal::Severity::kDebug))
             p_journal_.debug << "GetObj: Partial fetch pack for " << pLSeq;
-
-        if (packet.type () == protocol::TMGetObjectByHash::otFETCH_PACK)
-            getApp().getOPs ().gotFetchPack (progress, pLSeq);
     }
 }
 
@@ -1536,10 +1636,9 @@ void
 PeerImp::doFetchPack (const std::shared_ptr<protocol::TMGetObjectByHash>& packet)
 {
     // VFALCO TODO Invert this dependency using an observer and shared state object.
-    // Don't queue fetch pack jobs if we're under load or we already have
-    // some queued.
-    if (getApp().getFeeTrack ().isLoadedLocal () ||
-        (getApp().getLedgerMaster().getValidatedLedgerAge() > 40) ||
+    // Don't queue fetch pack jobs if we're not synced or we already have
+    // some queued. Under load the packs are made smaller instead.
+    if ((getApp().getLedgerMaster().getValidatedLedgerAge() > 40) ||
         (getApp().getJobQueue().getJobCount(jtPACK) > 10))
     {
         p_journal_.info << "Too busy to make fetch pack";
@@ -1562,6 +1661,47 @@ PeerImp::doFetchPack (const std::shared_ptr<protocol::TMGetObjectByHash>& packet
                 packet, hash, UptimeTimer::getInstance ().getElapsedSeconds ()));
 }
 
+void
+PeerImp::queueTransaction (int flags, STTx::pointer stx, bool sigGood)
+{
+    if (! sigGood)
+        return charge (Resource::feeInvalidSignature);
+
+    getApp().getJobQueue ().addJob (jtTRANSACTION,
+        "recvTransaction->checkTransaction",
+        std::bind(beast::weak_fn(&PeerImp::checkTransaction,
+        shared_from_this()), std::placeholders::_1, flags | SF_SIGGOOD, stx));
+}
+
+void
+PeerImp::queuePropose (std::shared_ptr <protocol::TMProposeSet> const& packet,
+    LedgerProposal::pointer proposal, uint256 consensusLCL, bool isTrusted,
+        bool sigGood)
+{
+    getApp().getJobQueue ().addJob (isTrusted ? jtPROPOSAL_t : jtPROPOSAL_ut,
+        "recvPropose->checkPropose", std::bind(beast::weak_fn(
+            &PeerImp::checkPropose, shared_from_this()), std::placeholders::_1,
+            packet, proposal, consensusLCL, sigGood));
+}
+
+void
+PeerImp::queueValidation (STValidation::pointer val, bool isTrusted,
+    std::shared_ptr<protocol::TMValidation> const& packet, bool sigGood)
+{
+    if (! sigGood)
+    {
+        p_journal_.warning <<
+            "Validation is invalid";
+        return charge (Resource::feeInvalidRequest);
+    }
+
+    getApp().getJobQueue ().addJob (isTrusted ?
+        jtVALIDATION_t : jtVALIDATION_ut, "recvValidation->checkValidation",
+            std::bind(beast::weak_fn(&PeerImp::checkValidation,
+                shared_from_this()), std::placeholders::_1, val,
+                    isTrusted, packet));
+}
+
 void
 PeerImp::checkTransaction (Job&, int flags,
     STTx::pointer stx)
@@ -1605,7 +1745,8 @@ PeerImp::checkTransaction (Job&, int flags,
 void
 PeerImp::checkPropose (Job& job,
     std::shared_ptr <protocol::TMProposeSet> const& packet,
-        LedgerProposal::pointer proposal, uint256 consensusLCL)
+        LedgerProposal::pointer proposal, uint256 consensusLCL,
+            bool signatureGood)
 {
     bool sigGood = false;
     bool isTrusted = (job.getType () == jtPROPOSAL_t);
@@ -1625,7 +1766,7 @@ PeerImp::checkPropose (Job& job,
             "proposal with previous ledger";
         memcpy (prevLedger.begin (), set.previousledger ().data (), 256 / 8);
 
-        if (! cluster() && !proposal->checkSign (set.signature ()))
+        if (! cluster() && ! signatureGood)
         {
             p_journal_.warning <<
                 "Proposal with previous ledger fails sig check";
@@ -1637,7 +1778,7 @@ PeerImp::checkPropose (Job& job,
     }
     else
     {
-        if (consensusLCL.isNonZero () && proposal->checkSign (set.signature ()))
+        if (consensusLCL.isNonZero () && signatureGood)
         {
             prevLedger = consensusLCL;
             sigGood = true;
@@ -1682,17 +1823,11 @@ void
 PeerImp::checkValidation (Job&, STValidation::pointer val,
     bool isTrusted, std::shared_ptr<protocol::TMValidation> const& packet)
 {
+    // The signature was checked by queueValidation
     try
     {
         // VFALCO Which functions throw?
         uint256 signingHash = val->getSigningHash();
-        if (! cluster() && !val->isValid (signingHash))
-        {
-            p_journal_.warning <<
-                "Validation is invalid";
-            charge (Resource::feeInvalidRequest);
-            return;
-        }
 
     #if RIPPLE_HOOK_VALIDATORS
         validatorsConnection_->onValidation(*val);
@@ -42,7 +42,8 @@
 #include <beast/http/parser.h>
 #include <beast/utility/WrappedSink.h>
 #include <cstdint>
-#include <queue>
+#include <deque>
+#include <vector>
 
 namespace ripple {
 
@@ -102,6 +103,8 @@ private:
     boost::asio::io_service::strand strand_;
     boost::asio::basic_waitable_timer<
         std::chrono::steady_clock> timer_;
+    boost::asio::basic_waitable_timer<
+        std::chrono::steady_clock> batch_timer_;
 
     //Type type_ = Type::legacy;
 
@@ -137,7 +140,13 @@ private:
     beast::http::message http_message_;
     beast::http::body http_body_;
     beast::asio::streambuf write_buffer_;
-    std::queue<Message::pointer> send_queue_;
+    std::deque<Message::pointer> send_queue_;
+    // Messages in the current write. Their buffers are shared with every
+    // other peer they were sent to, so they are kept until it completes.
+    std::vector<Message::pointer> writing_;
+    // Small queued messages joined so that they go out in one write
+    std::vector<std::uint8_t> coalesce_buffer_;
+    bool batching_ = false;
     bool gracefulClose_ = false;
     std::unique_ptr <LoadEvent> load_event_;
     std::unique_ptr<Validators::Connection> validatorsConnection_;
@@ -325,6 +334,14 @@ private:
     void
     onReadMessage (error_code ec, std::size_t bytes_transferred);
 
+    // Writes queued protocol messages
+    void
+    doWriteMessages();
+
+    // Called when the write batching window ends
+    void
+    onBatchTimer (error_code const& ec);
+
     // Called when protocol messages bytes are sent
     void
     onWriteMessage (error_code ec, std::size_t bytes_transferred);
@@ -406,13 +423,27 @@ private:
     void
     doFetchPack (const std::shared_ptr<protocol::TMGetObjectByHash>& packet);
 
+    // Called with the signature verdict to queue the matching check
+    void
+    queueTransaction (int flags, STTx::pointer stx, bool sigGood);
+
+    void
+    queuePropose (std::shared_ptr<protocol::TMProposeSet> const& packet,
+        LedgerProposal::pointer proposal, uint256 consensusLCL,
+            bool isTrusted, bool sigGood);
+
+    void
+    queueValidation (STValidation::pointer val, bool isTrusted,
+        std::shared_ptr<protocol::TMValidation> const& packet, bool sigGood);
+
     void
     checkTransaction (Job&, int flags, STTx::pointer stx);
 
     void
     checkPropose (Job& job,
         std::shared_ptr<protocol::TMProposeSet> const& packet,
-            LedgerProposal::pointer proposal, uint256 consensusLCL);
+            LedgerProposal::pointer proposal, uint256 consensusLCL,
+                bool signatureGood);
 
     void
     checkValidation (Job&, STValidation::pointer val,
@@ -446,6 +477,7 @@ PeerImp::PeerImp (id_t id, endpoint_type remote_endpoint,
     , stream_ (ssl_bundle_->stream)
     , strand_ (socket_.get_io_service())
     , timer_ (socket_.get_io_service())
+    , batch_timer_ (socket_.get_io_service())
     , remote_address_ (
         beast::IPAddressConversion::from_asio(remote_endpoint))
     , overlay_ (overlay)
@@ -475,6 +507,7 @@ PeerImp::PeerImp (std::unique_ptr<beast::asio::ssl_bundle>&& ssl_bundle,
     , stream_ (ssl_bundle_->stream)
     , strand_ (socket_.get_io_service())
     , timer_ (socket_.get_io_service())
+    , batch_timer_ (socket_.get_io_service())
     , remote_address_ (slot->remote_endpoint())
     , overlay_ (overlay)
     , m_inbound (false)
@@ -28,7 +28,12 @@ namespace Tuning
 enum
 {
     /** Size of buffer used to read from the socket. */
-    readBufferBytes     = 4096
+    readBufferBytes     = 4096,
+
+    /** Most bytes of queued messages joined into a single write.
+        This is the largest TLS record, which goes out in one send.
+    */
+    writeCoalesceBytes  = 16384
 };
 
 } // Tuning
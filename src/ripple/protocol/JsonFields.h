@@ -89,6 +89,7 @@ JSS ( full );
 JSS ( hash );
 JSS ( hostid );
 JSS ( id );
+JSS ( index );
 JSS ( issuer );
 JSS ( last_close );
 JSS ( ledger );
@@ -154,6 +155,7 @@ JSS ( seqNum );
 JSS ( server_state );
 JSS ( server_status );
 JSS ( stand_alone );
+JSS ( state );
 JSS ( status );
 JSS ( success );
 JSS ( system_time_offset );
@@ -1,6 +1,23 @@
 namespace ripple {
 
-// account_dividend [account]
+static void fillDividend (Json::Value& result,
+    NetworkOPs::AccountDividend const& dividend)
+{
+    result["DividendCoins"] = to_string(dividend.coins);
+    result["DividendCoinsVBC"] = to_string(dividend.coinsVBC);
+    result["DividendCoinsVBCRank"] = to_string(dividend.coinsVBCRank);
+    result["DividendCoinsVBCSprd"] = to_string(dividend.coinsVBCSprd);
+    result["DividendTSprd"] = to_string(dividend.tSprd);
+    result["DividendVRank"] = to_string(dividend.vRank);
+    result["DividendVSprd"] = to_string(dividend.vSprd);
+    result["DividendLedger"] = to_string(dividend.dividendLedger);
+}
+
+// account_dividend [account] [limit] [marker]
+//
+// Reports the account's share of the latest dividend. With a limit, also
+// lists the account's earlier dividends, newest first. The marker returned
+// with a page is passed to fetch the next one.
 Json::Value doAccountDividend (RPC::Context& context)
 {
     if (!context.params.isMember ("account"))
@@ -10,58 +27,62 @@ Json::Value doAccountDividend (RPC::Context& context)
     Json::Value result;
     auto account = context.params["account"].asString();
     result["Account"] = account;
-    
-    Ledger::pointer ledger = getApp().getOPs().getClosedLedger();
+
+    RippleAddress raAccount;
+    if (!raAccount.setAccountID (account))
+        return rpcError (rpcACT_MALFORMED);
+
+    auto& netOPs = getApp().getOPs();
+
+    NetworkOPs::AccountDividend latest {};
+    Ledger::pointer ledger = netOPs.getClosedLedger();
     SLE::pointer dividendSLE = ledger->getDividendObject();
     if (dividendSLE && dividendSLE->isFieldPresent(sfDividendLedger))
     {
         std::uint32_t baseLedgerSeq = dividendSLE->getFieldU32(sfDividendLedger);
-        std::string sql =
-        boost::str (boost::format ("SELECT AccountTransactions.TransID FROM AccountTransactions JOIN Transactions "
-                                   "ON AccountTransactions.TransID=Transactions.TransID "
-                                   "WHERE Account='%s' AND AccountTransactions.LedgerSeq>%d "
-                                   "AND TransType='Dividend' "
-                                   "ORDER BY AccountTransactions.LedgerSeq ASC LIMIT 1;")
-                    % account.c_str()
-                    % baseLedgerSeq);
-        Transaction::pointer txn = nullptr;
+        auto dividends = netOPs.getAccountDividends (raAccount, baseLedgerSeq, 1);
+        if (!dividends.empty () && dividends[0].dividendLedger == baseLedgerSeq)
+            latest = dividends[0];
+    }
+    fillDividend (result, latest);
+
+    if (context.params.isMember (jss::limit))
+    {
+        static unsigned int const maxLimit = 200;
+
+        unsigned int limit = context.params[jss::limit].asUInt ();
+        if (context.role != Role::ADMIN)
+            limit = std::min (limit, maxLimit);
+        limit = std::max (limit, 1u);
+
+        std::uint32_t marker = 0;
+        if (context.params.isMember (jss::marker))
         {
-            auto db = getApp().getTxnDB().getDB();
-            auto sl (getApp().getTxnDB().lock());
-            if (db->executeSQL(sql) && db->startIterRows())
-            {
-                std::string transID = "";
-                db->getStr(0, transID);
-                db->endIterRows();
-                if (transID != "")
-                {
-                    uint256 txid (transID);
-                    txn = getApp().getMasterTransaction ().fetch (txid, true);
-                }
-            }
+            marker = context.params[jss::marker].asUInt ();
+            if (marker == 0)
+                return rpcError (rpcINVALID_PARAMS);
         }
-        if (txn)
+
+        // One more than asked for tells us whether there is another page
+        auto dividends = netOPs.getAccountDividends (raAccount, marker, limit + 1);
+
+        Json::Value& history = (result["Dividends"] = Json::arrayValue);
+        for (auto const& dividend : dividends)
         {
-            result["DividendCoins"] = to_string(txn->getSTransaction()->getFieldU64(sfDividendCoins));
-            result["DividendCoinsVBC"] = to_string(txn->getSTransaction()->getFieldU64(sfDividendCoinsVBC));
-            result["DividendCoinsVBCRank"] = to_string(txn->getSTransaction()->getFieldU64(sfDividendCoinsVBCRank));
-            result["DividendCoinsVBCSprd"] = to_string(txn->getSTransaction()->getFieldU64(sfDividendCoinsVBCSprd));
-            result["DividendTSprd"] = to_string(txn->getSTransaction()->getFieldU64(sfDividendTSprd));
-            result["DividendVRank"] = to_string(txn->getSTransaction()->getFieldU64(sfDividendVRank));
-            result["DividendVSprd"] = to_string(txn->getSTransaction()->getFieldU64(sfDividendVSprd));
-            result["DividendLedger"] = to_string(txn->getSTransaction()->getFieldU32(sfDividendLedger));
+            if (history.size () == limit)
+            {
+                result[jss::marker] = dividend.dividendLedger;
+                break;
+            }
 
-            return result;
+            Json::Value& entry = history.append (Json::objectValue);
+            fillDividend (entry, dividend);
+            entry["LedgerSeq"] = dividend.ledgerSeq;
+            entry["hash"] = to_string (dividend.transID);
         }
+        result[jss::limit] = limit;
     }
-    result["DividendCoins"] = "0";
-    result["DividendCoinsVBC"] = "0";
-    result["DividendCoinsVBCRank"] = "0";
-    result["DividendCoinsVBCSprd"] = "0";
-    result["DividendTSprd"] = "0";
-    result["DividendVRank"] = "0";
-    result["DividendVSprd"] = "0";
-    result["DividendLedger"] = "0";
+
     return result;
 }
 
@@ -76,6 +76,8 @@ void addLine (Json::Value& jsonLines, RippleState const& line)
 // }
 Json::Value doAccountLines (RPC::Context& context)
 {
+    Json::ValueArena::Scope arena (context.arena);
+
     auto const& params (context.params);
     if (! params.isMember (jss::account))
         return RPC::missing_field_error ("account");
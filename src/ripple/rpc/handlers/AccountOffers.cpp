@@ -32,6 +32,8 @@ namespace ripple {
 // }
 Json::Value doAccountOffers (RPC::Context& context)
 {
+    Json::ValueArena::Scope arena (context.arena);
+
     auto const& params (context.params);
     if (! params.isMember (jss::account))
         return RPC::missing_field_error ("account");
@@ -18,6 +18,7 @@
 //==============================================================================
 
 #include <BeastConfig.h>
+#include <ripple/app/ledger/InboundLedgers.h>
 
 namespace ripple {
 
@@ -32,6 +33,7 @@ Json::Value doFetchInfo (RPC::Context& context)
     }
 
     ret["info"] = context.netOps.getLedgerFetchInfo();
+    ret["throughput"] = getApp().getInboundLedgers().getThroughput();
 
     return ret;
 }
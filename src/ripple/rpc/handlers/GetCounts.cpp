@@ -21,6 +21,7 @@
 #include <ripple/app/data/DatabaseCon.h>
 #include <ripple/app/data/SqliteDatabase.h>
 #include <ripple/app/ledger/AcceptedLedger.h>
+#include <ripple/app/paths/Pathfinder.h>
 #include <ripple/basics/UptimeTimer.h>
 #include <ripple/nodestore/Database.h>
 #include <boost/foreach.hpp>
@@ -77,6 +78,9 @@ Json::Value doGetCounts (RPC::Context& context)
     ret["node_hit_rate"] = app.getNodeStore ().getCacheHitRate ();
     ret["ledger_hit_rate"] = app.getLedgerMaster ().getCacheHitRate ();
     ret["AL_hit_rate"] = AcceptedLedger::getCacheHitRate ();
+    ret["path_hit_rate"] = Pathfinder::getCacheHitRate ();
+    ret["path_saved_ms"] = static_cast<Json::UInt> (
+        Pathfinder::getCacheSavedTime ());
 
     ret["fullbelow_size"] = static_cast<int>(app.getFullBelowCache().size());
     ret["treenode_cache_size"] = app.getTreeNodeCache().getCacheSize();
@@ -18,95 +18,60 @@
 //==============================================================================
 
 #include <BeastConfig.h>
+#include <ripple/rpc/handlers/LedgerData.h>
 #include <ripple/server/Role.h>
 
 namespace ripple {
+namespace RPC {
 
-// Get state nodes from a ledger
-//   Inputs:
-//     limit:        integer, maximum number of entries
-//     marker:       opaque, resume point
-//     binary:       boolean, format
-//   Outputs:
-//     ledger_hash:  chosen ledger's hash
-//     ledger_index: chosen ledger's index
-//     state:        array of state nodes
-//     marker:       resume point, if any
-Json::Value doLedgerData (RPC::Context& context)
+LedgerDataHandler::LedgerDataHandler (Context& context) : context_ (context)
+{
+}
+
+Status LedgerDataHandler::check ()
 {
     int const BINARY_PAGE_LENGTH = 2048;
     int const JSON_PAGE_LENGTH = 256;
 
-    Ledger::pointer lpLedger;
-    auto const& params = context.params;
+    auto const& params = context_.params;
 
-    Json::Value jvResult = RPC::lookupLedger (params, lpLedger, context.netOps);
-    if (!lpLedger)
-        return jvResult;
+    if (auto s = RPC::lookupLedger (params, ledger_, context_.netOps, result_))
+        return s;
 
-    uint256 resumePoint;
-    if (params.isMember ("marker"))
+    if (params.isMember (jss::marker))
     {
-        Json::Value const& jMarker = params["marker"];
-        if (!jMarker.isString ())
-            return RPC::expected_field_error ("marker", "valid");
-        if (!resumePoint.SetHex (jMarker.asString ()))
-            return RPC::expected_field_error ("marker", "valid");
+        Json::Value const& jMarker = params[jss::marker];
+        if (!jMarker.isString () || !resumePoint_.SetHex (jMarker.asString ()))
+        {
+            return Status (rpcINVALID_PARAMS,
+                expected_field_message ("marker", "valid"));
+        }
     }
 
-    bool isBinary = params["binary"].asBool();
+    binary_ = params["binary"].asBool();
 
-    int limit = -1;
-    int maxLimit = isBinary ? BINARY_PAGE_LENGTH : JSON_PAGE_LENGTH;
+    int maxLimit = binary_ ? BINARY_PAGE_LENGTH : JSON_PAGE_LENGTH;
 
-    if (params.isMember ("limit"))
+    if (params.isMember (jss::limit))
     {
-        Json::Value const& jLimit = params["limit"];
+        Json::Value const& jLimit = params[jss::limit];
         if (!jLimit.isIntegral ())
-            return RPC::expected_field_error ("limit", "integer");
+        {
+            return Status (rpcINVALID_PARAMS,
+                expected_field_message ("limit", "integer"));
+        }
 
-        limit = jLimit.asInt ();
+        limit_ = jLimit.asInt ();
     }
 
-    if ((limit < 0) || ((limit > maxLimit) && (context.role != Role::ADMIN)))
-        limit = maxLimit;
-
-    jvResult["ledger_hash"] = to_string (lpLedger->getHash());
-    jvResult["ledger_index"] = std::to_string( lpLedger->getLedgerSeq ());
+    if ((limit_ < 0) || ((limit_ > maxLimit) && (context_.role != Role::ADMIN)))
+        limit_ = maxLimit;
 
-    Json::Value& nodes = (jvResult["state"] = Json::arrayValue);
-    SHAMap& map = *(lpLedger->peekAccountStateMap ());
-
-    for (;;)
-    {
-       SHAMapItem::pointer item = map.peekNextItem (resumePoint);
-       if (!item)
-           break;
-       resumePoint = item->getTag();
-
-       if (limit-- <= 0)
-       {
-           --resumePoint;
-           jvResult["marker"] = to_string (resumePoint);
-           break;
-       }
-
-       if (isBinary)
-       {
-           Json::Value& entry = nodes.append (Json::objectValue);
-           entry["data"] = strHex (
-               item->peekData().begin(), item->peekData().size());
-           entry["index"] = to_string (item->getTag ());
-       }
-       else
-       {
-           SLE sle (item->peekSerializer(), item->getTag ());
-           Json::Value& entry = nodes.append (sle.getJson (0));
-           entry["index"] = to_string (item->getTag ());
-       }
-    }
+    result_[jss::ledger_hash] = to_string (ledger_->getHash());
+    result_[jss::ledger_index] = std::to_string (ledger_->getLedgerSeq ());
 
-    return jvResult;
+    return Status::OK;
 }
 
+} // RPC
 } // ripple
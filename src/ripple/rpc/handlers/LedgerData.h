@@ -0,0 +1,134 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLED_RIPPLE_RPC_HANDLERS_LEDGERDATA_H
+#define RIPPLED_RIPPLE_RPC_HANDLERS_LEDGERDATA_H
+
+#include <ripple/app/ledger/Ledger.h>
+#include <ripple/rpc/impl/JsonObject.h>
+#include <ripple/server/Role.h>
+
+namespace ripple {
+namespace RPC {
+
+// Get state nodes from a ledger
+//   Inputs:
+//     limit:        integer, maximum number of entries
+//     marker:       opaque, resume point
+//     binary:       boolean, format
+//   Outputs:
+//     ledger_hash:  chosen ledger's hash
+//     ledger_index: chosen ledger's index
+//     state:        array of state nodes
+//     marker:       resume point, if any
+class LedgerDataHandler {
+public:
+    explicit LedgerDataHandler (Context&);
+
+    Status check ();
+
+    template <class Object>
+    void writeResult (Object&);
+
+    static const char* const name()
+    {
+        return "ledger_data";
+    }
+
+    static Role role()
+    {
+        return Role::USER;
+    }
+
+    static Condition condition()
+    {
+        return NEEDS_CURRENT_LEDGER;
+    }
+
+private:
+    Context& context_;
+    Ledger::pointer ledger_;
+    Json::Value result_;
+    uint256 resumePoint_;
+    bool binary_ = false;
+    int limit_ = -1;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation.
+
+template <class Object>
+void LedgerDataHandler::writeResult (Object& value)
+{
+    RPC::copyFrom (value, result_);
+
+    auto resumePoint = resumePoint_;
+    auto limit = limit_;
+    bool more = false;
+
+    // Read no further ahead than the page needs; admin limits are
+    // unclamped, so avoid computing limit + 1 when it could overflow
+    int const readAhead = limit < SHAMap::LeafIterator::defaultReadAhead
+        ? limit + 1 : SHAMap::LeafIterator::defaultReadAhead;
+    SHAMap::LeafIterator it (*(ledger_->peekAccountStateMap ()),
+        readAhead, resumePoint);
+
+    {
+        auto&& nodes = RPC::addArray (value, jss::state);
+        for (;;)
+        {
+            SHAMapItem::pointer item = it.next ();
+            if (!item)
+                break;
+            resumePoint = item->getTag();
+
+            if (limit-- <= 0)
+            {
+                --resumePoint;
+                more = true;
+                break;
+            }
+
+            auto&& entry = RPC::appendObject (nodes);
+            if (binary_)
+            {
+                entry[jss::data] = strHex (
+                    item->peekData().begin(), item->peekData().size());
+                entry[jss::index] = to_string (item->getTag ());
+            }
+            else
+            {
+                // The entry's own JSON includes its index.
+                SLE sle (item->peekSerializer(), item->getTag ());
+                RPC::copyFrom (entry, sle);
+            }
+        }
+    }
+
+    // The marker is only known once the page has been written.
+    if (more)
+        value[jss::marker] = to_string (resumePoint);
+}
+
+} // RPC
+} // ripple
+
+#endif
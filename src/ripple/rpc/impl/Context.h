@@ -40,6 +40,13 @@ struct Context
     Role role;
     InfoSub::pointer infoSub;
     RPC::Yield yield;
+
+    /** An arena that outlives the reply, or null.
+        Handlers that build large replies, keep no Values after returning
+        and never yield may build the reply in it by opening a
+        Json::ValueArena::Scope on it.
+    */
+    Json::ValueArena* arena;
 };
 
 } // RPC
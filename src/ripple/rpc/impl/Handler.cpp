@@ -66,6 +66,7 @@ class HandlerTable {
 
         // This is where the new-style handlers are added.
         addHandler<LedgerHandler>();
+        addHandler<LedgerDataHandler>();
     }
 
     const Handler* getHandler(std::string name) {
@@ -112,7 +113,6 @@ HandlerTable HANDLERS({
     {   "ledger_cleaner",       byRef (&doLedgerCleaner),       Role::ADMIN,   NEEDS_NETWORK_CONNECTION  },
     {   "ledger_closed",        byRef (&doLedgerClosed),        Role::USER,  NEEDS_CLOSED_LEDGER   },
     {   "ledger_current",       byRef (&doLedgerCurrent),       Role::USER,  NEEDS_CURRENT_LEDGER  },
-    {   "ledger_data",          byRef (&doLedgerData),          Role::USER,  NEEDS_CURRENT_LEDGER  },
     {   "ledger_entry",         byRef (&doLedgerEntry),         Role::USER,  NEEDS_CURRENT_LEDGER  },
     {   "ledger_header",        byRef (&doLedgerHeader),        Role::USER,  NEEDS_CURRENT_LEDGER  },
     {   "ledger_request",       byRef (&doLedgerRequest),       Role::ADMIN,   NO_CONDITION     },
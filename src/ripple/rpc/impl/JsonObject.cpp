@@ -19,6 +19,9 @@
 
 #include <BeastConfig.h>
 #include <ripple/rpc/impl/JsonObject.h>
+#include <ripple/protocol/STArray.h>
+#include <ripple/protocol/STLedgerEntry.h>
+#include <ripple/protocol/STTx.h>
 
 namespace ripple {
 namespace RPC {
@@ -151,6 +154,80 @@ void copyFrom (Object& to, Json::Value const& from)
     doCopyFrom (to, from);
 }
 
+namespace {
+
+void writeFields (Object& to, STObject const& from);
+
+// Matches STArray::getJson: each element is an object holding a single
+// key, the element's field name, whose value is the element.
+void writeElements (Array& to, STArray const& from)
+{
+    int index = 1;
+    for (auto const& object: from)
+    {
+        if (object.getSType () != STI_NOTPRESENT)
+        {
+            auto const& name = object.getFName ();
+            auto inner = to.makeObject ();
+            auto element = name.hasName () ?
+                inner.makeObject (name.fieldName) :
+                inner.makeObject (std::to_string (index));
+            writeFields (element, object);
+            ++index;
+        }
+    }
+}
+
+// STObject::getJson never advances its index, so every unnamed field is "1".
+std::string const unnamedField ("1");
+
+// Matches STObject::getJson.
+void writeFields (Object& to, STObject const& from)
+{
+    for (auto const& field: from)
+    {
+        auto const type = field.getSType ();
+        if (type == STI_NOTPRESENT)
+            continue;
+
+        auto const& name = field.getFName ();
+        auto const& key = name.hasName () ? name.fieldName : unnamedField;
+
+        if (type == STI_OBJECT)
+        {
+            auto object = to.makeObject (key);
+            writeFields (object, static_cast <STObject const&> (field));
+        }
+        else if (type == STI_ARRAY)
+        {
+            auto array = to.makeArray (key);
+            writeElements (array, static_cast <STArray const&> (field));
+        }
+        else
+        {
+            to.set (key, field.getJson (0));
+        }
+    }
+}
+
+} // namespace
+
+void copyFrom (Json::Value& to, STObject const& from)
+{
+    copyFrom (to, from.getJson (0));
+}
+
+void copyFrom (Object& to, STObject const& from)
+{
+    writeFields (to, from);
+
+    // The fields that getJson adds for the derived objects.
+    if (auto const txn = dynamic_cast <STTx const*> (&from))
+        to.set ("hash", to_string (txn->getTransactionID ()));
+    else if (auto const sle = dynamic_cast <STLedgerEntry const*> (&from))
+        to.set ("index", to_string (sle->getIndex ()));
+}
+
 
 WriterObject stringWriterObject (std::string& s)
 {
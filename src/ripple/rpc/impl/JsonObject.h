@@ -23,6 +23,9 @@
 #include <ripple/rpc/impl/JsonWriter.h>
 
 namespace ripple {
+
+class STObject;
+
 namespace RPC {
 
 /**
@@ -283,6 +286,24 @@ void copyFrom (Json::Value& to, Json::Value const& from);
 /** Copy all the keys and values from one object into another. */
 void copyFrom (Object& to, Json::Value const& from);
 
+/** Copy the fields of a serialized object into an object.
+    The result is the same as copying from `from.getJson (0)`.
+*/
+void copyFrom (Json::Value& to, STObject const& from);
+
+/** Copy the fields of a serialized object into an object.
+    Each field is written as it is reached, so no Json::Value is built for
+    the object or for any object or array inside it.  Only the keys appear
+    in field order rather than sorted.
+*/
+void copyFrom (Object& to, STObject const& from);
+
+/** Append a new subobject to a Json array. */
+Json::Value& appendObject (Json::Value&);
+
+/** Append a new subobject to a Json array. */
+Object appendObject (Array&);
+
 /** An Object that contains its own Writer. */
 class WriterObject
 {
@@ -383,6 +404,18 @@ Object addObject (Object& object, Json::StaticString const& key)
     return object.makeObject (std::string (key));
 }
 
+inline
+Json::Value& appendObject (Json::Value& json)
+{
+    return json.append (Json::objectValue);
+}
+
+inline
+Object appendObject (Array& array)
+{
+    return array.makeObject ();
+}
+
 } // RPC
 } // ripple
 
@@ -21,24 +21,58 @@
 #include <ripple/rpc/impl/JsonWriter.h>
 #include <ripple/rpc/impl/WriteJson.h>
 #include <beast/unit_test/suite.h>
+#include <array>
 
 namespace ripple {
 namespace RPC {
 
 namespace {
 
-std::map <char, const char*> jsonSpecialCharacterEscape = {
-    {'"',  "\\\""},
-    {'\\', "\\\\"},
-    {'/',  "\\/"},
-    {'\b', "\\b"},
-    {'\f', "\\f"},
-    {'\n', "\\n"},
-    {'\r', "\\r"},
-    {'\t', "\\t"}
+// The escape sequence for each character, or an empty string for the
+// characters that are written as they are.  Looking a character up here costs
+// one index, which matters because every byte of every string goes through it.
+class EscapeTable
+{
+public:
+    EscapeTable ()
+    {
+        static char const hex[] = "0123456789abcdef";
+        for (int c = 0; c < controls; ++c)
+        {
+            char* s = unicode_[c];
+            s[0] = '\\';
+            s[1] = 'u';
+            s[2] = '0';
+            s[3] = '0';
+            s[4] = hex[c >> 4];
+            s[5] = hex[c & 0xf];
+            escapes_[c] = boost::string_ref (s, unicodeLength);
+        }
+
+        escapes_['"']  = "\\\"";
+        escapes_['\\'] = "\\\\";
+        escapes_['/']  = "\\/";
+        escapes_['\b'] = "\\b";
+        escapes_['\f'] = "\\f";
+        escapes_['\n'] = "\\n";
+        escapes_['\r'] = "\\r";
+        escapes_['\t'] = "\\t";
+    }
+
+    boost::string_ref const& operator[] (char c) const
+    {
+        return escapes_[static_cast <unsigned char> (c)];
+    }
+
+private:
+    static int const controls = 0x20;
+    static std::size_t const unicodeLength = 6;
+
+    std::array <boost::string_ref, 256> escapes_;
+    char unicode_[controls][unicodeLength];
 };
 
-static size_t const jsonEscapeLength = 2;
+EscapeTable const jsonSpecialCharacterEscape;
 
 // All other JSON punctuation.
 const char closeBrace = '}';
@@ -107,14 +141,14 @@ public:
         auto data = bytes.data();
         for (; position < bytes.size(); ++position)
         {
-            auto i = jsonSpecialCharacterEscape.find (data[position]);
-            if (i != jsonSpecialCharacterEscape.end ())
+            auto const& escape = jsonSpecialCharacterEscape[data[position]];
+            if (! escape.empty ())
             {
                 if (writtenUntil < position)
                 {
                     output_ ({data + writtenUntil, position - writtenUntil});
                 }
-                output_ ({i->second, jsonEscapeLength});
+                output_ (escape);
                 writtenUntil = position + 1;
             };
         }
@@ -145,13 +179,14 @@ public:
             output_ ({&comma, 1});
     }
 
-    void writeObjectTag (std::string const& tag)
+    void writeObjectTag (boost::string_ref const& tag)
     {
 #ifdef DEBUG
         // Make sure we haven't already seen this tag.
         auto& tags = stack_.top ().tags;
-        check (tags.find (tag) == tags.end (), "Already seen tag " + tag);
-        tags.insert (tag);
+        check (tags.find (tag.to_string ()) == tags.end (),
+               "Already seen tag " + tag.to_string ());
+        tags.insert (tag.to_string ());
 #endif
 
         stringOutput (tag);
@@ -243,8 +278,9 @@ void Writer::output (std::string const& s)
 
 void Writer::output (Json::Value const& value)
 {
-    impl_->markStarted();
-    writeJson (value, impl_->getOutput());
+    // Nested collections go on this Writer's own stack, so a Json::Value
+    // inside an Object costs no more than writing its members by hand.
+    writeJson (value, *this);
 }
 
 template <>
@@ -283,7 +319,7 @@ void Writer::rawAppend()
     impl_->nextCollectionEntry (array, "append");
 }
 
-void Writer::rawSet (std::string const& tag)
+void Writer::rawSet (boost::string_ref const& tag)
 {
     check (!tag.empty(), "Tag can't be empty");
 
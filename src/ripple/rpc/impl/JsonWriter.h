@@ -156,7 +156,7 @@ public:
      *  literal, nullptr or Json::Value
      */
     template <typename Scalar>
-    void append (Scalar t)
+    void append (Scalar const& t)
     {
         rawAppend();
         output (t);
@@ -178,7 +178,7 @@ public:
      *  the tag you use has already been used in this object.
      */
     template <typename Type>
-    void set (std::string const& tag, Type t)
+    void set (std::string const& tag, Type const& t)
     {
         rawSet (tag);
         output (t);
@@ -186,7 +186,7 @@ public:
 
     /** Emit just "tag": as part of an object.  Useful if you are writing the
         actual value data yourself. */
-    void rawSet (std::string const& key);
+    void rawSet (boost::string_ref const& key);
 
     // You won't need to call anything below here until you are writing single
     // items (numbers, strings, bools, null) to a JSON stream.
@@ -197,7 +197,7 @@ public:
     /*** Output a literal constant or C string. */
     void output (char const*);
 
-    /*** Output a literal constant or C string. */
+    /*** Output a legacy Json::Value. */
     void output (Json::Value const&);
 
     /** Output numbers, booleans, or nullptr. */
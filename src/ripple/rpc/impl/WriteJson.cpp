@@ -24,8 +24,6 @@
 namespace ripple {
 namespace RPC {
 
-namespace {
-
 void writeJson (Json::Value const& value, Writer& writer)
 {
     switch (value.type())
@@ -56,7 +54,7 @@ void writeJson (Json::Value const& value, Writer& writer)
 
     case Json::stringValue:
     {
-        writer.output (value.asString());
+        writer.output (value.asCString());
         break;
     }
 
@@ -81,11 +79,11 @@ void writeJson (Json::Value const& value, Writer& writer)
     case Json::objectValue:
     {
         writer.startRoot (Writer::object);
-        auto members = value.getMemberNames ();
-        for (auto const& tag: members)
+        // Walk the members in place rather than copying out their names.
+        for (auto i = value.begin (); i != value.end (); ++i)
         {
-            writer.rawSet (tag);
-            writeJson (value[tag], writer);
+            writer.rawSet (i.memberName ());
+            writeJson (*i, writer);
         }
         writer.finish();
         break;
@@ -93,8 +91,6 @@ void writeJson (Json::Value const& value, Writer& writer)
     } // switch
 }
 
-} // namespace
-
 void writeJson (Json::Value const& value, Output const& out)
 {
     Writer writer (out);
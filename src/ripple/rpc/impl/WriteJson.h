@@ -20,9 +20,14 @@
 #ifndef RIPPLED_RIPPLE_RPC_IMPL_WRITELEGACYJSON_H
 #define RIPPLED_RIPPLE_RPC_IMPL_WRITELEGACYJSON_H
 
+#include <ripple/json/json_value.h>
+#include <ripple/rpc/Output.h>
+
 namespace ripple {
 namespace RPC {
 
+class Writer;
+
 /** Writes a minimal representation of a Json value to an Output in O(n) time.
 
     Data is streamed right to the output, so only a marginal amount of memory is
@@ -30,6 +35,11 @@ namespace RPC {
  */
 void writeJson (Json::Value const&, Output const&);
 
+/** Writes a Json value to a Writer that may already be in the middle of a
+    collection, as the value of the last key set or appended.
+ */
+void writeJson (Json::Value const&, Writer&);
+
 /** Return the minimal string representation of a Json::Value in O(n) time.
 
     This requires a memory allocation for the full size of the output.
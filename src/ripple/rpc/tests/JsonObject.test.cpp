@@ -19,8 +19,18 @@
 
 #include <BeastConfig.h>
 #include <ripple/rpc/impl/JsonObject.h>
+#include <ripple/rpc/impl/WriteJson.h>
+#include <ripple/basics/StringUtilities.h>
+#include <ripple/json/json_reader.h>
+#include <ripple/json/to_string.h>
+#include <ripple/protocol/JsonFields.h>
+#include <ripple/protocol/STArray.h>
+#include <ripple/protocol/STLedgerEntry.h>
 #include <ripple/rpc/tests/TestOutputSuite.test.h>
+#include <beast/module/core/text/LexicalCast.h>
 #include <beast/unit_test/suite.h>
+#include <chrono>
+#include <vector>
 
 namespace ripple {
 namespace RPC {
@@ -228,6 +238,67 @@ public:
 #endif
     }
 
+    // Parse what was written and compare it with the legacy rendering.
+    void expectJson (Json::Value const& expected)
+    {
+        writerObject_.reset();
+        Json::Value written;
+        expect (Json::Reader().parse (output_, written), output_);
+        expect (written == expected, output_);
+    }
+
+    void testSTObject ()
+    {
+        setup ("STObject");
+
+        STObject memo (sfMemo);
+        memo.setFieldVL (sfMemoType, strCopy ("text/plain"));
+        memo.setFieldVL (sfMemoData, strCopy ("\"quoted\"\n"));
+        STArray memos;
+        memos.push_back (memo);
+        memos.push_back (memo);
+
+        STObject object (sfTransactionMetaData);
+        object.setFieldU32 (sfSequence, 7);
+        object.setFieldAmount (sfAmount, STAmount (std::uint64_t (1000)));
+        object.setFieldArray (sfMemos, memos);
+
+        {
+            auto& root = makeRoot();
+            copyFrom (root, object);
+        }
+        expectJson (object.getJson (0));
+
+        setup ("STObject in array");
+        {
+            auto& root = makeRoot();
+            auto array = root.makeArray ("array");
+            auto element = appendObject (array);
+            copyFrom (element, object);
+        }
+        Json::Value expected (Json::objectValue);
+        expected["array"] = Json::arrayValue;
+        copyFrom (appendObject (expected["array"]), object);
+        expectJson (expected);
+    }
+
+    void testSTLedgerEntry ()
+    {
+        setup ("STLedgerEntry");
+
+        STLedgerEntry sle (ltOFFER, uint256 (7));
+        sle.setFieldU32 (sfSequence, 3);
+        sle.setFieldAmount (sfTakerPays, STAmount (std::uint64_t (5)));
+
+        {
+            auto& root = makeRoot();
+            copyFrom (root, sle);
+        }
+        auto const expected = sle.getJson (0);
+        expect (expected.isMember ("index"));
+        expectJson (expected);
+    }
+
     void run () override
     {
         testTrivial ();
@@ -241,10 +312,119 @@ public:
         testFailureObject ();
         testFailureArray ();
         testKeyFailure ();
+
+        testSTObject ();
+        testSTLedgerEntry ();
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// Compares the rate at which a page of ledger entries is rendered as JSON by
+// building a Json::Value and writing it with FastWriter, by building a
+// Json::Value and streaming it through a Writer, and by streaming each entry
+// straight from its fields.  Pass the number of entries as the argument, the
+// default is 10000.
+class JsonObjectTiming_test : public beast::unit_test::suite
+{
+public:
+    typedef std::chrono::steady_clock clock_type;
+
+    static int const passes = 5;
+
+    static std::vector <STLedgerEntry> makeEntries (int count)
+    {
+        std::vector <STLedgerEntry> entries;
+        entries.reserve (count);
+        for (int i = 0; i < count; ++i)
+        {
+            entries.emplace_back (ltOFFER, uint256 (i + 1));
+            auto& sle = entries.back ();
+            sle.setFieldU32 (sfSequence, i);
+            sle.setFieldU32 (sfFlags, i % 3);
+            sle.setFieldAmount (sfTakerPays,
+                STAmount (std::uint64_t (1000000 + i)));
+            sle.setFieldAmount (sfTakerGets,
+                STAmount (std::uint64_t (2000000 + i)));
+            sle.setFieldH256 (sfBookDirectory, uint256 (i * 7919));
+        }
+        return entries;
+    }
+
+    // Returns megabytes per second, and leaves the last page in output.
+    template <class Render>
+    double time (std::string& output, Render const& render)
+    {
+        std::size_t bytes = 0;
+        auto const start = clock_type::now ();
+        for (int i = 0; i < passes; ++i)
+        {
+            output.clear ();
+            render (output);
+            bytes += output.size ();
+        }
+        auto const elapsed = std::chrono::duration_cast <
+            std::chrono::microseconds> (clock_type::now () - start).count ();
+        return double (bytes) / std::max <long long> (elapsed, 1);
+    }
+
+    void run ()
+    {
+        int count = 10000;
+        if (!arg().empty())
+            count = beast::lexicalCastThrow <int> (arg());
+
+        testcase (std::to_string (count) + " entries");
+        auto const entries = makeEntries (count);
+
+        auto makeTree = [&entries] ()
+        {
+            Json::Value json (Json::objectValue);
+            auto& state = addArray (json, jss::state);
+            for (auto const& sle : entries)
+                copyFrom (appendObject (state), sle);
+            return json;
+        };
+
+        std::string legacy;
+        double const a = time (legacy, [&makeTree] (std::string& output)
+        {
+            output = to_string (makeTree ());
+        });
+
+        std::string tree;
+        double const b = time (tree, [&makeTree] (std::string& output)
+        {
+            output = jsonAsString (makeTree ());
+        });
+
+        // The output buffer keeps its capacity from one pass to the next.
+        std::string streamed;
+        double const c = time (streamed, [&entries] (std::string& output)
+        {
+            auto root = stringWriterObject (output);
+            auto state = addArray (*root, jss::state);
+            for (auto const& sle : entries)
+            {
+                auto entry = appendObject (state);
+                copyFrom (entry, sle);
+            }
+        });
+
+        Json::Value a1, b1, c1;
+        expect (Json::Reader().parse (legacy, a1));
+        expect (Json::Reader().parse (tree, b1));
+        expect (Json::Reader().parse (streamed, c1));
+        expect (a1 == b1 && b1 == c1, "Same JSON from every path");
+
+        log << count << " entries: FastWriter " << a <<
+            " MB/s, Json::Value to Writer " << b <<
+            " MB/s, streamed " << c << " MB/s";
     }
 };
 
 BEAST_DEFINE_TESTSUITE(JsonObject, ripple_basics, ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(JsonObjectTiming, ripple_basics, ripple);
 
 } // RPC
 } // ripple
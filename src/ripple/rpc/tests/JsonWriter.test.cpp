@@ -109,6 +109,10 @@ public:
         setup ("remaining escapes");
         writer_->output ("\b\f\n\r\t");
         expectResult ("\"\\b\\f\\n\\r\\t\"");
+
+        setup ("control characters");
+        writer_->output ("\x01x\x1f");
+        expectResult ("\"\\u0001x\\u001f\"");
     }
 
     void testArray ()
@@ -19,6 +19,7 @@
 
 #include <BeastConfig.h>
 #include <ripple/rpc/impl/WriteJson.h>
+#include <ripple/rpc/impl/JsonWriter.h>
 #include <ripple/rpc/tests/TestOutputSuite.test.h>
 
 namespace ripple {
@@ -50,6 +51,18 @@ struct WriteJson_test : TestOutputSuite
         runTest (name, name);
     }
 
+    void testNested ()
+    {
+        setup ("nested in a writer");
+        Json::Value value;
+        expect (Json::Reader().parse ("{\"b\":[1,{\"c\":\"d\"}]}", value));
+        writer_->startRoot (Writer::object);
+        writer_->set ("a", value);
+        writer_->set ("e", Json::Value ("f"));
+        writer_->finish ();
+        expectResult ("{\"a\":{\"b\":[1,{\"c\":\"d\"}]},\"e\":\"f\"}");
+    }
+
     void run () override
     {
         runTest ("null");
@@ -65,6 +78,7 @@ struct WriteJson_test : TestOutputSuite
         runTest ("array array", "[[]]");
         runTest ("more complex",
                  "{\"array\":[{\"12\":23},{},null,false,0.5]}");
+        testNested ();
     }
 };
 
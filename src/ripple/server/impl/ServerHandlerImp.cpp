@@ -372,7 +372,10 @@ ServerHandlerImp::processRequest (
     WriteLog (lsTRACE, RPCHandler)
         << "doRpcCommand:" << strMethod << ":" << params;
 
-    RPC::Context context {params, loadType, m_networkOPs, role, nullptr, yield};
+    // Declared before the reply so that it outlives every Value in it.
+    Json::ValueArena arena;
+    RPC::Context context {
+        params, loadType, m_networkOPs, role, nullptr, yield, &arena};
     std::string response;
 
     if (setup_.yieldStrategy.streaming == RPC::YieldStrategy::Streaming::yes)
@@ -34,7 +34,9 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/shared_lock_guard.hpp>
 #include <boost/thread/shared_mutex.hpp>
+#include <deque>
 #include <stack>
+#include <vector>
 
 namespace std {
 
@@ -166,6 +168,13 @@ public:
     bool updateGiveItem (SHAMapItem::ref, bool isTransaction, bool hasMeta);
     bool addGiveItem (SHAMapItem::ref, bool isTransaction, bool hasMeta);
 
+    // Add many items at once. New subtrees are built bottom up so each new
+    // inner node is hashed once, and the branches of the root are filled
+    // concurrently for large batches. Items whose tag is already in the map
+    // are skipped. Returns the number of items added.
+    int addGiveItems (std::vector<SHAMapItem::pointer> items,
+                      bool isTransaction, bool hasMeta);
+
     // save a copy if you only need a temporary
     SHAMapItem::pointer peekItem (uint256 const& id);
     SHAMapItem::pointer peekItem (uint256 const& id, uint256 & hash);
@@ -182,6 +191,69 @@ public:
     void visitNodes (std::function<bool (SHAMapTreeNode&)> const&);
     void visitLeaves(std::function<void (SHAMapItem::ref)> const&);
 
+    // Visit only the subtree below one of the root's 16 branches. Leaves
+    // are visited in the same order as the full walk, so concatenating
+    // branches 0 through 15 reproduces visitLeaves.
+    void visitNodes (int branch, std::function<bool (SHAMapTreeNode&)> const&);
+    void visitLeaves (int branch, std::function<void (SHAMapItem::ref)> const&);
+
+    /** Walks the leaves in order, reading nodes ahead of the cursor.
+
+        The next readAhead nodes the walk will reach are requested from
+        the node store's asynchronous read threads, so a walk over a map
+        that is not in memory keeps many reads outstanding instead of
+        waiting on one at a time. Nodes are not hooked into the map, as
+        with visitLeaves.
+
+        next() throws SHAMapMissingNode if a node cannot be found.
+    */
+    class LeafIterator
+    {
+    public:
+        enum
+        {
+            defaultReadAhead = 256
+        };
+
+        /** Walk the whole map. */
+        LeafIterator (SHAMap& map, int readAhead);
+
+        /** Walk one branch of the root. Distinct branches share no nodes,
+            so they may be walked concurrently.
+        */
+        LeafIterator (SHAMap& map, int readAhead, int branch);
+
+        /** Walk the leaves whose keys follow the given key. */
+        LeafIterator (SHAMap& map, int readAhead, uint256 const& after);
+
+        /** The next leaf's item, or null once the walk is done. */
+        SHAMapItem::pointer next ();
+
+    private:
+        // A node the walk has yet to reach
+        struct Pending
+        {
+            SHAMapTreeNode::pointer parent;
+            int branch;
+        };
+
+        void push (SHAMapTreeNode::ref node, int firstBranch);
+        void request (Pending const& pending);
+        void readAhead ();
+
+        SHAMap& m_map;
+        std::size_t const m_readAhead;
+
+        // In the order they will be reached
+        std::deque <Pending> m_pending;
+
+        // This many of the first pending nodes have been requested
+        std::size_t m_requested;
+
+        // A map whose root is a leaf
+        SHAMapItem::pointer m_rootItem;
+    };
+
     // comparison/sync functions
     void getMissingNodes (std::vector<SHAMapNodeID>& nodeIDs, std::vector<uint256>& hashes, int max,
                           SHAMapSyncFilter * filter);
@@ -196,6 +268,14 @@ public:
     SHAMapAddNode addKnownNode (SHAMapNodeID const& nodeID, Blob const& rawNode,
                                 SHAMapSyncFilter * filter);
 
+    /** Add a node that was already built from its wire format.
+        This lets callers decode and hash received nodes without holding
+        whatever lock serializes changes to the map.
+    */
+    SHAMapAddNode addKnownNode (SHAMapNodeID const& nodeID,
+                                SHAMapTreeNode::pointer const& node,
+                                SHAMapSyncFilter * filter);
+
     // status functions
     void setImmutable ()
     {
@@ -232,7 +312,7 @@ public:
 
     typedef std::pair <uint256, Blob> fetchPackEntry_t;
 
-    void getFetchPack (SHAMap * have, bool includeLeaves, int max, std::function<void (uint256 const&, const Blob&)>);
+    void getFetchPack (SHAMap * have, bool includeLeaves, int max, std::function<bool (uint256 const&, const Blob&)>);
 
     void setUnbacked ()
     {
@@ -254,6 +334,10 @@ private:
     // database operations
     SHAMapTreeNode::pointer fetchNodeFromDB (uint256 const& hash);
 
+    // Make the node for an object already read from the database
+    SHAMapTreeNode::pointer fetchNodeFromDB (uint256 const& hash,
+        NodeObject::pointer const& obj);
+
     SHAMapTreeNode::pointer fetchNodeNT (uint256 const& hash);
 
     SHAMapTreeNode::pointer fetchNodeNT (
@@ -266,6 +350,12 @@ private:
     SHAMapTreeNode::pointer checkFilter (uint256 const& hash, SHAMapNodeID const& id,
         SHAMapSyncFilter* filter);
 
+    /** Hook a received node into the map.
+        Exactly one of rawNode and newNode is set.
+    */
+    SHAMapAddNode hookKnownNode (SHAMapNodeID const& nodeID, Blob const* rawNode,
+        SHAMapTreeNode::pointer newNode, SHAMapSyncFilter* filter);
+
     /** Update hashes up to the root */
     void dirtyUp (SharedPtrNodeStack& stack,
                   uint256 const& target, SHAMapTreeNode::pointer terminal);
@@ -287,6 +377,21 @@ private:
     void writeNode (NodeObjectType t, std::uint32_t seq,
         SHAMapTreeNode::pointer& node);
 
+    typedef std::vector<SHAMapItem::pointer>::const_iterator ItemIterator;
+
+    /** Build a new subtree holding sorted items with distinct tags */
+    SHAMapTreeNode::pointer buildSubTree (SHAMapNodeID const& nodeID,
+        ItemIterator begin, ItemIterator end, SHAMapTreeNode::TNType type);
+
+    /** Add sorted items below an unshared inner node, rehashing it once */
+    int addItemsBelow (SHAMapTreeNode::pointer const& node, SHAMapNodeID const& nodeID,
+        ItemIterator begin, ItemIterator end, SHAMapTreeNode::TNType type);
+
+    /** Add sorted items to one branch, returning the new child */
+    SHAMapTreeNode::pointer addItemsToBranch (SHAMapTreeNode::ref parent,
+        SHAMapNodeID const& childID, int branch, ItemIterator begin,
+        ItemIterator end, SHAMapTreeNode::TNType type, int& added);
+
     SHAMapTreeNode* firstBelow (SHAMapTreeNode*);
     SHAMapTreeNode* lastBelow (SHAMapTreeNode*);
 
@@ -321,8 +426,22 @@ private:
 
     void visitLeavesInternal (std::function<void (SHAMapItem::ref item)>& function);
 
+    /** Visit the nodes below an inner node. Returns true if stopped early. */
+    bool visitNodesBelow (SHAMapTreeNode::pointer node,
+        std::function<bool (SHAMapTreeNode&)> const& function);
+
     int walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq);
 
+    /** Flush an unshared inner node and everything below it that is dirty.
+        The node is replaced by its shareable version.
+    */
+    int walkSubTree (SHAMapTreeNode::pointer& node, bool doWrite,
+                     NodeObjectType t, std::uint32_t seq);
+
+    /** Write the dirty inner nodes below the root concurrently */
+    int flushBranches (SHAMapTreeNode::pointer const& node,
+                       NodeObjectType t, std::uint32_t seq);
+
 private:
     beast::Journal journal_;
     NodeStore::Database& db_;
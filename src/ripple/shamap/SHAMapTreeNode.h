@@ -26,6 +26,7 @@
 #include <ripple/basics/CountedObject.h>
 #include <ripple/basics/TaggedCache.h>
 #include <beast/utility/Journal.h>
+#include <vector>
 
 namespace ripple {
 
@@ -141,7 +142,9 @@ public:
     uint256 const& getChildHash (int m) const
     {
         assert ((m >= 0) && (m < 16) && (mType == tnINNER));
-        return mHashes[m];
+        if (isEmptyBranch (m))
+            return zeroHash ();
+        return mBranches[getSlot (m)].hash;
     }
 
     // item node function
@@ -188,17 +191,40 @@ private:
     // VFALCO TODO remove the use of friend
     friend class SHAMap;
 
+    // An inner node only stores the branches it has, in branch order.
+    // Most inner nodes have only a few branches and leaves have none, so
+    // keeping all sixteen would cost most nodes far more than they use.
+    struct Branch
+    {
+        uint256                 hash;
+        SHAMapTreeNode::pointer child;
+    };
+
     uint256                 mHash;
-    uint256                 mHashes[16];
-    SHAMapTreeNode::pointer mChildren[16];
+    std::vector<Branch>     mBranches;
     SHAMapItem::pointer     mItem;
     std::uint32_t           mSeq;
     TNType                  mType;
-    int                     mIsBranch;
+    std::uint16_t           mIsBranch;
     std::uint32_t           mFullBelowGen;
 
     bool updateHash ();
 
+    // Position in mBranches of branch m, whether or not it is present
+    int getSlot (int m) const
+    {
+        unsigned int v = mIsBranch & ((1u << m) - 1);
+        v = v - ((v >> 1) & 0x5555);
+        v = (v & 0x3333) + ((v >> 2) & 0x3333);
+        v = (v + (v >> 4)) & 0x0F0F;
+        return (v + (v >> 8)) & 0x1F;
+    }
+
+    // Set or clear a branch without updating the node's hash
+    void setBranch (int m, uint256 const& hash, SHAMapTreeNode::pointer child);
+
+    static uint256 const& zeroHash ();
+
     static std::mutex       childLock;
 };
 
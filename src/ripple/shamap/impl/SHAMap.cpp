@@ -19,8 +19,11 @@
 
 #include <BeastConfig.h>
 #include <ripple/shamap/SHAMap.h>
+#include <ripple/core/ParallelFor.h>
 #include <beast/unit_test/suite.h>
 #include <beast/chrono/manual_clock.h>
+#include <algorithm>
+#include <array>
 
 namespace ripple {
 
@@ -188,12 +191,20 @@ SHAMapTreeNode* SHAMap::walkToPointer (uint256 const& id)
 }
 
 SHAMapTreeNode::pointer SHAMap::fetchNodeFromDB (uint256 const& hash)
+{
+    if (!mBacked)
+        return SHAMapTreeNode::pointer ();
+
+    return fetchNodeFromDB (hash, db_.fetch (hash));
+}
+
+SHAMapTreeNode::pointer SHAMap::fetchNodeFromDB (uint256 const& hash,
+    NodeObject::pointer const& obj)
 {
     SHAMapTreeNode::pointer node;
 
     if (mBacked)
     {
-        NodeObject::pointer obj = db_.fetch (hash);
         if (obj)
         {
             try
@@ -850,6 +861,169 @@ bool SHAMap::addItem (const SHAMapItem& i, bool isTransaction, bool hasMetaData)
     return addGiveItem (std::make_shared<SHAMapItem> (i), isTransaction, hasMetaData);
 }
 
+int SHAMap::addGiveItems (std::vector<SHAMapItem::pointer> items,
+                          bool isTransaction, bool hasMeta)
+{
+    SHAMapTreeNode::TNType type = !isTransaction ? SHAMapTreeNode::tnACCOUNT_STATE :
+        (hasMeta ? SHAMapTreeNode::tnTRANSACTION_MD : SHAMapTreeNode::tnTRANSACTION_NM);
+
+    assert (mState != smsImmutable);
+
+    auto tagLess = [](SHAMapItem::ref a, SHAMapItem::ref b)
+    {
+        return a->getTag () < b->getTag ();
+    };
+    auto tagEqual = [](SHAMapItem::ref a, SHAMapItem::ref b)
+    {
+        return a->getTag () == b->getTag ();
+    };
+
+    // like addGiveItem, the first item with a tag wins
+    std::stable_sort (items.begin (), items.end (), tagLess);
+    items.erase (std::unique (items.begin (), items.end (), tagEqual), items.end ());
+
+    if (items.empty ())
+        return 0;
+
+    SHAMapTreeNode::pointer node = root;
+    unshareNode (node, SHAMapNodeID ());
+    return addItemsBelow (node, SHAMapNodeID (), items.begin (), items.end (), type);
+}
+
+SHAMapTreeNode::pointer SHAMap::buildSubTree (SHAMapNodeID const& nodeID,
+    ItemIterator begin, ItemIterator end, SHAMapTreeNode::TNType type)
+{
+    assert (begin != end);
+
+    if ((end - begin) == 1)
+        return std::make_shared<SHAMapTreeNode> (*begin, type, mSeq);
+
+    SHAMapTreeNode::pointer node = std::make_shared<SHAMapTreeNode> (mSeq);
+    node->makeInner ();
+
+    // the items are sorted, so each branch holds a contiguous run
+    while (begin != end)
+    {
+        int branch = nodeID.selectBranch ((*begin)->getTag ());
+        ItemIterator last = begin;
+        while ((last != end) && (nodeID.selectBranch ((*last)->getTag ()) == branch))
+            ++last;
+
+        SHAMapTreeNode::pointer child =
+            buildSubTree (nodeID.getChildNodeID (branch), begin, last, type);
+        uint256 const hash = child->getNodeHash ();
+        node->setBranch (branch, hash, std::move (child));
+        begin = last;
+    }
+
+    node->updateHash ();
+    return node;
+}
+
+SHAMapTreeNode::pointer SHAMap::addItemsToBranch (SHAMapTreeNode::ref parent,
+    SHAMapNodeID const& childID, int branch, ItemIterator begin,
+    ItemIterator end, SHAMapTreeNode::TNType type, int& added)
+{
+    if (parent->isEmptyBranch (branch))
+    {
+        added += static_cast<int> (end - begin);
+        return buildSubTree (childID, begin, end, type);
+    }
+
+    SHAMapTreeNode::pointer child = descendThrow (parent, branch);
+
+    if (child->isInner ())
+    {
+        // always work on a copy, so a missing node below leaves the map as it was
+        child = std::make_shared<SHAMapTreeNode> (*child, mSeq);
+        added += addItemsBelow (child, childID, begin, end, type);
+        return child;
+    }
+
+    // a leaf is replaced by a subtree holding its item and the new ones
+    SHAMapItem::pointer otherItem = child->peekItem ();
+    std::vector<SHAMapItem::pointer> merged;
+    merged.reserve ((end - begin) + 1);
+
+    ItemIterator pos = std::lower_bound (begin, end, otherItem,
+        [](SHAMapItem::ref a, SHAMapItem::ref b)
+        {
+            return a->getTag () < b->getTag ();
+        });
+    merged.insert (merged.end (), begin, pos);
+    merged.push_back (otherItem);
+    if ((pos != end) && ((*pos)->getTag () == otherItem->getTag ()))
+        ++pos;
+    merged.insert (merged.end (), pos, end);
+
+    if (merged.size () == 1)
+        return child;
+
+    added += static_cast<int> (merged.size () - 1);
+    return buildSubTree (childID, merged.begin (), merged.end (), type);
+}
+
+int SHAMap::addItemsBelow (SHAMapTreeNode::pointer const& node, SHAMapNodeID const& nodeID,
+    ItemIterator begin, ItemIterator end, SHAMapTreeNode::TNType type)
+{
+    assert (node->isInner () && (node->getSeq () == mSeq));
+
+    auto const count = end - begin;
+
+    struct Branch
+    {
+        ItemIterator begin;
+        ItemIterator end;
+        SHAMapTreeNode::pointer child;
+        int added;
+    };
+    std::array<Branch, 16> branches;
+    for (auto& b : branches)
+    {
+        b.begin = b.end = end;
+        b.added = 0;
+    }
+
+    while (begin != end)
+    {
+        int branch = nodeID.selectBranch ((*begin)->getTag ());
+        ItemIterator last = begin;
+        while ((last != end) && (nodeID.selectBranch ((*last)->getTag ()) == branch))
+            ++last;
+        branches[branch].begin = begin;
+        branches[branch].end = last;
+        begin = last;
+    }
+
+    // Only the root fans out, and only when there is enough hashing to do.
+    // Nothing is hooked up until every branch succeeded.
+    int const parallelMinimum = 1024;
+    parallelFor (16, [&](std::size_t branch)
+    {
+        Branch& b = branches[branch];
+        if (b.begin != b.end)
+        {
+            b.child = addItemsToBranch (node, nodeID.getChildNodeID (branch),
+                branch, b.begin, b.end, type, b.added);
+        }
+    }, (nodeID.isRoot () && (count >= parallelMinimum)) ? 0 : 1);
+
+    int added = 0;
+    for (int branch = 0; branch < 16; ++branch)
+    {
+        Branch& b = branches[branch];
+        if (!b.child)
+            continue;
+
+        uint256 const hash = b.child->getNodeHash ();
+        node->setBranch (branch, hash, std::move (b.child));
+        added += b.added;
+    }
+
+    node->updateHash ();
+    return added;
+}
+
 bool SHAMap::updateGiveItem (SHAMapItem::ref item, bool isTransaction, bool hasMeta)
 {
     // can't change the tag but can change the hash
@@ -941,7 +1115,10 @@ void SHAMap::writeNode (
 
     canonicalize (node->getNodeHash(), node);
 
-    Serializer s;
+    // The buffer becomes the stored object, so size it to fit: a prefix,
+    // sixteen hashes or the item, and a trailing tag
+    Serializer s (node->isInner () ? (4 + 16 * 32) :
+        static_cast<int> (node->peekItem ()->peekData ().size ()) + 4 + 32);
     node->addRaw (s, snfPREFIX);
     db_.store (t, std::move (s.modData()),
         node->getNodeHash ());
@@ -979,7 +1156,6 @@ int SHAMap::flushDirty (NodeObjectType t, std::uint32_t seq)
 int SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
 {
     int flushed = 0;
-    Serializer s;
 
     if (!root || (root->getSeq() == 0) || root->isEmpty ())
         return flushed;
@@ -992,14 +1168,77 @@ int SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
         return 1;
     }
 
+    SHAMapTreeNode::pointer node = root;
+    preFlushNode (node);
+
+    // The subtrees below the root are independent, so when nodes are
+    // written they are serialized and stored on several threads at once
+    if (doWrite && mBacked)
+        flushed += flushBranches (node, t, seq);
+
+    flushed += walkSubTree (node, doWrite, t, seq);
+
+    // Last inner node is the new root
+    root = std::move (node);
+
+    return flushed;
+}
+
+int SHAMap::flushBranches (SHAMapTreeNode::pointer const& node,
+    NodeObjectType t, std::uint32_t seq)
+{
+    assert (node->isInner () && (node->getSeq () == mSeq));
+
+    std::array<SHAMapTreeNode::pointer, 16> children;
+    std::vector<int> branches;
+    for (int branch = 0; branch < 16; ++branch)
+    {
+        if (node->isEmptyBranch (branch))
+            continue;
+
+        // No need to do I/O. If the node isn't linked,
+        // it can't need to be flushed
+        children[branch] = node->getChild (branch);
+        if (children[branch] && (children[branch]->getSeq () != 0) &&
+            children[branch]->isInner ())
+        {
+            branches.push_back (branch);
+        }
+    }
+
+    if (branches.size () < 2)
+        return 0;
+
+    std::array<int, 16> flushed;
+    parallelFor (branches.size (), [&](std::size_t i)
+    {
+        int const branch = branches[i];
+        preFlushNode (children[branch]);
+        flushed[branch] = walkSubTree (children[branch], true, t, seq);
+    });
+
+    // Hook the flushed subtrees to the root, which is flushed by the caller
+    int total = 0;
+    for (int branch : branches)
+    {
+        node->shareChild (branch, children[branch]);
+        total += flushed[branch];
+    }
+    return total;
+}
+
+int SHAMap::walkSubTree (SHAMapTreeNode::pointer& node, bool doWrite,
+    NodeObjectType t, std::uint32_t seq)
+{
+    assert (node->isInner () && (node->getSeq () == mSeq));
+
+    int flushed = 0;
+
     // Stack of {parent,index,child} pointers representing
     // inner nodes we are in the process of flushing
     using StackEntry = std::pair <SHAMapTreeNode::pointer, int>;
     std::stack <StackEntry, std::vector<StackEntry>> stack;
 
-    SHAMapTreeNode::pointer node = root;
-    preFlushNode (node);
-
     int pos = 0;
 
     // We can't flush an inner node until we flush its children
@@ -1072,9 +1311,6 @@ int SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
         ++pos;
     }
 
-    // Last inner node is the new root
-    root = std::move (node);
-
     return flushed;
 }
 
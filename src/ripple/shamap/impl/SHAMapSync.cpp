@@ -21,6 +21,7 @@
 #include <ripple/shamap/SHAMap.h>
 #include <ripple/nodestore/Database.h>
 #include <beast/unit_test/suite.h>
+#include <algorithm>
 
 namespace ripple {
 
@@ -28,23 +29,202 @@ namespace ripple {
 
 static const uint256 uZero;
 
-static bool visitLeavesHelper (
-    std::function <void (SHAMapItem::ref)> const& function,
-    SHAMapTreeNode& node)
+void SHAMap::visitLeaves (std::function<void (SHAMapItem::ref item)> const& leafFunction)
 {
-    // Adapt visitNodes to visitLeaves
-    if (!node.isInner ())
-        function (node.peekItem ());
+    LeafIterator it (*this, LeafIterator::defaultReadAhead);
 
-    return false;
+    while (SHAMapItem::pointer item = it.next ())
+        leafFunction (item);
 }
 
-void SHAMap::visitLeaves (std::function<void (SHAMapItem::ref item)> const& leafFunction)
+void SHAMap::visitLeaves (int branch,
+    std::function<void (SHAMapItem::ref item)> const& leafFunction)
+{
+    LeafIterator it (*this, LeafIterator::defaultReadAhead, branch);
+
+    while (SHAMapItem::pointer item = it.next ())
+        leafFunction (item);
+}
+
+//------------------------------------------------------------------------------
+
+// Reading further ahead than the node store's cache holds would push
+// nodes out before the walk gets to them
+static std::size_t clampReadAhead (NodeStore::Database& db, bool backed,
+    int readAhead)
+{
+    if (!backed || (readAhead <= 0))
+        return 0;
+
+    return std::min (readAhead, std::max (1, db.getDesiredAsyncReadCount ()));
+}
+
+SHAMap::LeafIterator::LeafIterator (SHAMap& map, int readAhead)
+    : m_map (map)
+    , m_readAhead (clampReadAhead (map.db_, map.mBacked, readAhead))
+    , m_requested (0)
+{
+    SHAMapTreeNode::pointer const& root = map.root;
+
+    if (!root || root->isEmpty ())
+        return;
+
+    if (root->isInner ())
+        push (root, 0);
+    else
+        m_rootItem = root->peekItem ();
+}
+
+SHAMap::LeafIterator::LeafIterator (SHAMap& map, int readAhead, int branch)
+    : m_map (map)
+    , m_readAhead (clampReadAhead (map.db_, map.mBacked, readAhead))
+    , m_requested (0)
+{
+    assert ((branch >= 0) && (branch < 16));
+
+    SHAMapTreeNode::pointer const& root = map.root;
+
+    if (root && root->isInner () && !root->isEmptyBranch (branch))
+        m_pending.push_back ({root, branch});
+}
+
+SHAMap::LeafIterator::LeafIterator (SHAMap& map, int readAhead,
+        uint256 const& after)
+    : m_map (map)
+    , m_readAhead (clampReadAhead (map.db_, map.mBacked, readAhead))
+    , m_requested (0)
+{
+    SHAMapTreeNode::pointer node = map.root;
+
+    if (!node || node->isEmpty ())
+        return;
+
+    if (!node->isInner ())
+    {
+        if (node->peekItem ()->getTag () > after)
+            m_rootItem = node->peekItem ();
+        return;
+    }
+
+    // Follow the key down. At each level the branches past the key's come
+    // after everything below the key's branch, which is pushed later.
+    SHAMapNodeID nodeID;
+
+    for (;;)
+    {
+        int const branch = nodeID.selectBranch (after);
+        push (node, branch + 1);
+
+        if (node->isEmptyBranch (branch))
+            break;
+
+        SHAMapTreeNode::pointer child = map.descendNoStore (node, branch);
+
+        if (!child)
+            throw SHAMapMissingNode (map.mType, node->getChildHash (branch));
+
+        if (child->isInner ())
+        {
+            node = std::move (child);
+            nodeID = nodeID.getChildNodeID (branch);
+            continue;
+        }
+
+        if (child->peekItem ()->getTag () > after)
+        {
+            // Already in memory, so it counts as requested
+            m_pending.push_front ({node, branch});
+            m_requested = std::min (m_requested + 1, m_readAhead);
+        }
+
+        break;
+    }
+}
+
+void SHAMap::LeafIterator::push (SHAMapTreeNode::ref node, int firstBranch)
+{
+    std::size_t count = 0;
+
+    for (int branch = 15; branch >= firstBranch; --branch)
+    {
+        if (!node->isEmptyBranch (branch))
+        {
+            m_pending.push_front ({node, branch});
+            ++count;
+        }
+    }
+
+    // The children are reached next, so they are read first. If they do
+    // not all fit, the reads already started for the nodes after them
+    // are forgotten and started again when the window reaches them.
+    std::size_t const reads = std::min (count, m_readAhead);
+
+    for (std::size_t i = 0; i < reads; ++i)
+        request (m_pending[i]);
+
+    if (reads == count)
+        m_requested = std::min (m_requested + count, m_readAhead);
+    else
+        m_requested = reads;
+}
+
+void SHAMap::LeafIterator::request (Pending const& pending)
 {
-    visitNodes (std::bind (visitLeavesHelper,
-            std::cref (leafFunction), std::placeholders::_1));
+    if (pending.parent->getChildPointer (pending.branch))
+        return;
+
+    uint256 const& hash = pending.parent->getChildHash (pending.branch);
+
+    if (m_map.getCache (hash))
+        return;
+
+    // Just starts the read; the walk picks the node up from the
+    // node store's cache when it gets there
+    NodeObject::pointer object;
+    m_map.db_.asyncFetch (hash, object);
 }
 
+void SHAMap::LeafIterator::readAhead ()
+{
+    std::size_t const target = std::min (m_readAhead, m_pending.size ());
+
+    while (m_requested < target)
+        request (m_pending[m_requested++]);
+}
+
+SHAMapItem::pointer SHAMap::LeafIterator::next ()
+{
+    if (m_rootItem)
+        return std::move (m_rootItem);
+
+    while (!m_pending.empty ())
+    {
+        readAhead ();
+
+        Pending const pending = std::move (m_pending.front ());
+        m_pending.pop_front ();
+
+        if (m_requested != 0)
+            --m_requested;
+
+        SHAMapTreeNode::pointer node =
+            m_map.descendNoStore (pending.parent, pending.branch);
+
+        if (!node)
+            throw SHAMapMissingNode (m_map.mType,
+                pending.parent->getChildHash (pending.branch));
+
+        if (!node->isInner ())
+            return node->peekItem ();
+
+        push (node, 0);
+    }
+
+    return SHAMapItem::pointer ();
+}
+
+//------------------------------------------------------------------------------
+
 void SHAMap::visitNodes(std::function<bool (SHAMapTreeNode&)> const& function)
 {
     // Visit every node in a SHAMap
@@ -58,10 +238,33 @@ void SHAMap::visitNodes(std::function<bool (SHAMapTreeNode&)> const& function)
     if (!root->isInner ())
         return;
 
+    visitNodesBelow (root, function);
+}
+
+void SHAMap::visitNodes (int branch,
+    std::function<bool (SHAMapTreeNode&)> const& function)
+{
+    // Visit every node below one branch of the root. Distinct branches
+    // share no nodes, so they may be walked concurrently.
+    assert ((branch >= 0) && (branch < 16));
+
+    if (!root || !root->isInner () || root->isEmptyBranch (branch))
+        return;
+
+    SHAMapTreeNode::pointer child = descendNoStore (root, branch);
+    if (function (*child))
+        return;
+
+    if (child->isInner ())
+        visitNodesBelow (child, function);
+}
+
+bool SHAMap::visitNodesBelow (SHAMapTreeNode::pointer node,
+    std::function<bool (SHAMapTreeNode&)> const& function)
+{
     using StackEntry = std::pair <int, SHAMapTreeNode::pointer>;
     std::stack <StackEntry, std::vector <StackEntry>> stack;
 
-    SHAMapTreeNode::pointer node = root;
     int pos = 0;
 
     while (1)
@@ -73,7 +276,7 @@ void SHAMap::visitNodes(std::function<bool (SHAMapTreeNode&)> const& function)
             {
                 SHAMapTreeNode::pointer child = descendNoStore (node, pos);
                 if (function (*child))
-                    return;
+                    return true;
 
                 if (child->isLeaf ())
                     ++pos;
@@ -106,6 +309,8 @@ void SHAMap::visitNodes(std::function<bool (SHAMapTreeNode&)> const& function)
         std::tie(pos, node) = stack.top ();
         stack.pop ();
     }
+
+    return false;
 }
 
 /** Get a list of node IDs and hashes for nodes that are part of this SHAMap
@@ -238,17 +443,38 @@ void SHAMap::getMissingNodes (std::vector<SHAMapNodeID>& nodeIDs, std::vector<ui
         if (deferredReads.empty ())
             break;
 
-        db_.waitReads();
+        // Read whatever the prefetch threads have not read yet in one
+        // batch, rather than waiting for them to get to it
+        std::vector <NodeObject::pointer> objects;
+        if (mBacked)
+        {
+            std::vector <uint256> deferredHashes;
+            deferredHashes.reserve (deferredReads.size ());
+
+            for (auto const& node : deferredReads)
+                deferredHashes.push_back (
+                    std::get<0>(node)->getChildHash (std::get<1>(node)));
+
+            objects = db_.fetchBatch (deferredHashes);
+        }
 
         // Process all deferred reads
-        for (auto const& node : deferredReads)
+        for (std::size_t i = 0; i < deferredReads.size (); ++i)
         {
+            auto const& node = deferredReads[i];
             auto parent = std::get<0>(node);
             auto branch = std::get<1>(node);
             auto const& nodeID = std::get<2>(node);
             auto const& nodeHash = parent->getChildHash (branch);
 
-            SHAMapTreeNode::pointer nodePtr = fetchNodeNT (nodeID, nodeHash, filter);
+            SHAMapTreeNode::pointer nodePtr = getCache (nodeHash);
+
+            if (!nodePtr && mBacked)
+                nodePtr = fetchNodeFromDB (nodeHash, objects[i]);
+
+            if (!nodePtr && filter)
+                nodePtr = checkFilter (nodeHash, nodeID, filter);
+
             if (nodePtr)
             {
                 if (mBacked)
@@ -452,9 +678,26 @@ SHAMapAddNode SHAMap::addRootNode (uint256 const& hash, Blob const& rootNode, SH
 SHAMapAddNode
 SHAMap::addKnownNode (const SHAMapNodeID& node, Blob const& rawNode,
                       SHAMapSyncFilter* filter)
+{
+    return hookKnownNode (node, &rawNode, SHAMapTreeNode::pointer (), filter);
+}
+
+SHAMapAddNode
+SHAMap::addKnownNode (const SHAMapNodeID& node,
+                      SHAMapTreeNode::pointer const& newNode,
+                      SHAMapSyncFilter* filter)
+{
+    return hookKnownNode (node, nullptr, newNode, filter);
+}
+
+SHAMapAddNode
+SHAMap::hookKnownNode (const SHAMapNodeID& node, Blob const* rawNode,
+                       SHAMapTreeNode::pointer newNode,
+                       SHAMapSyncFilter* filter)
 {
     // return value: true=okay, false=error
     assert (!node.isRoot ());
+    assert ((rawNode != nullptr) != (newNode != nullptr));
 
     if (!isSynching ())
     {
@@ -502,9 +745,10 @@ SHAMap::addKnownNode (const SHAMapNodeID& node, Blob const& rawNode,
                 return SHAMapAddNode::invalid ();
             }
 
-            SHAMapTreeNode::pointer newNode =
-                std::make_shared<SHAMapTreeNode> (rawNode, 0, snfWIRE,
-                                                  uZero, false);
+            // Only build the node once we know we need it
+            if (!newNode)
+                newNode = std::make_shared<SHAMapTreeNode> (*rawNode, 0,
+                    snfWIRE, uZero, false);
 
             if (!newNode->isInBounds (iNodeID))
             {
@@ -669,12 +913,14 @@ bool SHAMap::hasLeafNode (uint256 const& tag, uint256 const& targetNodeHash)
 @param includeLeaves True if leaf nodes should be included.
 @param max The maximum number of nodes to return.
 @param func The functor to call for each node added to the FetchPack.
+            Nodes are produced as the walk finds them; returning false
+            from the functor ends the walk.
 
 Note: a caller should set includeLeaves to false for transaction trees.
 There's no point in including the leaves of transaction trees.
 */
 void SHAMap::getFetchPack (SHAMap* have, bool includeLeaves, int max,
-                           std::function<void (uint256 const&, const Blob&)> func)
+                           std::function<bool (uint256 const&, const Blob&)> func)
 {
     if (root->getNodeHash ().isZero ())
         return;
@@ -690,7 +936,6 @@ void SHAMap::getFetchPack (SHAMap* have, bool includeLeaves, int max,
             Serializer s;
             root->addRaw (s, snfPREFIX);
             func (std::cref(root->getNodeHash ()), std::cref(s.peekData ()));
-            --max;
         }
 
         return;
@@ -711,7 +956,8 @@ void SHAMap::getFetchPack (SHAMap* have, bool includeLeaves, int max,
         // 1) Add this node to the pack
         Serializer s;
         node->addRaw (s, snfPREFIX);
-        func (std::cref(node->getNodeHash ()), std::cref(s.peekData ()));
+        if (!func (std::cref(node->getNodeHash ()), std::cref(s.peekData ())))
+            return;
         --max;
 
         // 2) push non-matching child inner nodes
@@ -732,7 +978,8 @@ void SHAMap::getFetchPack (SHAMap* have, bool includeLeaves, int max,
                 {
                     Serializer s;
                     next->addRaw (s, snfPREFIX);
-                    func (std::cref(childHash), std::cref(s.peekData ()));
+                    if (!func (std::cref(childHash), std::cref(s.peekData ())))
+                        return;
                     --max;
                 }
             }
@@ -48,12 +48,9 @@ SHAMapTreeNode::SHAMapTreeNode (const SHAMapTreeNode& node, std::uint32_t seq)
         mItem = node.mItem;
     else
     {
-        memcpy (mHashes, node.mHashes, sizeof (mHashes));
-
         std::unique_lock <std::mutex> lock (childLock);
 
-        for (int i = 0; i < 16; ++i)
-            mChildren[i] = node.mChildren[i];
+        mBranches = node.mBranches;
     }
 }
 
@@ -122,10 +119,9 @@ SHAMapTreeNode::SHAMapTreeNode (Blob const& rawNode,
 
             for (int i = 0; i < 16; ++i)
             {
-                s.get256 (mHashes[i], i * 32);
-
-                if (mHashes[i].isNonZero ())
-                    mIsBranch |= (1 << i);
+                uint256 hash;
+                s.get256 (hash, i * 32);
+                setBranch (i, hash, SHAMapTreeNode::pointer ());
             }
 
             mType = tnINNER;
@@ -140,10 +136,9 @@ SHAMapTreeNode::SHAMapTreeNode (Blob const& rawNode,
 
                 if ((pos < 0) || (pos >= 16)) throw std::runtime_error ("invalid CI node");
 
-                s.get256 (mHashes[pos], i * 33);
-
-                if (mHashes[pos].isNonZero ())
-                    mIsBranch |= (1 << pos);
+                uint256 hash;
+                s.get256 (hash, i * 33);
+                setBranch (pos, hash, SHAMapTreeNode::pointer ());
             }
 
             mType = tnINNER;
@@ -213,10 +208,9 @@ SHAMapTreeNode::SHAMapTreeNode (Blob const& rawNode,
 
             for (int i = 0; i < 16; ++i)
             {
-                s.get256 (mHashes[i], i * 32);
-
-                if (mHashes[i].isNonZero ())
-                    mIsBranch |= (1 << i);
+                uint256 hash;
+                s.get256 (hash, i * 32);
+                setBranch (i, hash, SHAMapTreeNode::pointer ());
             }
 
             mType = tnINNER;
@@ -266,13 +260,20 @@ bool SHAMapTreeNode::updateHash ()
     {
         if (mIsBranch != 0)
         {
-            nh = Serializer::getPrefixHash (HashPrefix::innerNode, reinterpret_cast<unsigned char*> (mHashes), sizeof (mHashes));
+            // The hash covers all sixteen branches, empty ones as zero
+            uint256 hashes[16];
+
+            for (int i = 0; i < 16; ++i)
+                if (!isEmptyBranch (i))
+                    hashes[i] = mBranches[getSlot (i)].hash;
+
+            nh = Serializer::getPrefixHash (HashPrefix::innerNode, reinterpret_cast<unsigned char*> (hashes), sizeof (hashes));
 #if RIPPLE_VERIFY_NODEOBJECT_KEYS
             Serializer s;
             s.add32 (HashPrefix::innerNode);
 
             for (int i = 0; i < 16; ++i)
-                s.add256 (mHashes[i]);
+                s.add256 (getChildHash (i));
 
             assert (nh == s.getSHA512Half ());
 #endif
@@ -330,7 +331,7 @@ void SHAMapTreeNode::addRaw (Serializer& s, SHANodeFormat format)
             s.add32 (HashPrefix::innerNode);
 
             for (int i = 0; i < 16; ++i)
-                s.add256 (mHashes[i]);
+                s.add256 (getChildHash (i));
         }
         else
         {
@@ -340,7 +341,7 @@ void SHAMapTreeNode::addRaw (Serializer& s, SHANodeFormat format)
                 for (int i = 0; i < 16; ++i)
                     if (!isEmptyBranch (i))
                     {
-                        s.add256 (mHashes[i]);
+                        s.add256 (getChildHash (i));
                         s.add8 (i);
                     }
 
@@ -349,7 +350,7 @@ void SHAMapTreeNode::addRaw (Serializer& s, SHANodeFormat format)
             else
             {
                 for (int i = 0; i < 16; ++i)
-                    s.add256 (mHashes[i]);
+                    s.add256 (getChildHash (i));
 
                 s.add8 (2);
             }
@@ -419,20 +420,14 @@ bool SHAMapTreeNode::isEmpty () const
 int SHAMapTreeNode::getBranchCount () const
 {
     assert (isInner ());
-    int count = 0;
-
-    for (int i = 0; i < 16; ++i)
-        if (!isEmptyBranch (i))
-            ++count;
-
-    return count;
+    return static_cast<int> (mBranches.size ());
 }
 
 void SHAMapTreeNode::makeInner ()
 {
     mItem.reset ();
     mIsBranch = 0;
-    memset (mHashes, 0, sizeof (mHashes));
+    mBranches.clear ();
     mType = tnINNER;
     mHash.zero ();
 }
@@ -459,7 +454,7 @@ std::string SHAMapTreeNode::getString (const SHAMapNodeID & id) const
                 ret += "\nb";
                 ret += beast::lexicalCastThrow <std::string> (i);
                 ret += " = ";
-                ret += to_string (mHashes[i]);
+                ret += to_string (getChildHash (i));
             }
     }
 
@@ -493,25 +488,43 @@ bool SHAMapTreeNode::setChild (int m, uint256 const& hash, SHAMapTreeNode::ref c
     assert (mSeq != 0);
     assert (child.get() != this);
 
-    if (mHashes[m] == hash)
+    if (getChildHash (m) == hash)
         return false;
 
-    mHashes[m] = hash;
+    assert (hash.isZero () ? !child : (child && (child->getNodeHash() == hash)));
+    setBranch (m, hash, child);
 
-    if (hash.isNonZero ())
+    return updateHash ();
+}
+
+void SHAMapTreeNode::setBranch (int m, uint256 const& hash, SHAMapTreeNode::pointer child)
+{
+    int const slot = getSlot (m);
+
+    if (hash.isZero ())
     {
-        assert (child && (child->getNodeHash() == hash));
+        if (!isEmptyBranch (m))
+        {
+            mBranches.erase (mBranches.begin () + slot);
+            mIsBranch &= ~ (1 << m);
+        }
+    }
+    else if (isEmptyBranch (m))
+    {
+        mBranches.insert (mBranches.begin () + slot, Branch {hash, std::move (child)});
         mIsBranch |= (1 << m);
     }
     else
     {
-        assert (!child);
-        mIsBranch &= ~ (1 << m);
+        mBranches[slot].hash = hash;
+        mBranches[slot].child = std::move (child);
     }
+}
 
-    mChildren[m] = child;
-
-    return updateHash ();
+uint256 const& SHAMapTreeNode::zeroHash ()
+{
+    static uint256 const zero;
+    return zero;
 }
 
 // finished modifying, now make shareable
@@ -522,9 +535,10 @@ void SHAMapTreeNode::shareChild (int m, SHAMapTreeNode::ref child)
     assert (mSeq != 0);
     assert (child);
     assert (child.get() != this);
-    assert (child->getNodeHash() == mHashes[m]);
+    assert (!isEmptyBranch (m));
+    assert (child->getNodeHash() == getChildHash (m));
 
-    mChildren[m] = child;
+    mBranches[getSlot (m)].child = child;
 }
 
 SHAMapTreeNode* SHAMapTreeNode::getChildPointer (int branch)
@@ -532,8 +546,11 @@ SHAMapTreeNode* SHAMapTreeNode::getChildPointer (int branch)
     assert (branch >= 0 && branch < 16);
     assert (isInnerNode ());
 
+    if (isEmptyBranch (branch))
+        return nullptr;
+
     std::unique_lock <std::mutex> lock (childLock);
-    return mChildren[branch].get ();
+    return mBranches[getSlot (branch)].child.get ();
 }
 
 SHAMapTreeNode::pointer SHAMapTreeNode::getChild (int branch)
@@ -541,9 +558,14 @@ SHAMapTreeNode::pointer SHAMapTreeNode::getChild (int branch)
     assert (branch >= 0 && branch < 16);
     assert (isInnerNode ());
 
+    if (isEmptyBranch (branch))
+        return SHAMapTreeNode::pointer ();
+
+    Branch const& b = mBranches[getSlot (branch)];
+
     std::unique_lock <std::mutex> lock (childLock);
-    assert (!mChildren[branch] || (mHashes[branch] == mChildren[branch]->getNodeHash()));
-    return mChildren[branch];
+    assert (!b.child || (b.hash == b.child->getNodeHash()));
+    return b.child;
 }
 
 void SHAMapTreeNode::canonicalizeChild (int branch, SHAMapTreeNode::pointer& node)
@@ -551,18 +573,21 @@ void SHAMapTreeNode::canonicalizeChild (int branch, SHAMapTreeNode::pointer& nod
     assert (branch >= 0 && branch < 16);
     assert (isInnerNode ());
     assert (node);
-    assert (node->getNodeHash() == mHashes[branch]);
+    assert (!isEmptyBranch (branch));
+    assert (node->getNodeHash() == getChildHash (branch));
+
+    SHAMapTreeNode::pointer& child = mBranches[getSlot (branch)].child;
 
     std::unique_lock <std::mutex> lock (childLock);
-    if (mChildren[branch])
+    if (child)
     {
         // There is already a node hooked up, return it
-        node = mChildren[branch];
+        node = child;
     }
     else
     {
         // Hook this node up
-        mChildren[branch] = node;
+        child = node;
     }
 }
 
@@ -24,9 +24,11 @@
 #include <ripple/basics/StringUtilities.h>
 #include <ripple/nodestore/DummyScheduler.h>
 #include <ripple/nodestore/Manager.h>
+#include <beast/module/core/text/LexicalCast.h>
 #include <beast/unit_test/suite.h>
 #include <beast/utility/Journal.h>
 #include <beast/chrono/manual_clock.h>
+#include <chrono>
 
 namespace ripple {
 
@@ -105,9 +107,285 @@ public:
         unexpected (!sMap.delItem (sMap.peekFirstItem ()->getTag ()), "bad mod");
         unexpected (sMap.getHash () == mapHash, "bad snapshot");
         unexpected (map2->getHash () != mapHash, "bad snapshot");
+
+        testcase ("node size");
+        expect (sizeof (SHAMapTreeNode) < 16 * sizeof (uint256),
+            "inner nodes hold all sixteen branches");
+
+        testBulkAdd (fullBelowCache, treeNodeCache, *db);
+        testFlush (clock, fullBelowCache, *db);
+        testLeafIterator (clock, fullBelowCache);
+    }
+
+    static SHAMapItem::pointer makeItem (int v)
+    {
+        Serializer s;
+        s.add32 (v);
+        return std::make_shared<SHAMapItem> (s.getSHA512Half (), IntToVUC (v));
+    }
+
+    void testBulkAdd (FullBelowCache& fullBelowCache,
+        TreeNodeCache& treeNodeCache, NodeStore::Database& db)
+    {
+        testcase ("bulk add");
+
+        // enough items for the root branches to be filled concurrently
+        int const count = 5000;
+
+        for (int existing : { 0, 1, 40, 3000 })
+        {
+            SHAMap one (smtFREE, fullBelowCache, treeNodeCache,
+                db, Handler(), beast::Journal());
+            SHAMap bulk (smtFREE, fullBelowCache, treeNodeCache,
+                db, Handler(), beast::Journal());
+
+            for (int v = 0; v < existing; ++v)
+            {
+                one.addGiveItem (makeItem (v), true, false);
+                bulk.addGiveItem (makeItem (v), true, false);
+            }
+
+            // a snapshot of the populated map must not see the bulk add
+            SHAMap::pointer before = bulk.snapShot (false);
+            uint256 const beforeHash = before->getHash ();
+
+            // overlaps the existing items and repeats some new ones
+            std::vector<SHAMapItem::pointer> items;
+            int added = 0;
+            for (int v = existing / 2; v < existing / 2 + count; ++v)
+            {
+                items.push_back (makeItem (v));
+                if (one.addGiveItem (items.back (), true, false))
+                    ++added;
+            }
+            items.push_back (makeItem (existing / 2 + 7));
+
+            expect (bulk.addGiveItems (items, true, false) == added, "bad add count");
+            expect (bulk.getHash () == one.getHash (), "bad bulk hash");
+            expect (existing == 0 || before->getHash () == beforeHash, "bad snapshot");
+
+            int n = 0;
+            for (auto i = bulk.peekFirstItem (); i; i = bulk.peekNextItem (i->getTag ()))
+                ++n;
+            expect (n == std::max (existing, existing / 2 + count), "bad traverse");
+        }
+    }
+
+    void testFlush (beast::manual_clock <std::chrono::steady_clock>& clock,
+        FullBelowCache& fullBelowCache, NodeStore::Database& db)
+    {
+        testcase ("flush");
+
+        beast::Journal const j;
+        TreeNodeCache treeNodeCache ("test.flush_cache", 65536, 60, clock, j);
+        SHAMap sMap (smtFREE, fullBelowCache, treeNodeCache,
+            db, Handler(), beast::Journal());
+
+        // every root branch gets a subtree to write
+        int const count = 3000;
+        std::vector<SHAMapItem::pointer> items;
+        for (int v = 0; v < count; ++v)
+            items.push_back (makeItem (10000 + v));
+        sMap.addGiveItems (items, false, false);
+
+        int const flushed = sMap.flushDirty (hotACCOUNT_NODE, 1);
+        expect (flushed > count, "too few nodes flushed");
+        expect (sMap.flushDirty (hotACCOUNT_NODE, 1) == 0, "flushed twice");
+
+        // read the map back through the node store alone
+        TreeNodeCache emptyCache ("test.empty_cache", 65536, 60, clock, j);
+        SHAMap loaded (smtFREE, sMap.getHash (), fullBelowCache, emptyCache,
+            db, Handler(), beast::Journal());
+        expect (loaded.fetchRoot (sMap.getHash (), nullptr), "no root");
+
+        std::vector<SHAMapMissingNode> missing;
+        loaded.walkMap (missing, 16);
+        expect (missing.empty (), "nodes not written");
+        expect (sMap.deepCompare (loaded), "bad flushed map");
+
+        // a later change only writes its own path
+        sMap.addGiveItem (makeItem (count + 20000), false, false);
+        int const again = sMap.flushDirty (hotACCOUNT_NODE, 2);
+        expect (again > 1 && again < 16, "bad incremental flush");
+    }
+
+    static std::vector<uint256> walk (SHAMap::LeafIterator& it)
+    {
+        std::vector<uint256> tags;
+        while (SHAMapItem::pointer item = it.next ())
+            tags.push_back (item->getTag ());
+        return tags;
+    }
+
+    void testLeafIterator (beast::manual_clock <std::chrono::steady_clock>& clock,
+        FullBelowCache& fullBelowCache)
+    {
+        testcase ("leaf iterator");
+
+        beast::Journal const j;
+        NodeStore::DummyScheduler scheduler;
+        auto db = NodeStore::Manager::instance().make_Database (
+            "test", scheduler, j, 2, parseDelimitedKeyValueString("type=memory|Path=SHAMap_leaves"));
+
+        TreeNodeCache treeNodeCache ("test.leaf_cache", 65536, 60, clock, j);
+        SHAMap sMap (smtFREE, fullBelowCache, treeNodeCache,
+            *db, Handler(), beast::Journal());
+
+        int const count = 2000;
+        std::vector<SHAMapItem::pointer> items;
+        for (int v = 0; v < count; ++v)
+            items.push_back (makeItem (30000 + v));
+        sMap.addGiveItems (items, false, false);
+        sMap.flushDirty (hotACCOUNT_NODE, 1);
+
+        std::vector<uint256> expected;
+        for (auto i = sMap.peekFirstItem (); i; i = sMap.peekNextItem (i->getTag ()))
+            expected.push_back (i->getTag ());
+        expect (expected.size () == count);
+
+        // nothing is in memory, so every node comes from the node store
+        TreeNodeCache emptyCache ("test.leaf_empty_cache", 65536, 60, clock, j);
+        SHAMap loaded (smtFREE, sMap.getHash (), fullBelowCache, emptyCache,
+            *db, Handler(), beast::Journal());
+        expect (loaded.fetchRoot (sMap.getHash (), nullptr), "no root");
+
+        SHAMap::LeafIterator all (loaded, 64);
+        expect (walk (all) == expected, "bad walk");
+        expect (! all.next (), "walk restarted");
+
+        // the branches in order make up the whole walk
+        std::vector<uint256> branches;
+        for (int branch = 0; branch < 16; ++branch)
+        {
+            SHAMap::LeafIterator it (loaded, 64, branch);
+            auto const tags = walk (it);
+            branches.insert (branches.end (), tags.begin (), tags.end ());
+        }
+        expect (branches == expected, "bad branch walk");
+
+        // resuming after a key, whether or not it is in the map
+        for (int i : { 0, 1, 700, count - 1 })
+        {
+            SHAMap::LeafIterator it (loaded, 16, expected[i]);
+            expect (walk (it) == std::vector<uint256> (
+                expected.begin () + i + 1, expected.end ()), "bad resume");
+
+            uint256 missing = expected[i];
+            ++missing;
+            SHAMap::LeafIterator next (sMap, 0, missing);
+            expect (walk (next) == std::vector<uint256> (
+                expected.begin () + i + 1, expected.end ()), "bad resume");
+        }
+
+        SHAMap::LeafIterator first (loaded, 16, uint256 ());
+        expect (walk (first) == expected, "bad resume from zero");
+
+        // a node missing on the way to the key is reported, not followed
+        auto partialDb = NodeStore::Manager::instance().make_Database (
+            "test", scheduler, j, 2, parseDelimitedKeyValueString("type=memory|Path=SHAMap_partial"));
+        Serializer rootNode;
+        expect (sMap.getRootNode (rootNode, snfPREFIX), "no root node");
+        partialDb->store (hotACCOUNT_NODE, std::move (rootNode.modData ()),
+            sMap.getHash ());
+
+        TreeNodeCache partialCache ("test.leaf_partial_cache", 65536, 60, clock, j);
+        SHAMap partial (smtFREE, sMap.getHash (), fullBelowCache, partialCache,
+            *partialDb, Handler(), beast::Journal());
+        expect (partial.fetchRoot (sMap.getHash (), nullptr), "no partial root");
+
+        bool thrown = false;
+        try
+        {
+            SHAMap::LeafIterator it (partial, 16, expected[700]);
+        }
+        catch (SHAMapMissingNode const&)
+        {
+            thrown = true;
+        }
+        expect (thrown, "missing node not reported");
+    }
+};
+
+// Measures the memory of a map's tree nodes and the time to walk it.
+// Pass the number of items as the argument, the default is 100000.
+class SHAMapTiming_test : public beast::unit_test::suite
+{
+public:
+    void run ()
+    {
+        int count = 100000;
+        if (!arg ().empty ())
+            count = beast::lexicalCastThrow <int> (arg ());
+
+        testcase ("walk " + std::to_string (count) + " items");
+
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        beast::Journal const j;
+        FullBelowCache fullBelowCache ("test.timing_full_below", clock);
+        TreeNodeCache treeNodeCache ("test.timing_cache", 65536, 60, clock, j);
+        NodeStore::DummyScheduler scheduler;
+        auto db = NodeStore::Manager::instance().make_Database (
+            "test", scheduler, j, 0, parseDelimitedKeyValueString("type=memory|Path=SHAMap_timing"));
+
+        SHAMap sMap (smtFREE, fullBelowCache, treeNodeCache,
+            *db, SHAMap_test::Handler(), beast::Journal());
+        {
+            std::vector<SHAMapItem::pointer> items;
+            items.reserve (count);
+            for (int v = 0; v < count; ++v)
+                items.push_back (SHAMap_test::makeItem (v));
+            sMap.addGiveItems (items, false, false);
+        }
+
+        // A branch is a hash and a child pointer. Before inner nodes kept
+        // only their populated branches, every node held sixteen inline.
+        std::size_t const branchSize =
+            sizeof (uint256) + sizeof (SHAMapTreeNode::pointer);
+        std::size_t nodes = 0;
+        std::size_t branches = 0;
+        sMap.visitNodes ([&] (SHAMapTreeNode& node)
+        {
+            ++nodes;
+            if (node.isInner ())
+                branches += node.getBranchCount ();
+            return false;
+        });
+
+        std::size_t const sparse =
+            nodes * sizeof (SHAMapTreeNode) + branches * branchSize;
+        std::size_t const dense = nodes * (sizeof (SHAMapTreeNode) -
+            sizeof (std::vector<int>) + 16 * branchSize);
+        log << "node size: " << sizeof (SHAMapTreeNode) << " bytes, " <<
+            nodes << " nodes";
+        log << "tree nodes: " << (sparse >> 20) << "MB, with sixteen " <<
+            "branches per node: " << (dense >> 20) << "MB";
+        expect (sparse < dense);
+
+        using time = std::chrono::steady_clock;
+        auto ms = [] (time::time_point start)
+        {
+            return std::chrono::duration_cast <std::chrono::milliseconds> (
+                time::now () - start).count ();
+        };
+
+        int const passes = 5;
+        std::size_t leaves = 0;
+        auto start = time::now ();
+        for (int i = 0; i < passes; ++i)
+            sMap.visitLeaves ([&leaves] (SHAMapItem::ref) { ++leaves; });
+        log << "visitLeaves, " << passes << " passes: " << ms (start) << "ms";
+        expect (leaves == std::size_t (passes) * count);
+
+        std::vector<SHAMapMissingNode> missing;
+        start = time::now ();
+        for (int i = 0; i < passes; ++i)
+            sMap.walkMap (missing, 16);
+        log << "walkMap, " << passes << " passes: " << ms (start) << "ms";
+        expect (missing.empty ());
     }
 };
 
 BEAST_DEFINE_TESTSUITE(SHAMap,ripple_app,ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(SHAMapTiming,ripple_app,ripple);
 
 } // ripple
@@ -20,6 +20,10 @@
 #include <BeastConfig.h>
 
 #include <ripple/app/consensus/LedgerConsensus.cpp>
+#include <ripple/app/consensus/tests/ApplyTransactions.test.cpp>
+#include <ripple/app/peers/AcquireScheduler.cpp>
+#include <ripple/app/peers/tests/AcquireScheduler.test.cpp>
 #include <ripple/app/peers/PeerSet.cpp>
 #include <ripple/app/ledger/LedgerCleaner.cpp>
 #include <ripple/app/ledger/LedgerMaster.cpp>
+#include <ripple/app/ledger/TransactionIndexer.cpp>
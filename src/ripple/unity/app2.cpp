@@ -24,6 +24,7 @@
 #include <ripple/app/data/SqliteDatabase.cpp>
 #ifdef USE_MYSQL
 #include <ripple/app/data/MySQLDatabase.cpp>
+#include <ripple/app/data/tests/MySQLDatabase.test.cpp>
 #endif
 #include <ripple/app/data/NullDatabase.cpp>
 #include <ripple/app/data/DBInit.cpp>
@@ -25,4 +25,8 @@
 #include <ripple/app/misc/Validations.cpp>
 #include <ripple/app/misc/FeeVoteImpl.cpp>
 #include <ripple/app/misc/DividendVoteImpl.cpp>
+#include <ripple/app/misc/DividendIndex.cpp>
 #include <ripple/app/misc/DividendMasterImpl.cpp>
+#include <ripple/app/misc/tests/DividendApply.test.cpp>
+#include <ripple/app/misc/tests/DividendIndex.test.cpp>
+#include <ripple/app/misc/tests/DividendMaster.test.cpp>
@@ -25,6 +25,8 @@
 #include <ripple/app/ledger/OrderBookIterator.cpp>
 #include <ripple/app/consensus/DisputedTx.cpp>
 #include <ripple/app/misc/HashRouter.cpp>
+#include <ripple/app/misc/SignatureVerifier.cpp>
+#include <ripple/app/misc/tests/SignatureVerifier.test.cpp>
 #include <ripple/app/paths/AccountCurrencies.cpp>
 #include <ripple/app/paths/Credit.cpp>
 #include <ripple/app/paths/FindPaths.cpp>
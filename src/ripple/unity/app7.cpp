@@ -24,4 +24,8 @@
 #include <ripple/app/tx/TransactionAcquire.cpp>
 #include <ripple/app/tx/LocalTxs.cpp>
 #include <ripple/app/misc/DefaultMissingNodeHandler.cpp>
+#include <ripple/app/misc/FetchPackTuner.cpp>
+#include <ripple/app/misc/FetchPackWriter.cpp>
+#include <ripple/app/misc/tests/FetchPackTuner.test.cpp>
+#include <ripple/app/misc/tests/FetchPackWriter.test.cpp>
 #include <ripple/app/misc/NetworkOPs.cpp>
@@ -25,5 +25,7 @@
 #include <ripple/core/impl/LoadMonitor.cpp>
 #include <ripple/core/impl/Job.cpp>
 #include <ripple/core/impl/JobQueue.cpp>
+#include <ripple/core/impl/ParallelFor.cpp>
 
 #include <ripple/core/tests/LoadFeeTrack.test.cpp>
+#include <ripple/core/tests/ParallelFor.test.cpp>
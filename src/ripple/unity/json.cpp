@@ -38,10 +38,12 @@
 #define JSON_ASSERT( condition ) assert( condition );  // @todo <= change this into an exception throw
 #define JSON_ASSERT_MESSAGE( condition, message ) if (!( condition )) throw std::runtime_error( message );
 
+#include <ripple/json/impl/json_arena.cpp>
 #include <ripple/json/impl/json_reader.cpp>
 #include <ripple/json/impl/json_value.cpp>
 #include <ripple/json/impl/json_writer.cpp>
 #include <ripple/json/impl/to_string.cpp>
 #include <ripple/json/impl/JsonPropertyStream.cpp>
 
+#include <ripple/json/tests/JsonArena.test.cpp>
 #include <ripple/json/tests/JsonCpp.test.cpp>